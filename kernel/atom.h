@@ -35,8 +35,9 @@
 
 /* Data types */
 
-/* Forward declaration */
+/* Forward declarations */
 struct atom_tcb;
+struct atom_periodic;
 
 typedef struct atom_tcb
 {
@@ -54,11 +55,38 @@ typedef struct atom_tcb
     /* Queue pointers */
     struct atom_tcb *prev_tcb;    /* Previous TCB in doubly-linked TCB list */
     struct atom_tcb *next_tcb;    /* Next TCB in doubly-linked list */
+    struct atom_tcb **tcb_queue;  /* Queue the TCB is on, NULL if none */
+
+    /* Round-robin data */
+    uint16_t timeslice;           /* Quantum in ticks, 0 = no timeslicing */
+    uint16_t slice_remaining;     /* Ticks left in the current quantum */
 
     /* Suspension data */
     uint8_t suspended;            /* TRUE if task is currently suspended */
     uint8_t suspend_wake_status;  /* Status returned to woken suspend calls */
     ATOM_TIMER *suspend_timo_cb;  /* Callback registered for suspension timeouts */
+    POINTER suspend_data;         /* Object-specific data for direct handoffs */
+
+    /* Termination data */
+    uint8_t terminated;           /* TRUE once the thread has exited */
+    struct atom_tcb *joinSuspQ;   /* Queue of threads waiting to join */
+
+    /* Notification data */
+    uint32_t notify_value;        /* Pending notification count or bits */
+    uint8_t notify_waiting;       /* TRUE if blocked in atomThreadNotifyWait() */
+
+    /* Periodic release data */
+    struct atom_periodic *periodic; /* Release control, NULL if not periodic */
+
+    /* Details used if the earliest-deadline-first class is enabled */
+#ifdef ATOM_EDF
+    uint32_t edf_rel_deadline;    /* Relative deadline in ticks, 0 if not EDF */
+    uint32_t edf_period;          /* Release period in ticks, 0 if sporadic */
+    uint32_t edf_release;         /* Release time of the current job */
+    uint32_t edf_deadline;        /* Absolute deadline of the current job */
+    uint32_t edf_misses;          /* Number of jobs which missed their deadline */
+    uint8_t edf_released;         /* FALSE until the next job is released */
+#endif
 
     /* Details used if thread stack-checking is required */
 #ifdef ATOM_STACK_CHECKING
@@ -96,6 +124,31 @@ extern uint8_t atomOSStarted;
 /* Idle thread priority (lowest) */
 #define IDLE_THREAD_PRIORITY    255
 
+/* Priority level shared by all earliest-deadline-first threads */
+#if defined(ATOM_EDF) && !defined(ATOM_EDF_PRIORITY)
+#define ATOM_EDF_PRIORITY       128
+#endif
+
+/* Default round-robin quantum in ticks for new threads (0 = no timeslicing) */
+#ifndef ATOM_DEFAULT_TIMESLICE
+#define ATOM_DEFAULT_TIMESLICE  1
+#endif
+
+/**
+ * Compiler barrier: the compiler may not move memory accesses across it.
+ * Ports can provide their own in atomport.h. Otherwise GCC-compatible
+ * compilers use an empty asm with a memory clobber, and other compilers
+ * call the empty atomBarrier(), which they must assume may access any
+ * memory.
+ */
+#ifndef ATOM_BARRIER
+#if defined(__GNUC__)
+#define ATOM_BARRIER()          __asm__ __volatile__ ("" ::: "memory")
+#else
+#define ATOM_BARRIER()          atomBarrier ()
+#endif
+#endif
+
 
 /* Function prototypes */
 extern uint8_t atomOSInit (void *idle_thread_stack_top, uint32_t stack_size);
@@ -106,6 +159,8 @@ extern void atomSched (uint8_t timer_tick);
 extern void atomIntEnter (void);
 extern void atomIntExit (uint8_t timer_tick);
 
+extern void atomBarrier (void);
+
 extern uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr);
 extern ATOM_TCB *tcbDequeueHead (ATOM_TCB **tcb_queue_ptr);
 extern ATOM_TCB *tcbDequeueEntry (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr);
@@ -114,6 +169,11 @@ extern ATOM_TCB *tcbDequeuePriority (ATOM_TCB **tcb_queue_ptr, uint8_t priority)
 extern ATOM_TCB *atomCurrentContext (void);
 
 extern uint8_t atomThreadCreate (ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_point)(uint32_t), uint32_t entry_param, void *stack_top, uint32_t stack_size);
+extern uint8_t atomThreadSetPriority (ATOM_TCB *tcb_ptr, uint8_t priority);
+extern uint8_t atomThreadSetTimeslice (ATOM_TCB *tcb_ptr, uint16_t ticks);
+extern uint8_t atomThreadYield (void);
+extern uint8_t atomThreadExit (void);
+extern uint8_t atomThreadJoin (ATOM_TCB *tcb_ptr, int32_t timeout);
 extern uint8_t atomThreadStackCheck (ATOM_TCB *tcb_ptr, uint32_t *used_bytes, uint32_t *free_bytes);
 
 extern void archContextSwitch (ATOM_TCB *old_tcb_ptr, ATOM_TCB *new_tcb_ptr);
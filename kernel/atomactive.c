@@ -0,0 +1,896 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Active object library.
+ *
+ *
+ * This module implements active objects: event-driven components which
+ * each own an event queue and a hierarchical state machine, and which
+ * communicate only by passing events. It has the following features:
+ *
+ * \par Own thread or shared executor
+ * Each active object either has a thread of its own, which blocks on its
+ * event queue, or runs as a run-to-completion task on the shared task
+ * executor (see atomtask.c), needing no stack of its own. Either way
+ * events are processed one at a time to completion, and handlers never
+ * block.
+ *
+ * \par Zero-copy, reference-counted events
+ * Events are allocated from memory pools, filled in once and then treated
+ * as immutable. Only pointers are queued. Each event counts the queues
+ * holding it, and is returned to its pool automatically after the last
+ * active object has processed it. Events which never change can instead
+ * be declared statically, and are never freed.
+ *
+ * \par Publish / subscribe
+ * Active objects subscribe to event signals. Publishing an event posts it
+ * to every subscriber, sharing the one copy.
+ *
+ * \par Hierarchical state machines
+ * Each active object's behaviour is a hierarchical state machine, with
+ * entry and exit actions, initial transitions and event handling inherited
+ * from superstates.
+ *
+ * \par Interrupt-safe calls
+ * Events can be allocated, posted and published from interrupt context.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * atomActiveInit() must be called once, with a table of ATOM_SUBSCR
+ * entries (one per signal) for the subscriber lists. If any active objects
+ * are run as tasks, atomTaskInit() must also be called first.
+ *
+ * Each state is a handler function taking the active object and an
+ * event. It returns ATOM_RET_HANDLED if it handled the event,
+ * ATOM_TRAN(me, target) to take a transition, or ATOM_SUPER(me, parent)
+ * for any event it does not handle, including ATOM_SIG_EMPTY which is used
+ * to discover the state hierarchy. Outermost states have atomActiveTop()
+ * as their parent. ATOM_SIG_ENTRY and ATOM_SIG_EXIT are sent for entry and
+ * exit actions, and ATOM_SIG_INIT asks a composite state for its initial
+ * transition into a substate.
+ *
+ * Active objects are started with atomActiveStart(), passing an initial
+ * pseudostate which returns ATOM_TRAN() to the first state, and storage for
+ * the event queue. To give the object its own thread pass a TCB and stack;
+ * pass a NULL TCB to run it as a task of the given task priority.
+ *
+ * Events are allocated using atomEventNew(), with a signal of
+ * ATOM_SIG_USER or above. Application events embed ATOM_EVENT as their
+ * first member, in pools with blocks large enough to hold them. Events are
+ * sent to one active object using atomActivePost(), or to all subscribers
+ * using atomActivePublish(). An allocated event must be posted or
+ * published, otherwise it is never freed.
+ *
+ * Posting never blocks. If an active object's queue is full the post
+ * fails, and the event is freed if nothing else holds it.
+ *
+ * A transition exits states up to, and enters states down from, the
+ * innermost state which contains both the target and the state handling
+ * the event. States may be nested up to ATOM_ACTIVE_MAX_DEPTH deep.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomactive.h"
+
+
+/* Local data */
+
+/** Registry of started active objects, indexed by ID */
+static ATOM_ACTIVE *active_registry[ATOM_ACTIVE_MAX_OBJECTS];
+
+/** Number of active objects started */
+static uint8_t active_count = 0;
+
+/** Subscriber lists, one entry per signal */
+static ATOM_SUBSCR *subscr_table = NULL;
+static ATOM_SIGNAL subscr_num_signals = 0;
+
+/** Events sent to state handlers for the reserved signals */
+static const ATOM_EVENT reserved_evts[] =
+{
+    { ATOM_SIG_EMPTY, 0, NULL },
+    { ATOM_SIG_ENTRY, 0, NULL },
+    { ATOM_SIG_EXIT, 0, NULL },
+    { ATOM_SIG_INIT, 0, NULL }
+};
+
+
+/* Forward declarations */
+
+static void atomActiveThread (uint32_t param);
+static void atomActiveTaskFunc (POINTER arg);
+static void atomEventGc (ATOM_EVENT *e);
+static void activeDispatch (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static void activeDrill (ATOM_ACTIVE *me);
+static ATOM_STATE activeSuper (ATOM_ACTIVE *me, ATOM_STATE state);
+static uint8_t activePath (ATOM_ACTIVE *me, ATOM_STATE state, ATOM_STATE *path);
+static void activeEnter (ATOM_ACTIVE *me, ATOM_STATE *path, uint8_t depth);
+static void activeUnregister (ATOM_ACTIVE *me);
+
+
+/**
+ * \b atomActiveInit
+ *
+ * Initialises the active object library.
+ *
+ * Must be called once, before any active objects are started. The table
+ * holds the subscriber list of each signal from 0 to \c num_signals - 1,
+ * and is cleared here.
+ *
+ * @param[in] table Subscriber table storage, one entry per signal
+ * @param[in] num_signals Number of signals in the table
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomActiveInit (ATOM_SUBSCR *table, ATOM_SIGNAL num_signals)
+{
+    uint8_t status;
+    ATOM_SIGNAL sig;
+
+    /* Check parameters */
+    if ((table == NULL) || (num_signals <= ATOM_SIG_USER))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Clear the subscriber lists */
+        for (sig = 0; sig < num_signals; sig++)
+        {
+            table[sig] = 0;
+        }
+        subscr_table = table;
+        subscr_num_signals = num_signals;
+        active_count = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomActiveStart
+ *
+ * Starts an active object.
+ *
+ * The initial pseudostate is called to find the first state, which is
+ * entered (along with any initial transitions into its substates) before
+ * this function returns. The object's thread is then created, or its task
+ * initialised, ready to process events.
+ *
+ * The object is registered before the initial pseudostate is called, so
+ * the initial transition and entry actions may subscribe to signals. If
+ * the object cannot be started it is removed again, along with any such
+ * subscriptions.
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] initial Initial pseudostate handler
+ * @param[in] queue_buff Storage for the event queue
+ * @param[in] queue_len Number of events the queue can hold
+ * @param[in] tcb_ptr TCB for the object's own thread, or NULL to run as a task
+ * @param[in] priority Thread priority, or task priority if run as a task
+ * @param[in] stack_top Top of the thread's stack area (own thread only)
+ * @param[in] stack_size Size of the stack area in bytes (own thread only)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters, or no initial transition
+ * @retval ATOM_ERR_OVF Too many active objects
+ * @retval ATOM_ERROR Problem creating the queue, thread or task
+ */
+uint8_t atomActiveStart (ATOM_ACTIVE *me, ATOM_STATE initial, ATOM_EVENT **queue_buff, uint8_t queue_len, ATOM_TCB *tcb_ptr, uint8_t priority, void *stack_top, uint32_t stack_size)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_STATE path[ATOM_ACTIVE_MAX_DEPTH];
+    ATOM_STATE target;
+    uint8_t depth;
+
+    /* Check parameters */
+    if ((me == NULL) || (initial == NULL) || (queue_buff == NULL)
+        || (queue_len == 0) || (subscr_table == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /**
+         * Register the object first, so that it can subscribe to events
+         * from its initial transition and entry actions.
+         */
+        CRITICAL_START ();
+        if (active_count >= ATOM_ACTIVE_MAX_OBJECTS)
+        {
+            /* No room in the registry */
+            status = ATOM_ERR_OVF;
+        }
+        else
+        {
+            me->id = active_count++;
+            active_registry[me->id] = me;
+            status = ATOM_OK;
+        }
+        CRITICAL_END ();
+
+        if (status == ATOM_OK)
+        {
+            if (atomQueueCreate (&me->queue, (uint8_t *)queue_buff,
+                    sizeof(ATOM_EVENT *), queue_len) != ATOM_OK)
+            {
+                /* Queue creation failed */
+                status = ATOM_ERROR;
+            }
+            else if (initial (me, &reserved_evts[ATOM_SIG_INIT]) != ATOM_RET_TRAN)
+            {
+                /* Initial pseudostate must transition to the first state */
+                status = ATOM_ERR_PARAM;
+            }
+            else
+            {
+                /* Take the initial transition from the top state */
+                target = me->temp;
+                me->tcb_ptr = tcb_ptr;
+                me->state = atomActiveTop;
+                depth = activePath (me, target, path);
+                activeEnter (me, path, depth - 1);
+                me->state = target;
+                activeDrill (me);
+
+                /* Create the thread or task which processes events */
+                if (tcb_ptr)
+                {
+                    status = (atomThreadCreate (tcb_ptr, priority, atomActiveThread,
+                                  (uint32_t)me, stack_top, stack_size) == ATOM_OK)
+                        ? ATOM_OK : ATOM_ERROR;
+                }
+                else
+                {
+                    status = (atomTaskCreate (&me->task, priority, atomActiveTaskFunc,
+                                  (POINTER)me) == ATOM_OK) ? ATOM_OK : ATOM_ERROR;
+                }
+            }
+
+            /* Undo the registration if the object could not be started */
+            if (status != ATOM_OK)
+            {
+                activeUnregister (me);
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomActivePost
+ *
+ * Posts an event to an active object.
+ *
+ * The event is queued by reference, without copying. It must not be
+ * modified after posting. If the queue is full the post fails, and an
+ * event from a pool is freed if nothing else holds it.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] e Pointer to event
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK The active object's queue is full
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomActivePost (ATOM_ACTIVE *me, ATOM_EVENT *e)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((me == NULL) || (e == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Count the reference held by the queue */
+        if (e->pool)
+        {
+            CRITICAL_START ();
+            e->refs++;
+            CRITICAL_END ();
+        }
+
+        /* Queue the event pointer, never blocking */
+        status = atomQueuePut (&me->queue, -1, (uint8_t *)&e);
+        if (status != ATOM_OK)
+        {
+            /* Not queued, drop the reference */
+            atomEventGc (e);
+        }
+        else if (me->tcb_ptr == NULL)
+        {
+            /* Run the object's task once for the event */
+            (void)atomTaskPost (&me->task);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomActivePublish
+ *
+ * Publishes an event to all active objects subscribed to its signal.
+ *
+ * The event is shared by all subscribers without copying. It must not be
+ * modified after publishing. An event from a pool is freed once every
+ * subscriber has processed it, or immediately if there are none.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] e Pointer to event
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_WOULDBLOCK A subscriber's queue was full
+ */
+uint8_t atomActivePublish (ATOM_EVENT *e)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t id;
+    ATOM_SUBSCR subscribers;
+
+    /* Check parameters */
+    if ((e == NULL) || (e->sig >= subscr_num_signals))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Hold a reference so the event survives until all posts are made */
+        if (e->pool)
+        {
+            CRITICAL_START ();
+            e->refs++;
+            CRITICAL_END ();
+        }
+
+        /* Post to each subscriber */
+        status = ATOM_OK;
+        subscribers = subscr_table[e->sig];
+        for (id = 0; subscribers; id++, subscribers >>= 1)
+        {
+            if ((subscribers & 1) && active_registry[id]
+                && (atomActivePost (active_registry[id], e) != ATOM_OK))
+            {
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+
+        /* Drop our reference, freeing the event if no one took it */
+        atomEventGc (e);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomActiveSubscribe
+ *
+ * Subscribes an active object to events published with a signal.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] me Pointer to started active object
+ * @param[in] sig Signal to subscribe to
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters, or object not started
+ */
+uint8_t atomActiveSubscribe (ATOM_ACTIVE *me, ATOM_SIGNAL sig)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((me == NULL) || (sig < ATOM_SIG_USER) || (sig >= subscr_num_signals))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((me->id >= active_count) || (active_registry[me->id] != me))
+    {
+        /* Not a started active object */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Add to the subscriber list */
+        CRITICAL_START ();
+        subscr_table[sig] |= ((ATOM_SUBSCR)1 << me->id);
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomActiveUnsubscribe
+ *
+ * Unsubscribes an active object from events published with a signal.
+ *
+ * Events already queued to the object are still delivered.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] me Pointer to started active object
+ * @param[in] sig Signal to unsubscribe from
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters, or object not started
+ */
+uint8_t atomActiveUnsubscribe (ATOM_ACTIVE *me, ATOM_SIGNAL sig)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((me == NULL) || (sig < ATOM_SIG_USER) || (sig >= subscr_num_signals))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((me->id >= active_count) || (active_registry[me->id] != me))
+    {
+        /* Not a started active object */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Remove from the subscriber list */
+        CRITICAL_START ();
+        subscr_table[sig] &= ~((ATOM_SUBSCR)1 << me->id);
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomActiveTop
+ *
+ * The top state, which contains all other states and ignores all events.
+ * Outermost application states return ATOM_SUPER(me, atomActiveTop).
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] e Pointer to event
+ *
+ * @retval ATOM_RET_IGNORED Always
+ */
+uint8_t atomActiveTop (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    /* Compiler warnings */
+    me = me;
+    e = e;
+
+    return (ATOM_RET_IGNORED);
+}
+
+
+/**
+ * \b atomEventNew
+ *
+ * Allocates an event from a memory pool.
+ *
+ * The event's signal is set and it holds no references. Application data
+ * following the ATOM_EVENT header should be filled in before the event is
+ * posted or published, after which it must not be modified.
+ *
+ * Depending on the \c timeout value specified the call will do one of the
+ * following if the pool is empty:
+ *
+ * \c timeout == 0 : Call will block until a block is free \n
+ * \c timeout > 0 : Call will block until a block is free or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the pool is empty \n
+ *
+ * This function can be called from interrupt context with \c timeout -1.
+ *
+ * @param[in] pool Pointer to memory pool
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] sig Event signal
+ * @param[out] evt_ptr Pointer to which the event pointer is written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT The pool was empty until the timeout
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 and the pool empty
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_CONTEXT Attempt to block from interrupt context
+ */
+uint8_t atomEventNew (ATOM_MEMPOOL *pool, int32_t timeout, ATOM_SIGNAL sig, ATOM_EVENT **evt_ptr)
+{
+    uint8_t status;
+    POINTER block;
+
+    /* Check parameters */
+    if ((pool == NULL) || (evt_ptr == NULL) || (sig < ATOM_SIG_USER)
+        || (pool->block_size < sizeof(ATOM_EVENT)))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Allocate the block */
+        status = atomMemPoolAlloc (pool, timeout, &block);
+        if (status == ATOM_OK)
+        {
+            /* Initialise the event header */
+            *evt_ptr = (ATOM_EVENT *)block;
+            (*evt_ptr)->sig = sig;
+            (*evt_ptr)->refs = 0;
+            (*evt_ptr)->pool = pool;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomEventGc
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Drops a reference to an event, returning it to its pool when no
+ * references remain. Static events are left alone.
+ *
+ * @param[in] e Pointer to event
+ *
+ * @return None
+ */
+static void atomEventGc (ATOM_EVENT *e)
+{
+    CRITICAL_STORE;
+    uint8_t free_it;
+
+    if (e->pool)
+    {
+        /* Drop the reference */
+        CRITICAL_START ();
+        if (e->refs > 0)
+        {
+            e->refs--;
+        }
+        free_it = (e->refs == 0) ? TRUE : FALSE;
+        CRITICAL_END ();
+
+        /* Return to the pool after the last reference */
+        if (free_it == TRUE)
+        {
+            (void)atomMemPoolFree (e->pool, (POINTER)e);
+        }
+    }
+}
+
+
+/**
+ * \b atomActiveThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for active objects with their own thread. Processes events
+ * from the object's queue, one at a time, forever.
+ *
+ * @param[in] param Pointer to the active object
+ *
+ * @return None
+ */
+static void atomActiveThread (uint32_t param)
+{
+    ATOM_ACTIVE *me;
+    ATOM_EVENT *e;
+
+    /* Get the active object */
+    me = (ATOM_ACTIVE *)param;
+
+    /* Loop forever */
+    while (1)
+    {
+        /* Wait for an event, dispatch it and drop its reference */
+        if (atomQueueGet (&me->queue, 0, (uint8_t *)&e) == ATOM_OK)
+        {
+            activeDispatch (me, e);
+            atomEventGc (e);
+        }
+    }
+}
+
+
+/**
+ * \b atomActiveTaskFunc
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Task function for active objects run on the shared executor. The task
+ * is posted once for each event queued, so processes one event per run.
+ *
+ * @param[in] arg Pointer to the active object
+ *
+ * @return None
+ */
+static void atomActiveTaskFunc (POINTER arg)
+{
+    ATOM_ACTIVE *me;
+    ATOM_EVENT *e;
+
+    /* Get the active object */
+    me = (ATOM_ACTIVE *)arg;
+
+    /* Dispatch the next event and drop its reference */
+    if (atomQueueGet (&me->queue, -1, (uint8_t *)&e) == ATOM_OK)
+    {
+        activeDispatch (me, e);
+        atomEventGc (e);
+    }
+}
+
+
+/**
+ * \b activeDispatch
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Dispatches an event to an active object's state machine. The event is
+ * offered to the current state and then its superstates until one handles
+ * it. If a transition is taken, states are exited up to the innermost
+ * state containing both the handling state and the target, and entered
+ * down to the target, followed by any initial transitions.
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] e Pointer to event
+ *
+ * @return None
+ */
+static void activeDispatch (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    ATOM_STATE path[ATOM_ACTIVE_MAX_DEPTH];
+    ATOM_STATE state, source, target, lca;
+    uint8_t ret, depth, i;
+
+    /* Offer the event to the current state and then its superstates */
+    state = me->state;
+    do
+    {
+        source = state;
+        ret = state (me, e);
+        state = me->temp;
+    } while (ret == ATOM_RET_SUPER);
+
+    /* Take any transition */
+    if (ret == ATOM_RET_TRAN)
+    {
+        /* Find the path from the target up to the top state */
+        target = me->temp;
+        depth = activePath (me, target, path);
+
+        /**
+         * The LCA is the innermost proper superstate of the target which
+         * is also the source or one of its superstates. For a transition
+         * to self this exits and re-enters the source.
+         */
+        lca = atomActiveTop;
+        for (i = 1; i < depth; i++)
+        {
+            for (state = source; state && (state != path[i]); )
+            {
+                state = activeSuper (me, state);
+            }
+            if (state)
+            {
+                lca = path[i];
+                break;
+            }
+        }
+
+        /* Exit from the current state up to the LCA */
+        state = me->state;
+        while (state && (state != lca))
+        {
+            (void)state (me, &reserved_evts[ATOM_SIG_EXIT]);
+            state = activeSuper (me, state);
+        }
+
+        /* Enter from below the LCA down to the target */
+        activeEnter (me, path, i);
+        me->state = target;
+
+        /* Follow initial transitions into substates */
+        activeDrill (me);
+    }
+}
+
+
+/**
+ * \b activeDrill
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Follows initial transitions from the current state down into its
+ * substates, entering each state on the way.
+ *
+ * @param[in] me Pointer to active object
+ *
+ * @return None
+ */
+static void activeDrill (ATOM_ACTIVE *me)
+{
+    ATOM_STATE path[ATOM_ACTIVE_MAX_DEPTH];
+    ATOM_STATE target;
+    uint8_t depth, i;
+
+    while (me->state (me, &reserved_evts[ATOM_SIG_INIT]) == ATOM_RET_TRAN)
+    {
+        /* Enter from below the current state down to the target */
+        target = me->temp;
+        depth = activePath (me, target, path);
+        for (i = 0; (i < depth) && (path[i] != me->state); i++)
+        {
+            /* Find the current state in the path */
+        }
+        activeEnter (me, path, i);
+        me->state = target;
+    }
+}
+
+
+/**
+ * \b activeSuper
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Finds the superstate of a state.
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] state State handler
+ *
+ * @return Superstate handler, or NULL for the top state
+ */
+static ATOM_STATE activeSuper (ATOM_ACTIVE *me, ATOM_STATE state)
+{
+    return ((state (me, &reserved_evts[ATOM_SIG_EMPTY]) == ATOM_RET_SUPER)
+        ? me->temp : NULL);
+}
+
+
+/**
+ * \b activePath
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Finds the path from a state up to the top state.
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] state Innermost state of the path
+ * @param[out] path Storage for ATOM_ACTIVE_MAX_DEPTH states, innermost first
+ *
+ * @return Number of states in the path
+ */
+static uint8_t activePath (ATOM_ACTIVE *me, ATOM_STATE state, ATOM_STATE *path)
+{
+    uint8_t depth;
+
+    depth = 0;
+    while (state && (depth < ATOM_ACTIVE_MAX_DEPTH))
+    {
+        path[depth++] = state;
+        state = activeSuper (me, state);
+    }
+
+    return (depth);
+}
+
+
+/**
+ * \b activeEnter
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Enters the states of a path from outermost to innermost.
+ *
+ * @param[in] me Pointer to active object
+ * @param[in] path States, innermost first
+ * @param[in] depth Number of states from the start of the path to enter
+ *
+ * @return None
+ */
+static void activeEnter (ATOM_ACTIVE *me, ATOM_STATE *path, uint8_t depth)
+{
+    while (depth > 0)
+    {
+        depth--;
+        (void)path[depth] (me, &reserved_evts[ATOM_SIG_ENTRY]);
+    }
+}
+
+
+/**
+ * \b activeUnregister
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes an active object which failed to start from the registry, along
+ * with any subscriptions it made from its initial transition. The ID is
+ * only reused if no other object has been registered since.
+ *
+ * @param[in] me Pointer to active object
+ *
+ * @return None
+ */
+static void activeUnregister (ATOM_ACTIVE *me)
+{
+    CRITICAL_STORE;
+    ATOM_SIGNAL sig;
+
+    CRITICAL_START ();
+    for (sig = 0; sig < subscr_num_signals; sig++)
+    {
+        subscr_table[sig] &= ~((ATOM_SUBSCR)1 << me->id);
+    }
+    active_registry[me->id] = NULL;
+    if (me->id == (active_count - 1))
+    {
+        active_count--;
+    }
+    CRITICAL_END ();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_ACTIVE_H
+#define __ATOM_ACTIVE_H
+
+#include "atomqueue.h"
+#include "atommempool.h"
+#include "atomtask.h"
+
+/* Maximum number of active objects which can be started (up to 32) */
+#ifndef ATOM_ACTIVE_MAX_OBJECTS
+#define ATOM_ACTIVE_MAX_OBJECTS     8
+#endif
+
+/* Maximum nesting depth of states, including the top state */
+#ifndef ATOM_ACTIVE_MAX_DEPTH
+#define ATOM_ACTIVE_MAX_DEPTH       6
+#endif
+
+/* Event signal type */
+typedef uint16_t ATOM_SIGNAL;
+
+/* Reserved signals */
+#define ATOM_SIG_EMPTY      0   /* Asks a state for its superstate */
+#define ATOM_SIG_ENTRY      1   /* State entry action */
+#define ATOM_SIG_EXIT       2   /* State exit action */
+#define ATOM_SIG_INIT       3   /* State initial transition */
+#define ATOM_SIG_USER       4   /* First signal for application use */
+
+/* Subscriber list entry, one bit per active object */
+typedef uint32_t ATOM_SUBSCR;
+
+typedef struct atom_event
+{
+    ATOM_SIGNAL     sig;        /* Event signal */
+    uint8_t         refs;       /* Number of queues holding the event */
+    ATOM_MEMPOOL *  pool;       /* Pool the event came from, NULL if static */
+} ATOM_EVENT;
+
+/* State handler return values */
+#define ATOM_RET_HANDLED    0   /* Event handled */
+#define ATOM_RET_IGNORED    1   /* Event ignored (top state only) */
+#define ATOM_RET_TRAN       2   /* Transition taken, target in temp */
+#define ATOM_RET_SUPER      3   /* Pass to the superstate, held in temp */
+
+/* Forward declaration */
+struct atom_active;
+
+/* State handler prototype */
+typedef uint8_t ( * ATOM_STATE ) ( struct atom_active *me, const ATOM_EVENT *e ) ;
+
+/* State handler return helpers */
+#define ATOM_TRAN(me, target)   ((me)->temp = (ATOM_STATE)(target), ATOM_RET_TRAN)
+#define ATOM_SUPER(me, parent)  ((me)->temp = (ATOM_STATE)(parent), ATOM_RET_SUPER)
+
+typedef struct atom_active
+{
+    ATOM_STATE      state;      /* Current (leaf) state */
+    ATOM_STATE      temp;       /* Transition target or superstate */
+    ATOM_QUEUE      queue;      /* Event queue, of ATOM_EVENT pointers */
+    ATOM_TCB *      tcb_ptr;    /* Own thread, or NULL if run as a task */
+    ATOM_TASK       task;       /* Task used on the shared executor */
+    uint8_t         id;         /* Index in the active object registry */
+} ATOM_ACTIVE;
+
+extern uint8_t atomActiveInit (ATOM_SUBSCR *subscr_table, ATOM_SIGNAL num_signals);
+extern uint8_t atomActiveStart (ATOM_ACTIVE *me, ATOM_STATE initial, ATOM_EVENT **queue_buff, uint8_t queue_len, ATOM_TCB *tcb_ptr, uint8_t priority, void *stack_top, uint32_t stack_size);
+extern uint8_t atomActivePost (ATOM_ACTIVE *me, ATOM_EVENT *e);
+extern uint8_t atomActivePublish (ATOM_EVENT *e);
+extern uint8_t atomActiveSubscribe (ATOM_ACTIVE *me, ATOM_SIGNAL sig);
+extern uint8_t atomActiveUnsubscribe (ATOM_ACTIVE *me, ATOM_SIGNAL sig);
+extern uint8_t atomActiveTop (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+extern uint8_t atomEventNew (ATOM_MEMPOOL *pool, int32_t timeout, ATOM_SIGNAL sig, ATOM_EVENT **evt_ptr);
+
+#endif /* __ATOM_ACTIVE_H */
@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * CPU budget library.
+ *
+ *
+ * This module implements per-thread execution-time budgets, which bound
+ * the CPU time a thread can take in each replenishment period regardless
+ * of its priority. It is only available when ATOM_CPU_BUDGETS is defined
+ * in the architecture port. It has the following features:
+ *
+ * \par Tick-based accounting
+ * Each system tick is charged to the thread that was running when the
+ * tick occurred. Budgets are replenished to their full value at the end of
+ * each period, in the style of a deferrable server.
+ *
+ * \par Enforcement on exhaustion
+ * When a thread uses its whole budget it is either demoted to a
+ * background priority, where it only runs when nothing more important is
+ * ready, or suspended outright. Its original priority or ready state is
+ * restored at the next replenishment.
+ *
+ * \par Exhaustion callback
+ * An optional callback is made each time a budget runs out, so that the
+ * application can log or otherwise handle the overrun.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A budget is attached to a thread using atomBudgetCreate(), with the
+ * budget and period in system ticks and the action to take on exhaustion.
+ * The first period starts immediately. atomBudgetGet() reads the budget
+ * remaining in the current period and the number of exhaustions so far,
+ * and atomBudgetDelete() removes the budget, restoring the thread if the
+ * exhaustion action is in force.
+ *
+ * Budgets must be deleted before their threads exit. A thread should only
+ * have one budget attached, and should not have its priority changed by
+ * other means while it is demoted.
+ *
+ * The exhaustion callback is made from the timer tick interrupt with the
+ * kernel's critical section held. It must be short, and may only call the
+ * kernel APIs which can be used from interrupt context.
+ *
+ * Accounting is at system tick resolution: a thread running for less than
+ * a tick between ticks is not charged, while a thread running when the
+ * tick occurs is charged the whole tick.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atombudget.h"
+
+
+#ifdef ATOM_CPU_BUDGETS
+
+
+/* Local data */
+
+/** List of active budgets */
+static ATOM_BUDGET *budget_list = NULL;
+
+
+/* Forward declarations */
+
+static void atomBudgetRestore (ATOM_BUDGET *budget_ptr);
+
+
+/**
+ * \b atomBudgetCreate
+ *
+ * Attaches a CPU budget to a thread.
+ *
+ * The thread may run for \c budget ticks in each period of \c period
+ * ticks. Once exhausted it is demoted to \c demote_priority or suspended,
+ * according to \c action, until the start of the next period.
+ *
+ * The ATOM_BUDGET structure must remain in existence until the budget is
+ * deleted.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] budget_ptr Pointer to budget object
+ * @param[in] tcb_ptr Pointer to the thread's TCB
+ * @param[in] budget Execution ticks allowed per period
+ * @param[in] period Replenishment period in ticks
+ * @param[in] action ATOM_BUDGET_DEMOTE or ATOM_BUDGET_SUSPEND
+ * @param[in] demote_priority Priority while demoted (ATOM_BUDGET_DEMOTE only)
+ * @param[in] exhausted_cb Callback on exhaustion, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomBudgetCreate (ATOM_BUDGET *budget_ptr, ATOM_TCB *tcb_ptr, uint32_t budget, uint32_t period, uint8_t action, uint8_t demote_priority, void (*exhausted_cb)(ATOM_TCB *))
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_BUDGET *next_ptr;
+
+    /* Check parameters */
+    if ((budget_ptr == NULL) || (tcb_ptr == NULL) || (budget == 0)
+        || (budget > period)
+        || ((action != ATOM_BUDGET_DEMOTE) && (action != ATOM_BUDGET_SUSPEND)))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Set up the budget */
+        budget_ptr->tcb_ptr = tcb_ptr;
+        budget_ptr->budget = budget;
+        budget_ptr->period = period;
+        budget_ptr->remaining = budget;
+        budget_ptr->replenish_ticks = period;
+        budget_ptr->exhaustions = 0;
+        budget_ptr->exhausted_cb = exhausted_cb;
+        budget_ptr->action = action;
+        budget_ptr->demote_priority = demote_priority;
+        budget_ptr->exhausted = FALSE;
+
+        /* Protect the budget list */
+        CRITICAL_START ();
+
+        /* Check the budget is not already active */
+        status = ATOM_OK;
+        for (next_ptr = budget_list; next_ptr; next_ptr = next_ptr->next_budget)
+        {
+            if (next_ptr == budget_ptr)
+            {
+                status = ATOM_ERR_PARAM;
+                break;
+            }
+        }
+
+        /* Add to the head of the list */
+        if (status == ATOM_OK)
+        {
+            budget_ptr->next_budget = budget_list;
+            budget_list = budget_ptr;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomBudgetDelete
+ *
+ * Removes a CPU budget from its thread.
+ *
+ * If the thread is currently demoted or suspended due to exhaustion it is
+ * restored. If called at thread context then the scheduler will be called
+ * during this function which may schedule in the restored thread depending
+ * on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] budget_ptr Pointer to budget object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_NOT_FOUND Budget is not active
+ */
+uint8_t atomBudgetDelete (ATOM_BUDGET *budget_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t restore;
+    ATOM_BUDGET *prev_ptr, *next_ptr;
+
+    /* Check parameters */
+    if (budget_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect the budget list */
+        CRITICAL_START ();
+
+        /* Find and unlink the budget */
+        status = ATOM_ERR_NOT_FOUND;
+        restore = FALSE;
+        prev_ptr = NULL;
+        for (next_ptr = budget_list; next_ptr; next_ptr = next_ptr->next_budget)
+        {
+            if (next_ptr == budget_ptr)
+            {
+                if (prev_ptr == NULL)
+                {
+                    budget_list = next_ptr->next_budget;
+                }
+                else
+                {
+                    prev_ptr->next_budget = next_ptr->next_budget;
+                }
+
+                /* Restore the thread if the exhaustion action is in force */
+                if (budget_ptr->exhausted == TRUE)
+                {
+                    budget_ptr->exhausted = FALSE;
+                    atomBudgetRestore (budget_ptr);
+                    restore = TRUE;
+                }
+
+                status = ATOM_OK;
+                break;
+            }
+            prev_ptr = next_ptr;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((restore == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomBudgetGet
+ *
+ * Reads the state of a CPU budget.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] budget_ptr Pointer to budget object
+ * @param[out] remaining Execution ticks left in the current period, or NULL
+ * @param[out] exhaustions Number of periods the budget ran out, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomBudgetGet (ATOM_BUDGET *budget_ptr, uint32_t *remaining, uint32_t *exhaustions)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if (budget_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Take a consistent copy */
+        CRITICAL_START ();
+        if (remaining)
+        {
+            *remaining = budget_ptr->remaining;
+        }
+        if (exhaustions)
+        {
+            *exhaustions = budget_ptr->exhaustions;
+        }
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomBudgetTick
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Called by atomIntExit() on each system tick, while still in interrupt
+ * context. Replenishes any budgets whose period has ended, and charges
+ * the tick to the thread that was running. If that exhausts its budget
+ * the exhaustion action is applied, for the scheduler to act on when it
+ * is called next by atomIntExit().
+ *
+ * Threads which were already suspending themselves when the tick occurred
+ * are not charged, so that the action is never applied to a thread which
+ * is blocked on some other kernel object.
+ *
+ * @param[in] curr_tcb_ptr Pointer to the interrupted thread's TCB
+ *
+ * @return None
+ */
+void atomBudgetTick (ATOM_TCB *curr_tcb_ptr)
+{
+    CRITICAL_STORE;
+    ATOM_BUDGET *budget_ptr;
+
+    /* Protect the budget list and OS queues */
+    CRITICAL_START ();
+
+    for (budget_ptr = budget_list; budget_ptr; budget_ptr = budget_ptr->next_budget)
+    {
+        /* Replenish at the end of each period */
+        if (--budget_ptr->replenish_ticks == 0)
+        {
+            budget_ptr->replenish_ticks = budget_ptr->period;
+            budget_ptr->remaining = budget_ptr->budget;
+            if (budget_ptr->exhausted == TRUE)
+            {
+                budget_ptr->exhausted = FALSE;
+                atomBudgetRestore (budget_ptr);
+            }
+        }
+
+        /* Charge the running thread */
+        if ((budget_ptr->tcb_ptr == curr_tcb_ptr)
+            && (curr_tcb_ptr->suspended == FALSE)
+            && (budget_ptr->exhausted == FALSE)
+            && (--budget_ptr->remaining == 0))
+        {
+            /* Budget exhausted, apply the action */
+            budget_ptr->exhausted = TRUE;
+            budget_ptr->exhaustions++;
+            if (budget_ptr->action == ATOM_BUDGET_DEMOTE)
+            {
+                /* Running, so not on any queue which needs re-sorting */
+                budget_ptr->base_priority = curr_tcb_ptr->priority;
+                curr_tcb_ptr->priority = budget_ptr->demote_priority;
+            }
+            else
+            {
+                /**
+                 * Not on any queue, so the scheduler will switch it out
+                 * and nothing else can make it ready until we do.
+                 */
+                curr_tcb_ptr->suspended = TRUE;
+            }
+
+            /* Notify the application */
+            if (budget_ptr->exhausted_cb)
+            {
+                budget_ptr->exhausted_cb (curr_tcb_ptr);
+            }
+        }
+    }
+
+    /* Exit critical region */
+    CRITICAL_END ();
+}
+
+
+/**
+ * \b atomBudgetRestore
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Undoes the exhaustion action of a budget, restoring the thread's
+ * original priority or putting it back on the ready queue. Does not call
+ * the scheduler. Must be called with the critical section held.
+ *
+ * @param[in] budget_ptr Pointer to budget object
+ *
+ * @return None
+ */
+static void atomBudgetRestore (ATOM_BUDGET *budget_ptr)
+{
+    ATOM_TCB *tcb_ptr;
+    ATOM_TCB **tcb_queue_ptr;
+
+    tcb_ptr = budget_ptr->tcb_ptr;
+    if (budget_ptr->action == ATOM_BUDGET_DEMOTE)
+    {
+        /* Restore the priority, re-sorting the thread if it is queued */
+        tcb_queue_ptr = tcb_ptr->tcb_queue;
+        if (tcb_queue_ptr)
+        {
+            (void)tcbDequeueEntry (tcb_queue_ptr, tcb_ptr);
+            tcb_ptr->priority = budget_ptr->base_priority;
+            (void)tcbEnqueuePriority (tcb_queue_ptr, tcb_ptr);
+        }
+        else
+        {
+            tcb_ptr->priority = budget_ptr->base_priority;
+        }
+    }
+    else
+    {
+        /* Make the thread ready again */
+        (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
+    }
+}
+
+
+#endif /* ATOM_CPU_BUDGETS */
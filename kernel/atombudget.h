@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_BUDGET_H
+#define __ATOM_BUDGET_H
+
+#ifdef ATOM_CPU_BUDGETS
+
+/* Actions taken when a thread exhausts its budget */
+#define ATOM_BUDGET_DEMOTE      1   /* Drop to a background priority */
+#define ATOM_BUDGET_SUSPEND     2   /* Stop running until replenished */
+
+typedef struct atom_budget
+{
+    ATOM_TCB *  tcb_ptr;        /* Thread the budget applies to */
+    uint32_t    budget;         /* Execution ticks allowed per period */
+    uint32_t    period;         /* Replenishment period in ticks */
+    uint32_t    remaining;      /* Execution ticks left this period */
+    uint32_t    replenish_ticks;/* Ticks until the next replenishment */
+    uint32_t    exhaustions;    /* Number of periods the budget ran out */
+    void        (*exhausted_cb)(ATOM_TCB *); /* Callback on exhaustion */
+    uint8_t     action;         /* ATOM_BUDGET_DEMOTE or ATOM_BUDGET_SUSPEND */
+    uint8_t     demote_priority;/* Priority while demoted */
+    uint8_t     base_priority;  /* Priority to restore on replenishment */
+    uint8_t     exhausted;      /* TRUE while the action is in force */
+    struct atom_budget *next_budget; /* Next budget on the active list */
+} ATOM_BUDGET;
+
+extern uint8_t atomBudgetCreate (ATOM_BUDGET *budget_ptr, ATOM_TCB *tcb_ptr, uint32_t budget, uint32_t period, uint8_t action, uint8_t demote_priority, void (*exhausted_cb)(ATOM_TCB *));
+extern uint8_t atomBudgetDelete (ATOM_BUDGET *budget_ptr);
+extern uint8_t atomBudgetGet (ATOM_BUDGET *budget_ptr, uint32_t *remaining, uint32_t *exhaustions);
+
+/* Kernel tick hook, not for use by application code */
+extern void atomBudgetTick (ATOM_TCB *curr_tcb_ptr);
+
+#endif /* ATOM_CPU_BUDGETS */
+
+#endif /* __ATOM_BUDGET_H */
@@ -0,0 +1,640 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Condition variable library.
+ *
+ *
+ * This module implements condition variables, used together with an
+ * ATOM_MUTEX to wait for a change to some shared state. It has the
+ * following features:
+ *
+ * \par Atomic release and wait
+ * A waiting thread releases the mutex and joins the condition's wait
+ * queue in a single critical region. A signal sent after the mutex is
+ * released can therefore never be missed, unlike with a separate
+ * semaphore and mutex.
+ *
+ * \par Mutex reacquired on wake
+ * Woken threads reacquire the mutex before returning, whatever the reason
+ * for waking, and their recursive lock count is restored. The caller can
+ * re-check the shared state straight away.
+ *
+ * \par Single-pass broadcast
+ * A broadcast moves every waiting thread to the ready queue in one
+ * critical region and calls the scheduler once.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are waiting on a condition, atomCondSignal() wakes
+ * the highest priority thread. Where multiple threads of the same priority
+ * are waiting, they are woken in FIFO order.
+ *
+ * \par Interrupt-safe calls
+ * atomCondSignal() and atomCondBroadcast() can be called from interrupt
+ * context. atomCondWait() must be called by a thread which owns the mutex.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All condition objects must be initialised before use by calling
+ * atomCondCreate(). A thread waits for the condition by locking the mutex
+ * which protects the shared state, checking the state, and calling
+ * atomCondWait() if it must wait. Because other threads may run between
+ * the wakeup and the mutex being reacquired, the state should always be
+ * checked again in a loop:
+ *
+ * \code
+ * atomMutexGet (&mutex, 0);
+ * while (!ready)
+ *     atomCondWait (&cond, &mutex, 0);
+ * ...
+ * atomMutexPut (&mutex);
+ * \endcode
+ *
+ * A thread which changes the state calls atomCondSignal() to wake one
+ * waiting thread, or atomCondBroadcast() to wake all of them, normally
+ * while holding the mutex.
+ *
+ * A condition which is no longer required can be deleted using
+ * atomCondDelete(). This function automatically wakes up any threads which
+ * are waiting on the deleted condition.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomcond.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct cond_timer
+{
+    ATOM_TCB *tcb_ptr;      /* Thread which is suspended with timeout */
+    ATOM_COND *cond_ptr;    /* Condition the thread is suspended on */
+} COND_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t condWake (ATOM_COND *cond, uint8_t wake_status, uint8_t all, uint8_t *woken);
+static void condMutexRelease (ATOM_MUTEX *mutex);
+static void atomCondTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomCondCreate
+ *
+ * Initialises a condition object.
+ *
+ * Must be called before calling any other condition library routines on a
+ * condition. Objects can be deleted later using atomCondDelete().
+ *
+ * Does not allocate storage, the caller provides the condition object.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cond Pointer to condition object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomCondCreate (ATOM_COND *cond)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (cond == NULL)
+    {
+        /* Bad condition pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Initialise the suspended threads queue */
+        cond->suspQ = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCondDelete
+ *
+ * Deletes a condition object.
+ *
+ * Any threads waiting on the condition are woken and return
+ * ATOM_ERR_DELETED (after reacquiring their mutex). If called at thread
+ * context then the scheduler will be called during this function which
+ * may schedule in one of the woken threads depending on relative
+ * priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cond Pointer to condition object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomCondDelete (ATOM_COND *cond)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Parameter check */
+    if (cond == NULL)
+    {
+        /* Bad condition pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Wake all waiting threads */
+        CRITICAL_START ();
+        status = condWake (cond, ATOM_ERR_DELETED, TRUE, &woken);
+        CRITICAL_END ();
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCondWait
+ *
+ * Releases a mutex and waits on a condition.
+ *
+ * The calling thread must own \c mutex. The mutex is released completely
+ * (whatever its recursive lock count) in the same critical region as the
+ * thread starts waiting, so no signal can be lost in between. Depending on
+ * the \c timeout value specified the call will do one of the following:
+ *
+ * \c timeout == 0 : Call will block until the condition is signalled \n
+ * \c timeout > 0 : Call will block until the condition is signalled or the specified timeout \n
+ * \c timeout == -1 : Return immediately with ATOM_WOULDBLOCK, still holding the mutex \n
+ *
+ * When woken, for any reason, the thread reacquires the mutex (blocking
+ * indefinitely if necessary) and its recursive lock count is restored
+ * before returning. The timeout only applies to the wait on the condition.
+ *
+ * This function can only be called from thread context.
+ *
+ * @param[in] cond Pointer to condition object
+ * @param[in] mutex Pointer to mutex object owned by the caller
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Condition was not signalled before the timeout
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1
+ * @retval ATOM_ERR_DELETED Condition was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context
+ * @retval ATOM_ERR_OWNERSHIP Mutex not owned by the calling thread
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomCondWait (ATOM_COND *cond, ATOM_MUTEX *mutex, int32_t timeout)
+{
+    CRITICAL_STORE;
+    uint8_t status, mutex_status;
+    uint8_t lock_count;
+    COND_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((cond == NULL) || (mutex == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Get the current TCB */
+        curr_tcb_ptr = atomCurrentContext();
+
+        /* Protect access to the condition, mutex and OS queues */
+        CRITICAL_START ();
+
+        if (curr_tcb_ptr == NULL)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Not currently in thread context, can't suspend */
+            status = ATOM_ERR_CONTEXT;
+        }
+        else if (mutex->owner != curr_tcb_ptr)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* The caller must hold the mutex */
+            status = ATOM_ERR_OWNERSHIP;
+        }
+        else if (timeout < 0)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* timeout == -1, cannot block */
+            status = ATOM_WOULDBLOCK;
+        }
+        else if (tcbEnqueuePriority (&cond->suspQ, curr_tcb_ptr) != ATOM_OK)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* There was an error putting this thread on the suspend list */
+            status = ATOM_ERR_QUEUE;
+        }
+        else
+        {
+            /* Set suspended status for the current thread */
+            curr_tcb_ptr->suspended = TRUE;
+            curr_tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Track errors */
+            status = ATOM_OK;
+
+            /* Register a timer callback if requested */
+            if (timeout)
+            {
+                /* Fill out the data needed by the callback to wake us up */
+                timer_data.tcb_ptr = curr_tcb_ptr;
+                timer_data.cond_ptr = cond;
+
+                /* Fill out the timer callback request structure */
+                timer_cb.cb_func = atomCondTimerCallback;
+                timer_cb.cb_data = (POINTER)&timer_data;
+                timer_cb.cb_ticks = timeout;
+
+                /**
+                 * Store the timer details in the TCB so that we can
+                 * cancel the timer callback if the condition is signalled
+                 * before the timeout occurs.
+                 */
+                curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                /* Register a callback on timeout */
+                if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                {
+                    /* Timer registration failed */
+                    status = ATOM_ERR_TIMER;
+
+                    /* Clean up and return to the caller, still owning the mutex */
+                    (void)tcbDequeueEntry (&cond->suspQ, curr_tcb_ptr);
+                    curr_tcb_ptr->suspended = FALSE;
+                    curr_tcb_ptr->suspend_timo_cb = NULL;
+                }
+            }
+
+            /* Exit critical region */
+            if (status != ATOM_OK)
+            {
+                CRITICAL_END ();
+            }
+            else
+            {
+                /**
+                 * Release the mutex entirely while still in the critical
+                 * region, remembering the recursive lock count so that it
+                 * can be restored once the mutex is reacquired.
+                 */
+                lock_count = mutex->count;
+                condMutexRelease (mutex);
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Current thread now blocking, schedule in a new one */
+                atomSched (FALSE);
+
+                /**
+                 * Signals will set ATOM_OK status, while timeouts will set
+                 * ATOM_TIMEOUT and condition deletions will set
+                 * ATOM_ERR_DELETED.
+                 */
+                status = curr_tcb_ptr->suspend_wake_status;
+
+                /* Reacquire the mutex, however we were woken */
+                mutex_status = atomMutexGet (mutex, 0);
+                if (mutex_status != ATOM_OK)
+                {
+                    /* Could not reacquire (e.g. mutex deleted) */
+                    status = mutex_status;
+                }
+                else
+                {
+                    /* Restore the recursive lock count */
+                    CRITICAL_START ();
+                    mutex->count = lock_count;
+                    CRITICAL_END ();
+                }
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCondSignal
+ *
+ * Wakes one thread waiting on a condition.
+ *
+ * The highest priority waiting thread is woken, or the longest waiting
+ * one where several of the same priority are waiting. Does nothing if no
+ * threads are waiting. If called at thread context then the scheduler
+ * will be called during this function which may schedule in the woken
+ * thread depending on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cond Pointer to condition object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on the woken thread
+ */
+uint8_t atomCondSignal (ATOM_COND *cond)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Parameter check */
+    if (cond == NULL)
+    {
+        /* Bad condition pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Wake the first waiting thread */
+        CRITICAL_START ();
+        status = condWake (cond, ATOM_OK, FALSE, &woken);
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCondBroadcast
+ *
+ * Wakes all threads waiting on a condition.
+ *
+ * All waiting threads are moved to the ready queue in a single critical
+ * region, and the scheduler is called only once. The woken threads then
+ * reacquire the mutex in priority order. Does nothing if no threads are
+ * waiting.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cond Pointer to condition object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomCondBroadcast (ATOM_COND *cond)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Parameter check */
+    if (cond == NULL)
+    {
+        /* Bad condition pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Wake all waiting threads in one pass */
+        CRITICAL_START ();
+        status = condWake (cond, ATOM_OK, TRUE, &woken);
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b condWake
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Moves the first, or all, of the threads waiting on a condition to the
+ * ready queue, cancelling their timeouts. Must be called with the critical
+ * section held.
+ *
+ * @param[in] cond Pointer to condition object
+ * @param[in] wake_status Status returned to the woken threads
+ * @param[in] all TRUE to wake all waiting threads, FALSE for just the first
+ * @param[out] woken Set to TRUE if any threads were woken
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+static uint8_t condWake (ATOM_COND *cond, uint8_t wake_status, uint8_t all, uint8_t *woken)
+{
+    uint8_t status;
+    ATOM_TCB *tcb_ptr;
+
+    status = ATOM_OK;
+    *woken = FALSE;
+    while ((tcb_ptr = tcbDequeueHead (&cond->suspQ)) != NULL)
+    {
+        /* Set the status to be returned to the waiting thread */
+        tcb_ptr->suspend_wake_status = wake_status;
+
+        /* Put the thread on the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+        {
+            /* There was a problem putting the thread on the ready queue */
+            status = ATOM_ERR_QUEUE;
+            break;
+        }
+        *woken = TRUE;
+
+        /* If there's a timeout on this suspension, cancel it */
+        if (tcb_ptr->suspend_timo_cb)
+        {
+            if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+            {
+                /* There was a problem cancelling a timeout */
+                status = ATOM_ERR_TIMER;
+            }
+
+            /* Flag as no timeout registered */
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+
+        /* Stop after the first thread unless broadcasting */
+        if (all == FALSE)
+        {
+            break;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b condMutexRelease
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Releases a mutex owned by the current thread regardless of its recursive
+ * lock count. If threads are waiting for the mutex, ownership is handed to
+ * the first of them in the same way as atomMutexPut(). Must be called with
+ * the critical section held, and does not call the scheduler.
+ *
+ * @param[in] mutex Pointer to mutex object
+ */
+static void condMutexRelease (ATOM_MUTEX *mutex)
+{
+    ATOM_TCB *tcb_ptr;
+
+    /* Relinquish ownership */
+    mutex->owner = NULL;
+    mutex->count = 0;
+
+    /* If any threads are blocking on the mutex, hand it to the first */
+    tcb_ptr = tcbDequeueHead (&mutex->suspQ);
+    if (tcb_ptr)
+    {
+        /**
+         * The new owner increments the lock count itself when it resumes
+         * in atomMutexGet().
+         */
+        tcb_ptr->suspend_wake_status = ATOM_OK;
+        mutex->owner = tcb_ptr;
+        (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
+
+        /* If there's a timeout on this suspension, cancel it */
+        if (tcb_ptr->suspend_timo_cb)
+        {
+            (void)atomTimerCancel (tcb_ptr->suspend_timo_cb);
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+    }
+}
+
+
+/**
+ * \b atomCondTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c COND_TIMER object which is used to retrieve the
+ * condition details.
+ *
+ * @param[in] cb_data Pointer to a COND_TIMER object
+ */
+static void atomCondTimerCallback (POINTER cb_data)
+{
+    COND_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the COND_TIMER structure pointer */
+    timer_data_ptr = (COND_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the condition's suspend list */
+        (void)tcbDequeueEntry (&timer_data_ptr->cond_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Cyclic executive library.
+ *
+ *
+ * This module implements a time-triggered cyclic executive, for
+ * subsystems which must run to a static schedule rather than in response
+ * to events. It has the following features:
+ *
+ * \par Static schedule table
+ * The schedule is a major frame of a fixed number of ticks, divided into
+ * slots at fixed tick offsets. Each slot activates a thread, calls a
+ * callback, or both. The frame repeats until stopped.
+ *
+ * \par Tick-accurate activation
+ * The frame clock is a kernel timer, driven by atomTimerTick(). Slot
+ * callbacks run directly from the timer tick interrupt, and slot threads
+ * are woken from it, so with the highest priorities in the system they
+ * start on the exact tick of their slot.
+ *
+ * \par Slot completion checking
+ * A thread activated by a slot must finish its work before the next slot
+ * starts. If it has not, the overrun is counted and reported through an
+ * optional callback.
+ *
+ * \par Coexistence with the scheduler
+ * Slot threads are ordinary threads. Background work runs in threads of
+ * lower priority, using the time left over in each frame.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * The application provides a table of ATOM_CYCLIC_SLOT entries sorted by
+ * increasing offset, all less than the frame length, and creates the
+ * executive with atomCyclicCreate(). The table is not copied and must
+ * remain in existence while the executive is in use.
+ *
+ * Slot threads should be created at higher priorities than any other
+ * threads. Each loops calling atomCyclicWait(), which marks its previous
+ * slot's work as complete and blocks until its next slot:
+ *
+ * \code
+ * while (atomCyclicWait(&cyc) == ATOM_OK)
+ * {
+ *     do_slot_work();
+ * }
+ * \endcode
+ *
+ * atomCyclicStart() starts the first frame on the next system tick, and
+ * atomCyclicStop() stops the schedule, after which atomCyclicWait()
+ * returns ATOM_ERR_DELETED.
+ *
+ * Activation uses the thread notification mechanism (ATOM_NOTIFY_COUNT
+ * mode), so slot threads should not also be sent notifications for other
+ * purposes.
+ *
+ * Slot and overrun callbacks run in interrupt context, and may only call
+ * the kernel APIs which can be used from interrupt context.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomcyclic.h"
+#include "atomnotify.h"
+#include "atomtimer.h"
+
+
+/* Forward declarations */
+
+static void atomCyclicTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomCyclicCreate
+ *
+ * Initialises a cyclic executive.
+ *
+ * The schedule table must contain at least one slot, sorted by strictly
+ * increasing offset, with all offsets less than \c frame_ticks. Each slot
+ * must have a thread, a callback or both.
+ *
+ * @param[in] cyc_ptr Pointer to cyclic executive object
+ * @param[in] slots Schedule table
+ * @param[in] num_slots Number of slots in the table
+ * @param[in] frame_ticks Length of the major frame in ticks
+ * @param[in] overrun_cb Called with the slot index on overruns, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomCyclicCreate (ATOM_CYCLIC *cyc_ptr, const ATOM_CYCLIC_SLOT *slots, uint8_t num_slots, uint32_t frame_ticks, void (*overrun_cb)(uint8_t))
+{
+    uint8_t status;
+    uint8_t slot;
+
+    /* Check parameters */
+    if ((cyc_ptr == NULL) || (slots == NULL) || (num_slots == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Check the schedule table */
+        status = ATOM_OK;
+        for (slot = 0; slot < num_slots; slot++)
+        {
+            if ((slots[slot].offset >= frame_ticks)
+                || ((slot > 0) && (slots[slot].offset <= slots[slot - 1].offset))
+                || ((slots[slot].tcb_ptr == NULL) && (slots[slot].cb_func == NULL)))
+            {
+                /* Bad slot */
+                status = ATOM_ERR_PARAM;
+                break;
+            }
+        }
+
+        /* Set up the executive */
+        if (status == ATOM_OK)
+        {
+            cyc_ptr->slots = slots;
+            cyc_ptr->num_slots = num_slots;
+            cyc_ptr->next_slot = 0;
+            cyc_ptr->running = FALSE;
+            cyc_ptr->frame_ticks = frame_ticks;
+            cyc_ptr->active_tcb = NULL;
+            cyc_ptr->overrun_cb = overrun_cb;
+            cyc_ptr->frames = 0;
+            cyc_ptr->overruns = 0;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicStart
+ *
+ * Starts a cyclic executive.
+ *
+ * The first major frame starts on the next system tick.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cyc_ptr Pointer to cyclic executive object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters or already running
+ * @retval ATOM_ERR_TIMER Problem registering the frame clock
+ */
+uint8_t atomCyclicStart (ATOM_CYCLIC *cyc_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((cyc_ptr == NULL) || (cyc_ptr->running == TRUE))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect against the frame clock */
+        CRITICAL_START ();
+
+        /* Start from the first slot of a new frame */
+        cyc_ptr->next_slot = 0;
+        cyc_ptr->active_tcb = NULL;
+
+        /* Fire the first slot at its offset from the next tick */
+        cyc_ptr->timer.cb_func = atomCyclicTimerCallback;
+        cyc_ptr->timer.cb_data = (POINTER)cyc_ptr;
+        cyc_ptr->timer.cb_ticks = cyc_ptr->slots[0].offset + 1;
+        if (atomTimerRegister (&cyc_ptr->timer) != ATOM_OK)
+        {
+            /* Timer registration failed */
+            status = ATOM_ERR_TIMER;
+        }
+        else
+        {
+            cyc_ptr->running = TRUE;
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicStop
+ *
+ * Stops a cyclic executive.
+ *
+ * No further slots are fired. All slot threads are woken, and they and
+ * any later calls to atomCyclicWait() return ATOM_ERR_DELETED.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cyc_ptr Pointer to cyclic executive object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters or not running
+ */
+uint8_t atomCyclicStop (ATOM_CYCLIC *cyc_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t slot;
+
+    /* Check parameters */
+    if ((cyc_ptr == NULL) || (cyc_ptr->running == FALSE))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Stop the frame clock */
+        CRITICAL_START ();
+        cyc_ptr->running = FALSE;
+        (void)atomTimerCancel (&cyc_ptr->timer);
+        CRITICAL_END ();
+
+        /* Wake the slot threads so they see the executive has stopped */
+        for (slot = 0; slot < cyc_ptr->num_slots; slot++)
+        {
+            if (cyc_ptr->slots[slot].tcb_ptr)
+            {
+                (void)atomThreadNotify (cyc_ptr->slots[slot].tcb_ptr, ATOM_NOTIFY_COUNT, 0);
+            }
+        }
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicWait
+ *
+ * Completes the calling thread's slot work and waits for its next slot.
+ *
+ * If the calling thread was activated by the current slot, its work is
+ * marked complete so that no overrun is recorded when the next slot
+ * starts. If a later slot activated the thread before it got here, that
+ * activation starts immediately.
+ *
+ * Must only be called from thread context.
+ *
+ * @param[in] cyc_ptr Pointer to cyclic executive object
+ *
+ * @retval ATOM_OK Success, the thread's next slot has started
+ * @retval ATOM_ERR_CONTEXT Not called from thread context
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_DELETED The executive was stopped
+ */
+uint8_t atomCyclicWait (ATOM_CYCLIC *cyc_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint32_t value;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if (cyc_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /**
+         * Mark the current slot complete, unless a later activation is
+         * already pending in which case that slot's work is still to do.
+         */
+        CRITICAL_START ();
+        if ((cyc_ptr->active_tcb == curr_tcb_ptr)
+            && (curr_tcb_ptr->notify_value == 0))
+        {
+            cyc_ptr->active_tcb = NULL;
+        }
+        CRITICAL_END ();
+
+        /* Wait for the next activation */
+        status = atomThreadNotifyWait (0, ATOM_NOTIFY_COUNT, &value);
+        if ((status == ATOM_OK) && (cyc_ptr->running == FALSE))
+        {
+            /* Woken by atomCyclicStop() */
+            status = ATOM_ERR_DELETED;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicStats
+ *
+ * Reads the statistics of a cyclic executive.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] cyc_ptr Pointer to cyclic executive object
+ * @param[out] frames Number of major frames started, or NULL
+ * @param[out] overruns Number of slots not completed in time, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomCyclicStats (ATOM_CYCLIC *cyc_ptr, uint32_t *frames, uint32_t *overruns)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if (cyc_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Take a consistent copy */
+        CRITICAL_START ();
+        if (frames)
+        {
+            *frames = cyc_ptr->frames;
+        }
+        if (overruns)
+        {
+            *overruns = cyc_ptr->overruns;
+        }
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomCyclicTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Frame clock callback, called by the timer system on the tick of each
+ * slot. Re-registers itself for the following slot, checks that the
+ * previous slot's thread completed, then fires the slot.
+ *
+ * @param[in] cb_data Pointer to the cyclic executive object
+ */
+static void atomCyclicTimerCallback (POINTER cb_data)
+{
+    ATOM_CYCLIC *cyc_ptr;
+    const ATOM_CYCLIC_SLOT *slot_ptr;
+    uint8_t slot, overrun;
+    CRITICAL_STORE;
+
+    /* Get the executive pointer */
+    cyc_ptr = (ATOM_CYCLIC *)cb_data;
+
+    /* Check parameter is valid */
+    if (cyc_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Check we were not stopped while the tick was in progress */
+        slot_ptr = NULL;
+        slot = 0;
+        overrun = FALSE;
+        if (cyc_ptr->running == TRUE)
+        {
+            /* Find this slot and move on to the next */
+            slot = cyc_ptr->next_slot;
+            slot_ptr = &cyc_ptr->slots[slot];
+            if (slot == 0)
+            {
+                cyc_ptr->frames++;
+            }
+            if (++cyc_ptr->next_slot >= cyc_ptr->num_slots)
+            {
+                /* Wrap to the first slot of the next frame */
+                cyc_ptr->next_slot = 0;
+                cyc_ptr->timer.cb_ticks = cyc_ptr->frame_ticks - slot_ptr->offset
+                    + cyc_ptr->slots[0].offset;
+            }
+            else
+            {
+                cyc_ptr->timer.cb_ticks = cyc_ptr->slots[cyc_ptr->next_slot].offset
+                    - slot_ptr->offset;
+            }
+
+            /* Re-register first, to keep the frame clock exact */
+            (void)atomTimerRegister (&cyc_ptr->timer);
+
+            /* Check the previous slot's thread has completed */
+            if (cyc_ptr->active_tcb)
+            {
+                cyc_ptr->overruns++;
+                overrun = TRUE;
+            }
+            cyc_ptr->active_tcb = slot_ptr->tcb_ptr;
+
+            /* Previous slot index, for reporting overruns */
+            slot = (slot == 0) ? (cyc_ptr->num_slots - 1) : (slot - 1);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Report overruns and fire the slot outside the critical region */
+        if (slot_ptr)
+        {
+            if ((overrun == TRUE) && cyc_ptr->overrun_cb)
+            {
+                cyc_ptr->overrun_cb (slot);
+            }
+            if (slot_ptr->cb_func)
+            {
+                slot_ptr->cb_func (slot_ptr->cb_data);
+            }
+            if (slot_ptr->tcb_ptr)
+            {
+                (void)atomThreadNotify (slot_ptr->tcb_ptr, ATOM_NOTIFY_COUNT, 0);
+            }
+        }
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_CYCLIC_H
+#define __ATOM_CYCLIC_H
+
+#include "atomtimer.h"
+
+typedef struct atom_cyclic_slot
+{
+    uint32_t    offset;         /* Tick offset of the slot within the frame */
+    ATOM_TCB *  tcb_ptr;        /* Thread to activate, or NULL */
+    TIMER_CB_FUNC cb_func;      /* Callback to call, or NULL */
+    POINTER     cb_data;        /* Parameter passed to the callback */
+} ATOM_CYCLIC_SLOT;
+
+typedef struct atom_cyclic
+{
+    const ATOM_CYCLIC_SLOT *slots; /* Schedule table, in offset order */
+    uint8_t     num_slots;      /* Number of slots in the table */
+    uint8_t     next_slot;      /* Index of the next slot to fire */
+    uint8_t     running;        /* TRUE while the schedule is running */
+    uint32_t    frame_ticks;    /* Length of the major frame in ticks */
+    ATOM_TCB *  active_tcb;     /* Thread activated by the current slot */
+    void        (*overrun_cb)(uint8_t); /* Called with an overrunning slot */
+    uint32_t    frames;         /* Number of major frames started */
+    uint32_t    overruns;       /* Number of slots not completed in time */
+    ATOM_TIMER  timer;          /* Frame clock timer */
+} ATOM_CYCLIC;
+
+extern uint8_t atomCyclicCreate (ATOM_CYCLIC *cyc_ptr, const ATOM_CYCLIC_SLOT *slots, uint8_t num_slots, uint32_t frame_ticks, void (*overrun_cb)(uint8_t));
+extern uint8_t atomCyclicStart (ATOM_CYCLIC *cyc_ptr);
+extern uint8_t atomCyclicStop (ATOM_CYCLIC *cyc_ptr);
+extern uint8_t atomCyclicWait (ATOM_CYCLIC *cyc_ptr);
+extern uint8_t atomCyclicStats (ATOM_CYCLIC *cyc_ptr, uint32_t *frames, uint32_t *overruns);
+
+#endif /* __ATOM_CYCLIC_H */
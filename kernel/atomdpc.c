@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Deferred procedure call library.
+ *
+ *
+ * This module allows interrupt handlers to defer work to a kernel thread
+ * which runs as soon as the interrupt handler returns, ahead of all
+ * application threads. Interrupt handlers can then be kept to a minimum
+ * (acknowledging the device and capturing data), without dedicating an
+ * application thread and stack to each device. It has the following
+ * features:
+ *
+ * \par No allocation
+ * Each deferred procedure call (DPC) is described by an ATOM_DPC object
+ * which is preallocated by the driver, so queueing one cannot fail for
+ * lack of storage and takes constant time.
+ *
+ * \par Run before application threads
+ * DPCs are run by a single kernel thread, normally at priority 0. Queueing
+ * a DPC readies this thread, so the scheduler call made at the end of the
+ * interrupt handler by atomIntExit() switches straight to it. Interrupts
+ * remain enabled while DPCs run, and further DPCs queued meanwhile are run
+ * in the same pass.
+ *
+ * \par FIFO ordering and coalescing
+ * DPCs run in the order in which they were queued. Queueing a DPC which
+ * is already pending has no further effect, so a burst of interrupts
+ * results in a single call.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * The DPC thread is started by calling atomDpcInit() once, after
+ * atomOSInit(). The caller provides its stack and priority. DPCs share
+ * the thread, so the stack must be sized for the deepest DPC.
+ *
+ * Each ATOM_DPC object is initialised with its procedure and argument by
+ * calling atomDpcCreate(). It can then be queued any number of times using
+ * atomDpcQueue(), from interrupt or thread context. A pending DPC can be
+ * removed from the queue using atomDpcCancel().
+ *
+ * Procedures run in thread context and may make kernel calls, but should
+ * not block for long as this delays all other DPCs.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomdpc.h"
+
+
+/* Local data */
+
+/** DPC thread storage */
+static ATOM_TCB dpc_tcb;
+
+/** Semaphore used to wake the DPC thread */
+static ATOM_SEM dpc_sem;
+
+/** Head and tail of the list of pending DPCs */
+static ATOM_DPC *dpc_head = NULL;
+static ATOM_DPC *dpc_tail = NULL;
+
+
+/* Forward declarations */
+
+static void atomDpcThread (uint32_t param);
+
+
+/**
+ * \b atomDpcInit
+ *
+ * Starts the DPC thread.
+ *
+ * Must be called once, after atomOSInit() and before any DPCs are queued.
+ * The thread is normally given priority 0 so that DPCs run before all
+ * application threads.
+ *
+ * @param[in] stack_top Top of the DPC thread's stack area
+ * @param[in] stack_size Size of the stack area in bytes
+ * @param[in] priority Priority of the DPC thread
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error putting the thread on the ready queue
+ */
+uint8_t atomDpcInit (void *stack_top, uint32_t stack_size, uint8_t priority)
+{
+    uint8_t status;
+
+    /* Initialise the pending list and wakeup semaphore */
+    dpc_head = NULL;
+    dpc_tail = NULL;
+    status = atomSemCreate (&dpc_sem, 0);
+
+    /* Start the DPC thread, which checks the stack parameters */
+    if (status == ATOM_OK)
+    {
+        status = atomThreadCreate (&dpc_tcb, priority, atomDpcThread, 0,
+                     stack_top, stack_size);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDpcCreate
+ *
+ * Initialises a DPC object.
+ *
+ * Must be called before the DPC is queued using atomDpcQueue(), and must
+ * not be called while the DPC is pending.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] dpc Pointer to DPC object
+ * @param[in] func Procedure to call
+ * @param[in] arg Parameter passed to the procedure
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomDpcCreate (ATOM_DPC *dpc, ATOM_DPC_FUNC func, POINTER arg)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((dpc == NULL) || (func == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the procedure details */
+        dpc->func = func;
+        dpc->arg = arg;
+        dpc->pending = FALSE;
+        dpc->next_dpc = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDpcQueue
+ *
+ * Queues a DPC to run on the DPC thread.
+ *
+ * The DPC is added to the end of the pending list, unless it is already
+ * pending in which case the call has no effect. If the list was empty the
+ * DPC thread is woken.
+ *
+ * When called from interrupt context the DPC thread is scheduled in when
+ * the interrupt handler calls atomIntExit(). When called from thread
+ * context it is scheduled in immediately if it has higher priority than
+ * the calling thread.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] dpc Pointer to DPC object
+ *
+ * @retval ATOM_OK Success (including if already pending)
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the DPC thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on the DPC thread
+ */
+uint8_t atomDpcQueue (ATOM_DPC *dpc)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t wake;
+
+    /* Parameter check */
+    if (dpc == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the pending list */
+        CRITICAL_START ();
+
+        /* Append to the pending list unless already on it */
+        wake = FALSE;
+        if (dpc->pending == FALSE)
+        {
+            dpc->pending = TRUE;
+            dpc->next_dpc = NULL;
+            if (dpc_tail)
+            {
+                dpc_tail->next_dpc = dpc;
+            }
+            else
+            {
+                /**
+                 * List was empty, so the DPC thread may be asleep. Only
+                 * post if no wakeup is already outstanding: a DPC which
+                 * requeues itself finds the list empty on every run, and
+                 * the extra posts would otherwise build up in the
+                 * semaphore count until it overflowed.
+                 */
+                dpc_head = dpc;
+                wake = (dpc_sem.count == 0) ? TRUE : FALSE;
+            }
+            dpc_tail = dpc;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Wake the DPC thread on the empty to non-empty transition. It
+         * drains the whole list before sleeping again, so later DPCs need
+         * no wakeup of their own, and one outstanding post is enough.
+         */
+        if (wake == TRUE)
+        {
+            status = atomSemPut (&dpc_sem);
+        }
+        else
+        {
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDpcCancel
+ *
+ * Removes a pending DPC from the queue.
+ *
+ * If the DPC is pending it is removed so that it does not run. This does
+ * not wait for a DPC which is already running to complete.
+ *
+ * This function can be called from interrupt context, but walks the list
+ * of pending DPCs.
+ *
+ * @param[in] dpc Pointer to DPC object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_NOT_FOUND The DPC was not pending
+ */
+uint8_t atomDpcCancel (ATOM_DPC *dpc)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_DPC *prev_ptr, *next_ptr;
+
+    /* Parameter check */
+    if (dpc == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the pending list */
+        CRITICAL_START ();
+
+        /* Default to not found */
+        status = ATOM_ERR_NOT_FOUND;
+
+        /* Find the DPC and its predecessor */
+        if (dpc->pending == TRUE)
+        {
+            prev_ptr = NULL;
+            next_ptr = dpc_head;
+            while (next_ptr && (next_ptr != dpc))
+            {
+                prev_ptr = next_ptr;
+                next_ptr = next_ptr->next_dpc;
+            }
+
+            /* Unlink it */
+            if (next_ptr)
+            {
+                if (prev_ptr)
+                {
+                    prev_ptr->next_dpc = dpc->next_dpc;
+                }
+                else
+                {
+                    dpc_head = dpc->next_dpc;
+                }
+                if (dpc_tail == dpc)
+                {
+                    dpc_tail = prev_ptr;
+                }
+                dpc->pending = FALSE;
+                dpc->next_dpc = NULL;
+
+                /* Successful */
+                status = ATOM_OK;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomDpcThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for the DPC thread. Sleeps until the pending list becomes
+ * non-empty, then runs DPCs in FIFO order until the list is empty.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void atomDpcThread (uint32_t param)
+{
+    CRITICAL_STORE;
+    ATOM_DPC *dpc;
+
+    /* Compiler warning */
+    param = param;
+
+    /* Loop forever */
+    while (1)
+    {
+        /* Wait for DPCs to be queued */
+        (void)atomSemGet (&dpc_sem, 0);
+
+        /* Run DPCs until the list is empty */
+        while (1)
+        {
+            /* Take the head of the list */
+            CRITICAL_START ();
+            dpc = dpc_head;
+            if (dpc)
+            {
+                dpc_head = dpc->next_dpc;
+                if (dpc_head == NULL)
+                {
+                    dpc_tail = NULL;
+                }
+
+                /* Allow the DPC to be queued again while it runs */
+                dpc->pending = FALSE;
+            }
+            CRITICAL_END ();
+
+            /* Quit when there is nothing left to run */
+            if (dpc == NULL)
+            {
+                break;
+            }
+
+            /* Run the procedure with interrupts enabled */
+            dpc->func (dpc->arg);
+        }
+    }
+}
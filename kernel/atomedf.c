@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Earliest-deadline-first scheduling library.
+ *
+ *
+ * This module implements an optional earliest-deadline-first (EDF)
+ * scheduling class, enabled by defining ATOM_EDF in the port or build
+ * options. EDF can schedule sets of deadline-constrained threads at higher
+ * CPU utilisations than fixed priorities, while leaving the fixed-priority
+ * scheduler in charge of all other threads. It has the following
+ * features:
+ *
+ * \par Priority band
+ * All EDF threads run at a single priority level, ATOM_EDF_PRIORITY
+ * (128 unless overridden at build time). Threads of higher priority
+ * preempt EDF threads as normal, and EDF threads preempt threads of lower
+ * priority, so EDF work can be placed anywhere in the system's priority
+ * scheme.
+ *
+ * \par Deadline-ordered queueing
+ * Within the EDF priority level, the ready queue (and any other TCB
+ * queues) are ordered by absolute deadline rather than FIFO, and a thread
+ * which becomes ready with an earlier deadline preempts the running EDF
+ * thread. EDF threads are not timesliced.
+ *
+ * \par Periodic and sporadic threads
+ * Periodic threads are released by the kernel every \c period ticks.
+ * Sporadic threads (with a zero period) are released whenever they are
+ * woken from an OS primitive after finishing a job, for example by an
+ * interrupt handler posting a semaphore.
+ *
+ * \par Deadline-miss counting
+ * Each EDF thread counts the jobs which finished after their deadline.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * Threads are created as normal using atomThreadCreate(), then moved into
+ * the EDF class by calling atomEdfSetParams() with their relative
+ * deadline and period. This releases the first job immediately, with a
+ * deadline \c rel_deadline ticks from now.
+ *
+ * At the end of each job the thread calls atomEdfJobEnd(). Periodic
+ * threads are delayed until their next release, while sporadic threads
+ * should then block waiting for their next event.
+ *
+ * The number of missed deadlines can be read using atomEdfGetMisses().
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomedf.h"
+#include "atomtimer.h"
+
+
+#ifdef ATOM_EDF
+
+
+/**
+ * \b atomEdfSetParams
+ *
+ * Moves a thread into the EDF scheduling class.
+ *
+ * The thread's priority is changed to ATOM_EDF_PRIORITY, timeslicing is
+ * disabled for it, and its first job is released with an absolute
+ * deadline \c rel_deadline ticks from now. Its deadline-miss count is
+ * reset.
+ *
+ * If called at thread context then the scheduler will be called during
+ * this function, which may schedule in the thread depending on relative
+ * priorities and deadlines.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread
+ * @param[in] rel_deadline Deadline of each job in ticks after its release
+ * @param[in] period Release period in ticks (0 = sporadic)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error re-sorting the thread on its queue
+ */
+uint8_t atomEdfSetParams (ATOM_TCB *tcb_ptr, uint32_t rel_deadline, uint32_t period)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((tcb_ptr == NULL) || (rel_deadline == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB */
+        CRITICAL_START ();
+
+        /* Release the first job now */
+        tcb_ptr->edf_rel_deadline = rel_deadline;
+        tcb_ptr->edf_period = period;
+        tcb_ptr->edf_release = atomTimeGet();
+        tcb_ptr->edf_deadline = tcb_ptr->edf_release + rel_deadline;
+        tcb_ptr->edf_released = TRUE;
+        tcb_ptr->edf_misses = 0;
+
+        /* EDF threads are ordered by deadline, not timesliced */
+        tcb_ptr->timeslice = 0;
+        tcb_ptr->slice_remaining = 0;
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Move to the EDF level, re-sorting by deadline and rescheduling */
+        status = atomThreadSetPriority (tcb_ptr, ATOM_EDF_PRIORITY);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomEdfJobEnd
+ *
+ * Ends the calling thread's current job.
+ *
+ * The job is counted as a deadline miss if it finished after its
+ * deadline.
+ *
+ * For periodic threads the next job is released \c period ticks after the
+ * current one, and the call blocks until then. If the next release time
+ * has already passed (the job overran) the call returns immediately with
+ * the next job released.
+ *
+ * For sporadic threads the call returns immediately. The next job is
+ * released (and its deadline set) the next time the thread is made ready,
+ * so the thread should block on an OS primitive after calling this.
+ *
+ * Must only be called from thread context, by an EDF thread.
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_CONTEXT Not called from thread context
+ * @retval ATOM_ERR_PARAM Calling thread is not an EDF thread
+ * @retval ATOM_ERR_TIMER Problem registering the delay to the next release
+ */
+uint8_t atomEdfJobEnd (void)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_TCB *curr_tcb_ptr;
+    uint32_t now;
+    int32_t delay;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check we are an EDF thread */
+    if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else if (curr_tcb_ptr->edf_rel_deadline == 0)
+    {
+        /* Not an EDF thread */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB */
+        CRITICAL_START ();
+
+        /* Count a miss if the job finished after its deadline */
+        now = atomTimeGet();
+        if ((int32_t)(now - curr_tcb_ptr->edf_deadline) > 0)
+        {
+            curr_tcb_ptr->edf_misses++;
+        }
+
+        /* Work out the next release */
+        if (curr_tcb_ptr->edf_period)
+        {
+            /* Periodic: release on the next period boundary */
+            curr_tcb_ptr->edf_release += curr_tcb_ptr->edf_period;
+            curr_tcb_ptr->edf_deadline = curr_tcb_ptr->edf_release
+                                         + curr_tcb_ptr->edf_rel_deadline;
+            curr_tcb_ptr->edf_released = TRUE;
+            delay = (int32_t)(curr_tcb_ptr->edf_release - now);
+        }
+        else
+        {
+            /* Sporadic: release when next made ready */
+            curr_tcb_ptr->edf_released = FALSE;
+            delay = 0;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Wait for the next release if it is in the future */
+        if (delay > 0)
+        {
+            status = atomTimerDelay ((uint32_t)delay);
+        }
+        else
+        {
+            /**
+             * Our deadline may have moved later, so check whether another
+             * EDF thread should now run instead.
+             */
+            atomSched (FALSE);
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomEdfGetMisses
+ *
+ * Reads the deadline-miss count of an EDF thread.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread
+ * @param[out] misses Pointer to which the miss count is written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomEdfGetMisses (ATOM_TCB *tcb_ptr, uint32_t *misses)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((tcb_ptr == NULL) || (misses == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Return the count */
+        *misses = tcb_ptr->edf_misses;
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+#endif /* ATOM_EDF */
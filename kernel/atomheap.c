@@ -0,0 +1,713 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Heap library.
+ *
+ *
+ * This module implements a real-time heap for variable-sized allocations,
+ * using the two-level segregated fit (TLSF) algorithm. It has the following
+ * features:
+ *
+ * \par Deterministic allocation
+ * Free blocks are kept on segregated lists indexed by size class, with
+ * bitmaps recording which lists are non-empty. Allocating and freeing take
+ * a bounded time which does not depend on the number of blocks in the heap
+ * or how fragmented it is.
+ *
+ * \par Bounded fragmentation
+ * Allocations are served by a good fit from the smallest suitable size
+ * class, blocks are split to the requested size, and freed blocks are
+ * immediately merged with free neighbours.
+ *
+ * \par Thread and interrupt safe
+ * Heap operations are protected by short critical regions, so the heap can
+ * be shared between threads and interrupt handlers without a mutex.
+ *
+ * \par Statistics
+ * The number of free bytes, the largest block which could currently be
+ * allocated and the high-water mark of memory in use can be retrieved to
+ * help size the heap.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A heap is initialised by calling atomHeapCreate() with a data area which
+ * it manages. Memory is allocated using atomHeapAlloc() and returned using
+ * atomHeapFree(). Allocations never block: if there is no free block large
+ * enough the call returns ATOM_ERR_OVF immediately. Returned memory is
+ * aligned to the size of a pointer.
+ *
+ * Each block carries a small header, and requests are rounded up to a
+ * multiple of the pointer size (with a minimum of two pointers), so the
+ * heap should be sized with some headroom above the total of the expected
+ * allocations. atomHeapStats() can be used during development to check the
+ * high-water mark.
+ *
+ * The largest size which can be managed is set by ATOM_HEAP_FL_COUNT,
+ * which may be reduced on targets with very little RAM to make the heap
+ * object itself smaller.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "atom.h"
+#include "atomheap.h"
+
+
+/* Local data types */
+
+typedef struct atom_heap_block
+{
+    /* Previous block in memory (NULL for the first block) */
+    struct atom_heap_block *prev_phys;
+
+    /* Size of the block's data area, with HEAP_BLOCK_FREE flag */
+    uint32_t size;
+
+    /* Free list links, only valid while the block is free */
+    struct atom_heap_block *next_free;
+    struct atom_heap_block *prev_free;
+} HEAP_BLOCK;
+
+
+/* Local definitions */
+
+/* Flag in the size field marking a block as free */
+#define HEAP_BLOCK_FREE     1
+
+/* Block data areas are aligned to, and sized in multiples of, a pointer */
+#define HEAP_ALIGN          sizeof(POINTER)
+#define HEAP_ALIGN_LOG2     ((sizeof(POINTER) >= 8) ? 3 : ((sizeof(POINTER) == 4) ? 2 : 1))
+
+/* Size of the block header preceding each data area */
+#define HEAP_HDR_SIZE       ((uint32_t)offsetof(HEAP_BLOCK, next_free))
+
+/* Smallest data area, large enough to hold the free list links */
+#define HEAP_MIN_SIZE       ((uint32_t)sizeof(HEAP_BLOCK) - HEAP_HDR_SIZE)
+
+/* Sizes below this all fall in first-level class 0 */
+#define HEAP_FL_SHIFT       (ATOM_HEAP_SL_LOG2 + HEAP_ALIGN_LOG2)
+#define HEAP_SMALL_SIZE     ((uint32_t)1 << HEAP_FL_SHIFT)
+
+/* Block accessors */
+#define BLOCK_SIZE(b)       ((b)->size & ~(uint32_t)HEAP_BLOCK_FREE)
+#define BLOCK_IS_FREE(b)    ((b)->size & HEAP_BLOCK_FREE)
+#define BLOCK_DATA(b)       ((POINTER)((uint8_t *)(b) + HEAP_HDR_SIZE))
+#define BLOCK_FROM_DATA(p)  ((HEAP_BLOCK *)((uint8_t *)(p) - HEAP_HDR_SIZE))
+#define BLOCK_NEXT_PHYS(b)  ((HEAP_BLOCK *)((uint8_t *)BLOCK_DATA(b) + BLOCK_SIZE(b)))
+
+
+/* Forward declarations */
+
+static uint8_t heap_fls (uint32_t word);
+static uint8_t heap_ffs (uint32_t word);
+static uint8_t heap_mapping (uint32_t size, uint8_t *fl, uint8_t *sl);
+static HEAP_BLOCK *heap_find (ATOM_HEAP *heap, uint32_t size);
+static void heap_insert (ATOM_HEAP *heap, HEAP_BLOCK *block);
+static void heap_remove (ATOM_HEAP *heap, HEAP_BLOCK *block);
+
+
+/**
+ * \b atomHeapCreate
+ *
+ * Initialises a heap object.
+ *
+ * Must be called before calling any other heap library routines on the
+ * heap. The whole data area is placed on the free lists as one block.
+ *
+ * Does not allocate storage, the caller provides the heap object and the
+ * data area to be managed.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[in] buff_ptr Pointer to the data area
+ * @param[in] size Size of the data area in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters, or data area too small or large
+ */
+uint8_t atomHeapCreate (ATOM_HEAP *heap, uint8_t *buff_ptr, uint32_t size)
+{
+    uint8_t status;
+    uint8_t fl, sl;
+    uint32_t skip;
+    HEAP_BLOCK *block;
+
+    /* Parameter check */
+    if ((heap == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Align the start of the data area */
+        skip = (uint32_t)(HEAP_ALIGN - ((uint8_t *)buff_ptr - (uint8_t *)0) % HEAP_ALIGN) % HEAP_ALIGN;
+
+        /* Leave room for the first block's header and the end sentinel */
+        if (size < (skip + (2 * HEAP_HDR_SIZE) + HEAP_MIN_SIZE))
+        {
+            /* Too small to hold any allocations */
+            status = ATOM_ERR_PARAM;
+        }
+        else
+        {
+            size = (size - skip - (2 * HEAP_HDR_SIZE)) & ~(uint32_t)(HEAP_ALIGN - 1);
+
+            /* Check the whole area can be represented in the size classes */
+            if (heap_mapping (size, &fl, &sl) != ATOM_OK)
+            {
+                /* Too large for ATOM_HEAP_FL_COUNT */
+                status = ATOM_ERR_PARAM;
+            }
+            else
+            {
+                /* Clear the free lists */
+                heap->fl_bitmap = 0;
+                for (fl = 0; fl < ATOM_HEAP_FL_COUNT; fl++)
+                {
+                    heap->sl_bitmap[fl] = 0;
+                    for (sl = 0; sl < ATOM_HEAP_SL_COUNT; sl++)
+                    {
+                        heap->free_lists[fl][sl] = NULL;
+                    }
+                }
+
+                /* Create a single free block covering the data area */
+                block = (HEAP_BLOCK *)(buff_ptr + skip);
+                block->prev_phys = NULL;
+                block->size = size;
+                heap->first_block = block;
+
+                /* Terminate the heap with a zero-sized block which is never free */
+                heap->end_block = BLOCK_NEXT_PHYS(block);
+                heap->end_block->prev_phys = block;
+                heap->end_block->size = 0;
+
+                /* Initialise the statistics */
+                heap->total_bytes = size;
+                heap->free_bytes = 0;
+                heap->max_used_bytes = 0;
+
+                /* Make the block available */
+                heap_insert (heap, block);
+
+                /* Successful */
+                status = ATOM_OK;
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomHeapAlloc
+ *
+ * Allocate memory from a heap.
+ *
+ * Finds a free block of at least \c size bytes from the smallest suitable
+ * size class, splits off any excess as a new free block and returns a
+ * pointer to the allocated memory in \c mem_ptr. The call never blocks.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[in] size Number of bytes required
+ * @param[out] mem_ptr Pointer to which the allocated memory will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_OVF No free block large enough
+ */
+uint8_t atomHeapAlloc (ATOM_HEAP *heap, uint32_t size, POINTER *mem_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint32_t used_bytes;
+    HEAP_BLOCK *block, *remain;
+
+    /* Check parameters */
+    if ((heap == NULL) || (mem_ptr == NULL) || (size == 0))
+    {
+        /* Bad parameter */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (size > heap->total_bytes)
+    {
+        /**
+         * Larger than the whole heap. This is checked before rounding up
+         * below, as rounding a size close to 0xFFFFFFFF would wrap it
+         * round to a small request.
+         */
+        status = ATOM_ERR_OVF;
+    }
+    else
+    {
+        /* Round up to the alignment, and to hold the free list links later */
+        if (size < HEAP_MIN_SIZE)
+        {
+            size = HEAP_MIN_SIZE;
+        }
+        size = (size + HEAP_ALIGN - 1) & ~(uint32_t)(HEAP_ALIGN - 1);
+
+        /* Protect access to the heap */
+        CRITICAL_START ();
+
+        /* Find a free block which is guaranteed to be large enough */
+        block = heap_find (heap, size);
+        if (block == NULL)
+        {
+            /* Out of memory, or too large for the heap */
+            status = ATOM_ERR_OVF;
+        }
+        else
+        {
+            /* Take the block off the free lists */
+            heap_remove (heap, block);
+
+            /* Split off the excess if it is large enough to be a block */
+            if (block->size >= (size + HEAP_HDR_SIZE + HEAP_MIN_SIZE))
+            {
+                remain = (HEAP_BLOCK *)((uint8_t *)BLOCK_DATA(block) + size);
+                remain->prev_phys = block;
+                remain->size = block->size - size - HEAP_HDR_SIZE;
+                BLOCK_NEXT_PHYS(remain)->prev_phys = remain;
+                block->size = size;
+                heap_insert (heap, remain);
+            }
+
+            /* Update the high-water mark */
+            used_bytes = heap->total_bytes - heap->free_bytes;
+            if (used_bytes > heap->max_used_bytes)
+            {
+                heap->max_used_bytes = used_bytes;
+            }
+
+            /* Return the data area */
+            *mem_ptr = BLOCK_DATA(block);
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomHeapFree
+ *
+ * Return memory to a heap.
+ *
+ * The memory must have been allocated from the same heap using
+ * atomHeapAlloc(). The block is merged with any free neighbouring blocks
+ * and placed back on the free lists.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[in] mem_ptr Pointer to the memory to free
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter, not from this heap, or already free
+ */
+uint8_t atomHeapFree (ATOM_HEAP *heap, POINTER mem_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    HEAP_BLOCK *block, *neighbour;
+
+    /* Check parameters */
+    if ((heap == NULL) || (mem_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        block = BLOCK_FROM_DATA(mem_ptr);
+
+        /* Protect access to the heap */
+        CRITICAL_START ();
+
+        /* Check the block lies within the heap and is in use */
+        if (((uint8_t *)block < (uint8_t *)heap->first_block)
+            || ((uint8_t *)block >= (uint8_t *)heap->end_block)
+            || BLOCK_IS_FREE(block))
+        {
+            /* Not a block allocated from this heap */
+            status = ATOM_ERR_PARAM;
+        }
+        else
+        {
+            /* Merge with the previous block if it is free */
+            neighbour = block->prev_phys;
+            if ((neighbour != NULL) && BLOCK_IS_FREE(neighbour))
+            {
+                heap_remove (heap, neighbour);
+                neighbour->size += HEAP_HDR_SIZE + block->size;
+                block = neighbour;
+            }
+
+            /* Merge with the next block if it is free */
+            neighbour = BLOCK_NEXT_PHYS(block);
+            if (BLOCK_IS_FREE(neighbour))
+            {
+                heap_remove (heap, neighbour);
+                block->size += HEAP_HDR_SIZE + BLOCK_SIZE(neighbour);
+            }
+
+            /* The following block must now point back at the merged block */
+            BLOCK_NEXT_PHYS(block)->prev_phys = block;
+
+            /* Make it available */
+            heap_insert (heap, block);
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomHeapStats
+ *
+ * Retrieve heap usage statistics.
+ *
+ * The largest free block is found by searching the highest non-empty free
+ * list, so unlike allocation this call takes time proportional to the
+ * number of blocks on that list. It is intended for monitoring rather than
+ * for use on time-critical paths.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[out] stats Pointer to which the statistics will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomHeapStats (ATOM_HEAP *heap, ATOM_HEAP_STATS *stats)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t fl, sl;
+    HEAP_BLOCK *block;
+
+    /* Check parameters */
+    if ((heap == NULL) || (stats == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the heap */
+        CRITICAL_START ();
+
+        stats->free_bytes = heap->free_bytes;
+        stats->used_bytes = heap->total_bytes - heap->free_bytes;
+        stats->max_used_bytes = heap->max_used_bytes;
+        stats->largest_free = 0;
+
+        /* The largest block is on the highest non-empty list */
+        if (heap->fl_bitmap)
+        {
+            fl = heap_fls (heap->fl_bitmap);
+            sl = heap_fls (heap->sl_bitmap[fl]);
+            for (block = heap->free_lists[fl][sl]; block != NULL; block = block->next_free)
+            {
+                if (BLOCK_SIZE(block) > stats->largest_free)
+                {
+                    stats->largest_free = BLOCK_SIZE(block);
+                }
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b heap_fls
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Finds the most significant set bit of a word. The loop is bounded by
+ * the word size, so takes constant worst-case time.
+ *
+ * @param[in] word Non-zero word to search
+ *
+ * @return Bit index (0 = least significant)
+ */
+static uint8_t heap_fls (uint32_t word)
+{
+    uint8_t bit;
+
+    bit = 0;
+    while (word >>= 1)
+    {
+        bit++;
+    }
+
+    return (bit);
+}
+
+
+/**
+ * \b heap_ffs
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Finds the least significant set bit of a word. The loop is bounded by
+ * the word size, so takes constant worst-case time.
+ *
+ * @param[in] word Non-zero word to search
+ *
+ * @return Bit index (0 = least significant)
+ */
+static uint8_t heap_ffs (uint32_t word)
+{
+    uint8_t bit;
+
+    bit = 0;
+    while ((word & 1) == 0)
+    {
+        word >>= 1;
+        bit++;
+    }
+
+    return (bit);
+}
+
+
+/**
+ * \b heap_mapping
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Works out the first and second level list indices for a block size.
+ * Sizes below HEAP_SMALL_SIZE share first-level class 0, divided linearly.
+ * Above that each first-level class covers a power of two range, divided
+ * into ATOM_HEAP_SL_COUNT equal parts.
+ *
+ * @param[in] size Block size
+ * @param[out] fl First level index
+ * @param[out] sl Second level index
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Size is too large for ATOM_HEAP_FL_COUNT
+ */
+static uint8_t heap_mapping (uint32_t size, uint8_t *fl, uint8_t *sl)
+{
+    uint8_t status;
+    uint8_t bit;
+
+    if (size < HEAP_SMALL_SIZE)
+    {
+        *fl = 0;
+        *sl = (uint8_t)(size / (HEAP_SMALL_SIZE / ATOM_HEAP_SL_COUNT));
+    }
+    else
+    {
+        bit = heap_fls (size);
+        *sl = (uint8_t)((size >> (bit - ATOM_HEAP_SL_LOG2)) ^ ATOM_HEAP_SL_COUNT);
+        *fl = (uint8_t)(bit - HEAP_FL_SHIFT + 1);
+    }
+
+    /* Check the class exists */
+    status = (*fl < ATOM_HEAP_FL_COUNT) ? ATOM_OK : ATOM_ERR_PARAM;
+
+    return (status);
+}
+
+
+/**
+ * \b heap_find
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Finds a free block of at least \c size bytes. The size is first rounded
+ * up to the start of the next list, so that any block on that list or a
+ * higher one is large enough and only the list heads need be examined.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[in] size Required block size
+ *
+ * @return Pointer to a suitable free block, or NULL if none
+ */
+static HEAP_BLOCK *heap_find (ATOM_HEAP *heap, uint32_t size)
+{
+    HEAP_BLOCK *block;
+    uint8_t fl, sl;
+    uint32_t sl_map, fl_map;
+
+    /* Default to nothing found */
+    block = NULL;
+
+    /* Round up so that every block on the chosen list fits */
+    if (size >= HEAP_SMALL_SIZE)
+    {
+        size += ((uint32_t)1 << (heap_fls (size) - ATOM_HEAP_SL_LOG2)) - 1;
+    }
+
+    if (heap_mapping (size, &fl, &sl) == ATOM_OK)
+    {
+        /* Look for a non-empty list in this class at or above sl */
+        sl_map = heap->sl_bitmap[fl] & ((uint32_t)0xFF << sl);
+        if (sl_map == 0)
+        {
+            /* None, so use the smallest list in a higher class */
+            fl_map = (fl + 1 < 32) ? (heap->fl_bitmap & ((uint32_t)0xFFFFFFFF << (fl + 1))) : 0;
+            if (fl_map != 0)
+            {
+                fl = heap_ffs (fl_map);
+                sl_map = heap->sl_bitmap[fl];
+            }
+        }
+
+        /* Take the head of the list found */
+        if (sl_map != 0)
+        {
+            block = heap->free_lists[fl][heap_ffs (sl_map)];
+        }
+    }
+
+    return (block);
+}
+
+
+/**
+ * \b heap_insert
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Marks a block free and adds it to the head of the list for its size.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[in] block Block to insert
+ */
+static void heap_insert (ATOM_HEAP *heap, HEAP_BLOCK *block)
+{
+    uint8_t fl, sl;
+
+    /* Find the list (the heap size has already been checked to fit) */
+    block->size &= ~(uint32_t)HEAP_BLOCK_FREE;
+    (void)heap_mapping (block->size, &fl, &sl);
+    heap->free_bytes += block->size;
+    block->size |= HEAP_BLOCK_FREE;
+
+    /* Link onto the head of the list */
+    block->prev_free = NULL;
+    block->next_free = heap->free_lists[fl][sl];
+    if (block->next_free)
+    {
+        block->next_free->prev_free = block;
+    }
+    heap->free_lists[fl][sl] = block;
+
+    /* Flag the list as non-empty */
+    heap->fl_bitmap |= ((uint32_t)1 << fl);
+    heap->sl_bitmap[fl] |= (uint8_t)(1 << sl);
+}
+
+
+/**
+ * \b heap_remove
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes a free block from its list and marks it in use.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] heap Pointer to heap object
+ * @param[in] block Block to remove
+ */
+static void heap_remove (ATOM_HEAP *heap, HEAP_BLOCK *block)
+{
+    uint8_t fl, sl;
+
+    /* Mark in use and find the list it is on */
+    block->size &= ~(uint32_t)HEAP_BLOCK_FREE;
+    (void)heap_mapping (block->size, &fl, &sl);
+    heap->free_bytes -= block->size;
+
+    /* Unlink from the list */
+    if (block->prev_free)
+    {
+        block->prev_free->next_free = block->next_free;
+    }
+    else
+    {
+        heap->free_lists[fl][sl] = block->next_free;
+    }
+    if (block->next_free)
+    {
+        block->next_free->prev_free = block->prev_free;
+    }
+
+    /* Flag the list as empty if this was the last block on it */
+    if (heap->free_lists[fl][sl] == NULL)
+    {
+        heap->sl_bitmap[fl] &= (uint8_t)~(1 << sl);
+        if (heap->sl_bitmap[fl] == 0)
+        {
+            heap->fl_bitmap &= ~((uint32_t)1 << fl);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_HEAP_H
+#define __ATOM_HEAP_H
+
+/**
+ * Number of first-level size classes. Each class covers sizes up to twice
+ * the previous one, so this sets the largest block which can be managed.
+ * Ports with very little RAM may reduce it to shrink the ATOM_HEAP object.
+ */
+#ifndef ATOM_HEAP_FL_COUNT
+#define ATOM_HEAP_FL_COUNT      16
+#endif
+
+/* Number of second-level lists each first-level class is divided into */
+#define ATOM_HEAP_SL_LOG2       2
+#define ATOM_HEAP_SL_COUNT      (1 << ATOM_HEAP_SL_LOG2)
+
+/* Forward declaration */
+struct atom_heap_block;
+
+typedef struct atom_heap
+{
+    uint32_t    fl_bitmap;      /* Non-empty first-level classes */
+    uint8_t     sl_bitmap[ATOM_HEAP_FL_COUNT];  /* Non-empty second-level lists */
+    struct atom_heap_block *free_lists[ATOM_HEAP_FL_COUNT][ATOM_HEAP_SL_COUNT];
+    struct atom_heap_block *first_block;    /* Lowest block in the heap */
+    struct atom_heap_block *end_block;      /* Sentinel after the last block */
+    uint32_t    total_bytes;    /* Usable bytes when the heap is empty */
+    uint32_t    free_bytes;     /* Bytes currently free */
+    uint32_t    max_used_bytes; /* High-water mark of bytes in use */
+} ATOM_HEAP;
+
+typedef struct atom_heap_stats
+{
+    uint32_t    free_bytes;     /* Bytes currently free */
+    uint32_t    largest_free;   /* Largest block which could be allocated */
+    uint32_t    used_bytes;     /* Bytes currently in use (incl. overheads) */
+    uint32_t    max_used_bytes; /* High-water mark of bytes in use */
+} ATOM_HEAP_STATS;
+
+extern uint8_t atomHeapCreate (ATOM_HEAP *heap, uint8_t *buff_ptr, uint32_t size);
+extern uint8_t atomHeapAlloc (ATOM_HEAP *heap, uint32_t size, POINTER *mem_ptr);
+extern uint8_t atomHeapFree (ATOM_HEAP *heap, POINTER mem_ptr);
+extern uint8_t atomHeapStats (ATOM_HEAP *heap, ATOM_HEAP_STATS *stats);
+
+#endif /* __ATOM_HEAP_H */
@@ -0,0 +1,959 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Synchronous message-passing (rendezvous) library.
+ *
+ *
+ * This module implements client/server IPC over channels, where a client
+ * sends a request and blocks until a server has received it and sent a
+ * reply. It has the following features:
+ *
+ * \par Direct copies between threads
+ * Requests are copied straight from the client's buffer to the server's,
+ * and replies straight back, with no intermediate queue storage. A
+ * request/response exchange costs one copy in each direction rather than
+ * two, and no queue objects are needed. Copies are made outside of
+ * critical regions, while the other thread is held blocked.
+ *
+ * \par Priority handoff
+ * Channels can optionally run the server at the priority of the client it
+ * is serving, from receipt of the request until the reply. A low priority
+ * server then handles requests from high priority clients without being
+ * preempted by medium priority threads.
+ *
+ * \par Flexible blocking APIs
+ * Clients and servers can choose whether to wait for the other side to
+ * arrive, wait with timeout, or not wait and return a relevent status
+ * code.
+ *
+ * \par Priority-based queueing
+ * Where multiple clients are waiting on a channel, the highest priority
+ * request is received first. Where multiple clients of the same priority
+ * are waiting, they are served in FIFO order. Multiple server threads may
+ * wait on the same channel.
+ *
+ * \par Smart channel deletion
+ * Where a channel is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All channel objects must be initialised before use by calling
+ * atomChannelCreate(), choosing whether servers should take on their
+ * clients' priorities.
+ *
+ * Server threads loop calling atomReceive() to wait for a request. This
+ * returns a handle for the client, which remains blocked until the server
+ * passes the handle to atomReply(). Every received request must be
+ * replied to exactly once, by the thread which received it. A server may
+ * receive several requests before replying, but should then reply in the
+ * reverse order of receipt so that any priority handoff unwinds correctly.
+ * If a server's priority is changed while it serves a request (for example
+ * by atomThreadSetPriority() or a CPU budget demotion), atomReply() keeps
+ * the new priority rather than restoring the one from before the handoff.
+ *
+ * Clients call atomSend() with a request buffer and a reply buffer. The
+ * timeout only applies to waiting for a server to receive the request;
+ * once received, the client always waits for the reply.
+ *
+ * Message sizes are not fixed. If a request or reply is larger than the
+ * receiving buffer it is truncated, and the receiver is told the full size
+ * so that it can detect this.
+ *
+ * A channel which is no longer required can be deleted using
+ * atomChannelDelete(). This function automatically wakes up any threads
+ * which are waiting on the deleted channel. Requests which have already
+ * been received must still be replied to.
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "atom.h"
+#include "atomipc.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct channel_timer
+{
+    ATOM_TCB     *tcb_ptr;  /* Thread which is suspended with timeout */
+    ATOM_CHANNEL *chan_ptr; /* Channel the thread is interested in */
+    ATOM_TCB     **suspQ;   /* TCB queue which thread is suspended on */
+} CHANNEL_TIMER;
+
+typedef struct ipc_send
+{
+    uint8_t  *send_ptr;     /* Client's request */
+    uint32_t send_size;     /* Size of the request */
+    uint8_t  *reply_ptr;    /* Client's reply buffer */
+    uint32_t reply_size;    /* Reply buffer size, then size of the reply */
+    ATOM_TCB *server;       /* Server which received the request */
+    uint8_t  server_prio;   /* Server priority before the handoff */
+    uint8_t  inherit_prio;  /* Priority the server was given by the handoff */
+    uint8_t  inherited;     /* TRUE if the server took the client's priority */
+} IPC_SEND;
+
+typedef struct ipc_recv
+{
+    uint8_t  *buff_ptr;     /* Server's receive buffer */
+    uint32_t size;          /* Buffer size, then size of the request */
+    ATOM_TCB *client;       /* Client whose request was received */
+} IPC_RECV;
+
+
+/* Forward declarations */
+
+static uint8_t channel_suspend (ATOM_CHANNEL *chan, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, CHANNEL_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr);
+static uint8_t channel_bind (ATOM_CHANNEL *chan, ATOM_TCB *client_ptr, ATOM_TCB *server_ptr, ATOM_TCB *waiting_ptr);
+static void channel_copy (ATOM_TCB *client_ptr, ATOM_TCB *server_ptr);
+static void atomChannelTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomChannelCreate
+ *
+ * Initialises a channel object.
+ *
+ * Must be called before calling any other IPC library routines on a
+ * channel. Objects can be deleted later using atomChannelDelete().
+ *
+ * Does not allocate storage, the caller provides the channel object.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] chan Pointer to channel object
+ * @param[in] inherit TRUE to run servers at the priority of their client
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomChannelCreate (ATOM_CHANNEL *chan, uint8_t inherit)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (chan == NULL)
+    {
+        /* Bad channel pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Initialise the suspended threads queues */
+        chan->sendSuspQ = NULL;
+        chan->recvSuspQ = NULL;
+
+        /* Store the priority handoff option */
+        chan->inherit = inherit;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomChannelDelete
+ *
+ * Deletes a channel object.
+ *
+ * Any clients or servers waiting on the channel are woken and returned
+ * ATOM_ERR_DELETED. Clients whose requests have already been received are
+ * not affected and still wait for their reply. If called at thread context
+ * then the scheduler will be called during this function which may
+ * schedule in one of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] chan Pointer to channel object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomChannelDelete (ATOM_CHANNEL *chan)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (chan == NULL)
+    {
+        /* Bad channel pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Wake up all suspended tasks */
+        while (1)
+        {
+            /* Enter critical region */
+            CRITICAL_START ();
+
+            /* Check if any threads are suspended */
+            if (((tcb_ptr = tcbDequeueHead (&chan->recvSuspQ)) != NULL)
+                || ((tcb_ptr = tcbDequeueHead (&chan->sendSuspQ)) != NULL))
+            {
+                /* A thread is waiting on a suspend queue */
+
+                /* Return error status to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+
+                /* Put the thread on the ready queue */
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Quit the loop, returning error */
+                    status = ATOM_ERR_QUEUE;
+                    break;
+                }
+
+                /* If there's a timeout on this suspension, cancel it */
+                if (tcb_ptr->suspend_timo_cb)
+                {
+                    /* Cancel the callback */
+                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+                    {
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Quit the loop, returning error */
+                        status = ATOM_ERR_TIMER;
+                        break;
+                    }
+
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+
+                }
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Request a reschedule */
+                woken_threads = TRUE;
+            }
+
+            /* No more suspended threads */
+            else
+            {
+                /* Exit critical region and quit the loop */
+                CRITICAL_END ();
+                break;
+            }
+        }
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomSend
+ *
+ * Sends a request on a channel and waits for the reply.
+ *
+ * If a server is already waiting in atomReceive(), the request is copied
+ * straight into its buffer and it is woken. Otherwise the call will do
+ * one of the following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a server receives the request \n
+ * \c timeout > 0 : Call will block until a server receives the request or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no server is waiting \n
+ *
+ * Once the request has been received the caller blocks, without timeout,
+ * until the server calls atomReply(). The reply is copied straight into
+ * \c reply_ptr. On entry \c reply_size holds the size of the reply buffer,
+ * and on return it holds the size of the server's reply, which will be
+ * larger than the buffer if the reply was truncated.
+ *
+ * This function can only be called from thread context.
+ *
+ * @param[in] chan Pointer to channel object
+ * @param[in] timeout Max system ticks to wait for a server (0 = forever)
+ * @param[in] send_ptr Pointer to the request
+ * @param[in] send_size Size in bytes of the request
+ * @param[out] reply_ptr Pointer to the reply buffer
+ * @param[in,out] reply_size Size of the reply buffer, then size of the reply
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT No server received the request before the timeout
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 and no server waiting
+ * @retval ATOM_ERR_DELETED Channel was deleted while waiting for a server
+ * @retval ATOM_ERR_CONTEXT Not called in thread context
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on a suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering or cancelling a timeout
+ */
+uint8_t atomSend (ATOM_CHANNEL *chan, int32_t timeout, uint8_t *send_ptr, uint32_t send_size, uint8_t *reply_ptr, uint32_t *reply_size)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    CHANNEL_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    IPC_SEND send;
+    ATOM_TCB *curr_tcb_ptr, *server_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if ((chan == NULL) || ((send_ptr == NULL) && send_size)
+        || (reply_size == NULL) || ((reply_ptr == NULL) && *reply_size))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context, can't suspend */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Fill out the request for the server */
+        send.send_ptr = send_ptr;
+        send.send_size = send_size;
+        send.reply_ptr = reply_ptr;
+        send.reply_size = *reply_size;
+        send.server = NULL;
+        curr_tcb_ptr->suspend_data = (POINTER)&send;
+
+        /* Protect access to the channel object and OS queues */
+        CRITICAL_START ();
+
+        /* If a server is waiting, hand the request straight to it */
+        if (chan->recvSuspQ)
+        {
+            server_ptr = tcbDequeueHead (&chan->recvSuspQ);
+            status = channel_bind (chan, curr_tcb_ptr, server_ptr, server_ptr);
+            CRITICAL_END ();
+
+            /**
+             * The server is off the channel with no timeout, and only we
+             * can wake it, so the copy can be made with interrupts enabled.
+             */
+            if (status == ATOM_OK)
+            {
+                channel_copy (curr_tcb_ptr, server_ptr);
+            }
+
+            /* Wake the server and wait for its reply in one critical region */
+            CRITICAL_START ();
+            server_ptr->suspend_wake_status = status;
+            if (tcbEnqueuePriority (&tcbReadyQ, server_ptr) != ATOM_OK)
+            {
+                /* There was a problem putting the server on the ready queue */
+                status = ATOM_ERR_QUEUE;
+            }
+            if (status == ATOM_OK)
+            {
+                curr_tcb_ptr->suspended = TRUE;
+                curr_tcb_ptr->suspend_timo_cb = NULL;
+            }
+            CRITICAL_END ();
+
+            /* Current thread now blocking, schedule in the server */
+            atomSched (FALSE);
+
+            /* atomReply() will set ATOM_OK status */
+            if (status == ATOM_OK)
+            {
+                status = curr_tcb_ptr->suspend_wake_status;
+            }
+        }
+
+        /* Otherwise wait for a server if requested */
+        else if (timeout >= 0)
+        {
+            /* Add current thread to the suspend list on sends */
+            status = channel_suspend (chan, &chan->sendSuspQ, curr_tcb_ptr,
+                                      timeout, &timer_data, &timer_cb);
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Check timer registration was successful */
+            if (status == ATOM_OK)
+            {
+                /* Current thread now blocking, schedule in a new one */
+                atomSched (FALSE);
+
+                /**
+                 * atomReply() will set ATOM_OK status once the request has
+                 * been received and answered, while timeouts will set
+                 * ATOM_TIMEOUT and channel deletions will set
+                 * ATOM_ERR_DELETED.
+                 */
+                status = curr_tcb_ptr->suspend_wake_status;
+            }
+        }
+        else
+        {
+            /* timeout == -1, no server waiting */
+            CRITICAL_END ();
+            status = ATOM_WOULDBLOCK;
+        }
+
+        /* Return the size of the reply */
+        if (status == ATOM_OK)
+        {
+            *reply_size = send.reply_size;
+        }
+        curr_tcb_ptr->suspend_data = NULL;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomReceive
+ *
+ * Receives a request from a client on a channel.
+ *
+ * If a client is already waiting in atomSend(), the highest priority
+ * request is copied straight into \c buff_ptr. Otherwise the call will do
+ * one of the following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a client sends a request \n
+ * \c timeout > 0 : Call will block until a client sends a request or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no client is waiting \n
+ *
+ * On entry \c size holds the size of the receive buffer, and on return it
+ * holds the size of the client's request, which will be larger than the
+ * buffer if the request was truncated.
+ *
+ * On success a handle for the client is returned in \c client. The client
+ * stays blocked until the calling thread passes this handle to
+ * atomReply(). If the channel was created with priority handoff and the
+ * client has a higher priority than the calling thread, the calling
+ * thread runs at the client's priority until it replies.
+ *
+ * This function can only be called from thread context.
+ *
+ * @param[in] chan Pointer to channel object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] buff_ptr Pointer to the receive buffer
+ * @param[in,out] size Size of the receive buffer, then size of the request
+ * @param[out] client Pointer to which the client handle is written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT No request was sent before the timeout
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 and no client waiting
+ * @retval ATOM_ERR_DELETED Channel was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue, or a client on the ready queue
+ * @retval ATOM_ERR_TIMER Problem registering or cancelling a timeout
+ */
+uint8_t atomReceive (ATOM_CHANNEL *chan, int32_t timeout, uint8_t *buff_ptr, uint32_t *size, ATOM_TCB **client)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    CHANNEL_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    IPC_RECV recv;
+    ATOM_TCB *curr_tcb_ptr, *client_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if ((chan == NULL) || (size == NULL) || ((buff_ptr == NULL) && *size)
+        || (client == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context, can't suspend */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Fill out where the request should be delivered */
+        recv.buff_ptr = buff_ptr;
+        recv.size = *size;
+        recv.client = NULL;
+        curr_tcb_ptr->suspend_data = (POINTER)&recv;
+
+        /* Protect access to the channel object and OS queues */
+        CRITICAL_START ();
+
+        /* If a client is waiting, take its request */
+        if (chan->sendSuspQ)
+        {
+            client_ptr = tcbDequeueHead (&chan->sendSuspQ);
+            status = channel_bind (chan, client_ptr, curr_tcb_ptr, client_ptr);
+
+            /**
+             * If the threads could not be paired the client is now off
+             * the channel with nobody to reply to it, so wake it with the
+             * error rather than leave it blocked forever.
+             */
+            if (status != ATOM_OK)
+            {
+                client_ptr->suspend_wake_status = status;
+                if (tcbEnqueuePriority (&tcbReadyQ, client_ptr) != ATOM_OK)
+                {
+                    /* There was a problem putting the client on the ready queue */
+                    status = ATOM_ERR_QUEUE;
+                }
+            }
+            CRITICAL_END ();
+
+            /**
+             * The client is off the channel with no timeout and stays
+             * blocked until we reply, so the copy can be made with
+             * interrupts enabled.
+             */
+            if (status == ATOM_OK)
+            {
+                channel_copy (client_ptr, curr_tcb_ptr);
+            }
+            else
+            {
+                /* Let the scheduler switch to the client we woke */
+                atomSched (FALSE);
+            }
+        }
+
+        /* Otherwise wait for a client if requested */
+        else if (timeout >= 0)
+        {
+            /* Add current thread to the suspend list on receives */
+            status = channel_suspend (chan, &chan->recvSuspQ, curr_tcb_ptr,
+                                      timeout, &timer_data, &timer_cb);
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Check timer registration was successful */
+            if (status == ATOM_OK)
+            {
+                /* Current thread now blocking, schedule in a new one */
+                atomSched (FALSE);
+
+                /**
+                 * atomSend() will set ATOM_OK status once the request has
+                 * been copied in, while timeouts will set ATOM_TIMEOUT and
+                 * channel deletions will set ATOM_ERR_DELETED.
+                 */
+                status = curr_tcb_ptr->suspend_wake_status;
+            }
+        }
+        else
+        {
+            /* timeout == -1, no client waiting */
+            CRITICAL_END ();
+            status = ATOM_WOULDBLOCK;
+        }
+
+        /* Return the request size and client handle */
+        if (status == ATOM_OK)
+        {
+            *size = recv.size;
+            *client = recv.client;
+        }
+        curr_tcb_ptr->suspend_data = NULL;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomReply
+ *
+ * Replies to a received request.
+ *
+ * The reply is copied straight into the client's reply buffer and the
+ * client is woken. If the calling thread took on the client's priority
+ * when it received the request, its previous priority is restored, unless
+ * its priority has been changed again since (for example by
+ * atomThreadSetPriority()) in which case the new priority is kept. The
+ * scheduler is then called, which may schedule in the client depending on
+ * relative priorities.
+ *
+ * Must be called exactly once for each request, by the thread which
+ * received it.
+ *
+ * This function can only be called from thread context.
+ *
+ * @param[in] client Client handle returned by atomReceive()
+ * @param[in] reply_ptr Pointer to the reply
+ * @param[in] reply_size Size in bytes of the reply
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_CONTEXT Not called in thread context
+ * @retval ATOM_ERR_OWNERSHIP The request was not received by the calling thread
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the client on the ready queue
+ */
+uint8_t atomReply (ATOM_TCB *client, uint8_t *reply_ptr, uint32_t reply_size)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    IPC_SEND *send_ptr;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if ((client == NULL) || (client->suspend_data == NULL)
+        || ((reply_ptr == NULL) && reply_size))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        send_ptr = (IPC_SEND *)client->suspend_data;
+        if (send_ptr->server != curr_tcb_ptr)
+        {
+            /* Request not received by this thread */
+            status = ATOM_ERR_OWNERSHIP;
+        }
+        else
+        {
+            /* Copy the reply while the client is still blocked */
+            memcpy (send_ptr->reply_ptr, reply_ptr,
+                (reply_size < send_ptr->reply_size) ? reply_size : send_ptr->reply_size);
+            send_ptr->reply_size = reply_size;
+
+            /* Protect access to the OS queues */
+            CRITICAL_START ();
+
+            /**
+             * Drop any priority taken on from the client. If our priority
+             * has been changed since by other means (e.g. by
+             * atomThreadSetPriority() or a CPU budget), that change is
+             * kept instead.
+             */
+            if (send_ptr->inherited
+                && (curr_tcb_ptr->priority == send_ptr->inherit_prio))
+            {
+                curr_tcb_ptr->priority = send_ptr->server_prio;
+            }
+
+            /* Prevent any further replies to this request */
+            send_ptr->server = NULL;
+            client->suspend_data = NULL;
+
+            /* Wake the client */
+            client->suspend_wake_status = ATOM_OK;
+            if (tcbEnqueuePriority (&tcbReadyQ, client) != ATOM_OK)
+            {
+                /* There was a problem putting the client on the ready queue */
+                status = ATOM_ERR_QUEUE;
+            }
+            else
+            {
+                /* Successful */
+                status = ATOM_OK;
+            }
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch, either to the client or because we dropped priority.
+             */
+            atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomChannelTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c CHANNEL_TIMER object which is used to retrieve the
+ * channel details.
+ *
+ * @param[in] cb_data Pointer to a CHANNEL_TIMER object
+ */
+static void atomChannelTimerCallback (POINTER cb_data)
+{
+    CHANNEL_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the CHANNEL_TIMER structure pointer */
+    timer_data_ptr = (CHANNEL_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the channel's send or receive list */
+        (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b channel_suspend
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Adds a thread to one of a channel's suspend queues, registering a
+ * timeout if requested. Must be called with the critical section held.
+ *
+ * @param[in] chan Pointer to channel object
+ * @param[in] suspQ Suspend queue to add the thread to
+ * @param[in] tcb_ptr Thread to suspend
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] timer_data_ptr Timer data storage (on the caller's stack)
+ * @param[in] timer_cb_ptr Timer storage (on the caller's stack)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+static uint8_t channel_suspend (ATOM_CHANNEL *chan, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, CHANNEL_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr)
+{
+    uint8_t status;
+
+    /* Add the thread to the requested suspend list */
+    if (tcbEnqueuePriority (suspQ, tcb_ptr) != ATOM_OK)
+    {
+        /* There was an error putting this thread on the suspend list */
+        status = ATOM_ERR_QUEUE;
+    }
+    else
+    {
+        /* Set suspended status for the thread */
+        tcb_ptr->suspended = TRUE;
+
+        /* Track errors */
+        status = ATOM_OK;
+
+        /* Register a timer callback if requested */
+        if (timeout)
+        {
+            /* Fill out the data needed by the callback to wake us up */
+            timer_data_ptr->tcb_ptr = tcb_ptr;
+            timer_data_ptr->chan_ptr = chan;
+            timer_data_ptr->suspQ = suspQ;
+
+            /* Fill out the timer callback request structure */
+            timer_cb_ptr->cb_func = atomChannelTimerCallback;
+            timer_cb_ptr->cb_data = (POINTER)timer_data_ptr;
+            timer_cb_ptr->cb_ticks = timeout;
+
+            /**
+             * Store the timer details in the TCB so that we can cancel the
+             * timer callback if the other side arrives before the timeout
+             * occurs.
+             */
+            tcb_ptr->suspend_timo_cb = timer_cb_ptr;
+
+            /* Register a callback on timeout */
+            if (atomTimerRegister (timer_cb_ptr) != ATOM_OK)
+            {
+                /* Timer registration failed */
+                status = ATOM_ERR_TIMER;
+
+                /* Clean up and return to the caller */
+                (void)tcbDequeueEntry (suspQ, tcb_ptr);
+                tcb_ptr->suspended = FALSE;
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+
+        /* Set no timeout requested */
+        else
+        {
+            /* No need to cancel timeouts on this one */
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b channel_bind
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Pairs a client with the server which is receiving its request, once
+ * whichever of them was waiting has been removed from the channel. Any
+ * timeout on the waiting thread is cancelled, and if the channel uses
+ * priority handoff the server takes on the client's priority. If the
+ * timeout cannot be cancelled the threads are not paired and the server's
+ * priority is left unchanged. Must be called with the critical section
+ * held.
+ *
+ * @param[in] chan Pointer to channel object
+ * @param[in] client_ptr Client thread
+ * @param[in] server_ptr Server thread
+ * @param[in] waiting_ptr Whichever of the two was waiting on the channel
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t channel_bind (ATOM_CHANNEL *chan, ATOM_TCB *client_ptr, ATOM_TCB *server_ptr, ATOM_TCB *waiting_ptr)
+{
+    uint8_t status;
+    IPC_SEND *send_ptr;
+
+    /* Default to success */
+    status = ATOM_OK;
+
+    /* Cancel any timeout on the thread which was waiting */
+    if (waiting_ptr->suspend_timo_cb)
+    {
+        if (atomTimerCancel (waiting_ptr->suspend_timo_cb) != ATOM_OK)
+        {
+            /* There was a problem cancelling a timeout */
+            status = ATOM_ERR_TIMER;
+        }
+
+        /* Flag as no timeout registered */
+        waiting_ptr->suspend_timo_cb = NULL;
+    }
+
+    /* Only pair the threads up (and hand off priority) if successful */
+    if (status == ATOM_OK)
+    {
+        /* Record which server holds the request */
+        send_ptr = (IPC_SEND *)client_ptr->suspend_data;
+        send_ptr->server = server_ptr;
+        send_ptr->server_prio = server_ptr->priority;
+        send_ptr->inherited = FALSE;
+        ((IPC_RECV *)server_ptr->suspend_data)->client = client_ptr;
+
+        /**
+         * Run the server at the client's priority if that is higher. The
+         * server is not on any queue here (it is either running or has
+         * just been removed from the channel), so no re-sort is needed.
+         */
+        if (chan->inherit && (client_ptr->priority < server_ptr->priority))
+        {
+            server_ptr->priority = client_ptr->priority;
+            send_ptr->inherit_prio = client_ptr->priority;
+            send_ptr->inherited = TRUE;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b channel_copy
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Copies a bound client's request into its server's receive buffer,
+ * truncating it if the buffer is too small, and records the full request
+ * size for the server. Called with interrupts enabled while both threads'
+ * buffers are held stable by the IPC protocol.
+ *
+ * @param[in] client_ptr Client thread
+ * @param[in] server_ptr Server thread
+ */
+static void channel_copy (ATOM_TCB *client_ptr, ATOM_TCB *server_ptr)
+{
+    IPC_SEND *send_ptr;
+    IPC_RECV *recv_ptr;
+
+    send_ptr = (IPC_SEND *)client_ptr->suspend_data;
+    recv_ptr = (IPC_RECV *)server_ptr->suspend_data;
+
+    /* Copy as much of the request as will fit */
+    memcpy (recv_ptr->buff_ptr, send_ptr->send_ptr,
+        (send_ptr->send_size < recv_ptr->size) ? send_ptr->send_size : recv_ptr->size);
+    recv_ptr->size = send_ptr->send_size;
+}
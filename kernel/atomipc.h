@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_IPC_H
+#define __ATOM_IPC_H
+
+typedef struct atom_channel
+{
+    ATOM_TCB *  sendSuspQ;      /* Clients waiting for a server to receive */
+    ATOM_TCB *  recvSuspQ;      /* Servers waiting for a client to send */
+    uint8_t     inherit;        /* TRUE to run servers at their client's priority */
+} ATOM_CHANNEL;
+
+extern uint8_t atomChannelCreate (ATOM_CHANNEL *chan, uint8_t inherit);
+extern uint8_t atomChannelDelete (ATOM_CHANNEL *chan);
+extern uint8_t atomSend (ATOM_CHANNEL *chan, int32_t timeout, uint8_t *send_ptr, uint32_t send_size, uint8_t *reply_ptr, uint32_t *reply_size);
+extern uint8_t atomReceive (ATOM_CHANNEL *chan, int32_t timeout, uint8_t *buff_ptr, uint32_t *size, ATOM_TCB **client);
+extern uint8_t atomReply (ATOM_TCB *client, uint8_t *reply_ptr, uint32_t reply_size);
+
+#endif /* __ATOM_IPC_H */
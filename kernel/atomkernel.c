@@ -66,7 +66,9 @@
  *     same priority is also ready. This happens on a timer tick, and ensures
  *     that threads of the same priority share timeslices. In this case the
  *     previously-running thread is still considered ready-to-run so is placed
- *     back on to the ready queue.
+ *     back on to the ready queue. The timeslice (quantum) defaults to one
+ *     tick, and can be set per thread using atomThreadSetTimeslice(),
+ *     including to zero which disables timeslicing for the thread.
  *
  * Thread scheduling decisions are made by atomSched(). This is called at
  * several times, but should never be called by application code directly:
@@ -125,6 +127,10 @@
  * \b Application-callable general functions: \n
  *
  * \li atomThreadCreate(): Thread creation API.
+ * \li atomThreadSetPriority(): Changes a thread's priority at runtime.
+ * \li atomThreadSetTimeslice(): Sets a thread's round-robin quantum.
+ * \li atomThreadYield(): Gives up the CPU to other same-priority threads.
+ * \li atomThreadExit() / atomThreadJoin(): Thread termination APIs.
  * \li atomCurrentContext(): Used by kernel and application code to check
  *     whether the thread is currently running at thread or interrupt context.
  *     This is very useful for implementing safety checks and preventing
@@ -136,6 +142,7 @@
  * \li atomSched(): Core scheduler.
  * \li atomThreadSwitch(): Context-switch routine.
  * \li atomIdleThread(): Simple thread to be run when no other threads ready.
+ * \li atomThreadJoinTimerCallback(): Wakes threads whose join timed out.
  * \li tcbEnqueuePriority(): Enqueues TCBs (task control blocks) on lists.
  * \li tcbDequeueHead(): Dequeues the head of a TCB list.
  * \li tcbDequeueEntry(): Dequeues a particular entry from a TCB list.
@@ -146,6 +153,10 @@
 
 #include <stddef.h>
 #include "atom.h"
+#include "atomperiodic.h"
+#ifdef ATOM_CPU_BUDGETS
+#include "atombudget.h"
+#endif
 
 
 /* Global data */
@@ -187,6 +198,15 @@ static ATOM_TCB idle_tcb;
 static int atomIntCnt = 0;
 
 
+/* Local data types */
+
+typedef struct join_timer
+{
+    ATOM_TCB *tcb_ptr;          /* Thread which is suspended with timeout */
+    ATOM_TCB *target_ptr;       /* Thread being joined */
+} JOIN_TIMER;
+
+
 /* Constants */
 
 /** Bytecode to fill thread stacks with for stack-checking purposes */
@@ -196,6 +216,10 @@ static int atomIntCnt = 0;
 /* Forward declarations */
 static void atomThreadSwitch(ATOM_TCB *old_tcb, ATOM_TCB *new_tcb);
 static void atomIdleThread (uint32_t data);
+static void atomThreadJoinTimerCallback (POINTER cb_data);
+#ifdef ATOM_EDF
+static uint8_t edfBefore (ATOM_TCB *tcb_ptr, ATOM_TCB *other_ptr);
+#endif
 
 
 /**
@@ -212,10 +236,19 @@ static void atomIdleThread (uint32_t data);
  * with the same priority. Round-robin is only performed on timer ticks
  * however. During reschedules caused by an OS operation (e.g. after
  * giving or taking a semaphore) we only allow the scheduling in of
- * threads with higher priority than current priority. On timer ticks we
- * also allow the scheduling of same-priority threads - in that case we
- * schedule in the head of the ready list for that priority and put the
- * current thread at the tail.
+ * threads with higher priority than current priority. On timer ticks
+ * which end the current thread's quantum we also allow the scheduling of
+ * same-priority threads - in that case we schedule in the head of the
+ * ready list for that priority and put the current thread at the tail.
+ *
+ * Each thread's quantum is counted down in \c slice_remaining on every
+ * timer tick while it runs, and reloaded from \c timeslice when it
+ * expires. Threads with a zero timeslice are never round-robined on
+ * ticks.
+ *
+ * If the earliest-deadline-first class is enabled (ATOM_EDF), a thread at
+ * the EDF priority level is also preempted by a ready thread at that level
+ * with an earlier deadline.
  *
  * @param[in] timer_tick Should be TRUE when called from the system tick
  *
@@ -226,6 +259,7 @@ void atomSched (uint8_t timer_tick)
     CRITICAL_STORE;
     ATOM_TCB *new_tcb = NULL;
     int16_t lowest_pri;
+    uint8_t slice_expired;
 
     /**
      * Check the OS has actually started. As long as the proper initialisation
@@ -272,8 +306,23 @@ void atomSched (uint8_t timer_tick)
      */
     else
     {
+        /**
+         * On timer ticks, count down the current thread's quantum. When
+         * it expires, reload it and allow round-robin. Threads with no
+         * timeslicing have nothing to count down.
+         */
+        slice_expired = FALSE;
+        if ((timer_tick == TRUE) && (curr_tcb->slice_remaining > 0))
+        {
+            if (--curr_tcb->slice_remaining == 0)
+            {
+                curr_tcb->slice_remaining = curr_tcb->timeslice;
+                slice_expired = TRUE;
+            }
+        }
+
         /* Calculate which priority is allowed to be scheduled in */
-        if (timer_tick == TRUE)
+        if (slice_expired == TRUE)
         {
             /* Same priority or higher threads can preempt */
             lowest_pri = (int16_t)curr_tcb->priority;
@@ -297,16 +346,28 @@ void atomSched (uint8_t timer_tick)
         {
             /* Check for a thread at the given minimum priority level or higher */
             new_tcb = tcbDequeuePriority (&tcbReadyQ, (uint8_t)lowest_pri);
+        }
 
-            /* If a thread was found, schedule it in */
-            if (new_tcb)
-            {
-                /* Add the current thread to the ready queue */
-                (void)tcbEnqueuePriority (&tcbReadyQ, curr_tcb);
+#ifdef ATOM_EDF
+        /**
+         * Within the EDF priority level, a thread with an earlier deadline
+         * also preempts. The ready queue is deadline-ordered within the
+         * level so only the head needs checking.
+         */
+        if ((new_tcb == NULL) && tcbReadyQ && edfBefore (tcbReadyQ, curr_tcb))
+        {
+            new_tcb = tcbDequeueHead (&tcbReadyQ);
+        }
+#endif
 
-                /* Switch to the new thread */
-                atomThreadSwitch (curr_tcb, new_tcb);
-            }
+        /* If a thread was found, schedule it in */
+        if (new_tcb)
+        {
+            /* Add the current thread to the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, curr_tcb);
+
+            /* Switch to the new thread */
+            atomThreadSwitch (curr_tcb, new_tcb);
         }
     }
 
@@ -400,9 +461,22 @@ uint8_t atomThreadCreate (ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_poin
         /* Set up the TCB initial values */
         tcb_ptr->suspended = FALSE;
         tcb_ptr->priority = priority;
+        tcb_ptr->timeslice = ATOM_DEFAULT_TIMESLICE;
+        tcb_ptr->slice_remaining = ATOM_DEFAULT_TIMESLICE;
         tcb_ptr->prev_tcb = NULL;
         tcb_ptr->next_tcb = NULL;
+        tcb_ptr->tcb_queue = NULL;
         tcb_ptr->suspend_timo_cb = NULL;
+        tcb_ptr->suspend_data = NULL;
+        tcb_ptr->terminated = FALSE;
+        tcb_ptr->joinSuspQ = NULL;
+        tcb_ptr->notify_value = 0;
+        tcb_ptr->notify_waiting = FALSE;
+        tcb_ptr->periodic = NULL;
+#ifdef ATOM_EDF
+        tcb_ptr->edf_rel_deadline = 0;
+        tcb_ptr->edf_misses = 0;
+#endif
 
         /**
          * Store the thread entry point and parameter in the TCB. This may
@@ -484,6 +558,522 @@ uint8_t atomThreadCreate (ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_poin
 }
 
 
+/**
+ * \b atomThreadSetPriority
+ *
+ * Changes the priority of a thread.
+ *
+ * The new priority takes effect immediately. If the thread is on the ready
+ * queue, or blocking on an OS primitive which queues threads by priority
+ * (e.g. a semaphore), it is moved to its new position in that queue, after
+ * any other threads of the same priority.
+ *
+ * If called at thread context the scheduler is called, so the calling
+ * thread may be preempted if it has lowered its own priority, or raised
+ * that of a ready thread, below that of another ready thread.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread
+ * @param[in] priority New priority of the thread (0 to 255)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error re-sorting the thread on its queue
+ */
+uint8_t atomThreadSetPriority (ATOM_TCB *tcb_ptr, uint8_t priority)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_TCB **tcb_queue_ptr;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and OS queues */
+        CRITICAL_START ();
+
+        /* Default to success */
+        status = ATOM_OK;
+
+        /* Re-sort the thread if it is on a queue, otherwise just update */
+        tcb_queue_ptr = tcb_ptr->tcb_queue;
+        if (tcb_queue_ptr)
+        {
+            (void)tcbDequeueEntry (tcb_queue_ptr, tcb_ptr);
+            tcb_ptr->priority = priority;
+            if (tcbEnqueuePriority (tcb_queue_ptr, tcb_ptr) != ATOM_OK)
+            {
+                /* Queue-related error */
+                status = ATOM_ERR_QUEUE;
+            }
+        }
+        else
+        {
+            tcb_ptr->priority = priority;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((status == ATOM_OK) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadSetTimeslice
+ *
+ * Sets the round-robin quantum of a thread.
+ *
+ * A thread which is running while other threads of the same priority are
+ * ready is scheduled out after running for \c ticks timer ticks, and
+ * placed behind them on the ready queue. Longer quanta reduce the number
+ * of context switches between CPU-bound threads of the same priority,
+ * while a quantum of zero disables timeslicing altogether, so the thread
+ * runs until it blocks, yields or is preempted by a higher priority
+ * thread. New threads are given ATOM_DEFAULT_TIMESLICE (normally one
+ * tick, which can be overridden at build time).
+ *
+ * The new quantum starts immediately.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread
+ * @param[in] ticks Quantum in system ticks (0 = no timeslicing)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ */
+uint8_t atomThreadSetTimeslice (ATOM_TCB *tcb_ptr, uint16_t ticks)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if (tcb_ptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect against the scheduler counting down the quantum */
+        CRITICAL_START ();
+        tcb_ptr->timeslice = ticks;
+        tcb_ptr->slice_remaining = ticks;
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadYield
+ *
+ * Gives up the CPU to other ready threads of the same priority.
+ *
+ * The calling thread is placed behind any other ready threads of the same
+ * priority, and the first of those is scheduled in, exactly as happens
+ * when a timeslice expires on a timer tick. The caller's quantum is
+ * restarted. This allows cooperating threads of the same priority to share
+ * the CPU without waiting for the next tick. If no other thread of the
+ * same or higher priority is ready, the call returns immediately.
+ *
+ * Threads in the earliest-deadline-first class are ordered by deadline
+ * rather than round-robin, so an EDF thread does not yield to a ready EDF
+ * thread with a later deadline (which the scheduler would preempt straight
+ * away). It only yields to threads of higher priority or with the same
+ * deadline.
+ *
+ * Must only be called from thread context.
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_CONTEXT Not called from thread context
+ */
+uint8_t atomThreadYield (void)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_TCB *new_tcb;
+
+    /* Check we are actually in thread context */
+    if (atomCurrentContext() == NULL)
+    {
+        /* Interrupt handlers have nothing to yield */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Enter critical section */
+        CRITICAL_START ();
+
+        /**
+         * Round-robin exactly as on a timer tick which ends the quantum.
+         * This also applies to threads which are not timesliced, whose
+         * quantum count is reloaded to zero again. The decision is made
+         * within this critical section so that a timer tick arriving
+         * part way through cannot round-robin the thread a second time.
+         */
+        curr_tcb->slice_remaining = curr_tcb->timeslice;
+#ifdef ATOM_EDF
+        /* An EDF thread keeps running while only later deadlines are ready */
+        if (tcbReadyQ && edfBefore (curr_tcb, tcbReadyQ))
+            new_tcb = NULL;
+        else
+            new_tcb = tcbDequeuePriority (&tcbReadyQ, curr_tcb->priority);
+#else
+        new_tcb = tcbDequeuePriority (&tcbReadyQ, curr_tcb->priority);
+#endif
+
+        /* If a thread was found, schedule it in */
+        if (new_tcb)
+        {
+            /* Add the current thread to the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, curr_tcb);
+
+            /* Switch to the new thread */
+            atomThreadSwitch (curr_tcb, new_tcb);
+        }
+
+        /* Exit critical section */
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadExit
+ *
+ * Terminates the calling thread.
+ *
+ * The thread is scheduled out and never runs again. Any threads blocking
+ * in atomThreadJoin() on it are woken with ATOM_OK status. Once a joining
+ * thread has been woken (or atomThreadJoin() returns ATOM_OK) the exited
+ * thread's TCB and stack are no longer used by the kernel, and may be
+ * reused, for example by passing them to atomThreadCreate() again.
+ *
+ * Returning from a thread's entry point has the same effect, if the
+ * architecture port's thread startup routine calls this function.
+ *
+ * A running thread is not on the ready queue or any suspend queue, and
+ * any timeout it registered for a blocking call has been cancelled by the
+ * time that call returned, so the kernel holds no other references to the
+ * TCB. The release timer of a periodic thread is also cancelled. Resources
+ * the thread itself holds (mutexes, timers registered with
+ * ATOM_TIMER storage on its stack etc.) are not released automatically,
+ * and must be released by the thread before it exits.
+ *
+ * Must only be called from thread context.
+ *
+ * @retval ATOM_ERR_CONTEXT Not called from thread context (does not return otherwise)
+ */
+uint8_t atomThreadExit (void)
+{
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr, *join_tcb_ptr;
+    uint8_t status;
+
+    /* Get the current TCB */
+    tcb_ptr = atomCurrentContext();
+
+    /* Check we are actually in thread context */
+    if (tcb_ptr == NULL)
+    {
+        /* Not currently in thread context, there is no thread to exit */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Flag as terminated, and suspended so it is not rescheduled */
+        tcb_ptr->terminated = TRUE;
+        tcb_ptr->suspended = TRUE;
+
+        /* Make sure no kernel timer still refers to the TCB */
+        if (tcb_ptr->suspend_timo_cb)
+        {
+            (void)atomTimerCancel (tcb_ptr->suspend_timo_cb);
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+
+        /* Stop the releases of a periodic thread */
+        if (tcb_ptr->periodic)
+        {
+            tcb_ptr->periodic->stopped = TRUE;
+            (void)atomTimerCancel (&tcb_ptr->periodic->timer);
+            tcb_ptr->periodic = NULL;
+        }
+
+        /* Wake up all threads joining this one */
+        while ((join_tcb_ptr = tcbDequeueHead (&tcb_ptr->joinSuspQ)) != NULL)
+        {
+            /* Return OK status to the joining thread */
+            join_tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /* If there's a timeout on this suspension, cancel it */
+            if (join_tcb_ptr->suspend_timo_cb)
+            {
+                (void)atomTimerCancel (join_tcb_ptr->suspend_timo_cb);
+                join_tcb_ptr->suspend_timo_cb = NULL;
+            }
+
+            /* Put the thread on the ready queue */
+            (void)tcbEnqueuePriority (&tcbReadyQ, join_tcb_ptr);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Schedule in another thread. As the current thread is suspended
+         * and is not on any queue, it will never be scheduled in again.
+         */
+        atomSched (FALSE);
+
+        /* Not reached */
+        status = ATOM_ERROR;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadJoin
+ *
+ * Waits for a thread to terminate.
+ *
+ * If the thread \c tcb_ptr has already exited (by calling atomThreadExit()
+ * or returning from its entry point) the call returns ATOM_OK immediately.
+ * Otherwise the call will do one of the following depending on the
+ * \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until the thread exits \n
+ * \c timeout > 0 : Call will block until the thread exits or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the thread has not exited \n
+ *
+ * When multiple threads join the same thread they are all woken when it
+ * exits. On ATOM_OK the exited thread's TCB and stack may be reused.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to join
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ *
+ * @retval ATOM_OK Success, the thread has exited
+ * @retval ATOM_TIMEOUT Timed out before the thread exited
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the thread has not exited
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter, or a thread attempted to join itself
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomThreadJoin (ATOM_TCB *tcb_ptr, int32_t timeout)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    JOIN_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if ((tcb_ptr == NULL) || (tcb_ptr == curr_tcb_ptr))
+    {
+        /* Bad pointer, or would wait forever on itself */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and OS queues */
+        CRITICAL_START ();
+
+        /* If the thread has already exited, return immediately */
+        if (tcb_ptr->terminated == TRUE)
+        {
+            CRITICAL_END ();
+            status = ATOM_OK;
+        }
+
+        /* Otherwise block if allowed */
+        else if (timeout >= 0)
+        {
+            /* Check we are actually in thread context */
+            if (curr_tcb_ptr)
+            {
+                /* Add current thread to the thread's join list */
+                if (tcbEnqueuePriority (&tcb_ptr->joinSuspQ, curr_tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* There was an error putting this thread on the suspend list */
+                    status = ATOM_ERR_QUEUE;
+                }
+                else
+                {
+                    /* Set suspended status for the current thread */
+                    curr_tcb_ptr->suspended = TRUE;
+
+                    /* Track errors */
+                    status = ATOM_OK;
+
+                    /* Register a timer callback if requested */
+                    if (timeout)
+                    {
+                        /* Fill out the data needed by the callback to wake us up */
+                        timer_data.tcb_ptr = curr_tcb_ptr;
+                        timer_data.target_ptr = tcb_ptr;
+
+                        /* Fill out the timer callback request structure */
+                        timer_cb.cb_func = atomThreadJoinTimerCallback;
+                        timer_cb.cb_data = (POINTER)&timer_data;
+                        timer_cb.cb_ticks = timeout;
+
+                        /**
+                         * Store the timer details in the TCB so that we can
+                         * cancel the timer callback if the thread exits
+                         * before the timeout occurs.
+                         */
+                        curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                        /* Register a callback on timeout */
+                        if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                        {
+                            /* Timer registration failed */
+                            status = ATOM_ERR_TIMER;
+
+                            /* Clean up and return to the caller */
+                            (void)tcbDequeueEntry (&tcb_ptr->joinSuspQ, curr_tcb_ptr);
+                            curr_tcb_ptr->suspended = FALSE;
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+                    }
+
+                    /* Set no timeout requested */
+                    else
+                    {
+                        /* No need to cancel timeouts on this one */
+                        curr_tcb_ptr->suspend_timo_cb = NULL;
+                    }
+
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Check no errors have occurred */
+                    if (status == ATOM_OK)
+                    {
+                        /**
+                         * Current thread now blocking, schedule in a new
+                         * one. We already know we are in thread context
+                         * so can call the scheduler from here.
+                         */
+                        atomSched (FALSE);
+
+                        /**
+                         * Normal atomThreadExit() wakeups will set ATOM_OK
+                         * status, while timeouts will set ATOM_TIMEOUT.
+                         */
+                        status = curr_tcb_ptr->suspend_wake_status;
+                    }
+                }
+            }
+            else
+            {
+                /* Not currently in thread context, can't suspend */
+                CRITICAL_END ();
+                status = ATOM_ERR_CONTEXT;
+            }
+        }
+        else
+        {
+            /* timeout == -1, cannot block. Just return thread still running */
+            CRITICAL_END ();
+            status = ATOM_WOULDBLOCK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadJoinTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on threads blocking in atomThreadJoin() are notified by the
+ * timer system through this callback. The timer system calls us back
+ * with a pointer to the relevant \c JOIN_TIMER object which is used to
+ * retrieve the join details.
+ *
+ * @param[in] cb_data Pointer to a JOIN_TIMER object
+ */
+static void atomThreadJoinTimerCallback (POINTER cb_data)
+{
+    JOIN_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the JOIN_TIMER structure pointer */
+    timer_data_ptr = (JOIN_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the target thread's join list */
+        (void)tcbDequeueEntry (&timer_data_ptr->target_ptr->joinSuspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
 #ifdef ATOM_STACK_CHECKING
 /**
  * \b atomThreadStackCheck
@@ -577,6 +1167,23 @@ void atomIntEnter (void)
 }
 
 
+/**
+ * \b atomBarrier
+ *
+ * Compiler barrier for ports without their own ATOM_BARRIER().
+ *
+ * Does nothing, but as the compiler cannot see that from the caller it
+ * must complete any memory accesses before the call, and must not start
+ * any after the call until it returns. Should not be called directly,
+ * use ATOM_BARRIER() instead.
+ *
+ * @return None
+ */
+void atomBarrier (void)
+{
+}
+
+
 /**
  * \b atomIntExit
  *
@@ -595,6 +1202,19 @@ void atomIntEnter (void)
  */
 void atomIntExit (uint8_t timer_tick)
 {
+#ifdef ATOM_CPU_BUDGETS
+    /**
+     * Charge the tick to the interrupted thread and replenish budgets.
+     * This is done while still in interrupt context so that exhaustion
+     * callbacks see atomCurrentContext() == NULL, and any suspension or
+     * demotion is acted on by the scheduler call below.
+     */
+    if (timer_tick == TRUE)
+    {
+        atomBudgetTick (curr_tcb);
+    }
+#endif
+
     /* Decrement the interrupt count */
     atomIntCnt--;
 
@@ -769,6 +1389,13 @@ static void atomIdleThread (uint32_t param)
  * the new list head. It is valid for tcb_queue_ptr to point to a NULL pointer,
  * which is the case if the queue is currently empty.
  *
+ * If the earliest-deadline-first class is enabled (ATOM_EDF), EDF threads
+ * are instead ordered by deadline within their priority level.
+ *
+ * The queue is recorded in the TCB until it is dequeued, so that a TCB can
+ * be re-sorted if its priority changes (see atomThreadSetPriority()). Queue
+ * head pointers must therefore remain valid while TCBs are enqueued.
+ *
  * \b NOTE: Assumes that the caller is already in a critical section.
  *
  * @param[in,out] tcb_queue_ptr Pointer to TCB queue head pointer
@@ -790,6 +1417,20 @@ uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
     }
     else
     {
+#ifdef ATOM_EDF
+        /**
+         * A sporadic EDF thread's next job is released when it is next
+         * made ready, which sets its deadline.
+         */
+        if ((tcb_queue_ptr == &tcbReadyQ) && tcb_ptr->edf_rel_deadline
+            && (tcb_ptr->edf_released == FALSE))
+        {
+            tcb_ptr->edf_release = atomTimeGet();
+            tcb_ptr->edf_deadline = tcb_ptr->edf_release + tcb_ptr->edf_rel_deadline;
+            tcb_ptr->edf_released = TRUE;
+        }
+#endif
+
         /* Walk the list and enqueue at the end of the TCBs at this priority */
         prev_ptr = next_ptr = *tcb_queue_ptr;
         do
@@ -797,8 +1438,13 @@ uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
             /* Insert if:
              *   next_ptr = NULL (we're at the head of an empty queue or at the tail)
              *   the next TCB in the list is lower priority than the one we're enqueuing.
+             *   the next TCB is an EDF thread with a later deadline (ATOM_EDF only).
              */
-            if ((next_ptr == NULL) || (next_ptr->priority > tcb_ptr->priority))
+            if ((next_ptr == NULL) || (next_ptr->priority > tcb_ptr->priority)
+#ifdef ATOM_EDF
+                || edfBefore (tcb_ptr, next_ptr)
+#endif
+                )
             {
                 /* Make this TCB the new listhead */
                 if (next_ptr == *tcb_queue_ptr)
@@ -819,6 +1465,9 @@ uint8_t tcbEnqueuePriority (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
                         next_ptr->prev_tcb = tcb_ptr;
                 }
 
+                /* Record which queue the TCB is on */
+                tcb_ptr->tcb_queue = tcb_queue_ptr;
+
                 /* Quit the loop, we've finished inserting */
                 break;
             }
@@ -886,6 +1535,7 @@ ATOM_TCB *tcbDequeueHead (ATOM_TCB **tcb_queue_ptr)
         if (*tcb_queue_ptr)
             (*tcb_queue_ptr)->prev_tcb = NULL;
         ret_ptr->next_tcb = ret_ptr->prev_tcb = NULL;
+        ret_ptr->tcb_queue = NULL;
     }
 
     return (ret_ptr);
@@ -955,6 +1605,7 @@ ATOM_TCB *tcbDequeueEntry (ATOM_TCB **tcb_queue_ptr, ATOM_TCB *tcb_ptr)
                 }
                 ret_ptr = next_ptr;
                 ret_ptr->prev_tcb = ret_ptr->next_tcb = NULL;
+                ret_ptr->tcb_queue = NULL;
                 break;
             }
 
@@ -1021,6 +1672,7 @@ ATOM_TCB *tcbDequeuePriority (ATOM_TCB **tcb_queue_ptr, uint8_t priority)
             (*tcb_queue_ptr)->prev_tcb = NULL;
             ret_ptr->next_tcb = NULL;
         }
+        ret_ptr->tcb_queue = NULL;
     }
     else
     {
@@ -1030,3 +1682,29 @@ ATOM_TCB *tcbDequeuePriority (ATOM_TCB **tcb_queue_ptr, uint8_t priority)
 
     return (ret_ptr);
 }
+
+
+#ifdef ATOM_EDF
+/**
+ * \b edfBefore
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Checks whether one thread should be scheduled before another under the
+ * earliest-deadline-first class: both must be EDF threads at the same
+ * priority level, and \c tcb_ptr must have the strictly earlier deadline.
+ * Deadlines are compared allowing for the system time wrapping.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB to check
+ * @param[in] other_ptr Pointer to the TCB to compare against
+ *
+ * @retval TRUE if \c tcb_ptr has an earlier deadline than \c other_ptr
+ */
+static uint8_t edfBefore (ATOM_TCB *tcb_ptr, ATOM_TCB *other_ptr)
+{
+    return ((tcb_ptr->edf_rel_deadline != 0)
+            && (other_ptr->edf_rel_deadline != 0)
+            && (tcb_ptr->priority == other_ptr->priority)
+            && ((int32_t)(tcb_ptr->edf_deadline - other_ptr->edf_deadline) < 0));
+}
+#endif /* ATOM_EDF */
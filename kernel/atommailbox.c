@@ -0,0 +1,762 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Mailbox library.
+ *
+ *
+ * This module implements mailboxes for passing pointer-sized messages,
+ * typically handles to buffers allocated from a memory pool. It has the
+ * following features:
+ *
+ * \par Direct handoff
+ * Where a thread is already waiting to receive, a posted message is written
+ * straight to the receiver and never enters the mailbox storage. Likewise
+ * a receiver emptying a slot in a full mailbox moves the message of the
+ * first waiting sender straight into it. Woken threads therefore never
+ * need to retry, and messages cannot be overtaken by other threads.
+ *
+ * \par Low per-message cost
+ * Messages are a single pointer and are copied by assignment, with 8-bit
+ * slot indices, avoiding the byte copy and 32-bit index arithmetic needed
+ * for general-purpose queues.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to make a call which may block can choose whether to
+ * block, block with timeout, or not block and return a relevent status
+ * code.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are blocking on a mailbox, they are woken in order
+ * of the threads' priorities. Where multiple threads of the same priority
+ * are blocking, they are woken in FIFO order.
+ *
+ * \par Smart mailbox deletion
+ * Where a mailbox is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All mailbox objects must be initialised before use by calling
+ * atomMailboxCreate(). Single-slot mailboxes need no storage other than the
+ * mailbox object itself, while deeper mailboxes are given an array of
+ * \c depth POINTER slots.
+ *
+ * Messages are posted using atomMailboxPut(). If the mailbox is full the
+ * caller will block until a slot becomes free (unless the calling
+ * parameters request no blocking). Messages are received in FIFO order
+ * using atomMailboxGet(), which blocks if the mailbox is empty (unless the
+ * calling parameters request no blocking).
+ *
+ * A mailbox which is no longer required can be deleted using
+ * atomMailboxDelete(). This function automatically wakes up any threads
+ * which are waiting on the deleted mailbox.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atommailbox.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct mailbox_timer
+{
+    ATOM_TCB     *tcb_ptr;  /* Thread which is suspended with timeout */
+    ATOM_MAILBOX *mbox_ptr; /* Mailbox the thread is interested in */
+    ATOM_TCB     **suspQ;   /* TCB queue which thread is suspended on */
+} MAILBOX_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t mailbox_suspend (ATOM_MAILBOX *mbox, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, MAILBOX_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr);
+static uint8_t mailbox_wake (ATOM_TCB *tcb_ptr);
+static void atomMailboxTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomMailboxCreate
+ *
+ * Initialises a mailbox object.
+ *
+ * Must be called before calling any other mailbox library routines on a
+ * mailbox. Objects can be deleted later using atomMailboxDelete().
+ *
+ * Does not allocate storage. Mailboxes with a \c depth of 1 may pass a
+ * NULL \c slots pointer to use storage within the mailbox object,
+ * otherwise the caller provides an array of \c depth slots.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] mbox Pointer to mailbox object
+ * @param[in] slots Pointer to message storage (or NULL if \c depth is 1)
+ * @param[in] depth Max number of storable messages (1 to 255)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomMailboxCreate (ATOM_MAILBOX *mbox, POINTER *slots, uint8_t depth)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((mbox == NULL) || (depth == 0) || ((slots == NULL) && (depth != 1)))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the mailbox details, using our own slot if none given */
+        mbox->slots = (slots != NULL) ? slots : &mbox->slot;
+        mbox->depth = depth;
+
+        /* Initialise the suspended threads queues */
+        mbox->putSuspQ = NULL;
+        mbox->getSuspQ = NULL;
+
+        /* Initialise the insert/remove indices */
+        mbox->insert_index = 0;
+        mbox->remove_index = 0;
+        mbox->count = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMailboxDelete
+ *
+ * Deletes a mailbox object.
+ *
+ * Any threads currently suspended on the mailbox will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context, but loops internally
+ * waking up all threads blocking on the mailbox, so the potential
+ * execution cycles cannot be determined in advance.
+ *
+ * @param[in] mbox Pointer to mailbox object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomMailboxDelete (ATOM_MAILBOX *mbox)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (mbox == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Wake up all suspended tasks */
+        while (1)
+        {
+            /* Enter critical region */
+            CRITICAL_START ();
+
+            /* Check if any threads are suspended */
+            if (((tcb_ptr = tcbDequeueHead (&mbox->getSuspQ)) != NULL)
+                || ((tcb_ptr = tcbDequeueHead (&mbox->putSuspQ)) != NULL))
+            {
+                /* A thread is waiting on a suspend queue */
+
+                /* Return error status to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+
+                /* Put the thread on the ready queue */
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Quit the loop, returning error */
+                    status = ATOM_ERR_QUEUE;
+                    break;
+                }
+
+                /* If there's a timeout on this suspension, cancel it */
+                if (tcb_ptr->suspend_timo_cb)
+                {
+                    /* Cancel the callback */
+                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+                    {
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Quit the loop, returning error */
+                        status = ATOM_ERR_TIMER;
+                        break;
+                    }
+
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+
+                }
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Request a reschedule */
+                woken_threads = TRUE;
+            }
+
+            /* No more suspended threads */
+            else
+            {
+                /* Exit critical region and quit the loop */
+                CRITICAL_END ();
+                break;
+            }
+        }
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMailboxPut
+ *
+ * Post a message to a mailbox.
+ *
+ * If a thread is blocking waiting to receive, the message is handed
+ * directly to the highest priority waiting thread. Otherwise it is stored
+ * in the next free slot. If all slots are full the call will do one of the
+ * following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a slot is free \n
+ * \c timeout > 0 : Call will block until a slot is free or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the mailbox is full \n
+ *
+ * A blocked sender's message is moved into the mailbox by the receiver
+ * which frees up a slot, so once this call returns ATOM_OK the message has
+ * been posted.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] mbox Pointer to mailbox object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] msg Message to post
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Mailbox timed out before a slot was freed
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the mailbox is full
+ * @retval ATOM_ERR_DELETED Mailbox was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on a suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering or cancelling a timeout
+ */
+uint8_t atomMailboxPut (ATOM_MAILBOX *mbox, int32_t timeout, POINTER msg)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    MAILBOX_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *tcb_ptr;
+
+    /* Check parameters */
+    if (mbox == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the mailbox object and OS queues */
+        CRITICAL_START ();
+
+        /* If a receiver is waiting, hand the message straight to it */
+        if (mbox->getSuspQ)
+        {
+            tcb_ptr = tcbDequeueHead (&mbox->getSuspQ);
+            *(POINTER *)tcb_ptr->suspend_data = msg;
+            status = mailbox_wake (tcb_ptr);
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+
+        /* Otherwise store it if there is a free slot */
+        else if (mbox->count < mbox->depth)
+        {
+            mbox->slots[mbox->insert_index] = msg;
+            if (++mbox->insert_index == mbox->depth)
+            {
+                mbox->insert_index = 0;
+            }
+            mbox->count++;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+
+        /* Mailbox is full */
+        else if (timeout >= 0)
+        {
+            /* Get the current TCB */
+            tcb_ptr = atomCurrentContext();
+
+            /* Check we are actually in thread context */
+            if (tcb_ptr)
+            {
+                /* Leave the message for the receiver which frees a slot */
+                tcb_ptr->suspend_data = msg;
+
+                /* Add current thread to the suspend list on sends */
+                status = mailbox_suspend (mbox, &mbox->putSuspQ, tcb_ptr,
+                                          timeout, &timer_data, &timer_cb);
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Check timer registration was successful */
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    atomSched (FALSE);
+
+                    /**
+                     * Normal atomMailboxGet() wakeups will set ATOM_OK
+                     * status once our message has been moved into the
+                     * mailbox, while timeouts will set ATOM_TIMEOUT and
+                     * mailbox deletions will set ATOM_ERR_DELETED.
+                     */
+                    status = tcb_ptr->suspend_wake_status;
+                }
+            }
+            else
+            {
+                /* Not currently in thread context, can't suspend */
+                CRITICAL_END ();
+                status = ATOM_ERR_CONTEXT;
+            }
+        }
+        else
+        {
+            /* timeout == -1, cannot block. Just return mailbox is full */
+            CRITICAL_END ();
+            status = ATOM_WOULDBLOCK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMailboxGet
+ *
+ * Receive a message from a mailbox.
+ *
+ * Retrieves the oldest message in the mailbox. If a sender is blocking
+ * because the mailbox was full, its message is moved into the freed slot
+ * and it is woken. If the mailbox is empty the call will do one of the
+ * following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a message is posted \n
+ * \c timeout > 0 : Call will block until a message is posted or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the mailbox is empty \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] mbox Pointer to mailbox object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] msgptr Pointer to which the received message will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Mailbox timed out before a message was posted
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the mailbox is empty
+ * @retval ATOM_ERR_DELETED Mailbox was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on a suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering or cancelling a timeout
+ */
+uint8_t atomMailboxGet (ATOM_MAILBOX *mbox, int32_t timeout, POINTER *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    MAILBOX_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *tcb_ptr;
+
+    /* Check parameters */
+    if ((mbox == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the mailbox object and OS queues */
+        CRITICAL_START ();
+
+        /* If there is a message, take the oldest */
+        if (mbox->count > 0)
+        {
+            *msgptr = mbox->slots[mbox->remove_index];
+            if (++mbox->remove_index == mbox->depth)
+            {
+                mbox->remove_index = 0;
+            }
+            mbox->count--;
+
+            /* Move the first blocked sender's message into the freed slot */
+            if (mbox->putSuspQ)
+            {
+                tcb_ptr = tcbDequeueHead (&mbox->putSuspQ);
+                mbox->slots[mbox->insert_index] = tcb_ptr->suspend_data;
+                if (++mbox->insert_index == mbox->depth)
+                {
+                    mbox->insert_index = 0;
+                }
+                mbox->count++;
+                status = mailbox_wake (tcb_ptr);
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /**
+                 * The scheduler may now make a policy decision to thread
+                 * switch if we are currently in thread context. If we are
+                 * in interrupt context it will be handled by atomIntExit().
+                 */
+                if (atomCurrentContext())
+                    atomSched (FALSE);
+            }
+            else
+            {
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Successful */
+                status = ATOM_OK;
+            }
+        }
+
+        /* Mailbox is empty */
+        else if (timeout >= 0)
+        {
+            /* Get the current TCB */
+            tcb_ptr = atomCurrentContext();
+
+            /* Check we are actually in thread context */
+            if (tcb_ptr)
+            {
+                /* Tell the sender where to write the message */
+                tcb_ptr->suspend_data = (POINTER)msgptr;
+
+                /* Add current thread to the suspend list on receives */
+                status = mailbox_suspend (mbox, &mbox->getSuspQ, tcb_ptr,
+                                          timeout, &timer_data, &timer_cb);
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Check timer registration was successful */
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    atomSched (FALSE);
+
+                    /**
+                     * Normal atomMailboxPut() wakeups will set ATOM_OK
+                     * status once the message has been written to
+                     * \c msgptr, while timeouts will set ATOM_TIMEOUT and
+                     * mailbox deletions will set ATOM_ERR_DELETED.
+                     */
+                    status = tcb_ptr->suspend_wake_status;
+                }
+            }
+            else
+            {
+                /* Not currently in thread context, can't suspend */
+                CRITICAL_END ();
+                status = ATOM_ERR_CONTEXT;
+            }
+        }
+        else
+        {
+            /* timeout == -1, cannot block. Just return mailbox is empty */
+            CRITICAL_END ();
+            status = ATOM_WOULDBLOCK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMailboxTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c MAILBOX_TIMER object which is used to retrieve the
+ * mailbox details.
+ *
+ * @param[in] cb_data Pointer to a MAILBOX_TIMER object
+ */
+static void atomMailboxTimerCallback (POINTER cb_data)
+{
+    MAILBOX_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the MAILBOX_TIMER structure pointer */
+    timer_data_ptr = (MAILBOX_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the mailbox's send or receive list */
+        (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b mailbox_suspend
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Places the calling thread on one of the mailbox's suspend lists, and
+ * registers a timeout callback if requested.
+ *
+ * The timer storage is provided by the caller (on its own stack) and must
+ * remain valid until the thread is woken.
+ *
+ * Assumes interrupts are already locked out. The caller is responsible for
+ * exiting the critical region and calling the scheduler if successful.
+ *
+ * @param[in] mbox Pointer to an ATOM_MAILBOX object
+ * @param[in] suspQ Suspend list to place the thread on
+ * @param[in] tcb_ptr TCB of the calling thread
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] timer_data_ptr Storage for the timeout callback data
+ * @param[in] timer_cb_ptr Storage for the timeout callback request
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+static uint8_t mailbox_suspend (ATOM_MAILBOX *mbox, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, MAILBOX_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr)
+{
+    uint8_t status;
+
+    /* Add the thread to the requested suspend list */
+    if (tcbEnqueuePriority (suspQ, tcb_ptr) != ATOM_OK)
+    {
+        /* There was an error putting this thread on the suspend list */
+        status = ATOM_ERR_QUEUE;
+    }
+    else
+    {
+        /* Set suspended status for the thread */
+        tcb_ptr->suspended = TRUE;
+
+        /* Track errors */
+        status = ATOM_OK;
+
+        /* Register a timer callback if requested */
+        if (timeout)
+        {
+            /* Fill out the data needed by the callback to wake us up */
+            timer_data_ptr->tcb_ptr = tcb_ptr;
+            timer_data_ptr->mbox_ptr = mbox;
+            timer_data_ptr->suspQ = suspQ;
+
+            /* Fill out the timer callback request structure */
+            timer_cb_ptr->cb_func = atomMailboxTimerCallback;
+            timer_cb_ptr->cb_data = (POINTER)timer_data_ptr;
+            timer_cb_ptr->cb_ticks = timeout;
+
+            /**
+             * Store the timer details in the TCB so that we can cancel the
+             * timer callback if the thread is woken before the timeout
+             * occurs.
+             */
+            tcb_ptr->suspend_timo_cb = timer_cb_ptr;
+
+            /* Register a callback on timeout */
+            if (atomTimerRegister (timer_cb_ptr) != ATOM_OK)
+            {
+                /* Timer registration failed */
+                status = ATOM_ERR_TIMER;
+
+                /* Clean up and return to the caller */
+                (void)tcbDequeueEntry (suspQ, tcb_ptr);
+                tcb_ptr->suspended = FALSE;
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+
+        /* Set no timeout requested */
+        else
+        {
+            /* No need to cancel timeouts on this one */
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b mailbox_wake
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Readies a thread which has been taken off one of the mailbox's suspend
+ * lists after its message transfer was completed on its behalf.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] tcb_ptr Thread to wake
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t mailbox_wake (ATOM_TCB *tcb_ptr)
+{
+    uint8_t status;
+
+    /* Move the waiting thread to the ready queue */
+    if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+    {
+        /* There was a problem putting the thread on the ready queue */
+        status = ATOM_ERR_QUEUE;
+    }
+    else
+    {
+        /* Set OK status to be returned to the waiting thread */
+        tcb_ptr->suspend_wake_status = ATOM_OK;
+
+        /* If there's a timeout on this suspension, cancel it */
+        if ((tcb_ptr->suspend_timo_cb != NULL)
+            && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+        {
+            /* There was a problem cancelling a timeout */
+            status = ATOM_ERR_TIMER;
+        }
+        else
+        {
+            /* Flag as no timeout registered */
+            tcb_ptr->suspend_timo_cb = NULL;
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
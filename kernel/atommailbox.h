@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_MAILBOX_H
+#define __ATOM_MAILBOX_H
+
+typedef struct atom_mailbox
+{
+    ATOM_TCB *  putSuspQ;       /* Queue of threads waiting to send */
+    ATOM_TCB *  getSuspQ;       /* Queue of threads waiting to receive */
+    POINTER *   slots;          /* Pointer to message storage */
+    POINTER     slot;           /* Built-in storage for single-slot mailboxes */
+    uint8_t     depth;          /* Max number of storable messages */
+    uint8_t     count;          /* Number of messages stored */
+    uint8_t     insert_index;   /* Next slot to insert into */
+    uint8_t     remove_index;   /* Next slot to remove from */
+} ATOM_MAILBOX;
+
+extern uint8_t atomMailboxCreate (ATOM_MAILBOX *mbox, POINTER *slots, uint8_t depth);
+extern uint8_t atomMailboxDelete (ATOM_MAILBOX *mbox);
+extern uint8_t atomMailboxPut (ATOM_MAILBOX *mbox, int32_t timeout, POINTER msg);
+extern uint8_t atomMailboxGet (ATOM_MAILBOX *mbox, int32_t timeout, POINTER *msgptr);
+
+#endif /* __ATOM_MAILBOX_H */
@@ -0,0 +1,691 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Memory pool library.
+ *
+ *
+ * This module implements a fixed-size block allocator with the following
+ * features:
+ *
+ * \par Deterministic allocation
+ * Free blocks are kept on a list linked through the blocks themselves, so
+ * allocating and freeing a block take constant time and the pool needs no
+ * storage beyond the blocks.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to allocate from an empty pool can choose whether to
+ * block, block with timeout, or not block and return a relevent status
+ * code.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any calls which could
+ * potentially block have optional parameters to prevent blocking if you
+ * wish to call them from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are blocking on a pool, they are woken in order of
+ * the threads' priorities. Where multiple threads of the same priority are
+ * blocking, they are woken in FIFO order.
+ *
+ * \par Smart pool deletion
+ * Where a pool is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All pool objects must be initialised before use by calling
+ * atomMemPoolCreate(), passing a data area large enough for the requested
+ * number of blocks. Each block must be at least large enough to hold a
+ * pointer, and the data area and block size should be suitably aligned
+ * for whatever will be stored in the blocks.
+ *
+ * Blocks are allocated using atomMemPoolAlloc(). If the pool is empty the
+ * caller will block until a block is freed (unless the calling parameters
+ * request no blocking). Blocks are returned using atomMemPoolFree(), which
+ * hands the block directly to the highest priority thread waiting for one
+ * (if any).
+ *
+ * Pools can be combined with queues of pointers to pass large messages
+ * between threads without copying them: the sender allocates a block,
+ * fills it in and posts the pointer, and the receiver frees the block once
+ * finished with it.
+ *
+ * A pool which is no longer required can be deleted using
+ * atomMemPoolDelete(). This function automatically wakes up any threads
+ * which are waiting on the deleted pool.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atommempool.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct mempool_timer
+{
+    ATOM_TCB     *tcb_ptr;  /* Thread which is suspended with timeout */
+    ATOM_MEMPOOL *pool_ptr; /* Pool the thread is suspended on */
+} MEMPOOL_TIMER;
+
+
+/* Forward declarations */
+
+static POINTER mempool_remove (ATOM_MEMPOOL *pool);
+static void atomMemPoolTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomMemPoolCreate
+ *
+ * Initialises a memory pool object.
+ *
+ * Must be called before calling any other memory pool library routines on
+ * the pool. Objects can be deleted later using atomMemPoolDelete().
+ *
+ * Does not allocate storage, the caller provides the pool object and the
+ * data area of (\c block_size * \c num_blocks) bytes, which is carved up
+ * into blocks and placed on the free list.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] pool Pointer to memory pool object
+ * @param[in] buff_ptr Pointer to the data area
+ * @param[in] block_size Size of each block (at least sizeof(POINTER))
+ * @param[in] num_blocks Number of blocks
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomMemPoolCreate (ATOM_MEMPOOL *pool, uint8_t *buff_ptr, uint32_t block_size, uint32_t num_blocks)
+{
+    uint8_t status;
+    uint8_t *block_ptr;
+    uint32_t i;
+
+    /* Parameter check */
+    if ((pool == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((block_size < sizeof(POINTER)) || (num_blocks == 0))
+    {
+        /* Bad values */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the pool details */
+        pool->buff_ptr = buff_ptr;
+        pool->block_size = block_size;
+        pool->num_blocks = num_blocks;
+
+        /* Initialise the suspended threads queue */
+        pool->suspQ = NULL;
+
+        /* Link every block onto the free list, in address order */
+        block_ptr = buff_ptr + (block_size * (num_blocks - 1));
+        pool->free_list = NULL;
+        for (i = 0; i < num_blocks; i++)
+        {
+            *(uint8_t **)block_ptr = pool->free_list;
+            pool->free_list = block_ptr;
+            block_ptr -= block_size;
+        }
+        pool->num_free = num_blocks;
+        pool->num_reserved = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMemPoolDelete
+ *
+ * Deletes a memory pool object.
+ *
+ * Any threads currently suspended on the pool will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context, but loops internally
+ * waking up all threads blocking on the pool, so the potential execution
+ * cycles cannot be determined in advance.
+ *
+ * @param[in] pool Pointer to memory pool object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomMemPoolDelete (ATOM_MEMPOOL *pool)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (pool == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Wake up all suspended tasks */
+        while (1)
+        {
+            /* Enter critical region */
+            CRITICAL_START ();
+
+            /* Check if any threads are suspended */
+            if ((tcb_ptr = tcbDequeueHead (&pool->suspQ)) != NULL)
+            {
+                /* A thread is waiting on a suspend queue */
+
+                /* Return error status to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+
+                /* Put the thread on the ready queue */
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Quit the loop, returning error */
+                    status = ATOM_ERR_QUEUE;
+                    break;
+                }
+
+                /* If there's a timeout on this suspension, cancel it */
+                if (tcb_ptr->suspend_timo_cb)
+                {
+                    /* Cancel the callback */
+                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+                    {
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Quit the loop, returning error */
+                        status = ATOM_ERR_TIMER;
+                        break;
+                    }
+
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+
+                }
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Request a reschedule */
+                woken_threads = TRUE;
+            }
+
+            /* No more suspended threads */
+            else
+            {
+                /* Exit critical region and quit the loop */
+                CRITICAL_END ();
+                break;
+            }
+        }
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMemPoolAlloc
+ *
+ * Allocate a block from a memory pool.
+ *
+ * Takes a block from the pool's free list and returns a pointer to it in
+ * \c block_ptr. If the pool is empty then the call will block until a
+ * block is freed by another thread or interrupt handler, or until the
+ * specified \c timeout is reached. Blocking threads will also be woken if
+ * the pool is deleted by another thread while blocking.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if the pool is empty:
+ *
+ * \c timeout == 0 : Call will block until a block is freed \n
+ * \c timeout > 0 : Call will block until a block is freed or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the pool is empty \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] pool Pointer to memory pool object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] block_ptr Pointer to which the allocated block will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Pool timed out before a block was freed
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the pool is empty
+ * @retval ATOM_ERR_DELETED Pool was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomMemPoolAlloc (ATOM_MEMPOOL *pool, int32_t timeout, POINTER *block_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    MEMPOOL_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((pool == NULL) || (block_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the pool object and OS queues */
+        CRITICAL_START ();
+
+        /* If every free block is spoken for, block the calling thread */
+        if (pool->num_free == pool->num_reserved)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Pool is empty, block the calling thread */
+
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Add current thread to the suspend list on this pool */
+                    if (tcbEnqueuePriority (&pool->suspQ, curr_tcb_ptr) != ATOM_OK)
+                    {
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* There was an error putting this thread on the suspend list */
+                        status = ATOM_ERR_QUEUE;
+                    }
+                    else
+                    {
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /* Track errors */
+                        status = ATOM_OK;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /* Fill out the data needed by the callback to wake us up */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.pool_ptr = pool;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomMemPoolTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we can
+                             * cancel the timer callback if a block is freed
+                             * before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                (void)tcbDequeueEntry (&pool->suspQ, curr_tcb_ptr);
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors have occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomMemPoolFree() wakeups will set ATOM_OK
+                             * status, while timeouts will set ATOM_TIMEOUT and
+                             * pool deletions will set ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+
+                            /**
+                             * If we have been woken up with ATOM_OK then a
+                             * block was freed and reserved for this thread,
+                             * so that other threads allocating before we
+                             * were scheduled back in could not take it.
+                             * Claim it now.
+                             */
+                            if (status == ATOM_OK)
+                            {
+                                /* Enter critical region */
+                                CRITICAL_START ();
+
+                                /* Take the reserved block */
+                                pool->num_reserved--;
+                                *block_ptr = mempool_remove (pool);
+
+                                /* Exit critical region */
+                                CRITICAL_END ();
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Not currently in thread context, can't suspend */
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block and pool is empty */
+                CRITICAL_END();
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+        else
+        {
+            /* A block is available, take it */
+            *block_ptr = mempool_remove (pool);
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Successful */
+            status = ATOM_OK;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMemPoolFree
+ *
+ * Return a block to a memory pool.
+ *
+ * The block must have been allocated from the same pool using
+ * atomMemPoolAlloc(). If any threads are blocking waiting for a block, the
+ * highest priority one is woken and the block is reserved for it.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] pool Pointer to memory pool object
+ * @param[in] block_ptr Pointer to the block to free
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or block is not from this pool
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout for a woken thread
+ */
+uint8_t atomMemPoolFree (ATOM_MEMPOOL *pool, POINTER block_ptr)
+{
+    uint8_t status;
+    uint32_t offset;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+
+    /* Check parameters */
+    if ((pool == NULL) || ((uint8_t *)block_ptr < pool->buff_ptr))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Check the block lies on a block boundary within the pool */
+        offset = (uint32_t)((uint8_t *)block_ptr - pool->buff_ptr);
+        if ((offset >= (pool->block_size * pool->num_blocks))
+            || ((offset % pool->block_size) != 0))
+        {
+            /* Not one of our blocks */
+            status = ATOM_ERR_PARAM;
+        }
+        else
+        {
+            /* Protect access to the pool object and OS queues */
+            CRITICAL_START ();
+
+            /* Put the block back on the free list */
+            *(uint8_t **)block_ptr = pool->free_list;
+            pool->free_list = (uint8_t *)block_ptr;
+            pool->num_free++;
+
+            /* If any threads are blocking on the pool, wake up one */
+            if (pool->suspQ)
+            {
+                /**
+                 * Threads are woken up in priority order, with a FIFO system
+                 * used on same priority threads. We always take the head,
+                 * ordering is taken care of by an ordered list enqueue.
+                 */
+                tcb_ptr = tcbDequeueHead (&pool->suspQ);
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* There was a problem putting the thread on the ready queue */
+                    status = ATOM_ERR_QUEUE;
+                }
+                else
+                {
+                    /* Reserve the block until the woken thread runs */
+                    pool->num_reserved++;
+
+                    /* Set OK status to be returned to the waiting thread */
+                    tcb_ptr->suspend_wake_status = ATOM_OK;
+
+                    /* If there's a timeout on this suspension, cancel it */
+                    if ((tcb_ptr->suspend_timo_cb != NULL)
+                        && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+                    {
+                        /* There was a problem cancelling a timeout */
+                        status = ATOM_ERR_TIMER;
+                    }
+                    else
+                    {
+                        /* Flag as no timeout registered */
+                        tcb_ptr->suspend_timo_cb = NULL;
+
+                        /* Successful */
+                        status = ATOM_OK;
+                    }
+
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /**
+                     * The scheduler may now make a policy decision to thread
+                     * switch if we are currently in thread context. If we are
+                     * in interrupt context it will be handled by atomIntExit().
+                     */
+                    if (atomCurrentContext())
+                        atomSched (FALSE);
+                }
+            }
+
+            /* If no threads waiting, just leave the block on the free list */
+            else
+            {
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Successful */
+                status = ATOM_OK;
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomMemPoolTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c MEMPOOL_TIMER object which is used to retrieve the
+ * pool details.
+ *
+ * @param[in] cb_data Pointer to a MEMPOOL_TIMER object
+ */
+static void atomMemPoolTimerCallback (POINTER cb_data)
+{
+    MEMPOOL_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the MEMPOOL_TIMER structure pointer */
+    timer_data_ptr = (MEMPOOL_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the pool's suspend list */
+        (void)tcbDequeueEntry (&timer_data_ptr->pool_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b mempool_remove
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Unlinks the first block from the pool's free list. Assumes the free list
+ * is not empty, which is already checked by the calling function with
+ * interrupts locked out.
+ *
+ * @param[in] pool Pointer to an ATOM_MEMPOOL object
+ *
+ * @return Pointer to the removed block
+ */
+static POINTER mempool_remove (ATOM_MEMPOOL *pool)
+{
+    uint8_t *block_ptr;
+
+    /* Take the head of the free list */
+    block_ptr = pool->free_list;
+    pool->free_list = *(uint8_t **)block_ptr;
+    pool->num_free--;
+
+    return ((POINTER)block_ptr);
+}
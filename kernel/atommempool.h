@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_MEMPOOL_H
+#define __ATOM_MEMPOOL_H
+
+typedef struct atom_mempool
+{
+    ATOM_TCB *  suspQ;          /* Queue of threads waiting for a block */
+    uint8_t *   buff_ptr;       /* Pointer to pool data area */
+    uint8_t *   free_list;      /* First free block (links stored in blocks) */
+    uint32_t    block_size;     /* Size of each block */
+    uint32_t    num_blocks;     /* Number of blocks in the pool */
+    uint32_t    num_free;       /* Number of blocks on the free list */
+    uint32_t    num_reserved;   /* Free blocks handed to woken threads */
+} ATOM_MEMPOOL;
+
+extern uint8_t atomMemPoolCreate (ATOM_MEMPOOL *pool, uint8_t *buff_ptr, uint32_t block_size, uint32_t num_blocks);
+extern uint8_t atomMemPoolDelete (ATOM_MEMPOOL *pool);
+extern uint8_t atomMemPoolAlloc (ATOM_MEMPOOL *pool, int32_t timeout, POINTER *block_ptr);
+extern uint8_t atomMemPoolFree (ATOM_MEMPOOL *pool, POINTER block_ptr);
+
+#endif /* __ATOM_MEMPOOL_H */
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Thread notification library.
+ *
+ *
+ * This module implements notifications sent directly to a thread, without
+ * any intermediate kernel object. Each thread has a 32-bit notification
+ * value held in its TCB, which can be used as a counter or as a set of
+ * event bits. It has the following features:
+ *
+ * \par Lightweight signalling
+ * Notifying a thread updates its value and, if it is waiting, readies it
+ * directly. There is no object to create, no suspend queue to walk and no
+ * RAM used beyond the TCB, making notifications the cheapest way for an
+ * interrupt handler to wake a particular thread.
+ *
+ * \par Counting and event-bit modes
+ * In counting mode each notification increments the value, and each wait
+ * consumes one, like a binary or counting semaphore owned by the thread.
+ * In event-bit mode notifications OR bits into the value, and a wait
+ * returns and clears all bits set, like an event flag group.
+ *
+ * \par Flexible blocking APIs
+ * Threads waiting for a notification can choose whether to block, block
+ * with timeout, or not block and return a relevent status code.
+ *
+ * \par Interrupt-safe calls
+ * Threads can be notified from interrupt context.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * No initialisation is required: the notification value of a thread is
+ * cleared by atomThreadCreate().
+ *
+ * A thread (or interrupt handler) notifies another thread using
+ * atomThreadNotify(), passing the target's TCB. The target thread waits for
+ * notifications using atomThreadNotifyWait(). A thread should use a single
+ * mode (counting or event bits) for all notifications sent to it.
+ *
+ * Only the target thread itself can wait on its notifications, so only one
+ * thread is ever woken and the wait involves no queueing.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomnotify.h"
+#include "atomtimer.h"
+
+
+/* Forward declarations */
+
+static void atomThreadNotifyTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomThreadNotify
+ *
+ * Sends a notification to a thread.
+ *
+ * In ATOM_NOTIFY_COUNT mode the thread's notification value is incremented
+ * (\c bits is ignored). In ATOM_NOTIFY_BITS mode \c bits are ORed into the
+ * thread's notification value.
+ *
+ * If the thread is blocking in atomThreadNotifyWait() and its value is now
+ * non-zero it is woken. If called at thread context then the scheduler will
+ * be called during this function which may schedule in the woken thread
+ * depending on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] tcb_ptr Pointer to the TCB of the thread to notify
+ * @param[in] mode ATOM_NOTIFY_COUNT or ATOM_NOTIFY_BITS
+ * @param[in] bits Bits to set (ATOM_NOTIFY_BITS mode only)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_OVF The notification count would overflow
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on the woken thread
+ */
+uint8_t atomThreadNotify (ATOM_TCB *tcb_ptr, uint8_t mode, uint32_t bits)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Check parameters */
+    if ((tcb_ptr == NULL)
+        || ((mode != ATOM_NOTIFY_COUNT) && (mode != ATOM_NOTIFY_BITS)))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the TCB and OS queues */
+        CRITICAL_START ();
+
+        /* Update the notification value */
+        status = ATOM_OK;
+        woken = FALSE;
+        if (mode == ATOM_NOTIFY_BITS)
+        {
+            tcb_ptr->notify_value |= bits;
+        }
+        else if (tcb_ptr->notify_value == 0xFFFFFFFF)
+        {
+            /* Count is already at its maximum */
+            status = ATOM_ERR_OVF;
+        }
+        else
+        {
+            tcb_ptr->notify_value++;
+        }
+
+        /* Wake the thread if it is waiting and now has a notification */
+        if ((status == ATOM_OK) && (tcb_ptr->notify_waiting == TRUE)
+            && (tcb_ptr->notify_value != 0))
+        {
+            /* Put the thread on the ready queue */
+            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+            {
+                /* There was a problem putting the thread on the ready queue */
+                status = ATOM_ERR_QUEUE;
+            }
+            else
+            {
+                /* Set OK status to be returned to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_OK;
+                tcb_ptr->notify_waiting = FALSE;
+                woken = TRUE;
+
+                /* If there's a timeout on this suspension, cancel it */
+                if ((tcb_ptr->suspend_timo_cb != NULL)
+                    && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+                {
+                    /* There was a problem cancelling a timeout */
+                    status = ATOM_ERR_TIMER;
+                }
+                else
+                {
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+                }
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadNotifyWait
+ *
+ * Waits for a notification to the calling thread.
+ *
+ * If the calling thread's notification value is non-zero it is returned in
+ * \c value_ptr and consumed: in ATOM_NOTIFY_COUNT mode the value is
+ * decremented, and in ATOM_NOTIFY_BITS mode it is cleared. Otherwise the
+ * call will do one of the following depending on the \c timeout value
+ * specified:
+ *
+ * \c timeout == 0 : Call will block until notified \n
+ * \c timeout > 0 : Call will block until notified or the specified timeout \n
+ * \c timeout == -1 : Return immediately if not notified \n
+ *
+ * Must only be called from thread context.
+ *
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] mode ATOM_NOTIFY_COUNT or ATOM_NOTIFY_BITS
+ * @param[out] value_ptr Pointer to which the notification value is written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Timed out before being notified
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 and not notified
+ * @retval ATOM_ERR_CONTEXT Not called from thread context
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomThreadNotifyWait (int32_t timeout, uint8_t mode, uint32_t *value_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if ((value_ptr == NULL)
+        || ((mode != ATOM_NOTIFY_COUNT) && (mode != ATOM_NOTIFY_BITS)))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context, no thread to wait for */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Protect access to the TCB and OS queues */
+        CRITICAL_START ();
+
+        /* Block if there is no notification yet */
+        status = ATOM_OK;
+        if (curr_tcb_ptr->notify_value == 0)
+        {
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else
+            {
+                /* Flag as waiting so that notifications wake us */
+                curr_tcb_ptr->suspended = TRUE;
+                curr_tcb_ptr->notify_waiting = TRUE;
+                curr_tcb_ptr->suspend_timo_cb = NULL;
+
+                /* Register a timer callback if requested */
+                if (timeout)
+                {
+                    /* The callback only needs to know which thread to wake */
+                    timer_cb.cb_func = atomThreadNotifyTimerCallback;
+                    timer_cb.cb_data = (POINTER)curr_tcb_ptr;
+                    timer_cb.cb_ticks = timeout;
+
+                    /**
+                     * Store the timer details in the TCB so that we can
+                     * cancel the timer callback if the thread is notified
+                     * before the timeout occurs.
+                     */
+                    curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                    /* Register a callback on timeout */
+                    if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                    {
+                        /* Timer registration failed, clean up */
+                        status = ATOM_ERR_TIMER;
+                        curr_tcb_ptr->suspended = FALSE;
+                        curr_tcb_ptr->notify_waiting = FALSE;
+                        curr_tcb_ptr->suspend_timo_cb = NULL;
+                    }
+                }
+
+                /* Block until notified or timed out */
+                if (status == ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Current thread now blocking, schedule in a new one */
+                    atomSched (FALSE);
+
+                    /**
+                     * Notifications will set ATOM_OK status, while
+                     * timeouts will set ATOM_TIMEOUT.
+                     */
+                    status = curr_tcb_ptr->suspend_wake_status;
+
+                    /* Re-enter critical region to consume the value */
+                    CRITICAL_START ();
+                }
+            }
+        }
+
+        /* Return and consume the notification */
+        if (status == ATOM_OK)
+        {
+            *value_ptr = curr_tcb_ptr->notify_value;
+            if (mode == ATOM_NOTIFY_COUNT)
+            {
+                curr_tcb_ptr->notify_value--;
+            }
+            else
+            {
+                curr_tcb_ptr->notify_value = 0;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadNotifyTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on threads waiting for notifications are notified by the timer
+ * system through this callback. The timer system calls us back with a
+ * pointer to the waiting thread's TCB.
+ *
+ * @param[in] cb_data Pointer to the waiting thread's TCB
+ */
+static void atomThreadNotifyTimerCallback (POINTER cb_data)
+{
+    ATOM_TCB *tcb_ptr;
+    CRITICAL_STORE;
+
+    /* Get the TCB pointer */
+    tcb_ptr = (ATOM_TCB *)cb_data;
+
+    /* Check parameter is valid */
+    if (tcb_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no longer waiting, and no timeout registered */
+        tcb_ptr->notify_waiting = FALSE;
+        tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Periodic thread library.
+ *
+ *
+ * This module implements kernel-managed periodic threads, for rate
+ * monotonic designs where each thread runs one job per period. It has the
+ * following features:
+ *
+ * \par Drift-free releases
+ * Each thread is released by a kernel timer exactly once per period, at
+ * a fixed phase from its creation. Releases do not drift however long
+ * each job takes, unlike a thread which calls atomTimerDelay() at the end
+ * of each job.
+ *
+ * \par Timing health statistics
+ * For each thread the kernel counts completed jobs, overruns (a release
+ * which occurred while the previous job was still running) and deadline
+ * misses, and records the worst-case release jitter (release to job
+ * start) and worst-case response time (release to job completion).
+ * Overrun releases are not lost: the next job starts immediately.
+ *
+ * \par Interrupt-safe stop
+ * Releases can be stopped from thread or interrupt context, which wakes
+ * the thread if it is waiting for its next release.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * Periodic threads are created using atomThreadCreatePeriodic(), which
+ * takes the same parameters as atomThreadCreate() plus an ATOM_PERIODIC
+ * control block and the period, phase (ticks until the first release,
+ * 0 to release immediately) and relative deadline (0 to use the period).
+ *
+ * The thread calls atomThreadWaitNextPeriod() at the start of each job,
+ * typically at the top of its main loop. The call blocks until the next
+ * release, and also marks completion of the previous job, so any setup
+ * code before the first call is not timed:
+ *
+ * \code
+ * while (1)
+ * {
+ *     if (atomThreadWaitNextPeriod() != ATOM_OK)
+ *         break;
+ *     do_job();
+ * }
+ * \endcode
+ *
+ * Statistics can be read at any time with atomThreadPeriodicStats().
+ * Releases stop automatically when the thread exits, or can be stopped
+ * with atomThreadStopPeriodic(), after which atomThreadWaitNextPeriod()
+ * returns ATOM_ERR_DELETED.
+ *
+ * Times are measured at system tick resolution.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomperiodic.h"
+#include "atomtimer.h"
+
+
+/* Forward declarations */
+
+static void atomPeriodicThreadShell (uint32_t param);
+static void atomPeriodicTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomThreadCreatePeriodic
+ *
+ * Creates a periodic thread.
+ *
+ * The thread is created as by atomThreadCreate(), and its first job is
+ * released \c phase ticks from now (or immediately if \c phase is zero).
+ * Further jobs are released every \c period ticks after that.
+ *
+ * The ATOM_PERIODIC control block must remain in existence until the
+ * thread has exited. The release timer is cancelled when the thread exits,
+ * so once atomThreadJoin() on the thread returns the control block can be
+ * reused, for example to create the thread again.
+ *
+ * @param[in] per_ptr Pointer to periodic control block
+ * @param[in] tcb_ptr Pointer to the thread's TCB storage
+ * @param[in] priority Priority of the thread (0 to 255)
+ * @param[in] entry_point Thread entry point
+ * @param[in] entry_param Parameter passed to thread entry point
+ * @param[in] stack_top Top of the stack area
+ * @param[in] stack_size Size of the stack area in bytes
+ * @param[in] period Release period in ticks
+ * @param[in] phase Ticks until the first release (0 = immediately)
+ * @param[in] deadline Relative deadline in ticks (0 = period)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_TIMER Problem registering the release timer
+ * @retval ATOM_ERROR Problem creating the thread
+ */
+uint8_t atomThreadCreatePeriodic (ATOM_PERIODIC *per_ptr, ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_point)(uint32_t), uint32_t entry_param, void *stack_top, uint32_t stack_size, uint32_t period, uint32_t phase, uint32_t deadline)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((per_ptr == NULL) || (tcb_ptr == NULL) || (entry_point == NULL)
+        || (period == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Set up the control block */
+        per_ptr->tcb_ptr = tcb_ptr;
+        per_ptr->entry_point = entry_point;
+        per_ptr->entry_param = entry_param;
+        per_ptr->period = period;
+        per_ptr->deadline = deadline ? deadline : period;
+        per_ptr->waiting = FALSE;
+        per_ptr->in_job = FALSE;
+        per_ptr->stopped = FALSE;
+        per_ptr->stats.jobs = 0;
+        per_ptr->stats.overruns = 0;
+        per_ptr->stats.deadline_misses = 0;
+        per_ptr->stats.max_jitter = 0;
+        per_ptr->stats.max_response = 0;
+
+        /* Protect the release time from the tick */
+        CRITICAL_START ();
+
+        /**
+         * The release time held is that of the previous job: it is
+         * advanced by one period as each job starts.
+         */
+        if (phase == 0)
+        {
+            /* First job is released now, the next after one period */
+            per_ptr->pending = 1;
+            per_ptr->release_time = atomTimeGet() - period;
+            per_ptr->timer.cb_ticks = period;
+        }
+        else
+        {
+            /* First job is released after the phase */
+            per_ptr->pending = 0;
+            per_ptr->release_time = atomTimeGet() + phase - period;
+            per_ptr->timer.cb_ticks = phase;
+        }
+
+        /* Register the release timer */
+        per_ptr->timer.cb_func = atomPeriodicTimerCallback;
+        per_ptr->timer.cb_data = (POINTER)per_ptr;
+        if (atomTimerRegister (&per_ptr->timer) != ATOM_OK)
+        {
+            /* Timer registration failed */
+            status = ATOM_ERR_TIMER;
+        }
+        else
+        {
+            status = ATOM_OK;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Create the thread. It starts in a shell which links the control
+         * block to the TCB before calling the real entry point, so that
+         * it is in place whatever the thread's priority.
+         */
+        if ((status == ATOM_OK)
+            && (atomThreadCreate (tcb_ptr, priority, atomPeriodicThreadShell,
+                    (uint32_t)per_ptr, stack_top, stack_size) != ATOM_OK))
+        {
+            /* Thread creation failed, stop the releases */
+            (void)atomTimerCancel (&per_ptr->timer);
+            status = ATOM_ERROR;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadWaitNextPeriod
+ *
+ * Completes the current job of the calling periodic thread and waits for
+ * the release of its next job.
+ *
+ * Completion of the current job is recorded in the thread's statistics:
+ * the response time since the job's release is checked against the
+ * worst case seen and the thread's relative deadline.
+ *
+ * If the next job has already been released (the current job overran)
+ * the call returns immediately, otherwise it blocks until the release.
+ * The delay between release and the job starting is recorded as the
+ * release jitter.
+ *
+ * Must only be called from a thread created by atomThreadCreatePeriodic().
+ *
+ * @retval ATOM_OK Success, the next job has been released
+ * @retval ATOM_ERR_CONTEXT Not called from thread context
+ * @retval ATOM_ERR_PARAM Calling thread is not periodic
+ * @retval ATOM_ERR_DELETED Releases were stopped
+ */
+uint8_t atomThreadWaitNextPeriod (void)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint32_t elapsed;
+    ATOM_TCB *curr_tcb_ptr;
+    ATOM_PERIODIC *per_ptr;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Check parameters */
+    if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else if ((per_ptr = curr_tcb_ptr->periodic) == NULL)
+    {
+        /* Not a periodic thread */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the control block */
+        CRITICAL_START ();
+
+        /* Record completion of the current job */
+        if (per_ptr->in_job == TRUE)
+        {
+            per_ptr->in_job = FALSE;
+            per_ptr->stats.jobs++;
+            elapsed = atomTimeGet() - per_ptr->release_time;
+            if (elapsed > per_ptr->stats.max_response)
+            {
+                per_ptr->stats.max_response = elapsed;
+            }
+            if (elapsed > per_ptr->deadline)
+            {
+                per_ptr->stats.deadline_misses++;
+            }
+        }
+
+        /* Wait for the next release unless it has already happened */
+        status = ATOM_OK;
+        if (per_ptr->pending > 0)
+        {
+            /* Overran into the next release, start it straight away */
+            per_ptr->pending--;
+        }
+        else if (per_ptr->stopped == TRUE)
+        {
+            /* No more releases will occur */
+            status = ATOM_ERR_DELETED;
+        }
+        else
+        {
+            /* Block until the release timer wakes us */
+            curr_tcb_ptr->suspended = TRUE;
+            per_ptr->waiting = TRUE;
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Current thread now blocking, schedule in a new one */
+            atomSched (FALSE);
+
+            /**
+             * Releases will set ATOM_OK status, while stopping the
+             * releases will set ATOM_ERR_DELETED.
+             */
+            status = curr_tcb_ptr->suspend_wake_status;
+
+            /* Re-enter critical region */
+            CRITICAL_START ();
+        }
+
+        /* Start the next job */
+        if (status == ATOM_OK)
+        {
+            per_ptr->in_job = TRUE;
+            per_ptr->release_time += per_ptr->period;
+            elapsed = atomTimeGet() - per_ptr->release_time;
+            if (elapsed > per_ptr->stats.max_jitter)
+            {
+                per_ptr->stats.max_jitter = elapsed;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadStopPeriodic
+ *
+ * Stops the releases of a periodic thread.
+ *
+ * If the thread is waiting in atomThreadWaitNextPeriod() it is woken with
+ * ATOM_ERR_DELETED, as are any later calls once released jobs have been
+ * started. If called at thread context then the scheduler will be called
+ * during this function which may schedule in the woken thread depending
+ * on relative priorities.
+ *
+ * It is not necessary to call this for threads which exit, their releases
+ * stop automatically.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] per_ptr Pointer to periodic control block
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the woken thread on the ready queue
+ */
+uint8_t atomThreadStopPeriodic (ATOM_PERIODIC *per_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Check parameters */
+    if (per_ptr == NULL)
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the control block and OS queues */
+        CRITICAL_START ();
+
+        /* Cancel the release timer if it is still running */
+        status = ATOM_OK;
+        woken = FALSE;
+        if (per_ptr->stopped == FALSE)
+        {
+            per_ptr->stopped = TRUE;
+            (void)atomTimerCancel (&per_ptr->timer);
+        }
+
+        /* Wake the thread if it is waiting for a release */
+        if (per_ptr->waiting == TRUE)
+        {
+            if (tcbEnqueuePriority (&tcbReadyQ, per_ptr->tcb_ptr) != ATOM_OK)
+            {
+                /* There was a problem putting the thread on the ready queue */
+                status = ATOM_ERR_QUEUE;
+            }
+            else
+            {
+                /* Set error status to be returned to the waiting thread */
+                per_ptr->tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+                per_ptr->waiting = FALSE;
+                woken = TRUE;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomThreadPeriodicStats
+ *
+ * Reads the timing statistics of a periodic thread.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] per_ptr Pointer to periodic control block
+ * @param[out] stats_ptr Pointer to which the statistics are written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomThreadPeriodicStats (ATOM_PERIODIC *per_ptr, ATOM_PERIODIC_STATS *stats_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if ((per_ptr == NULL) || (stats_ptr == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Take a consistent copy */
+        CRITICAL_START ();
+        *stats_ptr = per_ptr->stats;
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomPeriodicThreadShell
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point of all periodic threads. Links the periodic control block
+ * to the thread's TCB and calls the application's entry point, stopping
+ * the releases if it returns.
+ *
+ * @param[in] param Pointer to the periodic control block
+ *
+ * @return None
+ */
+static void atomPeriodicThreadShell (uint32_t param)
+{
+    CRITICAL_STORE;
+    ATOM_PERIODIC *per_ptr;
+
+    /* Link the control block to this thread */
+    per_ptr = (ATOM_PERIODIC *)param;
+    per_ptr->tcb_ptr->periodic = per_ptr;
+
+    /* Run the application's thread */
+    per_ptr->entry_point (per_ptr->entry_param);
+
+    /**
+     * The thread has returned, so stop its releases now rather than
+     * relying on the port's thread startup routine to call
+     * atomThreadExit().
+     */
+    CRITICAL_START ();
+    per_ptr->stopped = TRUE;
+    (void)atomTimerCancel (&per_ptr->timer);
+    per_ptr->tcb_ptr->periodic = NULL;
+    CRITICAL_END ();
+}
+
+
+/**
+ * \b atomPeriodicTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Releases of periodic threads are made by the timer system through this
+ * callback, which re-registers itself for the following release. A waiting
+ * thread is readied, otherwise the release is held pending until the
+ * thread next calls atomThreadWaitNextPeriod().
+ *
+ * @param[in] cb_data Pointer to the periodic control block
+ */
+static void atomPeriodicTimerCallback (POINTER cb_data)
+{
+    ATOM_PERIODIC *per_ptr;
+    CRITICAL_STORE;
+
+    /* Get the control block pointer */
+    per_ptr = (ATOM_PERIODIC *)cb_data;
+
+    /* Check parameter is valid */
+    if (per_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        if (per_ptr->waiting == TRUE)
+        {
+            /* Release the waiting thread */
+            per_ptr->waiting = FALSE;
+            per_ptr->tcb_ptr->suspend_wake_status = ATOM_OK;
+            (void)tcbEnqueuePriority (&tcbReadyQ, per_ptr->tcb_ptr);
+        }
+        else
+        {
+            /* Thread still busy, hold the release for it */
+            per_ptr->pending++;
+            if (per_ptr->in_job == TRUE)
+            {
+                per_ptr->stats.overruns++;
+            }
+        }
+
+        /* Re-register for the next release */
+        per_ptr->timer.cb_ticks = per_ptr->period;
+        (void)atomTimerRegister (&per_ptr->timer);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_PERIODIC_H
+#define __ATOM_PERIODIC_H
+
+#include "atomtimer.h"
+
+typedef struct atom_periodic_stats
+{
+    uint32_t    jobs;           /* Number of jobs completed */
+    uint32_t    overruns;       /* Releases which occurred while still busy */
+    uint32_t    deadline_misses;/* Jobs completed after their deadline */
+    uint32_t    max_jitter;     /* Worst-case release to job start, in ticks */
+    uint32_t    max_response;   /* Worst-case release to job completion, in ticks */
+} ATOM_PERIODIC_STATS;
+
+typedef struct atom_periodic
+{
+    ATOM_TCB *  tcb_ptr;        /* Periodic thread */
+    void        (*entry_point)(uint32_t); /* Thread entry point */
+    uint32_t    entry_param;    /* Thread entry parameter */
+    ATOM_TIMER  timer;          /* Release timer */
+    uint32_t    period;         /* Release period in ticks */
+    uint32_t    deadline;       /* Relative deadline in ticks */
+    uint32_t    release_time;   /* Nominal release time of the current job */
+    uint32_t    pending;        /* Releases not yet started by the thread */
+    uint8_t     waiting;        /* TRUE if blocked waiting for a release */
+    uint8_t     in_job;         /* TRUE if a job is in progress */
+    uint8_t     stopped;        /* TRUE once releases have been stopped */
+    ATOM_PERIODIC_STATS stats;  /* Timing statistics */
+} ATOM_PERIODIC;
+
+extern uint8_t atomThreadCreatePeriodic (ATOM_PERIODIC *per_ptr, ATOM_TCB *tcb_ptr, uint8_t priority, void (*entry_point)(uint32_t), uint32_t entry_param, void *stack_top, uint32_t stack_size, uint32_t period, uint32_t phase, uint32_t deadline);
+extern uint8_t atomThreadWaitNextPeriod (void);
+extern uint8_t atomThreadStopPeriodic (ATOM_PERIODIC *per_ptr);
+extern uint8_t atomThreadPeriodicStats (ATOM_PERIODIC *per_ptr, ATOM_PERIODIC_STATS *stats_ptr);
+
+#endif /* __ATOM_PERIODIC_H */
@@ -60,5 +60,11 @@
 /* Uncomment to enable stack-checking */
 /* #define ATOM_STACK_CHECKING */
 
+/* Uncomment to enable the earliest-deadline-first scheduling class */
+/* #define ATOM_EDF */
+
+/* Uncomment to enable per-thread CPU budget enforcement */
+/* #define ATOM_CPU_BUDGETS */
+
 
 #endif /* __ATOM_PORT_H */
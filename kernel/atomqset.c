@@ -0,0 +1,830 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Queue set library.
+ *
+ *
+ * This module allows a single thread to block waiting on several queues
+ * and semaphores at once, rather than polling each in turn or dedicating a
+ * thread (and stack) to each object. It has the following features:
+ *
+ * \par Mixed member types
+ * A set can contain any combination of queues and semaphores. The thread
+ * is woken as soon as any one of them has a message or count available.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to make a call which may block can choose whether to
+ * block, block with timeout, or not block and return a relevent status
+ * code.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are blocking on a set, they are woken in order of
+ * the threads' priorities. Where multiple threads of the same priority are
+ * blocking, they are woken in FIFO order.
+ *
+ * \par Smart set deletion
+ * Where a set is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A queue set is initialised by calling atomQSetCreate(), passing storage
+ * for the number of members required. Queues and semaphores which have
+ * already been created are then added using atomQSetAddQueue() and
+ * atomQSetAddSem(). An object can only be a member of one set at a time.
+ *
+ * A thread calls atomQSetWait() to block until any member is ready. The
+ * call returns a pointer to the ready member, which the thread should then
+ * read with a non-blocking atomQueueGet() or atomSemGet() (timeout -1).
+ * Where several members are ready the one added to the set first is
+ * reported, so members should be added in order of importance.
+ *
+ * atomQSetWait() does not itself remove the message or decrement the
+ * count. If other threads also read a member directly they may take the
+ * message first, in which case the non-blocking read returns
+ * ATOM_WOULDBLOCK and the thread should simply wait on the set again.
+ *
+ * Objects must be removed from a set using atomQSetRemove() before they
+ * are deleted. A set which is no longer required can be deleted using
+ * atomQSetDelete(), which removes all members and wakes up any threads
+ * waiting on the set.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomsem.h"
+#include "atomqset.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct qset_timer
+{
+    ATOM_TCB   *tcb_ptr;    /* Thread which is suspended with timeout */
+    ATOM_QSET  *qset_ptr;   /* Queue set the thread is waiting on */
+} QSET_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t qset_add (ATOM_QSET *qset, uint8_t type, POINTER obj_ptr, struct atom_qset **member_qset);
+static POINTER qset_find_ready (ATOM_QSET *qset);
+static void qset_detach (ATOM_QSET_ENTRY *entry);
+static void atomQSetTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomQSetCreate
+ *
+ * Initialises a queue set object.
+ *
+ * Must be called before calling any other queue set library routines on
+ * the set. Objects can be deleted later using atomQSetDelete().
+ *
+ * Does not allocate storage, the caller provides the set object and an
+ * array of \c max_entries member entries.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qset Pointer to queue set object
+ * @param[in] entries Pointer to storage for the member entries
+ * @param[in] max_entries Maximum number of members
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomQSetCreate (ATOM_QSET *qset, ATOM_QSET_ENTRY *entries, uint8_t max_entries)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((qset == NULL) || (entries == NULL) || (max_entries == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the member storage details, no members yet */
+        qset->entries = entries;
+        qset->max_entries = max_entries;
+        qset->num_entries = 0;
+
+        /* Initialise the suspended threads queue */
+        qset->suspQ = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetDelete
+ *
+ * Deletes a queue set object.
+ *
+ * All members are removed from the set. Any threads currently suspended on
+ * the set will be woken up with return status ATOM_ERR_DELETED. If called
+ * at thread context then the scheduler will be called during this function
+ * which may schedule in one of the woken threads depending on relative
+ * priorities.
+ *
+ * This function can be called from interrupt context, but loops internally
+ * waking up all threads blocking on the set, so the potential execution
+ * cycles cannot be determined in advance.
+ *
+ * @param[in] qset Pointer to queue set object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomQSetDelete (ATOM_QSET *qset)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (qset == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Detach all members so they no longer notify the set */
+        CRITICAL_START ();
+        while (qset->num_entries > 0)
+        {
+            qset->num_entries--;
+            qset_detach (&qset->entries[qset->num_entries]);
+        }
+        CRITICAL_END ();
+
+        /* Wake up all suspended tasks */
+        while (1)
+        {
+            /* Enter critical region */
+            CRITICAL_START ();
+
+            /* Check if any threads are suspended */
+            if ((tcb_ptr = tcbDequeueHead (&qset->suspQ)) != NULL)
+            {
+                /* Return error status to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+
+                /* Put the thread on the ready queue */
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Quit the loop, returning error */
+                    status = ATOM_ERR_QUEUE;
+                    break;
+                }
+
+                /* If there's a timeout on this suspension, cancel it */
+                if (tcb_ptr->suspend_timo_cb)
+                {
+                    /* Cancel the callback */
+                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+                    {
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Quit the loop, returning error */
+                        status = ATOM_ERR_TIMER;
+                        break;
+                    }
+
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+
+                }
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Request a reschedule */
+                woken_threads = TRUE;
+            }
+
+            /* No more suspended threads */
+            else
+            {
+                /* Exit critical region and quit the loop */
+                CRITICAL_END ();
+                break;
+            }
+        }
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetAddQueue
+ *
+ * Add a queue to a queue set.
+ *
+ * The queue must already have been created, and must not be a member of
+ * any other set.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qset Pointer to queue set object
+ * @param[in] qptr Pointer to queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or queue already in a set
+ * @retval ATOM_ERR_OVF The set is full
+ */
+uint8_t atomQSetAddQueue (ATOM_QSET *qset, ATOM_QUEUE *qptr)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (qptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Add to the set */
+        status = qset_add (qset, ATOM_QSET_QUEUE, (POINTER)qptr, &qptr->qset);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetAddSem
+ *
+ * Add a semaphore to a queue set.
+ *
+ * The semaphore must already have been created, and must not be a member
+ * of any other set.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qset Pointer to queue set object
+ * @param[in] sem Pointer to semaphore object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or semaphore already in a set
+ * @retval ATOM_ERR_OVF The set is full
+ */
+uint8_t atomQSetAddSem (ATOM_QSET *qset, ATOM_SEM *sem)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if (sem == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Add to the set */
+        status = qset_add (qset, ATOM_QSET_SEM, (POINTER)sem, &sem->qset);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetRemove
+ *
+ * Remove a queue or semaphore from a queue set.
+ *
+ * The order of the remaining members is preserved.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qset Pointer to queue set object
+ * @param[in] obj_ptr Pointer to the queue or semaphore object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_NOT_FOUND The object is not a member of the set
+ */
+uint8_t atomQSetRemove (ATOM_QSET *qset, POINTER obj_ptr)
+{
+    uint8_t status;
+    uint8_t i;
+    CRITICAL_STORE;
+
+    /* Parameter check */
+    if ((qset == NULL) || (obj_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the set and its members */
+        CRITICAL_START ();
+
+        /* Search for the member */
+        status = ATOM_ERR_NOT_FOUND;
+        for (i = 0; i < qset->num_entries; i++)
+        {
+            if (qset->entries[i].obj_ptr == obj_ptr)
+            {
+                /* Found it, stop the object notifying us */
+                qset_detach (&qset->entries[i]);
+
+                /* Close the gap, keeping the members in order */
+                qset->num_entries--;
+                for (; i < qset->num_entries; i++)
+                {
+                    qset->entries[i] = qset->entries[i + 1];
+                }
+
+                /* Successful */
+                status = ATOM_OK;
+                break;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetWait
+ *
+ * Wait until any member of a queue set is ready.
+ *
+ * A queue member is ready when it has a message available, and a semaphore
+ * member is ready when its count is non-zero. A pointer to the ready
+ * member is returned in \c ready_ptr, and should be compared against the
+ * member objects to find which one to read. If several members are ready
+ * the one added to the set first is returned.
+ *
+ * The message or count is not consumed by this call. The caller should
+ * read the returned member using atomQueueGet() or atomSemGet() with a
+ * timeout of -1.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if no member is ready:
+ *
+ * \c timeout == 0 : Call will block until a member is ready \n
+ * \c timeout > 0 : Call will block until a member is ready or timeout \n
+ * \c timeout == -1 : Return immediately if no member is ready \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qset Pointer to queue set object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] ready_ptr Pointer to which the ready member will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT No member became ready before the timeout expired
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but no member is ready
+ * @retval ATOM_ERR_DELETED Set was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomQSetWait (ATOM_QSET *qset, int32_t timeout, POINTER *ready_ptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    POINTER ready = NULL;
+    uint32_t start_time, elapsed;
+    int32_t ticks_left;
+    QSET_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((qset == NULL) || (ready_ptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Note the start time for any repeated blocking */
+        start_time = atomTimeGet ();
+        ticks_left = timeout;
+        status = ATOM_OK;
+
+        /* Protect access to the set, its members and OS queues */
+        CRITICAL_START ();
+
+        /* Block until a member is ready */
+        while ((status == ATOM_OK) && ((ready = qset_find_ready (qset)) == NULL))
+        {
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+            else if (tcbEnqueuePriority (&qset->suspQ, curr_tcb_ptr) != ATOM_OK)
+            {
+                /* There was an error putting this thread on the suspend list */
+                status = ATOM_ERR_QUEUE;
+            }
+            else
+            {
+                /* Set suspended status for the thread */
+                curr_tcb_ptr->suspended = TRUE;
+                curr_tcb_ptr->suspend_timo_cb = NULL;
+
+                /* Register a timer callback if requested */
+                if (ticks_left)
+                {
+                    /* Fill out the data needed by the callback to wake us up */
+                    timer_data.tcb_ptr = curr_tcb_ptr;
+                    timer_data.qset_ptr = qset;
+
+                    /* Fill out the timer callback request structure */
+                    timer_cb.cb_func = atomQSetTimerCallback;
+                    timer_cb.cb_data = (POINTER)&timer_data;
+                    timer_cb.cb_ticks = ticks_left;
+
+                    /* Store the timer details in the TCB for cancellation */
+                    curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                    /* Register a callback on timeout */
+                    if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                    {
+                        /* Timer registration failed, clean up */
+                        status = ATOM_ERR_TIMER;
+                        (void)tcbDequeueEntry (&qset->suspQ, curr_tcb_ptr);
+                        curr_tcb_ptr->suspended = FALSE;
+                        curr_tcb_ptr->suspend_timo_cb = NULL;
+                    }
+                }
+
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    CRITICAL_END ();
+                    atomSched (FALSE);
+
+                    /* Woken because a member changed, or timeout/deletion */
+                    status = curr_tcb_ptr->suspend_wake_status;
+
+                    /* Work out how much of the timeout remains for a recheck */
+                    if ((status == ATOM_OK) && (timeout > 0))
+                    {
+                        elapsed = atomTimeGet () - start_time;
+                        if (elapsed >= (uint32_t)timeout)
+                            status = ATOM_TIMEOUT;
+                        else
+                            ticks_left = timeout - (int32_t)elapsed;
+                    }
+                    CRITICAL_START ();
+
+                    /* Report any member which became ready as we timed out */
+                    if ((status == ATOM_TIMEOUT) && (qset_find_ready (qset) != NULL))
+                    {
+                        status = ATOM_OK;
+                    }
+                }
+            }
+        }
+
+        /* Return the ready member */
+        if (status == ATOM_OK)
+        {
+            *ready_ptr = ready;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetNotify
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Called by member queues and semaphores when a message or count becomes
+ * available. Wakes all threads waiting on the set, which then recheck the
+ * members themselves. The caller is responsible for calling the scheduler
+ * if in thread context.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qset Pointer to queue set object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+uint8_t atomQSetNotify (ATOM_QSET *qset)
+{
+    uint8_t status;
+    ATOM_TCB *tcb_ptr;
+
+    /* Default to success if there are no threads waiting */
+    status = ATOM_OK;
+
+    /* Wake threads until none remain */
+    while ((status == ATOM_OK) && ((tcb_ptr = tcbDequeueHead (&qset->suspQ)) != NULL))
+    {
+        /* Move the waiting thread to the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+        {
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /* If there's a timeout on this suspension, cancel it */
+            if ((tcb_ptr->suspend_timo_cb != NULL)
+                && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+            {
+                /* There was a problem cancelling a timeout */
+                status = ATOM_ERR_TIMER;
+            }
+            else
+            {
+                /* Flag as no timeout registered */
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+        else
+        {
+            /**
+             * There was a problem putting the thread on the ready
+             * queue.
+             */
+            status = ATOM_ERR_QUEUE;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQSetTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c QSET_TIMER object which is used to retrieve the set
+ * details.
+ *
+ * @param[in] cb_data Pointer to a QSET_TIMER object
+ */
+static void atomQSetTimerCallback (POINTER cb_data)
+{
+    QSET_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the QSET_TIMER structure pointer */
+    timer_data_ptr = (QSET_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the set's suspend list */
+        (void)tcbDequeueEntry (&timer_data_ptr->qset_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b qset_add
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Appends a member object to a set, and points the object's set pointer
+ * at the set so that it notifies the set when it becomes ready. If the
+ * object is already ready then any threads waiting on the set are woken.
+ *
+ * @param[in] qset Pointer to queue set object
+ * @param[in] type Member object type
+ * @param[in] obj_ptr Pointer to the member object
+ * @param[in] member_qset Pointer to the member object's set pointer
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or object already in a set
+ * @retval ATOM_ERR_OVF The set is full
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+static uint8_t qset_add (ATOM_QSET *qset, uint8_t type, POINTER obj_ptr, struct atom_qset **member_qset)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+
+    /* Parameter check */
+    if (qset == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the set and the member object */
+        CRITICAL_START ();
+
+        if (*member_qset != NULL)
+        {
+            /* Already a member of a set */
+            status = ATOM_ERR_PARAM;
+        }
+        else if (qset->num_entries == qset->max_entries)
+        {
+            /* No room for another member */
+            status = ATOM_ERR_OVF;
+        }
+        else
+        {
+            /* Add the member */
+            qset->entries[qset->num_entries].type = type;
+            qset->entries[qset->num_entries].obj_ptr = obj_ptr;
+            qset->num_entries++;
+            *member_qset = qset;
+
+            /* Let any waiters recheck in case the new member is ready */
+            status = atomQSetNotify (qset);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Allow a woken waiter to be scheduled in */
+        if ((status == ATOM_OK) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b qset_find_ready
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Searches the set's members in the order they were added for one which
+ * has a message or count available.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qset Pointer to queue set object
+ *
+ * @return Pointer to the first ready member, or NULL if none are ready
+ */
+static POINTER qset_find_ready (ATOM_QSET *qset)
+{
+    POINTER ready;
+    ATOM_QUEUE *qptr;
+    ATOM_SEM *sem;
+    uint8_t i;
+
+    /* Default to nothing ready */
+    ready = NULL;
+
+    for (i = 0; (i < qset->num_entries) && (ready == NULL); i++)
+    {
+        if (qset->entries[i].type == ATOM_QSET_QUEUE)
+        {
+            /* Queues are ready if a message can be retrieved */
+            qptr = (ATOM_QUEUE *)qset->entries[i].obj_ptr;
+            if ((qptr->num_msgs_stored > 0) && (qptr->peeked == FALSE))
+                ready = qset->entries[i].obj_ptr;
+        }
+        else
+        {
+            /* Semaphores are ready if the count can be decremented */
+            sem = (ATOM_SEM *)qset->entries[i].obj_ptr;
+            if (sem->count > 0)
+                ready = qset->entries[i].obj_ptr;
+        }
+    }
+
+    return (ready);
+}
+
+
+/**
+ * \b qset_detach
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Clears a member object's set pointer so that it no longer notifies the
+ * set.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] entry Pointer to the member's set entry
+ */
+static void qset_detach (ATOM_QSET_ENTRY *entry)
+{
+    if (entry->type == ATOM_QSET_QUEUE)
+    {
+        ((ATOM_QUEUE *)entry->obj_ptr)->qset = NULL;
+    }
+    else
+    {
+        ((ATOM_SEM *)entry->obj_ptr)->qset = NULL;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_QSET_H
+#define __ATOM_QSET_H
+
+/* Forward declarations */
+struct atom_queue;
+struct atom_sem;
+
+/* Member object types */
+#define ATOM_QSET_QUEUE     1
+#define ATOM_QSET_SEM       2
+
+typedef struct atom_qset_entry
+{
+    uint8_t     type;           /* Member object type (ATOM_QSET_QUEUE etc) */
+    POINTER     obj_ptr;        /* Pointer to the member object */
+} ATOM_QSET_ENTRY;
+
+typedef struct atom_qset
+{
+    ATOM_TCB *  suspQ;          /* Queue of threads waiting on the set */
+    ATOM_QSET_ENTRY *entries;   /* Pointer to member storage */
+    uint8_t     max_entries;    /* Max number of members */
+    uint8_t     num_entries;    /* Number of members added */
+} ATOM_QSET;
+
+extern uint8_t atomQSetCreate (ATOM_QSET *qset, ATOM_QSET_ENTRY *entries, uint8_t max_entries);
+extern uint8_t atomQSetDelete (ATOM_QSET *qset);
+extern uint8_t atomQSetAddQueue (ATOM_QSET *qset, struct atom_queue *qptr);
+extern uint8_t atomQSetAddSem (ATOM_QSET *qset, struct atom_sem *sem);
+extern uint8_t atomQSetRemove (ATOM_QSET *qset, POINTER obj_ptr);
+extern uint8_t atomQSetWait (ATOM_QSET *qset, int32_t timeout, POINTER *ready_ptr);
+
+/* Internal hook used by member objects, not for use by application code */
+extern uint8_t atomQSetNotify (ATOM_QSET *qset);
+
+#endif /* __ATOM_QSET_H */
@@ -55,13 +55,19 @@
  *
  * \par Configurable queue sizes
  * Queues can be created with any sized message, and any number of stored
- * messages.
+ * messages. Queues of 1, 2 or 4 byte messages can additionally be accessed
+ * through typed variants of atomQueueGet() and atomQueuePut() which copy
+ * the message with a fixed-size copy generated at compile time.
  *
  * \par Smart queue deletion
  * Where a queue is deleted while threads are blocking on it, all blocking
  * threads are woken and returned a status code to indicate the reason for
  * being woken.
  *
+ * \par Zero-copy access
+ * Large messages can be filled in and processed directly within the queue
+ * buffer, avoiding the copy into and out of the queue storage.
+ *
  *
  * \n <b> Usage instructions: </b> \n
  *
@@ -84,6 +90,29 @@
  * indicating that the queue is full. This allows messages to be received
  * by interrupt handlers or threads which you do not wish to block.
  * 
+ * For large messages the copy in and out of the queue storage can be avoided
+ * by using atomQueueReserve() and atomQueueCommit() in place of
+ * atomQueuePut(), and atomQueuePeek() and atomQueueRelease() in place of
+ * atomQueueGet(). These hand out pointers directly into the queue buffer so
+ * that messages can be filled in and processed in place, with the same
+ * blocking and timeout behaviour as atomQueuePut() and atomQueueGet(). Only
+ * one slot may be reserved and one message held at a time on each queue.
+ *
+ * Queues of 1, 2 or 4 byte messages (bytes, words or pointers on most
+ * targets) can use atomQueuePut8(), atomQueuePut16() and atomQueuePut32()
+ * in place of atomQueuePut(), and atomQueueGet8(), atomQueueGet16() and
+ * atomQueueGet32() in place of atomQueueGet(). These take the same
+ * parameters and have the same blocking behaviour, but when the call can
+ * complete immediately the message is copied with straight-line code
+ * rather than a call to memcpy(), which is comparatively expensive on
+ * 8-bit architectures. They return ATOM_ERR_PARAM if the queue was created
+ * with a different message size.
+ *
+ * Bursts of messages can be sent and received using atomQueuePutMulti() and
+ * atomQueueGetMulti(), which transfer as many messages as possible in one
+ * call with a single critical region, rather than calling atomQueuePut() or
+ * atomQueueGet() once per message.
+ *
  * A queue which is no longer required can be deleted using atomQueueDelete().
  * This function automatically wakes up any threads which are waiting on the
  * deleted queue.
@@ -96,9 +125,101 @@
 
 #include "atom.h"
 #include "atomqueue.h"
+#include "atomqset.h"
 #include "atomtimer.h"
 
 
+/* Local macros */
+
+/**
+ * Fixed-size copies of a single 1, 2 or 4 byte message, used by the typed
+ * get and put variants. Byte accesses are used so that neither the caller's
+ * message nor the slot in the queue storage needs to be aligned.
+ */
+#define QUEUE_COPY8(dst, src)   ((dst)[0] = (src)[0])
+#define QUEUE_COPY16(dst, src)  ((dst)[0] = (src)[0], (dst)[1] = (src)[1])
+#define QUEUE_COPY32(dst, src)  ((dst)[0] = (src)[0], (dst)[1] = (src)[1], \
+                                 (dst)[2] = (src)[2], (dst)[3] = (src)[3])
+
+/**
+ * Generates atomQueueGet<bits>() and atomQueuePut<bits>() for messages of
+ * \c size bytes. If the call can complete without blocking the message is
+ * copied using QUEUE_COPY<bits>() within a single critical region,
+ * otherwise the call is handed on to atomQueueGet() or atomQueuePut() to
+ * block (which re-checks the queue, so nothing is lost in the gap).
+ */
+#define QUEUE_TYPED_FUNCS(bits, size)                                       \
+uint8_t atomQueueGet##bits (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr) \
+{                                                                           \
+    CRITICAL_STORE;                                                         \
+    uint8_t status;                                                         \
+                                                                            \
+    if ((qptr == NULL) || (msgptr == NULL) || (qptr->unit_size != (size)))  \
+    {                                                                       \
+        /* Bad pointer or wrong message size */                             \
+        status = ATOM_ERR_PARAM;                                            \
+    }                                                                       \
+    else                                                                    \
+    {                                                                       \
+        CRITICAL_START ();                                                  \
+        if ((qptr->num_msgs_stored == 0) || (qptr->peeked == TRUE))         \
+        {                                                                   \
+            /* Queue empty, take the generic (blocking) path */             \
+            CRITICAL_END ();                                                \
+            status = atomQueueGet (qptr, timeout, msgptr);                  \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            /* Copy the message out and free its slot */                    \
+            QUEUE_COPY##bits (msgptr, (qptr->buff_ptr + qptr->remove_index)); \
+            status = queue_release (qptr, 1);                               \
+            CRITICAL_END ();                                                \
+                                                                            \
+            /* Let the scheduler switch to any sender we woke */            \
+            if ((status == ATOM_OK) && atomCurrentContext())                \
+                atomSched (FALSE);                                          \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    return (status);                                                        \
+}                                                                           \
+                                                                            \
+uint8_t atomQueuePut##bits (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr) \
+{                                                                           \
+    CRITICAL_STORE;                                                         \
+    uint8_t status;                                                         \
+                                                                            \
+    if ((qptr == NULL) || (msgptr == NULL) || (qptr->unit_size != (size)))  \
+    {                                                                       \
+        /* Bad pointer or wrong message size */                             \
+        status = ATOM_ERR_PARAM;                                            \
+    }                                                                       \
+    else                                                                    \
+    {                                                                       \
+        CRITICAL_START ();                                                  \
+        if ((qptr->num_msgs_stored == qptr->max_num_msgs) || (qptr->reserved == TRUE)) \
+        {                                                                   \
+            /* Queue full, take the generic (blocking) path */              \
+            CRITICAL_END ();                                                \
+            status = atomQueuePut (qptr, timeout, msgptr);                  \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            /* Copy the message in and post it */                           \
+            QUEUE_COPY##bits ((qptr->buff_ptr + qptr->insert_index), msgptr); \
+            status = queue_commit (qptr, 1);                                \
+            CRITICAL_END ();                                                \
+                                                                            \
+            /* Let the scheduler switch to any receiver we woke */          \
+            if ((status == ATOM_OK) && atomCurrentContext())                \
+                atomSched (FALSE);                                          \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    return (status);                                                        \
+}
+
+
 /* Local data types */
 
 typedef struct queue_timer
@@ -113,6 +234,13 @@ typedef struct queue_timer
 
 static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr);
 static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr);
+static uint8_t queue_remove_multi (ATOM_QUEUE *qptr, uint8_t* msgptr, uint32_t num_msgs);
+static uint8_t queue_insert_multi (ATOM_QUEUE *qptr, uint8_t* msgptr, uint32_t num_msgs);
+static uint8_t queue_release (ATOM_QUEUE *qptr, uint32_t num_msgs);
+static uint8_t queue_commit (ATOM_QUEUE *qptr, uint32_t num_msgs);
+static uint8_t queue_suspend (ATOM_QUEUE *qptr, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, QUEUE_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr);
+static uint8_t queue_block (ATOM_QUEUE *qptr, ATOM_TCB **suspQ, int32_t timeout, uint32_t start_time, QUEUE_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr);
+static uint8_t queue_wake (ATOM_TCB **suspQ, uint32_t max_threads);
 static void atomQueueTimerCallback (POINTER cb_data);
 
 
@@ -165,6 +293,12 @@ uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size
         qptr->unit_size = unit_size;
         qptr->max_num_msgs = max_num_msgs;
 
+        /**
+         * Precalculate the storage size so that it is not recalculated on
+         * every put and get.
+         */
+        qptr->buff_size = unit_size * max_num_msgs;
+
         /* Initialise the suspended threads queues */
         qptr->putSuspQ = NULL;
         qptr->getSuspQ = NULL;
@@ -173,6 +307,14 @@ uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size
         qptr->insert_index = 0;
         qptr->remove_index = 0;
         qptr->num_msgs_stored = 0;
+        qptr->max_msgs_stored = 0;
+
+        /* No zero-copy slots handed out yet */
+        qptr->reserved = FALSE;
+        qptr->peeked = FALSE;
+
+        /* Not a member of any queue set */
+        qptr->qset = NULL;
 
         /* Successful */
         status = ATOM_OK;
@@ -318,6 +460,9 @@ uint8_t atomQueueDelete (ATOM_QUEUE *qptr)
  * is present on the queue for the specified number of system ticks, the
  * call will return with \c ATOM_TIMEOUT.
  *
+ * While a message is held by atomQueuePeek() the queue is treated as empty
+ * until the message is given back using atomQueueRelease().
+ *
  * This function can only be called from interrupt context if the \c timeout
  * parameter is -1 (in which case it does not block).
  *
@@ -340,7 +485,7 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
     uint8_t status;
     QUEUE_TIMER timer_data;
     ATOM_TIMER timer_cb;
-    ATOM_TCB *curr_tcb_ptr;
+    uint32_t start_time;
 
     /* Check parameters */
     if ((qptr == NULL) || (msgptr == NULL))
@@ -350,153 +495,57 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
     }
     else
     {
+        /* Note the start time for any repeated blocking */
+        start_time = (timeout > 0) ? atomTimeGet () : 0;
+        status = ATOM_OK;
+
         /* Protect access to the queue object and OS queues */
         CRITICAL_START ();
 
-        /* If no messages on the queue, block the calling thread */
-        if (qptr->num_msgs_stored == 0)
+        /**
+         * Block the calling thread until the queue is ready. A single
+         * call can wake several threads, so the check is repeated each
+         * time we are woken in case another thread got there first.
+         */
+        while ((status == ATOM_OK) && ((qptr->num_msgs_stored == 0) || (qptr->peeked == TRUE)))
         {
-            /* If called with timeout >= 0, we should block */
-            if (timeout >= 0)
+            /* Add current thread to the suspend list, if allowed to block */
+            status = queue_block (qptr, &qptr->getSuspQ, timeout, start_time,
+                                  &timer_data, &timer_cb);
+            if (status == ATOM_OK)
             {
-                /* Queue is empty, block the calling thread */
-
-                /* Get the current TCB */
-                curr_tcb_ptr = atomCurrentContext();
-
-                /* Check we are actually in thread context */
-                if (curr_tcb_ptr)
-                {
-                    /* Add current thread to the list suspended on receives */
-                    if (tcbEnqueuePriority (&qptr->getSuspQ, curr_tcb_ptr) == ATOM_OK)
-                    {
-                        /* Set suspended status for the current thread */
-                        curr_tcb_ptr->suspended = TRUE;
-
-                        /* Track errors */
-                        status = ATOM_OK;
-
-                        /* Register a timer callback if requested */
-                        if (timeout)
-                        {
-                            /**
-                             * Fill out the data needed by the callback to
-                             * wake us up.
-                             */
-                            timer_data.tcb_ptr = curr_tcb_ptr;
-                            timer_data.queue_ptr = qptr;
-                            timer_data.suspQ = &qptr->getSuspQ;
-
-                            /* Fill out the timer callback request structure */
-                            timer_cb.cb_func = atomQueueTimerCallback;
-                            timer_cb.cb_data = (POINTER)&timer_data;
-                            timer_cb.cb_ticks = timeout;
-
-                            /**
-                             * Store the timer details in the TCB so that we
-                             * can cancel the timer callback if the queue is
-                             * put before the timeout occurs.
-                             */
-                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
-
-                            /* Register a callback on timeout */
-                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
-                            {
-                                /* Timer registration failed */
-                                status = ATOM_ERR_TIMER;
-
-                                /* Clean up and return to the caller */
-                                (void)tcbDequeueEntry (&qptr->getSuspQ, curr_tcb_ptr);
-                                curr_tcb_ptr->suspended = FALSE;
-                                curr_tcb_ptr->suspend_timo_cb = NULL;
-                            }
-                        }
-
-                        /* Set no timeout requested */
-                        else
-                        {
-                            /* No need to cancel timeouts on this one */
-                            curr_tcb_ptr->suspend_timo_cb = NULL;
-                        }
+                /* Current thread now blocking, schedule in a new one */
+                CRITICAL_END ();
+                atomSched (FALSE);
 
-                        /* Exit critical region */
-                        CRITICAL_END ();
+                /**
+                 * Normal atomQueuePut() wakeups will set ATOM_OK
+                 * status, while timeouts will set ATOM_TIMEOUT and
+                 * queue deletions will set ATOM_ERR_DELETED.
+                 */
+                status = atomCurrentContext()->suspend_wake_status;
 
-                        /* Check no errors occurred */
-                        if (status == ATOM_OK)
-                        {
-                            /**
-                             * Current thread now blocking, schedule in a new
-                             * one. We already know we are in thread context
-                             * so can call the scheduler from here.
-                             */
-                            atomSched (FALSE);
-
-                            /**
-                             * Normal atomQueuePut() wakeups will set ATOM_OK
-                             * status, while timeouts will set ATOM_TIMEOUT
-                             * and queue deletions will set ATOM_ERR_DELETED.
-                             */
-                            status = curr_tcb_ptr->suspend_wake_status;
-
-                            /**
-                             * Check suspend_wake_status. If it is ATOM_OK
-                             * then we were woken because a message has been
-                             * put on the queue and we can now copy it out.
-                             * Otherwise we were woken because we timed out
-                             * waiting for a message, or the queue was
-                             * deleted, so we should just quit.
-                             */
-                            if (status == ATOM_OK)
-                            {
-                                /* Enter critical region */
-                                CRITICAL_START();
-
-                                /* Copy the message out of the queue */
-                                status = queue_remove (qptr, msgptr);
-
-                                /* Exit critical region */
-                                CRITICAL_END();
-                            }
-                        }
-                    }
-                    else
-                    {
-                        /* There was an error putting this thread on the suspend list */
-                        CRITICAL_END ();
-                        status = ATOM_ERR_QUEUE;
-                    }
-                }
-                else
-                {
-                    /* Not currently in thread context, can't suspend */
-                    CRITICAL_END ();
-                    status = ATOM_ERR_CONTEXT;
-                }
-            }
-            else
-            {
-                /* timeout == -1, requested not to block and queue is empty */
-                CRITICAL_END();
-                status = ATOM_WOULDBLOCK;
+                /* Re-enter critical region to check the queue again */
+                CRITICAL_START ();
             }
         }
-        else
+
+        /* Copy the message out of the queue */
+        if (status == ATOM_OK)
         {
-            /* No need to block, there is a message to copy out of the queue */
             status = queue_remove (qptr, msgptr);
+        }
 
-            /* Exit critical region */
-            CRITICAL_END ();
+        /* Exit critical region */
+        CRITICAL_END ();
 
-            /**
-             * The scheduler may now make a policy decision to thread
-             * switch if we are currently in thread context. If we are
-             * in interrupt context it will be handled by atomIntExit().
-             */
-            if (atomCurrentContext())
-                atomSched (FALSE);
-        }
+        /**
+         * The scheduler may now make a policy decision to thread
+         * switch if we are currently in thread context. If we are
+         * in interrupt context it will be handled by atomIntExit().
+         */
+        if ((status == ATOM_OK) && atomCurrentContext())
+            atomSched (FALSE);
     }
 
     return (status);
@@ -523,6 +572,9 @@ uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
  * is available on the queue for the specified number of system ticks, the
  * call will return with \c ATOM_TIMEOUT.
  *
+ * While a slot is reserved by atomQueueReserve() the queue is treated as
+ * full until the reserved message is posted using atomQueueCommit().
+ *
  * This function can only be called from interrupt context if the \c timeout
  * parameter is -1 (in which case it does not block and may fail to post a
  * message if the queue is full).
@@ -546,7 +598,7 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
     uint8_t status;
     QUEUE_TIMER timer_data;
     ATOM_TIMER timer_cb;
-    ATOM_TCB *curr_tcb_ptr;
+    uint32_t start_time;
 
     /* Check parameters */
     if ((qptr == NULL) || (msgptr == NULL))
@@ -556,155 +608,57 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
     }
     else
     {
+        /* Note the start time for any repeated blocking */
+        start_time = (timeout > 0) ? atomTimeGet () : 0;
+        status = ATOM_OK;
+
         /* Protect access to the queue object and OS queues */
         CRITICAL_START ();
 
-        /* If queue is full, block the calling thread */
-        if (qptr->num_msgs_stored == qptr->max_num_msgs)
+        /**
+         * Block the calling thread until the queue is ready. A single
+         * call can wake several threads, so the check is repeated each
+         * time we are woken in case another thread got there first.
+         */
+        while ((status == ATOM_OK) && ((qptr->num_msgs_stored == qptr->max_num_msgs) || (qptr->reserved == TRUE)))
         {
-            /* If called with timeout >= 0, we should block */
-            if (timeout >= 0)
+            /* Add current thread to the suspend list, if allowed to block */
+            status = queue_block (qptr, &qptr->putSuspQ, timeout, start_time,
+                                  &timer_data, &timer_cb);
+            if (status == ATOM_OK)
             {
-                /* Queue is full, block the calling thread */
-
-                /* Get the current TCB */
-                curr_tcb_ptr = atomCurrentContext();
-
-                /* Check we are actually in thread context */
-                if (curr_tcb_ptr)
-                {
-                    /* Add current thread to the suspend list on sends */
-                    if (tcbEnqueuePriority (&qptr->putSuspQ, curr_tcb_ptr) == ATOM_OK)
-                    {
-                        /* Set suspended status for the current thread */
-                        curr_tcb_ptr->suspended = TRUE;
-
-                        /* Track errors */
-                        status = ATOM_OK;
-
-                        /* Register a timer callback if requested */
-                        if (timeout)
-                        {
-                            /**
-                             * Fill out the data needed by the callback to
-                             * wake us up.
-                             */
-                            timer_data.tcb_ptr = curr_tcb_ptr;
-                            timer_data.queue_ptr = qptr;
-                            timer_data.suspQ = &qptr->putSuspQ;
-
-
-                            /* Fill out the timer callback request structure */
-                            timer_cb.cb_func = atomQueueTimerCallback;
-                            timer_cb.cb_data = (POINTER)&timer_data;
-                            timer_cb.cb_ticks = timeout;
-
-                            /**
-                             * Store the timer details in the TCB so that we
-                             * can cancel the timer callback if a message is
-                             * removed from the queue before the timeout
-                             * occurs.
-                             */
-                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
-
-                            /* Register a callback on timeout */
-                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
-                            {
-                                /* Timer registration failed */
-                                status = ATOM_ERR_TIMER;
-
-                                /* Clean up and return to the caller */
-                                (void)tcbDequeueEntry (&qptr->putSuspQ, curr_tcb_ptr);
-                                curr_tcb_ptr->suspended = FALSE;
-                                curr_tcb_ptr->suspend_timo_cb = NULL;
-                            }
-                        }
-
-                        /* Set no timeout requested */
-                        else
-                        {
-                            /* No need to cancel timeouts on this one */
-                            curr_tcb_ptr->suspend_timo_cb = NULL;
-                        }
+                /* Current thread now blocking, schedule in a new one */
+                CRITICAL_END ();
+                atomSched (FALSE);
 
-                        /* Exit critical region */
-                        CRITICAL_END ();
+                /**
+                 * Normal atomQueueGet() wakeups will set ATOM_OK
+                 * status, while timeouts will set ATOM_TIMEOUT and
+                 * queue deletions will set ATOM_ERR_DELETED.
+                 */
+                status = atomCurrentContext()->suspend_wake_status;
 
-                        /* Check timer registration was successful */
-                        if (status == ATOM_OK)
-                        {
-                            /**
-                             * Current thread now blocking, schedule in a new
-                             * one. We already know we are in thread context
-                             * so can call the scheduler from here.
-                             */
-                            atomSched (FALSE);
-
-                            /**
-                             * Normal atomQueueGet() wakeups will set ATOM_OK
-                             * status, while timeouts will set ATOM_TIMEOUT
-                             * and queue deletions will set ATOM_ERR_DELETED.
-                             */
-                            status = curr_tcb_ptr->suspend_wake_status;
-
-                            /**
-                             * Check suspend_wake_status. If it is ATOM_OK
-                             * then we were woken because a message has been
-                             * removed from the queue and we can now add ours.
-                             * Otherwise we were woken because we timed out
-                             * waiting for a message, or the queue was
-                             * deleted, so we should just quit.
-                             */
-                            if (status == ATOM_OK)
-                            {
-                                /* Enter critical region */
-                                CRITICAL_START();
-
-                                /* Copy the message into the queue */
-                                status = queue_insert (qptr, msgptr);
-
-                                /* Exit critical region */
-                                CRITICAL_END();
-                            }
-                        }
-                    }
-                    else
-                    {
-                        /* There was an error putting this thread on the suspend list */
-                        CRITICAL_END ();
-                        status = ATOM_ERR_QUEUE;
-                    }
-                }
-                else
-                {
-                    /* Not currently in thread context, can't suspend */
-                    CRITICAL_END ();
-                    status = ATOM_ERR_CONTEXT;
-                }
-            }
-            else
-            {
-                /* timeout == -1, cannot block. Just return queue is full */
-                CRITICAL_END();
-                status = ATOM_WOULDBLOCK;
+                /* Re-enter critical region to check the queue again */
+                CRITICAL_START ();
             }
         }
-        else
+
+        /* Copy the message into the queue */
+        if (status == ATOM_OK)
         {
-            /* No need to block, there is space to copy into the queue */
             status = queue_insert (qptr, msgptr);
+        }
 
-            /* Exit critical region */
-            CRITICAL_END ();
+        /* Exit critical region */
+        CRITICAL_END ();
 
-            /**
-             * The scheduler may now make a policy decision to thread
-             * switch if we are currently in thread context. If we are
-             * in interrupt context it will be handled by atomIntExit().
-             */
-            if (atomCurrentContext())
-                atomSched (FALSE);
-        }
+        /**
+         * The scheduler may now make a policy decision to thread
+         * switch if we are currently in thread context. If we are
+         * in interrupt context it will be handled by atomIntExit().
+         */
+        if ((status == ATOM_OK) && atomCurrentContext())
+            atomSched (FALSE);
     }
 
     return (status);
@@ -712,145 +666,150 @@ uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr)
 
 
 /**
- * \b atomQueueTimerCallback
+ * \b atomQueueGet8, atomQueueGet16, atomQueueGet32,
+ * \b atomQueuePut8, atomQueuePut16, atomQueuePut32
  *
- * This is an internal function not for use by application code.
+ * Typed variants of atomQueueGet() and atomQueuePut() for queues of 1, 2
+ * and 4 byte messages respectively.
  *
- * Timeouts on suspended threads are notified by the timer system through
- * this generic callback. The timer system calls us back with a pointer to
- * the relevant \c QUEUE_TIMER object which is used to retrieve the
- * queue details.
+ * These take the same parameters and return the same status codes as
+ * atomQueueGet() and atomQueuePut(), and can be called from interrupt
+ * context under the same conditions. Where the message can be transferred
+ * immediately it is copied using straight-line code generated at compile
+ * time for the message size. Where the caller must block the call is
+ * passed on to atomQueueGet() or atomQueuePut().
  *
- * @param[in] cb_data Pointer to a QUEUE_TIMER object
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[in,out] msgptr Pointer to the message to be received or sent
+ *
+ * @retval ATOM_ERR_PARAM Bad parameter, or queue message size does not match
+ * @retval Otherwise as atomQueueGet() and atomQueuePut()
  */
-static void atomQueueTimerCallback (POINTER cb_data)
-{
-    QUEUE_TIMER *timer_data_ptr;
-    CRITICAL_STORE;
-
-    /* Get the QUEUE_TIMER structure pointer */
-    timer_data_ptr = (QUEUE_TIMER *)cb_data;
-
-    /* Check parameter is valid */
-    if (timer_data_ptr)
-    {
-        /* Enter critical region */
-        CRITICAL_START ();
-
-        /* Set status to indicate to the waiting thread that it timed out */
-        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
-
-        /* Flag as no timeout registered */
-        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
-
-        /**
-         * Remove this thread from the queue's suspend list. Handles threads
-         * suspended on the receive list as well as the send list.
-         */
-        (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
-
-        /* Put the thread on the ready queue */
-        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
-
-        /* Exit critical region */
-        CRITICAL_END ();
-
-        /**
-         * Note that we don't call the scheduler now as it will be called
-         * when we exit the ISR by atomIntExit().
-         */
-    }
-}
+QUEUE_TYPED_FUNCS(8, 1)
+QUEUE_TYPED_FUNCS(16, 2)
+QUEUE_TYPED_FUNCS(32, 4)
 
 
 /**
- * \b queue_remove
+ * \b atomQueueGetMulti
  *
- * This is an internal function not for use by application code.
+ * Attempt to retrieve a batch of messages from a queue.
  *
- * Removes a message from a queue. Assumes that there is a message present,
- * which is already checked by the calling functions with interrupts locked
- * out.
+ * Retrieves up to \c num_msgs messages in one call. Messages are copied
+ * into the passed \c msgptr storage area which should be large enough to
+ * contain \c num_msgs messages of \c unit_size bytes each, and are
+ * retrieved in FIFO order. The number of messages actually retrieved is
+ * returned in \c num_got.
  *
- * Also wakes up a suspended thread if there are any waiting to send on the
- * queue.
+ * This is intended for draining bursts of messages (e.g. a serial receive
+ * buffer) without the overhead of a separate atomQueueGet() call per
+ * message. The whole batch is copied out within a single critical region
+ * using at most two copies (split where the queue storage wraps), and any
+ * threads waiting to send are woken together at the end of the batch.
  *
- * Assumes interrupts are already locked out.
+ * The call only blocks if the queue is completely empty. Otherwise as many
+ * messages as are currently available (up to \c num_msgs) are retrieved
+ * immediately. If the queue is empty the call will do one of the following
+ * depending on the \c timeout value specified:
  *
- * @param[in] qptr Pointer to an ATOM_QUEUE object
- * @param[in] msgptr Destination pointer for the message to be copied into
+ * \c timeout == 0 : Call will block until a message is available \n
+ * \c timeout > 0 : Call will block until a message or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no message is on the queue \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] msgptr Pointer to which the received messages will be copied
+ * @param[in] num_msgs Maximum number of messages to retrieve
+ * @param[out] num_got Pointer into which the number retrieved is stored
  *
  * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was empty
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
  * @retval ATOM_ERR_PARAM Bad parameter
- * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
  */
-static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr)
+uint8_t atomQueueGetMulti (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr, uint32_t num_msgs, uint32_t *num_got)
 {
+    CRITICAL_STORE;
     uint8_t status;
-    ATOM_TCB *tcb_ptr;
+    QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    uint32_t start_time;
 
     /* Check parameters */
-    if ((qptr == NULL) || (msgptr == NULL))
+    if ((qptr == NULL) || (msgptr == NULL) || (num_got == NULL) || (num_msgs == 0))
     {
-        /* Bad pointer */
+        /* Bad parameter */
         status = ATOM_ERR_PARAM;
     }
     else
     {
-        /* There is a message on the queue, copy it out */
-        memcpy (msgptr, (qptr->buff_ptr + qptr->remove_index), qptr->unit_size);
-        qptr->remove_index += qptr->unit_size;
-        qptr->num_msgs_stored--;
+        /* Nothing retrieved yet */
+        *num_got = 0;
+
+        /* Note the start time for any repeated blocking */
+        start_time = (timeout > 0) ? atomTimeGet () : 0;
+        status = ATOM_OK;
 
-        /* Check if the remove index should now wrap to the beginning */
-        if (qptr->remove_index >= (qptr->unit_size * qptr->max_num_msgs))
-            qptr->remove_index = 0;
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
 
         /**
-         * If there are threads waiting to send, wake one up now. Waiting
-         * threads are woken up in priority order, with same-priority
-         * threads woken up in FIFO order.
+         * Block the calling thread until the queue is ready. A single
+         * call can wake several threads, so the check is repeated each
+         * time we are woken in case another thread got there first.
          */
-        tcb_ptr = tcbDequeueHead (&qptr->putSuspQ);
-        if (tcb_ptr)
+        while ((status == ATOM_OK) && ((qptr->num_msgs_stored == 0) || (qptr->peeked == TRUE)))
         {
-            /* Move the waiting thread to the ready queue */
-            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+            /* Add current thread to the suspend list, if allowed to block */
+            status = queue_block (qptr, &qptr->getSuspQ, timeout, start_time,
+                                  &timer_data, &timer_cb);
+            if (status == ATOM_OK)
             {
-                /* Set OK status to be returned to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_OK;
-
-                /* If there's a timeout on this suspension, cancel it */
-                if ((tcb_ptr->suspend_timo_cb != NULL)
-                    && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
-                {
-                    /* There was a problem cancelling a timeout */
-                    status = ATOM_ERR_TIMER;
-                }
-                else
-                {
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
+                /* Current thread now blocking, schedule in a new one */
+                CRITICAL_END ();
+                atomSched (FALSE);
 
-                    /* Successful */
-                    status = ATOM_OK;
-                }
-            }
-            else
-            {
                 /**
-                 * There was a problem putting the thread on the ready
-                 * queue.
+                 * Normal atomQueuePut() wakeups will set ATOM_OK
+                 * status, while timeouts will set ATOM_TIMEOUT and
+                 * queue deletions will set ATOM_ERR_DELETED.
                  */
-                status = ATOM_ERR_QUEUE;
+                status = atomCurrentContext()->suspend_wake_status;
+
+                /* Re-enter critical region to check the queue again */
+                CRITICAL_START ();
             }
         }
-        else
+
+        /**
+         * Copy out as many messages as are available now. This is
+         * worked out after any blocking, as other threads woken at the
+         * same time may already have taken some.
+         */
+        if (status == ATOM_OK)
         {
-            /* There were no threads waiting to send */
-            status = ATOM_OK;
+            *num_got = (qptr->num_msgs_stored < num_msgs) ? qptr->num_msgs_stored : num_msgs;
+            status = queue_remove_multi (qptr, msgptr, *num_got);
         }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread
+         * switch if we are currently in thread context. If we are
+         * in interrupt context it will be handled by atomIntExit().
+         */
+        if ((status == ATOM_OK) && atomCurrentContext())
+            atomSched (FALSE);
     }
 
     return (status);
@@ -858,93 +817,1063 @@ static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr)
 
 
 /**
- * \b queue_insert
+ * \b atomQueuePutMulti
  *
- * This is an internal function not for use by application code.
+ * Attempt to put a batch of messages onto a queue.
  *
- * Inserts a message onto a queue. Assumes that the queue has space for one
- * message, which has already been checked by the calling function with
- * interrupts locked out.
+ * Sends up to \c num_msgs messages in one call. Messages are copied from
+ * the passed \c msgptr storage area which should contain \c num_msgs
+ * messages of \c unit_size bytes each. The number of messages actually
+ * sent is returned in \c num_put.
  *
- * Also wakes up a suspended thread if there are any waiting to receive on the
- * queue.
+ * This is intended for posting bursts of messages (e.g. a block of ADC
+ * samples) without the overhead of a separate atomQueuePut() call per
+ * message. The whole batch is copied in within a single critical region
+ * using at most two copies (split where the queue storage wraps), and any
+ * threads waiting to receive are woken together at the end of the batch.
  *
- * Assumes interrupts are already locked out.
+ * The call only blocks if the queue is completely full. Otherwise as many
+ * messages as there is currently space for (up to \c num_msgs) are sent
+ * immediately, and callers wishing to send the remainder should call again
+ * with the rest of the batch. If the queue is full the call will do one of
+ * the following depending on the \c timeout value specified:
  *
- * @param[in] qptr Pointer to an ATOM_QUEUE object
- * @param[in] msgptr Source pointer for the message to be copied out of
+ * \c timeout == 0 : Call will block until space is available \n
+ * \c timeout > 0 : Call will block until space or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the queue is full \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[in] msgptr Pointer from which the messages should be copied out
+ * @param[in] num_msgs Maximum number of messages to send
+ * @param[out] num_put Pointer into which the number sent is stored
  *
  * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
  * @retval ATOM_ERR_PARAM Bad parameter
- * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
- * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
  */
-static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr)
+uint8_t atomQueuePutMulti (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr, uint32_t num_msgs, uint32_t *num_put)
 {
+    CRITICAL_STORE;
     uint8_t status;
-    ATOM_TCB *tcb_ptr;
+    QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    uint32_t start_time;
+    uint32_t num_free;
 
     /* Check parameters */
-    if ((qptr == NULL) || (msgptr == NULL))
+    if ((qptr == NULL) || (msgptr == NULL) || (num_put == NULL) || (num_msgs == 0))
     {
-        /* Bad pointer */
+        /* Bad parameter */
         status = ATOM_ERR_PARAM;
     }
     else
     {
-        /* There is space in the queue, copy it in */
-        memcpy ((qptr->buff_ptr + qptr->insert_index), msgptr, qptr->unit_size);
-        qptr->insert_index += qptr->unit_size;
-        qptr->num_msgs_stored++;
+        /* Nothing sent yet */
+        *num_put = 0;
 
-        /* Check if the insert index should now wrap to the beginning */
-        if (qptr->insert_index >= (qptr->unit_size * qptr->max_num_msgs))
-            qptr->insert_index = 0;
+        /* Note the start time for any repeated blocking */
+        start_time = (timeout > 0) ? atomTimeGet () : 0;
+        status = ATOM_OK;
+
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
 
         /**
-         * If there are threads waiting to receive, wake one up now. Waiting
-         * threads are woken up in priority order, with same-priority
-         * threads woken up in FIFO order.
+         * Block the calling thread until the queue is ready. A single
+         * call can wake several threads, so the check is repeated each
+         * time we are woken in case another thread got there first.
          */
-        tcb_ptr = tcbDequeueHead (&qptr->getSuspQ);
-        if (tcb_ptr)
+        while ((status == ATOM_OK) && ((qptr->num_msgs_stored == qptr->max_num_msgs) || (qptr->reserved == TRUE)))
         {
-            /* Move the waiting thread to the ready queue */
-            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+            /* Add current thread to the suspend list, if allowed to block */
+            status = queue_block (qptr, &qptr->putSuspQ, timeout, start_time,
+                                  &timer_data, &timer_cb);
+            if (status == ATOM_OK)
             {
-                /* Set OK status to be returned to the waiting thread */
-                tcb_ptr->suspend_wake_status = ATOM_OK;
+                /* Current thread now blocking, schedule in a new one */
+                CRITICAL_END ();
+                atomSched (FALSE);
 
-                /* If there's a timeout on this suspension, cancel it */
-                if ((tcb_ptr->suspend_timo_cb != NULL)
-                    && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
-                {
-                    /* There was a problem cancelling a timeout */
-                    status = ATOM_ERR_TIMER;
-                }
-                else
-                {
-                    /* Flag as no timeout registered */
-                    tcb_ptr->suspend_timo_cb = NULL;
+                /**
+                 * Normal atomQueueGet() wakeups will set ATOM_OK
+                 * status, while timeouts will set ATOM_TIMEOUT and
+                 * queue deletions will set ATOM_ERR_DELETED.
+                 */
+                status = atomCurrentContext()->suspend_wake_status;
 
-                    /* Successful */
-                    status = ATOM_OK;
-                }
+                /* Re-enter critical region to check the queue again */
+                CRITICAL_START ();
             }
-            else
+        }
+
+        /**
+         * Copy in as many messages as there is space for now. This is
+         * worked out after any blocking, as other threads woken at the
+         * same time may already have used some of the space.
+         */
+        if (status == ATOM_OK)
+        {
+            num_free = qptr->max_num_msgs - qptr->num_msgs_stored;
+            *num_put = (num_free < num_msgs) ? num_free : num_msgs;
+            status = queue_insert_multi (qptr, msgptr, *num_put);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread
+         * switch if we are currently in thread context. If we are
+         * in interrupt context it will be handled by atomIntExit().
+         */
+        if ((status == ATOM_OK) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueReserve
+ *
+ * Reserve the next free message slot in a queue for in-place filling.
+ *
+ * On success \c slotptr is set to point directly into the queue's buffer
+ * area, at storage for one message of \c unit_size bytes. The caller fills
+ * in the message there and then posts it using atomQueueCommit(). This
+ * avoids copying the message in from separate storage as atomQueuePut()
+ * does, which is worthwhile for large messages.
+ *
+ * Only one slot may be reserved at a time. Until the reservation is
+ * committed the queue is treated as full by atomQueuePut() and any other
+ * atomQueueReserve() calls, so that messages are always posted in the
+ * order in which their slots were handed out.
+ *
+ * If the queue is currently full (or a slot is already reserved), the call
+ * will do one of the following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until space is available \n
+ * \c timeout > 0 : Call will block until space or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the queue is full \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] slotptr Pointer into which the reserved slot address is stored
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was full
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomQueueReserve (ATOM_QUEUE *qptr, int32_t timeout, uint8_t **slotptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    uint32_t start_time;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (slotptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Note the start time for any repeated blocking */
+        start_time = (timeout > 0) ? atomTimeGet () : 0;
+        status = ATOM_OK;
+
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /**
+         * Block the calling thread until the queue is ready. A single
+         * call can wake several threads, so the check is repeated each
+         * time we are woken in case another thread got there first.
+         */
+        while ((status == ATOM_OK) && ((qptr->num_msgs_stored == qptr->max_num_msgs) || (qptr->reserved == TRUE)))
+        {
+            /* Add current thread to the suspend list, if allowed to block */
+            status = queue_block (qptr, &qptr->putSuspQ, timeout, start_time,
+                                  &timer_data, &timer_cb);
+            if (status == ATOM_OK)
             {
+                /* Current thread now blocking, schedule in a new one */
+                CRITICAL_END ();
+                atomSched (FALSE);
+
                 /**
-                 * There was a problem putting the thread on the ready
-                 * queue.
+                 * Normal atomQueueGet() wakeups will set ATOM_OK
+                 * status, while timeouts will set ATOM_TIMEOUT and
+                 * queue deletions will set ATOM_ERR_DELETED.
                  */
-                status = ATOM_ERR_QUEUE;
+                status = atomCurrentContext()->suspend_wake_status;
+
+                /* Re-enter critical region to check the queue again */
+                CRITICAL_START ();
             }
         }
+
+        /* Hand out the next insert slot */
+        if (status == ATOM_OK)
+        {
+            qptr->reserved = TRUE;
+            *slotptr = qptr->buff_ptr + qptr->insert_index;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueCommit
+ *
+ * Post a message previously reserved using atomQueueReserve().
+ *
+ * The message must have been filled in directly in the slot handed out by
+ * atomQueueReserve(). It is now made available to receivers exactly as if
+ * it had been posted using atomQueuePut(), and a thread blocking on the
+ * queue (if any) is woken.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or no slot was reserved
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout for a woken thread
+ */
+uint8_t atomQueueCommit (ATOM_QUEUE *qptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if (qptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /* Check there is actually a reserved slot to commit */
+        if (qptr->reserved == FALSE)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Nothing was reserved */
+            status = ATOM_ERR_PARAM;
+        }
         else
         {
-            /* There were no threads waiting to send */
-            status = ATOM_OK;
+            /* Release the reservation and post the message */
+            qptr->reserved = FALSE;
+            status = queue_commit (qptr, 1);
+
+            /**
+             * Messages removed while the slot was reserved did not wake
+             * any blocked senders. Hand out the free space to them now.
+             */
+            if (status == ATOM_OK)
+            {
+                status = queue_wake (&qptr->putSuspQ,
+                                     qptr->max_num_msgs - qptr->num_msgs_stored);
+            }
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueuePeek
+ *
+ * Access the oldest message in a queue in place.
+ *
+ * On success \c msgptr is set to point directly into the queue's buffer
+ * area, at the oldest message stored. The caller processes the message
+ * there and then gives the slot back using atomQueueRelease(), at which
+ * point the message is removed from the queue. This avoids copying the
+ * message out to separate storage as atomQueueGet() does, which is
+ * worthwhile for large messages.
+ *
+ * Only one message may be held at a time. Until it is released the queue
+ * is treated as empty by atomQueueGet() and any other atomQueuePeek()
+ * calls.
+ *
+ * If the queue is currently empty (or a message is already held), the call
+ * will do one of the following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a message is available \n
+ * \c timeout > 0 : Call will block until a message or the specified timeout \n
+ * \c timeout == -1 : Return immediately if no message is on the queue \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] qptr Pointer to queue object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] msgptr Pointer into which the message address is stored
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Queue wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but queue was empty
+ * @retval ATOM_ERR_DELETED Queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomQueuePeek (ATOM_QUEUE *qptr, int32_t timeout, uint8_t **msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    QUEUE_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    uint32_t start_time;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Note the start time for any repeated blocking */
+        start_time = (timeout > 0) ? atomTimeGet () : 0;
+        status = ATOM_OK;
+
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /**
+         * Block the calling thread until the queue is ready. A single
+         * call can wake several threads, so the check is repeated each
+         * time we are woken in case another thread got there first.
+         */
+        while ((status == ATOM_OK) && ((qptr->num_msgs_stored == 0) || (qptr->peeked == TRUE)))
+        {
+            /* Add current thread to the suspend list, if allowed to block */
+            status = queue_block (qptr, &qptr->getSuspQ, timeout, start_time,
+                                  &timer_data, &timer_cb);
+            if (status == ATOM_OK)
+            {
+                /* Current thread now blocking, schedule in a new one */
+                CRITICAL_END ();
+                atomSched (FALSE);
+
+                /**
+                 * Normal atomQueuePut() wakeups will set ATOM_OK
+                 * status, while timeouts will set ATOM_TIMEOUT and
+                 * queue deletions will set ATOM_ERR_DELETED.
+                 */
+                status = atomCurrentContext()->suspend_wake_status;
+
+                /* Re-enter critical region to check the queue again */
+                CRITICAL_START ();
+            }
+        }
+
+        /* Hand out the oldest message */
+        if (status == ATOM_OK)
+        {
+            qptr->peeked = TRUE;
+            *msgptr = qptr->buff_ptr + qptr->remove_index;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueRelease
+ *
+ * Remove a message previously accessed using atomQueuePeek().
+ *
+ * The message slot is given back to the queue exactly as if the message
+ * had been received using atomQueueGet(), and a thread blocking on the
+ * queue (if any) is woken. The pointer handed out by atomQueuePeek() must
+ * not be used after this call.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] qptr Pointer to queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter or no message was held
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout for a woken thread
+ */
+uint8_t atomQueueRelease (ATOM_QUEUE *qptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Check parameters */
+    if (qptr == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the queue object and OS queues */
+        CRITICAL_START ();
+
+        /* Check there is actually a held message to release */
+        if (qptr->peeked == FALSE)
+        {
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /* Nothing was held */
+            status = ATOM_ERR_PARAM;
         }
+        else
+        {
+            /* Give back the message slot */
+            qptr->peeked = FALSE;
+            status = queue_release (qptr, 1);
+
+            /**
+             * Messages posted while one was held did not wake any blocked
+             * receivers. Hand out the remaining messages to them now.
+             */
+            if (status == ATOM_OK)
+            {
+                status = queue_wake (&qptr->getSuspQ, qptr->num_msgs_stored);
+            }
+
+            /* Let any queue set waiters know the messages are available */
+            if ((status == ATOM_OK) && (qptr->qset != NULL)
+                && (qptr->num_msgs_stored > 0))
+            {
+                status = atomQSetNotify (qptr->qset);
+            }
+
+            /* Exit critical region */
+            CRITICAL_END ();
+
+            /**
+             * The scheduler may now make a policy decision to thread
+             * switch if we are currently in thread context. If we are
+             * in interrupt context it will be handled by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomQueueTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c QUEUE_TIMER object which is used to retrieve the
+ * queue details.
+ *
+ * @param[in] cb_data Pointer to a QUEUE_TIMER object
+ */
+static void atomQueueTimerCallback (POINTER cb_data)
+{
+    QUEUE_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the QUEUE_TIMER structure pointer */
+    timer_data_ptr = (QUEUE_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /**
+         * Remove this thread from the queue's suspend list. Handles threads
+         * suspended on the receive list as well as the send list.
+         */
+        (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b queue_suspend
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Places the calling thread on one of the queue's suspend lists, and
+ * registers a timeout callback if requested. Used by all of the queue
+ * APIs which may block.
+ *
+ * The timer storage is provided by the caller (on its own stack) and must
+ * remain valid until the thread is woken.
+ *
+ * Assumes interrupts are already locked out. The caller is responsible for
+ * exiting the critical region and calling the scheduler if successful.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] suspQ Suspend list to place the thread on
+ * @param[in] tcb_ptr TCB of the calling thread
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] timer_data_ptr Storage for the timeout callback data
+ * @param[in] timer_cb_ptr Storage for the timeout callback request
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+static uint8_t queue_suspend (ATOM_QUEUE *qptr, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, QUEUE_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr)
+{
+    uint8_t status;
+
+    /* Add the thread to the requested suspend list */
+    if (tcbEnqueuePriority (suspQ, tcb_ptr) != ATOM_OK)
+    {
+        /* There was an error putting this thread on the suspend list */
+        status = ATOM_ERR_QUEUE;
+    }
+    else
+    {
+        /* Set suspended status for the thread */
+        tcb_ptr->suspended = TRUE;
+
+        /* Track errors */
+        status = ATOM_OK;
+
+        /* Register a timer callback if requested */
+        if (timeout)
+        {
+            /* Fill out the data needed by the callback to wake us up */
+            timer_data_ptr->tcb_ptr = tcb_ptr;
+            timer_data_ptr->queue_ptr = qptr;
+            timer_data_ptr->suspQ = suspQ;
+
+            /* Fill out the timer callback request structure */
+            timer_cb_ptr->cb_func = atomQueueTimerCallback;
+            timer_cb_ptr->cb_data = (POINTER)timer_data_ptr;
+            timer_cb_ptr->cb_ticks = timeout;
+
+            /**
+             * Store the timer details in the TCB so that we can cancel the
+             * timer callback if the thread is woken before the timeout
+             * occurs.
+             */
+            tcb_ptr->suspend_timo_cb = timer_cb_ptr;
+
+            /* Register a callback on timeout */
+            if (atomTimerRegister (timer_cb_ptr) != ATOM_OK)
+            {
+                /* Timer registration failed */
+                status = ATOM_ERR_TIMER;
+
+                /* Clean up and return to the caller */
+                (void)tcbDequeueEntry (suspQ, tcb_ptr);
+                tcb_ptr->suspended = FALSE;
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+
+        /* Set no timeout requested */
+        else
+        {
+            /* No need to cancel timeouts on this one */
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_block
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Suspends the calling thread on one of the queue's suspend lists, for the
+ * blocking APIs which found the queue empty (or full). These APIs call
+ * this each time round their wait loop, so it also applies the non-blocking
+ * and thread context checks, and works out how much of the caller's
+ * timeout is left after any earlier wakeups.
+ *
+ * Assumes interrupts are already locked out. The caller is responsible for
+ * exiting the critical region and calling the scheduler if successful.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] suspQ Suspend list to place the thread on
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 = no block)
+ * @param[in] start_time System time at which the caller first checked the queue
+ * @param[in] timer_data_ptr Storage for the timeout callback data
+ * @param[in] timer_cb_ptr Storage for the timeout callback request
+ *
+ * @retval ATOM_OK Success, the thread is suspended
+ * @retval ATOM_TIMEOUT The timeout expired during earlier wakeups
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1
+ * @retval ATOM_ERR_CONTEXT Not called in thread context
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+static uint8_t queue_block (ATOM_QUEUE *qptr, ATOM_TCB **suspQ, int32_t timeout, uint32_t start_time, QUEUE_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr)
+{
+    uint8_t status;
+    ATOM_TCB *curr_tcb_ptr;
+    uint32_t elapsed;
+    int32_t ticks_left;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Work out how much of the timeout remains */
+    ticks_left = timeout;
+    if (timeout > 0)
+    {
+        elapsed = atomTimeGet () - start_time;
+        ticks_left = (elapsed >= (uint32_t)timeout) ? -1 : (timeout - (int32_t)elapsed);
+    }
+
+    if (timeout < 0)
+    {
+        /* timeout == -1, requested not to block */
+        status = ATOM_WOULDBLOCK;
+    }
+    else if (ticks_left < 0)
+    {
+        /* Timed out while other threads took the queue from us */
+        status = ATOM_TIMEOUT;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context, can't suspend */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else
+    {
+        /* Add current thread to the requested suspend list */
+        status = queue_suspend (qptr, suspQ, curr_tcb_ptr, ticks_left,
+                                timer_data_ptr, timer_cb_ptr);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_wake
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Wakes up to \c max_threads threads suspended on one of the queue's
+ * suspend lists. Waiting threads are woken up in priority order, with
+ * same-priority threads woken up in FIFO order.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] suspQ Suspend list to wake threads from
+ * @param[in] max_threads Maximum number of threads to wake
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_wake (ATOM_TCB **suspQ, uint32_t max_threads)
+{
+    uint8_t status;
+    ATOM_TCB *tcb_ptr;
+
+    /* Default to success if there are no threads waiting */
+    status = ATOM_OK;
+
+    /* Wake threads until enough are woken or none remain */
+    while ((max_threads > 0) && (status == ATOM_OK)
+        && ((tcb_ptr = tcbDequeueHead (suspQ)) != NULL))
+    {
+        /* Move the waiting thread to the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+        {
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+
+            /* If there's a timeout on this suspension, cancel it */
+            if ((tcb_ptr->suspend_timo_cb != NULL)
+                && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+            {
+                /* There was a problem cancelling a timeout */
+                status = ATOM_ERR_TIMER;
+            }
+            else
+            {
+                /* Flag as no timeout registered */
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+        else
+        {
+            /**
+             * There was a problem putting the thread on the ready
+             * queue.
+             */
+            status = ATOM_ERR_QUEUE;
+        }
+
+        /* One less thread to wake */
+        max_threads--;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_remove
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes a message from a queue. Assumes that there is a message present,
+ * which is already checked by the calling functions with interrupts locked
+ * out.
+ *
+ * Also wakes up a suspended thread if there are any waiting to send on the
+ * queue.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] msgptr Destination pointer for the message to be copied into
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_remove (ATOM_QUEUE *qptr, uint8_t* msgptr)
+{
+    uint8_t status;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* There is a message on the queue, copy it out */
+        memcpy (msgptr, (qptr->buff_ptr + qptr->remove_index), qptr->unit_size);
+
+        /* Free up the slot and wake any waiting senders */
+        status = queue_release (qptr, 1);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_remove_multi
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes \c num_msgs messages from a queue. Assumes that at least that
+ * many messages are present, which is already checked by the calling
+ * functions with interrupts locked out.
+ *
+ * The messages are copied out using at most two copies, split where the
+ * queue storage wraps back to the beginning. Also wakes up suspended
+ * threads (one per message removed) if there are any waiting to send on
+ * the queue.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] msgptr Destination pointer for the messages to be copied into
+ * @param[in] num_msgs Number of messages to remove
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_remove_multi (ATOM_QUEUE *qptr, uint8_t* msgptr, uint32_t num_msgs)
+{
+    uint8_t status;
+    uint32_t num_bytes, first_bytes;
+
+    /* Find how much can be copied before the end of the queue storage */
+    num_bytes = num_msgs * qptr->unit_size;
+    first_bytes = qptr->buff_size - qptr->remove_index;
+    if (first_bytes > num_bytes)
+        first_bytes = num_bytes;
+
+    /* Copy out up to the end of the storage, then any wrapped remainder */
+    memcpy (msgptr, (qptr->buff_ptr + qptr->remove_index), first_bytes);
+    if (num_bytes > first_bytes)
+        memcpy (msgptr + first_bytes, qptr->buff_ptr, num_bytes - first_bytes);
+
+    /* Free up the slots and wake any waiting senders */
+    status = queue_release (qptr, num_msgs);
+
+    return (status);
+}
+
+
+/**
+ * \b queue_insert_multi
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Inserts \c num_msgs messages onto a queue. Assumes that the queue has
+ * space for that many messages, which has already been checked by the
+ * calling function with interrupts locked out.
+ *
+ * The messages are copied in using at most two copies, split where the
+ * queue storage wraps back to the beginning. Also wakes up suspended
+ * threads (one per message inserted) if there are any waiting to receive
+ * on the queue.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] msgptr Source pointer for the messages to be copied out of
+ * @param[in] num_msgs Number of messages to insert
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_insert_multi (ATOM_QUEUE *qptr, uint8_t* msgptr, uint32_t num_msgs)
+{
+    uint8_t status;
+    uint32_t num_bytes, first_bytes;
+
+    /* Find how much can be copied before the end of the queue storage */
+    num_bytes = num_msgs * qptr->unit_size;
+    first_bytes = qptr->buff_size - qptr->insert_index;
+    if (first_bytes > num_bytes)
+        first_bytes = num_bytes;
+
+    /* Copy in up to the end of the storage, then any wrapped remainder */
+    memcpy ((qptr->buff_ptr + qptr->insert_index), msgptr, first_bytes);
+    if (num_bytes > first_bytes)
+        memcpy (qptr->buff_ptr, msgptr + first_bytes, num_bytes - first_bytes);
+
+    /* Post the messages and wake any waiting receivers */
+    status = queue_commit (qptr, num_msgs);
+
+    return (status);
+}
+
+
+/**
+ * \b queue_release
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Frees the slots of the oldest \c num_msgs messages in the queue, once
+ * they have been copied out (or processed in place). Also wakes up
+ * suspended threads (one per freed slot) if there are any waiting to send
+ * on the queue, unless a slot is currently reserved (in which case
+ * atomQueueCommit() wakes them instead).
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] num_msgs Number of messages removed
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_release (ATOM_QUEUE *qptr, uint32_t num_msgs)
+{
+    uint8_t status;
+
+    /* Step past the removed messages */
+    qptr->remove_index += (qptr->unit_size * num_msgs);
+    qptr->num_msgs_stored -= num_msgs;
+
+    /* Check if the remove index should now wrap to the beginning */
+    if (qptr->remove_index >= qptr->buff_size)
+        qptr->remove_index -= qptr->buff_size;
+
+    /* If there are threads waiting to send, wake them up now */
+    if (qptr->reserved == FALSE)
+    {
+        status = queue_wake (&qptr->putSuspQ, num_msgs);
+    }
+    else
+    {
+        /* Senders are woken when the reserved slot is committed */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_insert
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Inserts a message onto a queue. Assumes that the queue has space for one
+ * message, which has already been checked by the calling function with
+ * interrupts locked out.
+ *
+ * Also wakes up a suspended thread if there are any waiting to receive on the
+ * queue.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] msgptr Source pointer for the message to be copied out of
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_insert (ATOM_QUEUE *qptr, uint8_t* msgptr)
+{
+    uint8_t status;
+
+    /* Check parameters */
+    if ((qptr == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* There is space in the queue, copy it in */
+        memcpy ((qptr->buff_ptr + qptr->insert_index), msgptr, qptr->unit_size);
+
+        /* Post the message and wake any waiting receivers */
+        status = queue_commit (qptr, 1);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b queue_commit
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Posts the \c num_msgs messages in the next insert slots, once they have
+ * been copied in (or filled in place). Also wakes up suspended threads
+ * (one per message posted) if there are any waiting to receive on the
+ * queue, unless a message is currently held by atomQueuePeek() (in which
+ * case atomQueueRelease() wakes them instead).
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] qptr Pointer to an ATOM_QUEUE object
+ * @param[in] num_msgs Number of messages posted
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t queue_commit (ATOM_QUEUE *qptr, uint32_t num_msgs)
+{
+    uint8_t status;
+
+    /* Step past the inserted messages */
+    qptr->insert_index += (qptr->unit_size * num_msgs);
+    qptr->num_msgs_stored += num_msgs;
+
+    /* Track the high-water mark before any receiver can take them */
+    if (qptr->num_msgs_stored > qptr->max_msgs_stored)
+        qptr->max_msgs_stored = qptr->num_msgs_stored;
+
+    /* Check if the insert index should now wrap to the beginning */
+    if (qptr->insert_index >= qptr->buff_size)
+        qptr->insert_index -= qptr->buff_size;
+
+    /* If there are threads waiting to receive, wake them up now */
+    if (qptr->peeked == FALSE)
+    {
+        status = queue_wake (&qptr->getSuspQ, num_msgs);
+
+        /* Wake any threads waiting on a queue set containing this queue */
+        if ((status == ATOM_OK) && (qptr->qset != NULL))
+        {
+            status = atomQSetNotify (qptr->qset);
+        }
+    }
+    else
+    {
+        /* Receivers are woken when the held message is released */
+        status = ATOM_OK;
     }
 
     return (status);
@@ -29,6 +29,9 @@
 #ifndef __ATOM_QUEUE_H
 #define __ATOM_QUEUE_H
 
+/* Forward declaration */
+struct atom_qset;
+
 typedef struct atom_queue
 {
     ATOM_TCB *  putSuspQ;       /* Queue of threads waiting to send */
@@ -36,14 +39,31 @@ typedef struct atom_queue
     uint8_t *   buff_ptr;       /* Pointer to queue data area */
     uint32_t    unit_size;      /* Size of each message */
     uint32_t    max_num_msgs;   /* Max number of storable messages */
+    uint32_t    buff_size;      /* Size of the queue data area in bytes */
     uint32_t    insert_index;   /* Next byte index to insert into */
     uint32_t    remove_index;   /* Next byte index to remove from */
     uint32_t    num_msgs_stored;/* Number of messages stored */
+    uint32_t    max_msgs_stored;/* High-water mark of messages stored */
+    uint8_t     reserved;       /* TRUE if the insert slot is reserved */
+    uint8_t     peeked;         /* TRUE if the remove slot is held */
+    struct atom_qset *qset;     /* Queue set this queue is a member of */
 } ATOM_QUEUE;
 
 extern uint8_t atomQueueCreate (ATOM_QUEUE *qptr, uint8_t *buff_ptr, uint32_t unit_size, uint32_t max_num_msgs);
 extern uint8_t atomQueueDelete (ATOM_QUEUE *qptr);
 extern uint8_t atomQueueGet (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
 extern uint8_t atomQueuePut (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueueGet8 (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueuePut8 (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueueGet16 (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueuePut16 (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueueGet32 (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueuePut32 (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+extern uint8_t atomQueueGetMulti (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr, uint32_t num_msgs, uint32_t *num_got);
+extern uint8_t atomQueuePutMulti (ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr, uint32_t num_msgs, uint32_t *num_put);
+extern uint8_t atomQueueReserve (ATOM_QUEUE *qptr, int32_t timeout, uint8_t **slotptr);
+extern uint8_t atomQueueCommit (ATOM_QUEUE *qptr);
+extern uint8_t atomQueuePeek (ATOM_QUEUE *qptr, int32_t timeout, uint8_t **msgptr);
+extern uint8_t atomQueueRelease (ATOM_QUEUE *qptr);
 
 #endif /* __ATOM_QUEUE_H */
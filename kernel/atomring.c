@@ -0,0 +1,620 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Lock-free ring buffer library.
+ *
+ *
+ * This module implements a single-producer, single-consumer ring buffer
+ * intended for passing data from an interrupt handler to a thread with the
+ * minimum of interrupt latency. It has the following features:
+ *
+ * \par Lock-free fast path
+ * The producer and consumer each own one of the ring's indices, which are
+ * only ever written by their owner. Provided that a single byte can be
+ * read and written atomically (true on all supported architectures), the
+ * data path needs no critical region at all. Interrupts are only locked out
+ * when the consumer needs to go to sleep, or when the producer needs to
+ * wake it up. The entry storage itself is not volatile, so each side
+ * places an ATOM_BARRIER() between copying an entry and updating its
+ * index. This stops the compiler moving the producer's copy after the
+ * head update, or the consumer's copy after the tail update. The consumer
+ * also has a barrier between checking head and reading the entry. Only the
+ * compiler is constrained: the single-core targets supported do not
+ * reorder memory accesses in hardware.
+ *
+ * \par Wake only on empty
+ * A consumer thread only suspends when the ring is empty, and the producer
+ * only enters the kernel to wake it on the next put. While the consumer is
+ * keeping up with the producer, a put is just a copy and an index update.
+ *
+ * \par Flexible blocking APIs
+ * The consumer can choose whether to block, block with timeout, or not
+ * block and return a relevant status code if the ring is empty. The
+ * producer never blocks, and simply returns a status code if the ring is
+ * full.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All ring objects must be initialised before use by calling
+ * atomRingCreate(). Callers pass in their own buffer area for storing the
+ * ring entries. Rings use a fixed-size entry, and one entry slot is always
+ * kept empty to tell a full ring from an empty one, so a ring created with
+ * \c num_entries slots can store up to (\c num_entries - 1) entries.
+ *
+ * Entries are added by the producer (typically an interrupt handler) by
+ * calling atomRingPut(), and are removed in FIFO order by the consumer
+ * thread by calling atomRingGet().
+ *
+ * There must be only one producer and one consumer for each ring. If more
+ * than one context needs to put to or get from the same ring, they must
+ * be serialised by the application, or an ATOM_QUEUE used instead.
+ *
+ * A ring which is no longer required can be deleted using atomRingDelete().
+ * This function automatically wakes up the consumer thread if it is
+ * waiting on the deleted ring.
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "atom.h"
+#include "atomring.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct ring_timer
+{
+    ATOM_TCB   *tcb_ptr;    /* Thread which is suspended with timeout */
+    ATOM_RING  *ring_ptr;   /* Ring the thread is suspended on */
+} RING_TIMER;
+
+
+/* Forward declarations */
+
+static void atomRingTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomRingCreate
+ *
+ * Initialises a ring object.
+ *
+ * Must be called before calling any other ring library routines on a
+ * ring. Objects can be deleted later using atomRingDelete().
+ *
+ * Does not allocate storage, the caller provides the ring object and
+ * a buffer area which must be large enough to store (\c unit_size *
+ * \c num_entries) bytes. Up to (\c num_entries - 1) entries can be
+ * stored in the ring at once.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] ring Pointer to ring object
+ * @param[in] buff_ptr Pointer to buffer storage area
+ * @param[in] unit_size Size in bytes of each ring entry
+ * @param[in] num_entries Number of entry slots in the buffer area (2-255)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomRingCreate (ATOM_RING *ring, uint8_t *buff_ptr, uint16_t unit_size, uint8_t num_entries)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((ring == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((unit_size == 0) || (num_entries < 2))
+    {
+        /* Bad values */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the ring details */
+        ring->buff_ptr = buff_ptr;
+        ring->unit_size = unit_size;
+        ring->num_entries = num_entries;
+
+        /* No consumer waiting */
+        ring->suspTcb = NULL;
+
+        /* Start empty */
+        ring->head = 0;
+        ring->tail = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomRingDelete
+ *
+ * Deletes a ring object.
+ *
+ * If the consumer thread is currently suspended on the ring it will be
+ * woken up with return status ATOM_ERR_DELETED. If called at thread
+ * context then the scheduler will be called during this function which
+ * may schedule in the woken thread depending on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] ring Pointer to ring object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomRingDelete (ATOM_RING *ring)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+
+    /* Parameter check */
+    if (ring == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Check if the consumer is suspended */
+        tcb_ptr = ring->suspTcb;
+        if (tcb_ptr)
+        {
+            /* Take the consumer off the ring */
+            ring->suspTcb = NULL;
+
+            /* Return error status to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+
+            /* Put the thread on the ready queue */
+            if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+            {
+                /* There was a problem putting the thread on the ready queue */
+                status = ATOM_ERR_QUEUE;
+            }
+
+            /* If there's a timeout on this suspension, cancel it */
+            else if (tcb_ptr->suspend_timo_cb)
+            {
+                /* Cancel the callback */
+                if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+                {
+                    /* There was a problem cancelling the timeout */
+                    status = ATOM_ERR_TIMER;
+                }
+
+                /* Flag as no timeout registered */
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /* Call scheduler if the consumer was woken up */
+        if (tcb_ptr)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomRingPut
+ *
+ * Put an entry onto a ring.
+ *
+ * Entries are copied from the passed \c msgptr storage area which should
+ * contain an entry of \c unit_size bytes. This is only to be called by the
+ * ring's single producer.
+ *
+ * The entry is copied in and published to the consumer without locking
+ * out interrupts. Only if the consumer thread is currently suspended
+ * waiting for data (i.e. the ring was empty) is a critical region entered
+ * to wake it.
+ *
+ * The call never blocks. If the ring is full the entry is not stored and
+ * \c ATOM_WOULDBLOCK is returned.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] ring Pointer to ring object
+ * @param[in] msgptr Pointer from which the entry should be copied out
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_WOULDBLOCK The ring was full
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting the woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on the woken thread
+ */
+uint8_t atomRingPut (ATOM_RING *ring, uint8_t *msgptr)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t head, next;
+
+    /* Check parameters */
+    if ((ring == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Find the slot after the one we are about to fill */
+        head = ring->head;
+        next = (uint8_t)(head + 1);
+        if (next == ring->num_entries)
+            next = 0;
+
+        /* The ring is full if that would catch up with the consumer */
+        if (next == ring->tail)
+        {
+            /* No space, the entry is dropped */
+            status = ATOM_WOULDBLOCK;
+        }
+        else
+        {
+            /* Copy the entry in, then publish it to the consumer */
+            memcpy (ring->buff_ptr + ((uint16_t)head * ring->unit_size), msgptr, ring->unit_size);
+            ATOM_BARRIER ();
+            ring->head = next;
+
+            /* Successful */
+            status = ATOM_OK;
+
+            /**
+             * The consumer only registers itself as waiting (with interrupts
+             * locked out) after finding the ring empty, and checks again for
+             * data before it sleeps. So if it is not registered here it will
+             * see the entry we have just published, and we need not enter
+             * the kernel at all.
+             */
+            if (ring->suspTcb != NULL)
+            {
+                /* Enter critical region */
+                CRITICAL_START ();
+
+                /* Check the consumer is still waiting (it may have timed out) */
+                tcb_ptr = ring->suspTcb;
+                if (tcb_ptr)
+                {
+                    /* Take the consumer off the ring */
+                    ring->suspTcb = NULL;
+
+                    /* Move the waiting thread to the ready queue */
+                    if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+                    {
+                        /* Set OK status to be returned to the waiting thread */
+                        tcb_ptr->suspend_wake_status = ATOM_OK;
+
+                        /* If there's a timeout on this suspension, cancel it */
+                        if ((tcb_ptr->suspend_timo_cb != NULL)
+                            && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+                        {
+                            /* There was a problem cancelling a timeout */
+                            status = ATOM_ERR_TIMER;
+                        }
+                        else
+                        {
+                            /* Flag as no timeout registered */
+                            tcb_ptr->suspend_timo_cb = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* There was a problem putting the thread on the ready queue */
+                        status = ATOM_ERR_QUEUE;
+                    }
+                }
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /**
+                 * The scheduler may now make a policy decision to thread
+                 * switch if we are currently in thread context. If we are
+                 * in interrupt context it will be handled by atomIntExit().
+                 */
+                if (tcb_ptr && atomCurrentContext())
+                    atomSched (FALSE);
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomRingGet
+ *
+ * Get an entry from a ring.
+ *
+ * Retrieves the oldest entry in the ring. Entries are copied into the
+ * passed \c msgptr storage area which should be large enough to contain
+ * one entry of \c unit_size bytes. This is only to be called by the ring's
+ * single consumer.
+ *
+ * If data is available the entry is copied out and handed back to the
+ * producer without locking out interrupts. If the ring is currently empty,
+ * the call will do one of the following depending on the \c timeout value
+ * specified:
+ *
+ * \c timeout == 0 : Call will block until an entry is available \n
+ * \c timeout > 0 : Call will block until an entry or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the ring is empty \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] ring Pointer to ring object
+ * @param[in] timeout Max system ticks to block (0 = forever, -1 =  no block)
+ * @param[out] msgptr Pointer to which the entry will be copied
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Ring wait timed out before being woken
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but ring was empty
+ * @retval ATOM_ERR_DELETED Ring was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomRingGet (ATOM_RING *ring, int32_t timeout, uint8_t *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    RING_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    uint8_t tail;
+
+    /* Check parameters */
+    if ((ring == NULL) || (msgptr == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success */
+        status = ATOM_OK;
+
+        /* Slow path: the ring is empty, we may need to wait for the producer */
+        if (ring->head == ring->tail)
+        {
+            /* If called with timeout >= 0, we should block */
+            if (timeout >= 0)
+            {
+                /* Get the current TCB */
+                curr_tcb_ptr = atomCurrentContext();
+
+                /* Check we are actually in thread context */
+                if (curr_tcb_ptr)
+                {
+                    /* Protect against the producer while deciding to sleep */
+                    CRITICAL_START ();
+
+                    /**
+                     * Check again now that interrupts are locked out. If the
+                     * producer has put an entry since the first check we
+                     * need not sleep at all, otherwise any put from now on
+                     * will see us registered as waiting and wake us.
+                     */
+                    if (ring->head == ring->tail)
+                    {
+                        /* Register as the waiting consumer */
+                        ring->suspTcb = curr_tcb_ptr;
+
+                        /* Set suspended status for the current thread */
+                        curr_tcb_ptr->suspended = TRUE;
+
+                        /* Register a timer callback if requested */
+                        if (timeout)
+                        {
+                            /* Fill out the data needed by the callback to wake us up */
+                            timer_data.tcb_ptr = curr_tcb_ptr;
+                            timer_data.ring_ptr = ring;
+
+                            /* Fill out the timer callback request structure */
+                            timer_cb.cb_func = atomRingTimerCallback;
+                            timer_cb.cb_data = (POINTER)&timer_data;
+                            timer_cb.cb_ticks = timeout;
+
+                            /**
+                             * Store the timer details in the TCB so that we
+                             * can cancel the timer callback if an entry is put
+                             * before the timeout occurs.
+                             */
+                            curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                            /* Register a callback on timeout */
+                            if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                            {
+                                /* Timer registration failed */
+                                status = ATOM_ERR_TIMER;
+
+                                /* Clean up and return to the caller */
+                                ring->suspTcb = NULL;
+                                curr_tcb_ptr->suspended = FALSE;
+                                curr_tcb_ptr->suspend_timo_cb = NULL;
+                            }
+                        }
+
+                        /* Set no timeout requested */
+                        else
+                        {
+                            /* No need to cancel timeouts on this one */
+                            curr_tcb_ptr->suspend_timo_cb = NULL;
+                        }
+
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Check no errors occurred */
+                        if (status == ATOM_OK)
+                        {
+                            /**
+                             * Current thread now blocking, schedule in a new
+                             * one. We already know we are in thread context
+                             * so can call the scheduler from here.
+                             */
+                            atomSched (FALSE);
+
+                            /**
+                             * Normal atomRingPut() wakeups will set ATOM_OK
+                             * status, while timeouts will set ATOM_TIMEOUT
+                             * and ring deletions will set ATOM_ERR_DELETED.
+                             */
+                            status = curr_tcb_ptr->suspend_wake_status;
+                        }
+                    }
+                    else
+                    {
+                        /* An entry arrived while we were checking */
+                        CRITICAL_END ();
+                    }
+                }
+                else
+                {
+                    /* Not currently in thread context, can't suspend */
+                    status = ATOM_ERR_CONTEXT;
+                }
+            }
+            else
+            {
+                /* timeout == -1, requested not to block and ring is empty */
+                status = ATOM_WOULDBLOCK;
+            }
+        }
+
+        /* If there is now an entry in the ring, copy it out */
+        if (status == ATOM_OK)
+        {
+            /**
+             * Copy the entry out, then hand the slot back to the producer.
+             * The first barrier stops the copy being started before the
+             * check above saw the producer's head update.
+             */
+            tail = ring->tail;
+            ATOM_BARRIER ();
+            memcpy (msgptr, ring->buff_ptr + ((uint16_t)tail * ring->unit_size), ring->unit_size);
+            tail++;
+            if (tail == ring->num_entries)
+                tail = 0;
+            ATOM_BARRIER ();
+            ring->tail = tail;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomRingTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c RING_TIMER object which is used to retrieve the
+ * ring details.
+ *
+ * @param[in] cb_data Pointer to a RING_TIMER object
+ */
+static void atomRingTimerCallback (POINTER cb_data)
+{
+    RING_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the RING_TIMER structure pointer */
+    timer_data_ptr = (RING_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Take the consumer off the ring */
+        timer_data_ptr->ring_ptr->suspTcb = NULL;
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
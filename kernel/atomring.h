@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_RING_H
+#define __ATOM_RING_H
+
+typedef struct atom_ring
+{
+    ATOM_TCB *  suspTcb;        /* Consumer thread waiting for data */
+    uint8_t *   buff_ptr;       /* Pointer to ring data area */
+    uint16_t    unit_size;      /* Size of each entry */
+    uint8_t     num_entries;    /* Number of entry slots in the ring */
+    volatile uint8_t head;      /* Next entry to write (producer only) */
+    volatile uint8_t tail;      /* Next entry to read (consumer only) */
+} ATOM_RING;
+
+extern uint8_t atomRingCreate (ATOM_RING *ring, uint8_t *buff_ptr, uint16_t unit_size, uint8_t num_entries);
+extern uint8_t atomRingDelete (ATOM_RING *ring);
+extern uint8_t atomRingPut (ATOM_RING *ring, uint8_t *msgptr);
+extern uint8_t atomRingGet (ATOM_RING *ring, int32_t timeout, uint8_t *msgptr);
+
+#endif /* __ATOM_RING_H */
@@ -91,6 +91,7 @@
 #include <stdio.h>
 #include "atom.h"
 #include "atomsem.h"
+#include "atomqset.h"
 #include "atomtimer.h"
 
 
@@ -144,6 +145,9 @@ uint8_t atomSemCreate (ATOM_SEM *sem, uint8_t initial_count)
         /* Initialise the suspended threads queue */
         sem->suspQ = NULL;
 
+        /* Not a member of any queue set */
+        sem->qset = NULL;
+
         /* Successful */
         status = ATOM_OK;
     }
@@ -577,10 +581,20 @@ uint8_t atomSemPut (ATOM_SEM * sem)
                 /* Increment the count and return success */
                 sem->count++;
                 status = ATOM_OK;
+
+                /* Wake any threads waiting on a queue set containing us */
+                if (sem->qset != NULL)
+                {
+                    status = atomQSetNotify (sem->qset);
+                }
             }
 
             /* Exit critical region */
             CRITICAL_END ();
+
+            /* Allow a woken queue set waiter to be scheduled in */
+            if ((sem->qset != NULL) && atomCurrentContext())
+                atomSched (FALSE);
         }
     }
 
@@ -30,10 +30,14 @@
 #ifndef __ATOM_SEM_H
 #define __ATOM_SEM_H
 
+/* Forward declaration */
+struct atom_qset;
+
 typedef struct atom_sem
 {
     ATOM_TCB *  suspQ;  /* Queue of threads suspended on this semaphore */
     uint8_t       count;  /* Semaphore count */
+    struct atom_qset *qset; /* Queue set this semaphore is a member of */
 } ATOM_SEM;
 
 extern uint8_t atomSemCreate (ATOM_SEM *sem, uint8_t initial_count);
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Seqlock library.
+ *
+ *
+ * This module implements a sequence lock protecting a small shared state
+ * structure, such as the latest value from a sensor, which is updated by
+ * one writer and read by any number of readers. It has the following
+ * features:
+ *
+ * \par Readers never block
+ * Readers take no lock and never disable interrupts. A read simply copies
+ * the snapshot out, and is retried only if a write completed while it was
+ * copying. Readers therefore never contend with the writer or with each
+ * other, and never delay interrupts.
+ *
+ * \par Double-buffered snapshots
+ * The state is held in two copies. The writer always updates the copy
+ * which readers are not currently directed to, so a reader which
+ * interrupts the writer (for example an interrupt handler reading state
+ * written by a thread) always gets a consistent snapshot at the first
+ * attempt, rather than spinning on a write that cannot complete.
+ *
+ * \par Interrupt-safe calls
+ * Both the writer and the readers can run in interrupt context. All calls
+ * are non-blocking.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All seqlock objects must be initialised before use by calling
+ * atomSeqlockCreate(). Callers pass in their own buffer area which must
+ * be large enough for two copies of the protected state (2 * \c size
+ * bytes). Both copies are cleared on creation.
+ *
+ * New snapshots are published by calling atomSeqlockWrite() and the latest
+ * snapshot is read by calling atomSeqlockRead().
+ *
+ * There must be only one writer for each seqlock. If more than one context
+ * needs to write the same state, the writers must be serialised by the
+ * application, for example using an ATOM_MUTEX (between threads only).
+ *
+ * The write sequence number is a single byte so that it can be read and
+ * written atomically on all supported architectures. A reader which is
+ * preempted for exactly a multiple of 128 writes could therefore miss that
+ * the snapshot changed underneath it, so readers should not be starved for
+ * that long by the writer.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomseqlock.h"
+
+
+/**
+ * \b atomSeqlockCreate
+ *
+ * Initialises a seqlock object.
+ *
+ * Must be called before calling any other seqlock library routines on a
+ * seqlock. Seqlocks do not hold any waiting threads, so no delete call
+ * is required.
+ *
+ * Does not allocate storage, the caller provides the seqlock object and
+ * a buffer area which must be large enough to store (2 * \c size) bytes.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] lock Pointer to seqlock object
+ * @param[in] buff_ptr Pointer to buffer storage area (2 * \c size bytes)
+ * @param[in] size Size in bytes of the protected state
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomSeqlockCreate (ATOM_SEQLOCK *lock, uint8_t *buff_ptr, uint16_t size)
+{
+    uint8_t status;
+    uint16_t i;
+
+    /* Parameter check */
+    if ((lock == NULL) || (buff_ptr == NULL) || (size == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the buffer details */
+        lock->buff_ptr = buff_ptr;
+        lock->size = size;
+
+        /* Clear both copies, readers start on the first */
+        for (i = 0; i < (uint16_t)(size * 2); i++)
+        {
+            lock->buff_ptr[i] = 0;
+        }
+        lock->seq = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomSeqlockWrite
+ *
+ * Publishes a new snapshot of the protected state.
+ *
+ * Each copy is updated while readers are directed to the other one, so
+ * readers always have a consistent copy available. The sequence number
+ * is advanced twice, once before each copy is updated.
+ *
+ * Must only be called by the single writer of this seqlock.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] lock Pointer to seqlock object
+ * @param[in] dataptr Pointer to the new state (\c size bytes)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomSeqlockWrite (ATOM_SEQLOCK *lock, uint8_t *dataptr)
+{
+    uint8_t status;
+    uint16_t i;
+    volatile uint8_t *copy_ptr;
+
+    /* Parameter check */
+    if ((lock == NULL) || (dataptr == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /**
+         * Direct readers to the second copy and update the first. The
+         * copies are accessed through a volatile pointer so that the
+         * compiler cannot move the data accesses across the sequence
+         * updates.
+         */
+        lock->seq++;
+        copy_ptr = lock->buff_ptr;
+        for (i = 0; i < lock->size; i++)
+        {
+            copy_ptr[i] = dataptr[i];
+        }
+
+        /* Direct readers back to the first copy and update the second */
+        lock->seq++;
+        copy_ptr = lock->buff_ptr + lock->size;
+        for (i = 0; i < lock->size; i++)
+        {
+            copy_ptr[i] = dataptr[i];
+        }
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomSeqlockRead
+ *
+ * Reads the latest snapshot of the protected state.
+ *
+ * Copies the copy which readers are currently directed to. If the writer
+ * moved on while the copy was being made, the snapshot may be torn and the
+ * read is retried. Retries only occur when this reader is preempted by
+ * the writer, and never when the writer is preempted by this reader.
+ *
+ * The sequence number of the snapshot can optionally be returned via
+ * \c seqptr. This is the number of writes completed before the snapshot
+ * (modulo 128), so it goes up by one for each write. Callers can compare
+ * it with a previous read to see whether the state has been updated. A
+ * read which interrupts a write returns the snapshot from before that
+ * write, and the sequence number from before it too.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] lock Pointer to seqlock object
+ * @param[out] dataptr Pointer to which the state is copied (\c size bytes)
+ * @param[out] seqptr Pointer to which the sequence number is written, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomSeqlockRead (ATOM_SEQLOCK *lock, uint8_t *dataptr, uint8_t *seqptr)
+{
+    uint8_t status;
+    uint8_t seq;
+    uint16_t i;
+    volatile uint8_t *copy_ptr;
+
+    /* Parameter check */
+    if ((lock == NULL) || (dataptr == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Copy out the stable copy until no write intervened */
+        do
+        {
+            /* An odd sequence number means the first copy is being written */
+            seq = lock->seq;
+            copy_ptr = lock->buff_ptr + ((seq & 1) ? lock->size : 0);
+            for (i = 0; i < lock->size; i++)
+            {
+                dataptr[i] = copy_ptr[i];
+            }
+        } while (lock->seq != seq);
+
+        /**
+         * Return the sequence number if requested. The internal count
+         * goes up twice per write (and is odd part way through one), so
+         * halve it to count only completed writes.
+         */
+        if (seqptr)
+        {
+            *seqptr = (uint8_t)(seq >> 1);
+        }
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
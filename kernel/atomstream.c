@@ -0,0 +1,1256 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Stream and message buffer library.
+ *
+ *
+ * This module implements byte-oriented buffers for passing data whose size
+ * is not known in advance, which would otherwise have to be sent through a
+ * queue of fixed-size messages. It has the following features:
+ *
+ * \par Stream buffers
+ * Any number of bytes can be written and read in each call, for example to
+ * pass serial data from an interrupt handler to a protocol thread. A
+ * trigger level sets how many bytes must be stored before a blocked
+ * receiver is woken, so that receivers are not woken for every byte.
+ *
+ * \par Message buffers
+ * Variable-length messages are stored with a length prefix and are always
+ * written and read whole, so each receive returns exactly one message as
+ * it was sent.
+ *
+ * \par Flexible blocking APIs
+ * Threads which wish to make a call which may block can choose whether to
+ * block, block with timeout, or not block and return a relevent status
+ * code.
+ *
+ * \par Interrupt-safe calls
+ * All APIs can be called from interrupt context. Any attempt to make a call
+ * which would block from interrupt context will be automatically and
+ * safely prevented.
+ *
+ * \par Priority-based queueing
+ * Where multiple threads are blocking on a buffer, they are woken in order
+ * of the threads' priorities. Where multiple threads of the same priority
+ * are blocking, they are woken in FIFO order.
+ *
+ * \par Smart buffer deletion
+ * Where a buffer is deleted while threads are blocking on it, all blocking
+ * threads are woken and returned a status code to indicate the reason for
+ * being woken.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A stream buffer is initialised by calling atomStreamCreate(), passing a
+ * data area and the trigger level. Bytes are written using atomStreamSend()
+ * which copies in as many of the bytes as there is space for, blocking only
+ * if the buffer is completely full, and returns the number of bytes
+ * written. Bytes are read using atomStreamReceive(), which blocks until at
+ * least the trigger level number of bytes are stored and then returns as
+ * many as are available up to the size of the caller's buffer. If fewer
+ * bytes than the trigger level arrive before a timeout expires (or when
+ * called non-blocking) then whatever bytes are stored are returned, and
+ * ATOM_TIMEOUT or ATOM_WOULDBLOCK is only returned if there were none.
+ *
+ * A message buffer is initialised by calling atomStreamMsgCreate().
+ * Messages are written using atomStreamMsgSend(), which blocks until there
+ * is space for the whole message and its ATOM_STREAM_MSG_HDR_SIZE byte
+ * length prefix, and read using atomStreamMsgReceive(), which blocks until
+ * a message is available and returns its length. If the next message is
+ * too large for the caller's buffer it is left in place and ATOM_ERR_OVF
+ * is returned along with the length needed.
+ *
+ * The stream and message APIs cannot be mixed on the same buffer.
+ *
+ * A buffer which is no longer required can be deleted using
+ * atomStreamDelete(). This function automatically wakes up any threads
+ * which are waiting on the deleted buffer.
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "atom.h"
+#include "atomstream.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct stream_timer
+{
+    ATOM_TCB    *tcb_ptr;    /* Thread which is suspended with timeout */
+    ATOM_STREAM *stream_ptr; /* Buffer the thread is interested in */
+    ATOM_TCB    **suspQ;     /* TCB queue which thread is suspended on */
+} STREAM_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t stream_suspend (ATOM_STREAM *stream, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, STREAM_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr);
+static uint8_t stream_ticks_left (int32_t timeout, uint32_t start_time, int32_t *ticks_left);
+static uint8_t stream_wake (ATOM_TCB **suspQ, uint8_t *woken);
+static void stream_copy_in (ATOM_STREAM *stream, uint8_t *dataptr, uint16_t len);
+static void stream_copy_out (ATOM_STREAM *stream, uint8_t *dataptr, uint16_t len);
+static void stream_discard (ATOM_STREAM *stream, uint16_t len);
+static void atomStreamTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomStreamCreate
+ *
+ * Initialises a stream buffer object.
+ *
+ * Must be called before calling any other stream buffer library routines
+ * on the buffer. Objects can be deleted later using atomStreamDelete().
+ *
+ * Does not allocate storage, the caller provides the buffer object and the
+ * data area of \c size bytes.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] stream Pointer to stream buffer object
+ * @param[in] buff_ptr Pointer to the data area
+ * @param[in] size Size of the data area in bytes
+ * @param[in] trigger_level Bytes which must be stored to wake a receiver (1 to size)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomStreamCreate (ATOM_STREAM *stream, uint8_t *buff_ptr, uint16_t size, uint16_t trigger_level)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((stream == NULL) || (buff_ptr == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else if ((size == 0) || (trigger_level == 0) || (trigger_level > size))
+    {
+        /* Bad values */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the buffer details */
+        stream->buff_ptr = buff_ptr;
+        stream->size = size;
+        stream->trigger_level = trigger_level;
+        stream->msg_mode = FALSE;
+
+        /* Initialise the suspended threads queues */
+        stream->putSuspQ = NULL;
+        stream->getSuspQ = NULL;
+
+        /* Initialise the insert/remove pointers */
+        stream->insert_index = 0;
+        stream->remove_index = 0;
+        stream->num_bytes_stored = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamMsgCreate
+ *
+ * Initialises a message buffer object.
+ *
+ * Must be called before calling any other message buffer library routines
+ * on the buffer. Objects can be deleted later using atomStreamDelete().
+ *
+ * Each stored message occupies its own length plus ATOM_STREAM_MSG_HDR_SIZE
+ * bytes of the data area, so the largest message which can be sent is
+ * \c size - ATOM_STREAM_MSG_HDR_SIZE bytes.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] stream Pointer to message buffer object
+ * @param[in] buff_ptr Pointer to the data area
+ * @param[in] size Size of the data area in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomStreamMsgCreate (ATOM_STREAM *stream, uint8_t *buff_ptr, uint16_t size)
+{
+    uint8_t status;
+
+    /* Must have room for at least a one byte message */
+    if (size <= ATOM_STREAM_MSG_HDR_SIZE)
+    {
+        /* Bad values */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Create as a stream woken on any stored data */
+        status = atomStreamCreate (stream, buff_ptr, size, 1);
+        if (status == ATOM_OK)
+        {
+            /* Store length-prefixed messages */
+            stream->msg_mode = TRUE;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamDelete
+ *
+ * Deletes a stream or message buffer object.
+ *
+ * Any threads currently suspended on the buffer will be woken up with
+ * return status ATOM_ERR_DELETED. If called at thread context then the
+ * scheduler will be called during this function which may schedule in one
+ * of the woken threads depending on relative priorities.
+ *
+ * This function can be called from interrupt context, but loops internally
+ * waking up all threads blocking on the buffer, so the potential
+ * execution cycles cannot be determined in advance.
+ *
+ * @param[in] stream Pointer to stream or message buffer object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomStreamDelete (ATOM_STREAM *stream)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+    ATOM_TCB *tcb_ptr;
+    uint8_t woken_threads = FALSE;
+
+    /* Parameter check */
+    if (stream == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur during wakeup */
+        status = ATOM_OK;
+
+        /* Wake up all suspended tasks */
+        while (1)
+        {
+            /* Enter critical region */
+            CRITICAL_START ();
+
+            /* Check if any threads are suspended */
+            if (((tcb_ptr = tcbDequeueHead (&stream->getSuspQ)) != NULL)
+                || ((tcb_ptr = tcbDequeueHead (&stream->putSuspQ)) != NULL))
+            {
+                /* A thread is waiting on a suspend queue */
+
+                /* Return error status to the waiting thread */
+                tcb_ptr->suspend_wake_status = ATOM_ERR_DELETED;
+
+                /* Put the thread on the ready queue */
+                if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Quit the loop, returning error */
+                    status = ATOM_ERR_QUEUE;
+                    break;
+                }
+
+                /* If there's a timeout on this suspension, cancel it */
+                if (tcb_ptr->suspend_timo_cb)
+                {
+                    /* Cancel the callback */
+                    if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+                    {
+                        /* Exit critical region */
+                        CRITICAL_END ();
+
+                        /* Quit the loop, returning error */
+                        status = ATOM_ERR_TIMER;
+                        break;
+                    }
+
+                    /* Flag as no timeout registered */
+                    tcb_ptr->suspend_timo_cb = NULL;
+
+                }
+
+                /* Exit critical region */
+                CRITICAL_END ();
+
+                /* Request a reschedule */
+                woken_threads = TRUE;
+            }
+
+            /* No more suspended threads */
+            else
+            {
+                /* Exit critical region and quit the loop */
+                CRITICAL_END ();
+                break;
+            }
+        }
+
+        /* Call scheduler if any threads were woken up */
+        if (woken_threads == TRUE)
+        {
+            /**
+             * Only call the scheduler if we are in thread context, otherwise
+             * it will be called on exiting the ISR by atomIntExit().
+             */
+            if (atomCurrentContext())
+                atomSched (FALSE);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamSend
+ *
+ * Write bytes to a stream buffer.
+ *
+ * Copies in as many of the \c len bytes as there is currently space for,
+ * and returns the number written in \c sent. The caller only blocks if the
+ * buffer is completely full, in which case it waits for any space to
+ * become available and then writes as much as fits. The remainder (if
+ * any) can be sent with a further call.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if the buffer is full:
+ *
+ * \c timeout == 0 : Call will block until space is available \n
+ * \c timeout > 0 : Call will block until space is available or timeout \n
+ * \c timeout == -1 : Return immediately if the buffer is full \n
+ *
+ * Any receivers blocking on the buffer are woken once the trigger level
+ * number of bytes are stored.
+ *
+ * This function can be called from interrupt context if \c timeout is -1.
+ *
+ * @param[in] stream Pointer to stream buffer object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] dataptr Pointer to the bytes to write
+ * @param[in] len Number of bytes to write
+ * @param[out] sent Number of bytes actually written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT The buffer was still full when the timeout expired
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the buffer is full
+ * @retval ATOM_ERR_DELETED Buffer was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter, or buffer is a message buffer
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomStreamSend (ATOM_STREAM *stream, int32_t timeout, uint8_t *dataptr, uint16_t len, uint16_t *sent)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken = FALSE;
+    uint16_t free_bytes;
+    uint32_t start_time;
+    int32_t ticks_left;
+    STREAM_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((stream == NULL) || (dataptr == NULL) || (sent == NULL)
+        || (len == 0) || (stream->msg_mode == TRUE))
+    {
+        /* Bad parameter */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Nothing written yet */
+        *sent = 0;
+
+        /* Note the start time for any repeated blocking */
+        start_time = atomTimeGet ();
+        ticks_left = timeout;
+        status = ATOM_OK;
+
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* Block while the buffer is full */
+        while ((status == ATOM_OK) && (stream->num_bytes_stored == stream->size))
+        {
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+            else
+            {
+                /* Add current thread to the suspend list on sends */
+                status = stream_suspend (stream, &stream->putSuspQ, curr_tcb_ptr,
+                                         ticks_left, &timer_data, &timer_cb);
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    CRITICAL_END ();
+                    atomSched (FALSE);
+
+                    /* Woken because space was freed, or timeout/deletion */
+                    status = curr_tcb_ptr->suspend_wake_status;
+                    if (status == ATOM_OK)
+                    {
+                        /* Another writer may have taken the space: recheck */
+                        status = stream_ticks_left (timeout, start_time, &ticks_left);
+                    }
+                    CRITICAL_START ();
+                }
+            }
+        }
+
+        /* Write as much as there is room for */
+        if (status == ATOM_OK)
+        {
+            free_bytes = stream->size - stream->num_bytes_stored;
+            if (len > free_bytes)
+            {
+                len = free_bytes;
+            }
+            stream_copy_in (stream, dataptr, len);
+            *sent = len;
+
+            /* Wake the receivers if the trigger level has been reached */
+            if (stream->num_bytes_stored >= stream->trigger_level)
+            {
+                status = stream_wake (&stream->getSuspQ, &woken);
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If a thread was woken and we are in thread context, call the
+         * scheduler. In interrupt context it will be handled by
+         * atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamReceive
+ *
+ * Read bytes from a stream buffer.
+ *
+ * Blocks until at least the trigger level number of bytes are stored, and
+ * then reads as many bytes as are available, up to \c max_len.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if fewer than the trigger level bytes are stored:
+ *
+ * \c timeout == 0 : Call will block until the trigger level is reached \n
+ * \c timeout > 0 : Call will block until the trigger level is reached or timeout \n
+ * \c timeout == -1 : Return immediately \n
+ *
+ * If the timeout expires, or the call was non-blocking, then any bytes
+ * which are stored are still returned with ATOM_OK status. ATOM_TIMEOUT
+ * and ATOM_WOULDBLOCK are only returned if the buffer was empty.
+ *
+ * This function can be called from interrupt context if \c timeout is -1.
+ *
+ * @param[in] stream Pointer to stream buffer object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] dataptr Pointer to which the bytes will be copied
+ * @param[in] max_len Maximum number of bytes to read
+ * @param[out] received Number of bytes actually read
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT The buffer was still empty when the timeout expired
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the buffer is empty
+ * @retval ATOM_ERR_DELETED Buffer was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter, or buffer is a message buffer
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomStreamReceive (ATOM_STREAM *stream, int32_t timeout, uint8_t *dataptr, uint16_t max_len, uint16_t *received)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken = FALSE;
+    uint32_t start_time;
+    int32_t ticks_left;
+    STREAM_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((stream == NULL) || (dataptr == NULL) || (received == NULL)
+        || (max_len == 0) || (stream->msg_mode == TRUE))
+    {
+        /* Bad parameter */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Nothing read yet */
+        *received = 0;
+
+        /* Note the start time for any repeated blocking */
+        start_time = atomTimeGet ();
+        ticks_left = timeout;
+        status = ATOM_OK;
+
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* Block until the trigger level is reached */
+        while ((status == ATOM_OK) && (stream->num_bytes_stored < stream->trigger_level))
+        {
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+            else
+            {
+                /* Add current thread to the suspend list on receives */
+                status = stream_suspend (stream, &stream->getSuspQ, curr_tcb_ptr,
+                                         ticks_left, &timer_data, &timer_cb);
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    CRITICAL_END ();
+                    atomSched (FALSE);
+
+                    /* Woken because data arrived, or timeout/deletion */
+                    status = curr_tcb_ptr->suspend_wake_status;
+                    if (status == ATOM_OK)
+                    {
+                        /* Another reader may have taken the data: recheck */
+                        status = stream_ticks_left (timeout, start_time, &ticks_left);
+                    }
+                    CRITICAL_START ();
+                }
+            }
+        }
+
+        /* Return whatever is stored if we timed out below the trigger level */
+        if (((status == ATOM_TIMEOUT) || (status == ATOM_WOULDBLOCK))
+            && (stream->num_bytes_stored > 0))
+        {
+            status = ATOM_OK;
+        }
+
+        /* Read as much as is available */
+        if (status == ATOM_OK)
+        {
+            if (max_len > stream->num_bytes_stored)
+            {
+                max_len = stream->num_bytes_stored;
+            }
+            stream_copy_out (stream, dataptr, max_len);
+            stream_discard (stream, max_len);
+            *received = max_len;
+
+            /* Space was freed, let any blocked senders retry */
+            status = stream_wake (&stream->putSuspQ, &woken);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If a thread was woken and we are in thread context, call the
+         * scheduler. In interrupt context it will be handled by
+         * atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamMsgSend
+ *
+ * Write a message to a message buffer.
+ *
+ * The message is written whole along with its length, so that it will be
+ * returned intact by a single call to atomStreamMsgReceive(). The caller
+ * blocks until there is space for the entire message.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if there is not enough space:
+ *
+ * \c timeout == 0 : Call will block until space is available \n
+ * \c timeout > 0 : Call will block until space is available or timeout \n
+ * \c timeout == -1 : Return immediately if there is not enough space \n
+ *
+ * This function can be called from interrupt context if \c timeout is -1.
+ *
+ * @param[in] stream Pointer to message buffer object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] msgptr Pointer to the message
+ * @param[in] len Length of the message in bytes
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT There was not enough space before the timeout expired
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but there is not enough space
+ * @retval ATOM_ERR_DELETED Buffer was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter, message too large, or not a message buffer
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomStreamMsgSend (ATOM_STREAM *stream, int32_t timeout, uint8_t *msgptr, uint16_t len)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken = FALSE;
+    uint8_t hdr[ATOM_STREAM_MSG_HDR_SIZE];
+    uint32_t start_time;
+    int32_t ticks_left;
+    STREAM_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((stream == NULL) || (msgptr == NULL) || (len == 0)
+        || (stream->msg_mode == FALSE)
+        || (len > (stream->size - ATOM_STREAM_MSG_HDR_SIZE)))
+    {
+        /* Bad parameter */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Note the start time for any repeated blocking */
+        start_time = atomTimeGet ();
+        ticks_left = timeout;
+        status = ATOM_OK;
+
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* Block until the whole message fits */
+        while ((status == ATOM_OK) &&
+            ((stream->size - stream->num_bytes_stored) < (len + ATOM_STREAM_MSG_HDR_SIZE)))
+        {
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+            else
+            {
+                /* Add current thread to the suspend list on sends */
+                status = stream_suspend (stream, &stream->putSuspQ, curr_tcb_ptr,
+                                         ticks_left, &timer_data, &timer_cb);
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    CRITICAL_END ();
+                    atomSched (FALSE);
+
+                    /* Woken because space was freed, or timeout/deletion */
+                    status = curr_tcb_ptr->suspend_wake_status;
+                    if (status == ATOM_OK)
+                    {
+                        /* The space may still be too small: recheck */
+                        status = stream_ticks_left (timeout, start_time, &ticks_left);
+                    }
+                    CRITICAL_START ();
+                }
+            }
+        }
+
+        /* Write the length prefix followed by the message */
+        if (status == ATOM_OK)
+        {
+            hdr[0] = (uint8_t)(len & 0xFF);
+            hdr[1] = (uint8_t)(len >> 8);
+            stream_copy_in (stream, hdr, ATOM_STREAM_MSG_HDR_SIZE);
+            stream_copy_in (stream, msgptr, len);
+
+            /* Wake any blocked receivers */
+            status = stream_wake (&stream->getSuspQ, &woken);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If a thread was woken and we are in thread context, call the
+         * scheduler. In interrupt context it will be handled by
+         * atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamMsgReceive
+ *
+ * Read the next message from a message buffer.
+ *
+ * Copies the oldest message into \c msgptr and returns its length in
+ * \c len. If the message is larger than \c max_len then it is left in the
+ * buffer, ATOM_ERR_OVF is returned and \c len is set to the size of buffer
+ * needed to receive it.
+ *
+ * Depending on the \c timeout value specified the call will do one of
+ * the following if the buffer is empty:
+ *
+ * \c timeout == 0 : Call will block until a message is available \n
+ * \c timeout > 0 : Call will block until a message is available or timeout \n
+ * \c timeout == -1 : Return immediately if the buffer is empty \n
+ *
+ * This function can be called from interrupt context if \c timeout is -1.
+ *
+ * @param[in] stream Pointer to message buffer object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] msgptr Pointer to which the message will be copied
+ * @param[in] max_len Size of the \c msgptr buffer in bytes
+ * @param[out] len Length of the message received
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT The buffer was still empty when the timeout expired
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the buffer is empty
+ * @retval ATOM_ERR_OVF The next message is larger than \c max_len
+ * @retval ATOM_ERR_DELETED Buffer was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter, or not a message buffer
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomStreamMsgReceive (ATOM_STREAM *stream, int32_t timeout, uint8_t *msgptr, uint16_t max_len, uint16_t *len)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken = FALSE;
+    uint8_t hdr[ATOM_STREAM_MSG_HDR_SIZE];
+    uint16_t msg_len;
+    uint32_t start_time;
+    int32_t ticks_left;
+    STREAM_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Check parameters */
+    if ((stream == NULL) || (msgptr == NULL) || (len == NULL)
+        || (stream->msg_mode == FALSE))
+    {
+        /* Bad parameter */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Nothing read yet */
+        *len = 0;
+
+        /* Note the start time for any repeated blocking */
+        start_time = atomTimeGet ();
+        ticks_left = timeout;
+        status = ATOM_OK;
+
+        /* Protect access to the buffer object and OS queues */
+        CRITICAL_START ();
+
+        /* Block until a message is available */
+        while ((status == ATOM_OK) && (stream->num_bytes_stored == 0))
+        {
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+            else
+            {
+                /* Add current thread to the suspend list on receives */
+                status = stream_suspend (stream, &stream->getSuspQ, curr_tcb_ptr,
+                                         ticks_left, &timer_data, &timer_cb);
+                if (status == ATOM_OK)
+                {
+                    /* Current thread now blocking, schedule in a new one */
+                    CRITICAL_END ();
+                    atomSched (FALSE);
+
+                    /* Woken because data arrived, or timeout/deletion */
+                    status = curr_tcb_ptr->suspend_wake_status;
+                    if (status == ATOM_OK)
+                    {
+                        /* Another reader may have taken the message: recheck */
+                        status = stream_ticks_left (timeout, start_time, &ticks_left);
+                    }
+                    CRITICAL_START ();
+                }
+            }
+        }
+
+        if (status == ATOM_OK)
+        {
+            /* Fetch the length prefix of the oldest message */
+            stream_copy_out (stream, hdr, ATOM_STREAM_MSG_HDR_SIZE);
+            msg_len = (uint16_t)hdr[0] | ((uint16_t)hdr[1] << 8);
+            *len = msg_len;
+
+            if (msg_len > max_len)
+            {
+                /* Caller's buffer too small, leave the message in place */
+                status = ATOM_ERR_OVF;
+            }
+            else
+            {
+                /* Remove the prefix and copy out the message */
+                stream_discard (stream, ATOM_STREAM_MSG_HDR_SIZE);
+                stream_copy_out (stream, msgptr, msg_len);
+                stream_discard (stream, msg_len);
+
+                /* Space was freed, let any blocked senders retry */
+                status = stream_wake (&stream->putSuspQ, &woken);
+            }
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * If a thread was woken and we are in thread context, call the
+         * scheduler. In interrupt context it will be handled by
+         * atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomStreamTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended threads are notified by the timer system through
+ * this generic callback. The timer system calls us back with a pointer to
+ * the relevant \c STREAM_TIMER object which is used to retrieve the
+ * buffer details.
+ *
+ * @param[in] cb_data Pointer to a STREAM_TIMER object
+ */
+static void atomStreamTimerCallback (POINTER cb_data)
+{
+    STREAM_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the STREAM_TIMER structure pointer */
+    timer_data_ptr = (STREAM_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the buffer's send or receive list */
+        (void)tcbDequeueEntry (timer_data_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
+
+
+/**
+ * \b stream_suspend
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Places the calling thread on one of the buffer's suspend lists, and
+ * registers a timeout callback if requested.
+ *
+ * The timer storage is provided by the caller (on its own stack) and must
+ * remain valid until the thread is woken.
+ *
+ * Assumes interrupts are already locked out. The caller is responsible for
+ * exiting the critical region and calling the scheduler if successful.
+ *
+ * @param[in] stream Pointer to an ATOM_STREAM object
+ * @param[in] suspQ Suspend list to place the thread on
+ * @param[in] tcb_ptr TCB of the calling thread
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] timer_data_ptr Storage for the timeout callback data
+ * @param[in] timer_cb_ptr Storage for the timeout callback request
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+static uint8_t stream_suspend (ATOM_STREAM *stream, ATOM_TCB **suspQ, ATOM_TCB *tcb_ptr, int32_t timeout, STREAM_TIMER *timer_data_ptr, ATOM_TIMER *timer_cb_ptr)
+{
+    uint8_t status;
+
+    /* Add the thread to the requested suspend list */
+    if (tcbEnqueuePriority (suspQ, tcb_ptr) != ATOM_OK)
+    {
+        /* There was an error putting this thread on the suspend list */
+        status = ATOM_ERR_QUEUE;
+    }
+    else
+    {
+        /* Set suspended status for the thread */
+        tcb_ptr->suspended = TRUE;
+
+        /* Track errors */
+        status = ATOM_OK;
+
+        /* Register a timer callback if requested */
+        if (timeout)
+        {
+            /* Fill out the data needed by the callback to wake us up */
+            timer_data_ptr->tcb_ptr = tcb_ptr;
+            timer_data_ptr->stream_ptr = stream;
+            timer_data_ptr->suspQ = suspQ;
+
+            /* Fill out the timer callback request structure */
+            timer_cb_ptr->cb_func = atomStreamTimerCallback;
+            timer_cb_ptr->cb_data = (POINTER)timer_data_ptr;
+            timer_cb_ptr->cb_ticks = timeout;
+
+            /**
+             * Store the timer details in the TCB so that we can cancel the
+             * timer callback if the thread is woken before the timeout
+             * occurs.
+             */
+            tcb_ptr->suspend_timo_cb = timer_cb_ptr;
+
+            /* Register a callback on timeout */
+            if (atomTimerRegister (timer_cb_ptr) != ATOM_OK)
+            {
+                /* Timer registration failed */
+                status = ATOM_ERR_TIMER;
+
+                /* Clean up and return to the caller */
+                (void)tcbDequeueEntry (suspQ, tcb_ptr);
+                tcb_ptr->suspended = FALSE;
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+
+        /* Set no timeout requested */
+        else
+        {
+            /* No need to cancel timeouts on this one */
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b stream_ticks_left
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Woken threads recheck the buffer and may need to block again, so this
+ * works out how much of the caller's original timeout remains.
+ *
+ * @param[in] timeout Original timeout passed by the caller (0 = forever)
+ * @param[in] start_time System tick time at which the call was made
+ * @param[out] ticks_left Remaining ticks to block for (0 = forever)
+ *
+ * @retval ATOM_OK Time remains, or the caller blocks forever
+ * @retval ATOM_TIMEOUT The original timeout has expired
+ */
+static uint8_t stream_ticks_left (int32_t timeout, uint32_t start_time, int32_t *ticks_left)
+{
+    uint8_t status;
+    uint32_t elapsed;
+
+    /* Default to success */
+    status = ATOM_OK;
+
+    /* Nothing to do for callers blocking forever */
+    if (timeout > 0)
+    {
+        elapsed = atomTimeGet () - start_time;
+        if (elapsed >= (uint32_t)timeout)
+        {
+            /* Timeout has already expired */
+            status = ATOM_TIMEOUT;
+        }
+        else
+        {
+            *ticks_left = timeout - (int32_t)elapsed;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b stream_wake
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Wakes all threads suspended on one of the buffer's suspend lists, in
+ * priority order. Because each sender or receiver may need a different
+ * number of bytes, woken threads recheck the buffer themselves and block
+ * again if their request still cannot be satisfied.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] suspQ Suspend list to wake threads from
+ * @param[out] woken Set to TRUE if any threads were woken
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout
+ */
+static uint8_t stream_wake (ATOM_TCB **suspQ, uint8_t *woken)
+{
+    uint8_t status;
+    ATOM_TCB *tcb_ptr;
+
+    /* Default to success if there are no threads waiting */
+    status = ATOM_OK;
+
+    /* Wake threads until none remain */
+    while ((status == ATOM_OK) && ((tcb_ptr = tcbDequeueHead (suspQ)) != NULL))
+    {
+        /* Move the waiting thread to the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) == ATOM_OK)
+        {
+            /* Set OK status to be returned to the waiting thread */
+            tcb_ptr->suspend_wake_status = ATOM_OK;
+            *woken = TRUE;
+
+            /* If there's a timeout on this suspension, cancel it */
+            if ((tcb_ptr->suspend_timo_cb != NULL)
+                && (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK))
+            {
+                /* There was a problem cancelling a timeout */
+                status = ATOM_ERR_TIMER;
+            }
+            else
+            {
+                /* Flag as no timeout registered */
+                tcb_ptr->suspend_timo_cb = NULL;
+            }
+        }
+        else
+        {
+            /**
+             * There was a problem putting the thread on the ready
+             * queue.
+             */
+            status = ATOM_ERR_QUEUE;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b stream_copy_in
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Copies bytes into the buffer at the insert position, wrapping around the
+ * end of the data area if necessary. Assumes the caller has checked there
+ * is enough space.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] stream Pointer to an ATOM_STREAM object
+ * @param[in] dataptr Bytes to copy in
+ * @param[in] len Number of bytes
+ */
+static void stream_copy_in (ATOM_STREAM *stream, uint8_t *dataptr, uint16_t len)
+{
+    uint16_t first;
+
+    /* Copy up to the end of the data area, then the rest from the start */
+    first = stream->size - stream->insert_index;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy (stream->buff_ptr + stream->insert_index, dataptr, first);
+    memcpy (stream->buff_ptr, dataptr + first, len - first);
+
+    /* Advance the insert index, avoiding overflow for large buffers */
+    if (len >= (stream->size - stream->insert_index))
+    {
+        stream->insert_index = len - (stream->size - stream->insert_index);
+    }
+    else
+    {
+        stream->insert_index += len;
+    }
+    stream->num_bytes_stored += len;
+}
+
+
+/**
+ * \b stream_copy_out
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Copies bytes out of the buffer from the remove position, wrapping around
+ * the end of the data area if necessary. The bytes are not removed, which
+ * is done separately by stream_discard(). Assumes the caller has checked
+ * that enough bytes are stored.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] stream Pointer to an ATOM_STREAM object
+ * @param[out] dataptr Destination for the bytes
+ * @param[in] len Number of bytes
+ */
+static void stream_copy_out (ATOM_STREAM *stream, uint8_t *dataptr, uint16_t len)
+{
+    uint16_t first;
+
+    /* Copy up to the end of the data area, then the rest from the start */
+    first = stream->size - stream->remove_index;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy (dataptr, stream->buff_ptr + stream->remove_index, first);
+    memcpy (dataptr + first, stream->buff_ptr, len - first);
+}
+
+
+/**
+ * \b stream_discard
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Removes bytes from the buffer by advancing the remove position.
+ *
+ * Assumes interrupts are already locked out.
+ *
+ * @param[in] stream Pointer to an ATOM_STREAM object
+ * @param[in] len Number of bytes
+ */
+static void stream_discard (ATOM_STREAM *stream, uint16_t len)
+{
+    if (len >= (stream->size - stream->remove_index))
+    {
+        stream->remove_index = len - (stream->size - stream->remove_index);
+    }
+    else
+    {
+        stream->remove_index += len;
+    }
+    stream->num_bytes_stored -= len;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ATOM_STREAM_H
+#define __ATOM_STREAM_H
+
+typedef struct atom_stream
+{
+    ATOM_TCB *  putSuspQ;       /* Queue of threads waiting to send */
+    ATOM_TCB *  getSuspQ;       /* Queue of threads waiting to receive */
+    uint8_t *   buff_ptr;       /* Pointer to stream data area */
+    uint16_t    size;           /* Size of the data area in bytes */
+    uint16_t    trigger_level;  /* Bytes needed before receivers are woken */
+    uint16_t    insert_index;   /* Next byte index to insert into */
+    uint16_t    remove_index;   /* Next byte index to remove from */
+    uint16_t    num_bytes_stored;/* Number of bytes stored */
+    uint8_t     msg_mode;       /* TRUE if storing length-prefixed messages */
+} ATOM_STREAM;
+
+/* Size of the length prefix stored with each message */
+#define ATOM_STREAM_MSG_HDR_SIZE    2
+
+extern uint8_t atomStreamCreate (ATOM_STREAM *stream, uint8_t *buff_ptr, uint16_t size, uint16_t trigger_level);
+extern uint8_t atomStreamMsgCreate (ATOM_STREAM *stream, uint8_t *buff_ptr, uint16_t size);
+extern uint8_t atomStreamDelete (ATOM_STREAM *stream);
+extern uint8_t atomStreamSend (ATOM_STREAM *stream, int32_t timeout, uint8_t *dataptr, uint16_t len, uint16_t *sent);
+extern uint8_t atomStreamReceive (ATOM_STREAM *stream, int32_t timeout, uint8_t *dataptr, uint16_t max_len, uint16_t *received);
+extern uint8_t atomStreamMsgSend (ATOM_STREAM *stream, int32_t timeout, uint8_t *msgptr, uint16_t len);
+extern uint8_t atomStreamMsgReceive (ATOM_STREAM *stream, int32_t timeout, uint8_t *msgptr, uint16_t max_len, uint16_t *len);
+
+#endif /* __ATOM_STREAM_H */
@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Run-to-completion task library.
+ *
+ *
+ * This module implements lightweight tasks which have no stack of their
+ * own. Each task is a function which runs to completion every time the
+ * task is posted, and all tasks share the stack of a single kernel thread,
+ * so dozens of small event handlers cost little more RAM than one thread.
+ * It has the following features:
+ *
+ * \par Shared stack
+ * Tasks are run by the task executor thread, on its stack. A task cannot
+ * block, so it needs no stack of its own between runs. The only per-task
+ * storage is its small ATOM_TASK object.
+ *
+ * \par Priority ordering
+ * Each task has a priority of its own, independent of the thread
+ * priorities. Ready tasks always run highest priority first, and in the
+ * order posted within a priority.
+ *
+ * \par Preemption of lower tasks
+ * A task which posts a higher priority task runs it immediately, nested
+ * on the shared stack, and continues once it has completed. Tasks of
+ * equal or lower priority wait until the posting task completes. The
+ * nesting depth, and so the stack needed, is bounded by the number of
+ * task priorities in use.
+ *
+ * \par Scheduled alongside threads
+ * The executor is an ordinary thread, so all tasks preempt threads below
+ * the executor's priority and are preempted by threads above it.
+ *
+ * \par Event counting
+ * Posts are counted, so a task posted several times (for example by a
+ * burst of interrupts) runs once for each post.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * The executor thread is started by calling atomTaskInit() once, after
+ * atomOSInit(). The caller provides its stack and thread priority. The
+ * stack must be sized for the deepest nesting of task functions.
+ *
+ * Each ATOM_TASK object is initialised with its priority, function and
+ * argument by calling atomTaskCreate(). It can then be posted any number
+ * of times using atomTaskPost(), from interrupt context, thread context
+ * or another task.
+ *
+ * Task functions must not make blocking kernel calls, as blocking would
+ * stall all tasks.
+ *
+ * Tasks posted from interrupt handlers or other threads while a task is
+ * running do not preempt it, as there is no way to nest them onto the
+ * shared stack from outside. They run, in priority order, as soon as the
+ * running task completes.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtask.h"
+
+
+/* Constants */
+
+/** Running priority when no task is running, below all task priorities */
+#define TASK_PRIO_NONE      256
+
+
+/* Local data */
+
+/** Executor thread storage */
+static ATOM_TCB task_tcb;
+
+/** Semaphore used to wake the executor thread */
+static ATOM_SEM task_sem;
+
+/** List of ready tasks, in priority order */
+static ATOM_TASK *task_ready_list = NULL;
+
+/** Priority of the innermost running task */
+static uint16_t task_running_prio = TASK_PRIO_NONE;
+
+
+/* Forward declarations */
+
+static void atomTaskThread (uint32_t param);
+static void atomTaskDispatch (uint16_t threshold);
+static void taskEnqueuePriority (ATOM_TASK *task);
+
+
+/**
+ * \b atomTaskInit
+ *
+ * Starts the task executor thread.
+ *
+ * Must be called once, after atomOSInit() and before any tasks are
+ * posted.
+ *
+ * @param[in] stack_top Top of the executor thread's stack area
+ * @param[in] stack_size Size of the stack area in bytes
+ * @param[in] priority Thread priority of the executor
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error putting the thread on the ready queue
+ */
+uint8_t atomTaskInit (void *stack_top, uint32_t stack_size, uint8_t priority)
+{
+    uint8_t status;
+
+    /* Initialise the ready list and wakeup semaphore */
+    task_ready_list = NULL;
+    task_running_prio = TASK_PRIO_NONE;
+    status = atomSemCreate (&task_sem, 0);
+
+    /* Start the executor thread, which checks the stack parameters */
+    if (status == ATOM_OK)
+    {
+        status = atomThreadCreate (&task_tcb, priority, atomTaskThread, 0,
+                     stack_top, stack_size);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTaskCreate
+ *
+ * Initialises a task object.
+ *
+ * Must be called before the task is posted using atomTaskPost(), and must
+ * not be called while the task is pending.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] task Pointer to task object
+ * @param[in] priority Task priority (0 = highest)
+ * @param[in] func Task function
+ * @param[in] arg Parameter passed to the function
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomTaskCreate (ATOM_TASK *task, uint8_t priority, ATOM_TASK_FUNC func, POINTER arg)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((task == NULL) || (func == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the task details */
+        task->func = func;
+        task->arg = arg;
+        task->priority = priority;
+        task->pending = 0;
+        task->next_task = NULL;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTaskPost
+ *
+ * Posts a task to run.
+ *
+ * The task is made ready if it is not already, and its count of posts is
+ * incremented so that it runs once for each post.
+ *
+ * When called from a task of lower priority, the posted task runs before
+ * this function returns. When called from interrupt context the executor
+ * is scheduled in when the interrupt handler calls atomIntExit(), and when
+ * called from another thread it is scheduled in immediately if it has
+ * higher priority than the calling thread.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] task Pointer to task object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_OVF The task's count of posts would overflow
+ * @retval ATOM_ERR_QUEUE Problem putting the executor on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on the executor
+ */
+uint8_t atomTaskPost (ATOM_TASK *task)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t wake;
+    ATOM_TCB *curr_tcb_ptr;
+
+    /* Parameter check */
+    if (task == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the ready list */
+        CRITICAL_START ();
+
+        /* Count the post, making the task ready if it was not already */
+        status = ATOM_OK;
+        wake = FALSE;
+        if (task->pending == 0xFFFF)
+        {
+            /* Count is already at its maximum */
+            status = ATOM_ERR_OVF;
+        }
+        else if (task->pending++ == 0)
+        {
+            /**
+             * The executor may be asleep if the list was empty. Only post
+             * if no wakeup is already outstanding: a task which reposts
+             * itself finds the list empty on every run, and the extra
+             * posts would otherwise build up in the semaphore count until
+             * it overflowed.
+             */
+            wake = ((task_ready_list == NULL) && (task_sem.count == 0)) ? TRUE : FALSE;
+            taskEnqueuePriority (task);
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        if (status == ATOM_OK)
+        {
+            curr_tcb_ptr = atomCurrentContext();
+            if ((curr_tcb_ptr == &task_tcb) && (task->priority < task_running_prio))
+            {
+                /* Posted by a lower task, preempt it on the shared stack */
+                atomTaskDispatch (task_running_prio);
+            }
+            else if (wake == TRUE)
+            {
+                /**
+                 * Wake the executor on the empty to non-empty transition.
+                 * It drains the whole list before sleeping again, so later
+                 * posts need no wakeup of their own, and one outstanding
+                 * post is enough.
+                 */
+                status = atomSemPut (&task_sem);
+            }
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTaskThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for the executor thread. Sleeps until a task is posted,
+ * then runs tasks until none are ready.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void atomTaskThread (uint32_t param)
+{
+    /* Compiler warning */
+    param = param;
+
+    /* Loop forever */
+    while (1)
+    {
+        /* Wait for tasks to be posted */
+        (void)atomSemGet (&task_sem, 0);
+
+        /* Run all ready tasks */
+        atomTaskDispatch (TASK_PRIO_NONE);
+    }
+}
+
+
+/**
+ * \b atomTaskDispatch
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Runs ready tasks of higher priority than \c threshold, highest first,
+ * until there are none. Called by the executor thread to run all tasks,
+ * and nested from atomTaskPost() to run tasks which preempt the one
+ * currently running.
+ *
+ * @param[in] threshold Only run tasks of priority numerically lower
+ *
+ * @return None
+ */
+static void atomTaskDispatch (uint16_t threshold)
+{
+    CRITICAL_STORE;
+    ATOM_TASK *task;
+    uint16_t saved_prio;
+
+    /* Note the priority of any task we are preempting */
+    saved_prio = task_running_prio;
+
+    while (1)
+    {
+        /* Take the highest priority ready task if it is eligible */
+        CRITICAL_START ();
+        task = task_ready_list;
+        if (task && (task->priority < threshold))
+        {
+            task_ready_list = task->next_task;
+            task->next_task = NULL;
+
+            /* Requeue behind its peers if there are more posts to run */
+            if (--task->pending > 0)
+            {
+                taskEnqueuePriority (task);
+            }
+        }
+        else
+        {
+            task = NULL;
+        }
+        CRITICAL_END ();
+
+        /* Quit when there is nothing left to run */
+        if (task == NULL)
+        {
+            break;
+        }
+
+        /* Run the task with interrupts enabled */
+        task_running_prio = task->priority;
+        task->func (task->arg);
+    }
+
+    /* Resume the preempted task, if any */
+    task_running_prio = saved_prio;
+}
+
+
+/**
+ * \b taskEnqueuePriority
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Adds a task to the ready list, after all tasks of the same or higher
+ * priority. Must be called with the critical section held.
+ *
+ * @param[in] task Pointer to task object
+ *
+ * @return None
+ */
+static void taskEnqueuePriority (ATOM_TASK *task)
+{
+    ATOM_TASK *prev_ptr, *next_ptr;
+
+    /* Walk the list to find the insertion point */
+    prev_ptr = NULL;
+    next_ptr = task_ready_list;
+    while (next_ptr && (next_ptr->priority <= task->priority))
+    {
+        prev_ptr = next_ptr;
+        next_ptr = next_ptr->next_task;
+    }
+
+    /* Link it in */
+    task->next_task = next_ptr;
+    if (prev_ptr)
+    {
+        prev_ptr->next_task = task;
+    }
+    else
+    {
+        task_ready_list = task;
+    }
+}
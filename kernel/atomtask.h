@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_TASK_H
+#define __ATOM_TASK_H
+
+/* Task function prototype */
+typedef void ( * ATOM_TASK_FUNC ) ( POINTER arg ) ;
+
+typedef struct atom_task
+{
+    ATOM_TASK_FUNC  func;       /* Task function, runs to completion */
+    POINTER         arg;        /* Parameter passed to the function */
+    uint8_t         priority;   /* Task priority (0 = highest) */
+    uint16_t        pending;    /* Number of posts not yet run */
+
+    /* Internal data */
+    struct atom_task *next_task; /* Next task in the ready list */
+} ATOM_TASK;
+
+extern uint8_t atomTaskInit (void *stack_top, uint32_t stack_size, uint8_t priority);
+extern uint8_t atomTaskCreate (ATOM_TASK *task, uint8_t priority, ATOM_TASK_FUNC func, POINTER arg);
+extern uint8_t atomTaskPost (ATOM_TASK *task);
+
+#endif /* __ATOM_TASK_H */
@@ -108,7 +108,8 @@ static void atomTimerDelayCallback (POINTER cb_data);
  * must be greater than zero.
  *
  * On the relevant system tick count, the callback function will be
- * called.
+ * called. Timers are one-shot, but a callback may re-register its own
+ * timer descriptor to obtain a periodic callback.
  *
  * These timers are used by some of the OS library routines, but they
  * can also be used by application code requiring timer facilities at
@@ -409,7 +410,7 @@ uint8_t atomTimerDelay (uint32_t ticks)
  */
 static void atomTimerCallbacks (void)
 {
-    ATOM_TIMER *prev_ptr, *next_ptr;
+    ATOM_TIMER *prev_ptr, *next_ptr, *saved_next_ptr;
 
     /*
      * Walk the list decrementing each timer's remaining ticks count and
@@ -418,6 +419,12 @@ static void atomTimerCallbacks (void)
     prev_ptr = next_ptr = timer_queue;
     while (next_ptr)
     {
+        /*
+         * Note the following entry now, as a due callback may re-register
+         * its own timer which relinks it at the head of the list.
+         */
+        saved_next_ptr = next_ptr->next_timer;
+
         /* Is this entry due? */
         if (--(next_ptr->cb_ticks) == 0)
         {
@@ -454,7 +461,7 @@ static void atomTimerCallbacks (void)
         }
 
         /* Move on to the next in the list */
-        next_ptr = next_ptr->next_timer;
+        next_ptr = saved_next_ptr;
 
     }
 
@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Topic library.
+ *
+ *
+ * This module implements publish/subscribe topics, which broadcast each
+ * message to any number of readers. It has the following features:
+ *
+ * \par Publish once, read many
+ * A producer publishes a message once, into a ring shared by all
+ * subscribers. Each subscriber has its own read position in the ring,
+ * so every subscriber receives every message without the producer making
+ * a copy (or taking a critical section) per subscriber.
+ *
+ * \par Producers never block
+ * The ring always accepts new messages, overwriting the oldest. Fast
+ * producers such as sensor interrupts are never held up by a slow reader.
+ *
+ * \par Overrun detection
+ * A subscriber which falls more than a ring's worth of messages behind
+ * resumes from the oldest message still held, and is told how many
+ * messages it lost.
+ *
+ * \par Flexible blocking APIs
+ * Subscribers waiting for new messages can choose whether to block, block
+ * with timeout, or not block and return a relevent status code. All
+ * waiting subscribers are woken together by each publish.
+ *
+ * \par Interrupt-safe calls
+ * Messages can be published from interrupt context.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * All topics must be initialised before use by calling atomTopicCreate(),
+ * with storage for \c max_num_msgs messages of \c unit_size bytes. Topics
+ * can be deleted using atomTopicDelete(), which wakes any waiting
+ * subscribers with ATOM_ERR_DELETED.
+ *
+ * Each reader has an ATOM_TOPIC_SUB object, attached to the topic by
+ * calling atomTopicSubscribe(). A subscriber receives only messages
+ * published after it subscribed. Subscribers need no unsubscription, they
+ * can simply stop reading. Each subscriber object should only be read by
+ * one thread.
+ *
+ * Messages are published using atomTopicPublish() and read using
+ * atomTopicRead().
+ *
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "atom.h"
+#include "atomtopic.h"
+#include "atomtimer.h"
+
+
+/* Local data types */
+
+typedef struct topic_timer
+{
+    ATOM_TCB   *tcb_ptr;  /* Thread which is suspended with timeout */
+    ATOM_TOPIC *topic_ptr; /* Topic the thread is suspended on */
+} TOPIC_TIMER;
+
+
+/* Forward declarations */
+
+static uint8_t topicWakeAll (ATOM_TOPIC *topic, uint8_t wake_status, uint8_t *woken);
+static void atomTopicTimerCallback (POINTER cb_data);
+
+
+/**
+ * \b atomTopicCreate
+ *
+ * Initialises a topic object.
+ *
+ * Must be called before calling any other topic library routines on a
+ * topic. Objects can be deleted later using atomTopicDelete().
+ *
+ * Does not allocate storage, the caller provides the topic object and the
+ * ring storage of \c unit_size * \c max_num_msgs bytes.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] buff_ptr Pointer to ring storage area
+ * @param[in] unit_size Size in bytes of each message
+ * @param[in] max_num_msgs Number of messages the ring holds
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomTopicCreate (ATOM_TOPIC *topic, uint8_t *buff_ptr, uint32_t unit_size, uint32_t max_num_msgs)
+{
+    uint8_t status;
+
+    /* Parameter check */
+    if ((topic == NULL) || (buff_ptr == NULL) || (unit_size == 0)
+        || (max_num_msgs == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Store the ring details */
+        topic->buff_ptr = buff_ptr;
+        topic->unit_size = unit_size;
+        topic->max_num_msgs = max_num_msgs;
+
+        /* Initialise the suspended threads queue */
+        topic->suspQ = NULL;
+
+        /* Nothing published yet */
+        topic->insert_index = 0;
+        topic->seq = 0;
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicDelete
+ *
+ * Deletes a topic object.
+ *
+ * Any subscribers waiting for messages are woken with ATOM_ERR_DELETED.
+ * If called at thread context then the scheduler will be called during
+ * this function which may schedule in one of the woken threads depending
+ * on relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] topic Pointer to topic object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomTopicDelete (ATOM_TOPIC *topic)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Parameter check */
+    if (topic == NULL)
+    {
+        /* Bad topic pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Wake all waiting subscribers */
+        CRITICAL_START ();
+        status = topicWakeAll (topic, ATOM_ERR_DELETED, &woken);
+        CRITICAL_END ();
+
+        /**
+         * Only call the scheduler if we are in thread context, otherwise
+         * it will be called on exiting the ISR by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicPublish
+ *
+ * Publishes a message to all subscribers of a topic.
+ *
+ * The message is copied into the shared ring, overwriting the oldest
+ * message if the ring is full, and all waiting subscribers are woken. If
+ * called at thread context then the scheduler will be called during this
+ * function which may schedule in one of the woken threads depending on
+ * relative priorities.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] msgptr Pointer to the message to publish (\c unit_size bytes)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+uint8_t atomTopicPublish (ATOM_TOPIC *topic, uint8_t *msgptr)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    uint8_t woken;
+
+    /* Parameter check */
+    if ((topic == NULL) || (msgptr == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the topic object and OS queues */
+        CRITICAL_START ();
+
+        /* Copy the message into the ring */
+        memcpy ((topic->buff_ptr + (topic->insert_index * topic->unit_size)),
+            msgptr, topic->unit_size);
+        if (++topic->insert_index >= topic->max_num_msgs)
+        {
+            topic->insert_index = 0;
+        }
+        topic->seq++;
+
+        /* Wake all the subscribers waiting for it, in one critical section */
+        status = topicWakeAll (topic, ATOM_OK, &woken);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * The scheduler may now make a policy decision to thread switch if
+         * we are currently in thread context. If we are in interrupt
+         * context it will be handled by atomIntExit().
+         */
+        if ((woken == TRUE) && atomCurrentContext())
+            atomSched (FALSE);
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicSubscribe
+ *
+ * Attaches a subscriber to a topic.
+ *
+ * The subscriber will receive all messages published from now on.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] sub Pointer to subscriber object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomTopicSubscribe (ATOM_TOPIC *topic, ATOM_TOPIC_SUB *sub)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((topic == NULL) || (sub == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Start reading at the next message to be published */
+        CRITICAL_START ();
+        sub->topic = topic;
+        sub->remove_index = topic->insert_index;
+        sub->seq = topic->seq;
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicRead
+ *
+ * Reads the next message for a subscriber.
+ *
+ * If there is a message the subscriber has not yet read, it is copied to
+ * \c msgptr. Otherwise the call will do one of the following depending on
+ * the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until a message is published \n
+ * \c timeout > 0 : Call will block until a message is published or the specified timeout \n
+ * \c timeout == -1 : Return immediately if there is no new message \n
+ *
+ * If the subscriber has fallen so far behind that unread messages were
+ * overwritten, it skips to the oldest message still in the ring, and the
+ * number of messages skipped is returned in \c lost. Otherwise \c lost is
+ * set to zero.
+ *
+ * If the call needs to block and \c timeout is zero, it will block
+ * indefinitely until atomTopicPublish() or atomTopicDelete() is called on
+ * the topic.
+ *
+ * If the call needs to block and \c timeout is non-zero, the call will only
+ * block for the specified number of system ticks after which time, if the
+ * thread was not already woken, the call will return with ATOM_TIMEOUT.
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] sub Pointer to subscriber object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[out] msgptr Pointer to which the message is copied (\c unit_size bytes)
+ * @param[out] lost Pointer to which the number of lost messages is written, or NULL
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT No message was published before the timeout
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 and no new message
+ * @retval ATOM_ERR_DELETED Topic was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to suspend
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Problem putting the thread on the suspend queue
+ * @retval ATOM_ERR_TIMER Problem registering the timeout
+ */
+uint8_t atomTopicRead (ATOM_TOPIC_SUB *sub, int32_t timeout, uint8_t *msgptr, uint32_t *lost)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    TOPIC_TIMER timer_data;
+    ATOM_TIMER timer_cb;
+    ATOM_TCB *curr_tcb_ptr;
+    ATOM_TOPIC *topic;
+    uint32_t behind;
+
+    /* Check parameters */
+    if ((sub == NULL) || (sub->topic == NULL) || (msgptr == NULL))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Protect access to the topic object and OS queues */
+        topic = sub->topic;
+        CRITICAL_START ();
+
+        /* Block if there is nothing new */
+        status = ATOM_OK;
+        if (sub->seq == topic->seq)
+        {
+            /* Get the current TCB */
+            curr_tcb_ptr = atomCurrentContext();
+
+            if (timeout < 0)
+            {
+                /* timeout == -1, cannot block */
+                status = ATOM_WOULDBLOCK;
+            }
+            else if (curr_tcb_ptr == NULL)
+            {
+                /* Not currently in thread context, can't suspend */
+                status = ATOM_ERR_CONTEXT;
+            }
+            else if (tcbEnqueuePriority (&topic->suspQ, curr_tcb_ptr) != ATOM_OK)
+            {
+                /* There was an error putting this thread on the suspend list */
+                status = ATOM_ERR_QUEUE;
+            }
+            else
+            {
+                /* Set suspended status for the current thread */
+                curr_tcb_ptr->suspended = TRUE;
+                curr_tcb_ptr->suspend_timo_cb = NULL;
+
+                /* Register a timer callback if requested */
+                if (timeout)
+                {
+                    /* Fill out the data needed by the callback to wake us up */
+                    timer_data.tcb_ptr = curr_tcb_ptr;
+                    timer_data.topic_ptr = topic;
+
+                    /* Fill out the timer callback request structure */
+                    timer_cb.cb_func = atomTopicTimerCallback;
+                    timer_cb.cb_data = (POINTER)&timer_data;
+                    timer_cb.cb_ticks = timeout;
+
+                    /**
+                     * Store the timer details in the TCB so that we can
+                     * cancel the timer callback if a message is published
+                     * before the timeout occurs.
+                     */
+                    curr_tcb_ptr->suspend_timo_cb = &timer_cb;
+
+                    /* Register a callback on timeout */
+                    if (atomTimerRegister (&timer_cb) != ATOM_OK)
+                    {
+                        /* Timer registration failed, clean up */
+                        status = ATOM_ERR_TIMER;
+                        (void)tcbDequeueEntry (&topic->suspQ, curr_tcb_ptr);
+                        curr_tcb_ptr->suspended = FALSE;
+                        curr_tcb_ptr->suspend_timo_cb = NULL;
+                    }
+                }
+
+                /* Block until woken */
+                if (status == ATOM_OK)
+                {
+                    /* Exit critical region */
+                    CRITICAL_END ();
+
+                    /* Current thread now blocking, schedule in a new one */
+                    atomSched (FALSE);
+
+                    /**
+                     * Publishes will set ATOM_OK status, while timeouts
+                     * will set ATOM_TIMEOUT and topic deletions will set
+                     * ATOM_ERR_DELETED.
+                     */
+                    status = curr_tcb_ptr->suspend_wake_status;
+
+                    /* Re-enter critical region to read the message */
+                    CRITICAL_START ();
+                }
+            }
+        }
+
+        /* Read the next message */
+        if (status == ATOM_OK)
+        {
+            /* Skip to the oldest message held if we were overrun */
+            behind = topic->seq - sub->seq;
+            if (behind > topic->max_num_msgs)
+            {
+                sub->seq = topic->seq - topic->max_num_msgs;
+                sub->remove_index = topic->insert_index;
+                behind -= topic->max_num_msgs;
+            }
+            else
+            {
+                behind = 0;
+            }
+            if (lost)
+            {
+                *lost = behind;
+            }
+
+            /* Copy the message out and move on */
+            memcpy (msgptr, (topic->buff_ptr + (sub->remove_index * topic->unit_size)),
+                topic->unit_size);
+            if (++sub->remove_index >= topic->max_num_msgs)
+            {
+                sub->remove_index = 0;
+            }
+            sub->seq++;
+        }
+
+        /* Exit critical region */
+        CRITICAL_END ();
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b topicWakeAll
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Moves all subscribers waiting on a topic to the ready queue, cancelling
+ * their timeouts. Must be called with the critical section held.
+ *
+ * @param[in] topic Pointer to topic object
+ * @param[in] wake_status Status returned to the woken threads
+ * @param[out] woken Set to TRUE if any threads were woken
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_QUEUE Problem putting a woken thread on the ready queue
+ * @retval ATOM_ERR_TIMER Problem cancelling a timeout on a woken thread
+ */
+static uint8_t topicWakeAll (ATOM_TOPIC *topic, uint8_t wake_status, uint8_t *woken)
+{
+    uint8_t status;
+    ATOM_TCB *tcb_ptr;
+
+    status = ATOM_OK;
+    *woken = FALSE;
+    while ((tcb_ptr = tcbDequeueHead (&topic->suspQ)) != NULL)
+    {
+        /* Set the status to be returned to the waiting thread */
+        tcb_ptr->suspend_wake_status = wake_status;
+
+        /* Put the thread on the ready queue */
+        if (tcbEnqueuePriority (&tcbReadyQ, tcb_ptr) != ATOM_OK)
+        {
+            /* There was a problem putting the thread on the ready queue */
+            status = ATOM_ERR_QUEUE;
+            break;
+        }
+        *woken = TRUE;
+
+        /* If there's a timeout on this suspension, cancel it */
+        if (tcb_ptr->suspend_timo_cb)
+        {
+            if (atomTimerCancel (tcb_ptr->suspend_timo_cb) != ATOM_OK)
+            {
+                /* There was a problem cancelling a timeout */
+                status = ATOM_ERR_TIMER;
+            }
+
+            /* Flag as no timeout registered */
+            tcb_ptr->suspend_timo_cb = NULL;
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomTopicTimerCallback
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Timeouts on suspended subscribers are notified by the timer system
+ * through this generic callback. The timer system calls us back with a
+ * pointer to the relevant \c TOPIC_TIMER object which is used to retrieve
+ * the topic details.
+ *
+ * @param[in] cb_data Pointer to a TOPIC_TIMER object
+ */
+static void atomTopicTimerCallback (POINTER cb_data)
+{
+    TOPIC_TIMER *timer_data_ptr;
+    CRITICAL_STORE;
+
+    /* Get the TOPIC_TIMER structure pointer */
+    timer_data_ptr = (TOPIC_TIMER *)cb_data;
+
+    /* Check parameter is valid */
+    if (timer_data_ptr)
+    {
+        /* Enter critical region */
+        CRITICAL_START ();
+
+        /* Set status to indicate to the waiting thread that it timed out */
+        timer_data_ptr->tcb_ptr->suspend_wake_status = ATOM_TIMEOUT;
+
+        /* Flag as no timeout registered */
+        timer_data_ptr->tcb_ptr->suspend_timo_cb = NULL;
+
+        /* Remove this thread from the topic's suspend list */
+        (void)tcbDequeueEntry (&timer_data_ptr->topic_ptr->suspQ, timer_data_ptr->tcb_ptr);
+
+        /* Put the thread on the ready queue */
+        (void)tcbEnqueuePriority (&tcbReadyQ, timer_data_ptr->tcb_ptr);
+
+        /* Exit critical region */
+        CRITICAL_END ();
+
+        /**
+         * Note that we don't call the scheduler now as it will be called
+         * when we exit the ISR by atomIntExit().
+         */
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_TOPIC_H
+#define __ATOM_TOPIC_H
+
+typedef struct atom_topic
+{
+    ATOM_TCB *  suspQ;          /* Queue of subscribers waiting for data */
+    uint8_t *   buff_ptr;       /* Pointer to the shared ring */
+    uint32_t    unit_size;      /* Size of each message */
+    uint32_t    max_num_msgs;   /* Number of messages the ring holds */
+    uint32_t    insert_index;   /* Next message index to publish into */
+    uint32_t    seq;            /* Number of messages published */
+} ATOM_TOPIC;
+
+typedef struct atom_topic_sub
+{
+    ATOM_TOPIC *topic;          /* Topic subscribed to */
+    uint32_t    remove_index;   /* Next message index to read */
+    uint32_t    seq;            /* Sequence number of the next message to read */
+} ATOM_TOPIC_SUB;
+
+extern uint8_t atomTopicCreate (ATOM_TOPIC *topic, uint8_t *buff_ptr, uint32_t unit_size, uint32_t max_num_msgs);
+extern uint8_t atomTopicDelete (ATOM_TOPIC *topic);
+extern uint8_t atomTopicPublish (ATOM_TOPIC *topic, uint8_t *msgptr);
+extern uint8_t atomTopicSubscribe (ATOM_TOPIC *topic, ATOM_TOPIC_SUB *sub);
+extern uint8_t atomTopicRead (ATOM_TOPIC_SUB *sub, int32_t timeout, uint8_t *msgptr, uint32_t *lost);
+
+#endif /* __ATOM_TOPIC_H */
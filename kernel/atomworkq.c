@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ * Work queue library.
+ *
+ *
+ * This module implements pools of worker threads which run jobs submitted
+ * to a shared queue. A single pool can replace many special-purpose
+ * threads which spend most of their time waiting for work, saving the RAM
+ * used by their stacks and TCBs. It has the following features:
+ *
+ * \par Shared job queue
+ * Jobs are a function and argument, copied into an ATOM_QUEUE owned by the
+ * pool, so the submitter need not keep any storage for the job. Whichever
+ * worker is free takes the next job in FIFO order.
+ *
+ * \par Interrupt-safe submission
+ * Jobs can be submitted from interrupt context (with a \c timeout of -1),
+ * allowing ISRs to hand off lengthy processing to thread context.
+ *
+ * \par Completion notification
+ * A semaphore can optionally be passed with each job, which is put by the
+ * worker once the job function has returned.
+ *
+ * \par Statistics
+ * Each pool counts the jobs submitted and completed, the high-water mark of
+ * pending jobs, and the maximum and total latency in system ticks between
+ * submission and a worker starting the job.
+ *
+ *
+ * \n <b> Usage instructions: </b> \n
+ *
+ * A pool is created using atomWorkQCreate(), passing storage for the
+ * pending jobs, and a TCB and stack for each worker thread. The stacks are
+ * given as a single contiguous area, \c stack_size bytes per worker. All
+ * workers run at the same priority, and are started immediately.
+ *
+ * Jobs are submitted using atomWorkQSubmit(), which blocks if the job queue
+ * is full (unless the calling parameters request no blocking). Job
+ * functions run in thread context and may block, though a blocked job
+ * occupies its worker until it completes.
+ *
+ * Statistics can be read at any time using atomWorkQStats().
+ *
+ * A pool which is no longer required can be deleted using
+ * atomWorkQDelete(). This waits for all jobs submitted so far to complete
+ * and for the worker threads to exit, after which the TCBs, stacks and job
+ * storage may be reused.
+ *
+ */
+
+
+#include <stdio.h>
+
+#include "atom.h"
+#include "atomworkq.h"
+#include "atomtimer.h"
+
+
+/* Forward declarations */
+
+static void atomWorkQThread (uint32_t param);
+
+
+/**
+ * \b atomWorkQCreate
+ *
+ * Initialises a work queue and starts its worker threads.
+ *
+ * Must be called before calling any other work queue library routines on
+ * a pool. Pools can be deleted later using atomWorkQDelete().
+ *
+ * Does not allocate storage, the caller provides storage for the job queue
+ * and for the worker threads. \c stacks points to the bottom of an area of
+ * \c num_workers * \c stack_size bytes which is divided between the
+ * workers.
+ *
+ * Must only be called from thread context, or before the OS is started.
+ *
+ * @param[in] wq Pointer to work queue object
+ * @param[in] job_buff Pointer to storage for \c max_jobs pending jobs
+ * @param[in] max_jobs Max number of pending jobs
+ * @param[in] tcbs Pointer to an array of \c num_workers TCBs
+ * @param[in] stacks Pointer to the bottom of the worker stack area
+ * @param[in] stack_size Size of each worker's stack in bytes
+ * @param[in] num_workers Number of worker threads
+ * @param[in] priority Priority of the worker threads
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ * @retval ATOM_ERR_QUEUE Error putting a worker thread on the ready queue
+ */
+uint8_t atomWorkQCreate (ATOM_WORKQ *wq, ATOM_WORK *job_buff, uint32_t max_jobs, ATOM_TCB *tcbs, uint8_t *stacks, uint32_t stack_size, uint8_t num_workers, uint8_t priority)
+{
+    uint8_t status;
+    uint8_t i;
+
+    /* Parameter check */
+    if ((wq == NULL) || (tcbs == NULL) || (stacks == NULL)
+        || (stack_size == 0) || (num_workers == 0))
+    {
+        /* Bad parameters */
+        status = ATOM_ERR_PARAM;
+    }
+
+    /* Create the job queue, which checks the job storage parameters */
+    else if ((status = atomQueueCreate (&wq->queue, (uint8_t *)job_buff,
+                 sizeof(ATOM_WORK), max_jobs)) == ATOM_OK)
+    {
+        /* Store the pool details */
+        wq->tcbs = tcbs;
+        wq->num_workers = num_workers;
+
+        /* Reset the statistics */
+        wq->num_submitted = 0;
+        wq->num_completed = 0;
+        wq->max_latency = 0;
+        wq->total_latency = 0;
+
+        /**
+         * Start the workers, passing each a pointer to the pool. The
+         * pointer goes through the uint32_t entry parameter, which
+         * relies on pointers being no wider than 32 bits. That holds on
+         * the supported targets, but the pointer is truncated on 64-bit
+         * hosts.
+         */
+        for (i = 0; (i < num_workers) && (status == ATOM_OK); i++)
+        {
+            status = atomThreadCreate (&tcbs[i], priority, atomWorkQThread,
+                         (uint32_t)wq, &stacks[((i + 1) * stack_size) - 1],
+                         stack_size);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkQDelete
+ *
+ * Deletes a work queue.
+ *
+ * All jobs submitted before this call are run to completion, then the
+ * worker threads exit. The call blocks until all workers have exited, so
+ * on return the TCBs, stacks and job storage may be reused. Jobs
+ * submitted while the pool is being deleted are discarded.
+ *
+ * Must only be called from thread context, and not from one of the pool's
+ * own jobs.
+ *
+ * @param[in] wq Pointer to work queue object
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_CONTEXT Not called from thread context
+ * @retval ATOM_ERR_PARAM Bad parameter, or called by one of the workers
+ * @retval ATOM_ERR_QUEUE Problem queueing or waiting for the workers
+ */
+uint8_t atomWorkQDelete (ATOM_WORKQ *wq)
+{
+    uint8_t status;
+    uint8_t i;
+    ATOM_TCB *curr_tcb_ptr;
+    ATOM_WORK stop;
+
+    /* Get the current TCB */
+    curr_tcb_ptr = atomCurrentContext();
+
+    /* Parameter check */
+    if (wq == NULL)
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else if (curr_tcb_ptr == NULL)
+    {
+        /* Not currently in thread context, can't wait for the workers */
+        status = ATOM_ERR_CONTEXT;
+    }
+    else if ((curr_tcb_ptr >= wq->tcbs)
+             && (curr_tcb_ptr < &wq->tcbs[wq->num_workers]))
+    {
+        /* A worker cannot wait for itself to exit */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Default to success status unless errors occur */
+        status = ATOM_OK;
+
+        /**
+         * Queue a stop job for each worker. These are queued behind any
+         * pending jobs, so the workers complete those first.
+         */
+        stop.func = NULL;
+        stop.arg = NULL;
+        stop.done_sem = NULL;
+        stop.submit_time = 0;
+        for (i = 0; (i < wq->num_workers) && (status == ATOM_OK); i++)
+        {
+            if (atomQueuePut (&wq->queue, 0, (uint8_t *)&stop) != ATOM_OK)
+            {
+                status = ATOM_ERR_QUEUE;
+            }
+        }
+
+        /* Wait for all workers to exit */
+        for (i = 0; (i < wq->num_workers) && (status == ATOM_OK); i++)
+        {
+            if (atomThreadJoin (&wq->tcbs[i], 0) != ATOM_OK)
+            {
+                status = ATOM_ERR_QUEUE;
+            }
+        }
+
+        /* Delete the job queue, discarding any late submissions */
+        if (status == ATOM_OK)
+        {
+            status = atomQueueDelete (&wq->queue);
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkQSubmit
+ *
+ * Submits a job to a work queue.
+ *
+ * The job function \c func will be called with \c arg by the next free
+ * worker thread. If \c done_sem is not NULL it is put once the job
+ * function returns. If the job queue is full the call will do one of the
+ * following depending on the \c timeout value specified:
+ *
+ * \c timeout == 0 : Call will block until there is space in the queue \n
+ * \c timeout > 0 : Call will block until there is space or the specified timeout \n
+ * \c timeout == -1 : Return immediately if the queue is full \n
+ *
+ * This function can only be called from interrupt context if the \c timeout
+ * parameter is -1 (in which case it does not block).
+ *
+ * @param[in] wq Pointer to work queue object
+ * @param[in] timeout Max system ticks to block (0 = forever)
+ * @param[in] func Job function
+ * @param[in] arg Parameter passed to the job function
+ * @param[in] done_sem Semaphore to put on completion (or NULL)
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_TIMEOUT Timed out before there was space in the queue
+ * @retval ATOM_WOULDBLOCK Called with timeout == -1 but the queue is full
+ * @retval ATOM_ERR_DELETED Work queue was deleted while suspended
+ * @retval ATOM_ERR_CONTEXT Not called in thread context and attempted to block
+ * @retval ATOM_ERR_PARAM Bad parameter
+ * @retval ATOM_ERR_QUEUE Problem putting a thread on a suspend or ready queue
+ * @retval ATOM_ERR_TIMER Problem registering or cancelling a timeout
+ */
+uint8_t atomWorkQSubmit (ATOM_WORKQ *wq, int32_t timeout, ATOM_WORK_FUNC func, POINTER arg, ATOM_SEM *done_sem)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+    ATOM_WORK job;
+
+    /* Parameter check */
+    if ((wq == NULL) || (func == NULL))
+    {
+        /* Bad pointer */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Fill out the job descriptor */
+        job.func = func;
+        job.arg = arg;
+        job.done_sem = done_sem;
+        job.submit_time = atomTimeGet();
+
+        /* Copy it into the job queue */
+        status = atomQueuePut (&wq->queue, timeout, (uint8_t *)&job);
+
+        /* Update the statistics */
+        if (status == ATOM_OK)
+        {
+            CRITICAL_START ();
+            wq->num_submitted++;
+            CRITICAL_END ();
+        }
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkQStats
+ *
+ * Reads the statistics of a work queue.
+ *
+ * The job queue records the high-water mark of pending jobs as each job
+ * is inserted, before any worker can take it. It only counts jobs waiting
+ * in the queue, not those a worker is already running, so it understates
+ * the total work outstanding at that moment.
+ * Latencies are measured in system ticks from submission until a worker
+ * starts the job. The average latency is \c total_latency divided by the
+ * number of started jobs.
+ *
+ * This function can be called from interrupt context.
+ *
+ * @param[in] wq Pointer to work queue object
+ * @param[out] stats Pointer to which the statistics will be written
+ *
+ * @retval ATOM_OK Success
+ * @retval ATOM_ERR_PARAM Bad parameters
+ */
+uint8_t atomWorkQStats (ATOM_WORKQ *wq, ATOM_WORKQ_STATS *stats)
+{
+    CRITICAL_STORE;
+    uint8_t status;
+
+    /* Parameter check */
+    if ((wq == NULL) || (stats == NULL))
+    {
+        /* Bad pointers */
+        status = ATOM_ERR_PARAM;
+    }
+    else
+    {
+        /* Take a consistent snapshot */
+        CRITICAL_START ();
+        stats->depth = wq->queue.num_msgs_stored;
+        stats->max_depth = wq->queue.max_msgs_stored;
+        stats->num_submitted = wq->num_submitted;
+        stats->num_completed = wq->num_completed;
+        stats->max_latency = wq->max_latency;
+        stats->total_latency = wq->total_latency;
+        CRITICAL_END ();
+
+        /* Successful */
+        status = ATOM_OK;
+    }
+
+    return (status);
+}
+
+
+/**
+ * \b atomWorkQThread
+ *
+ * This is an internal function not for use by application code.
+ *
+ * Entry point for worker threads. Runs jobs from the pool's queue until a
+ * stop job (with a NULL function) is received, then exits.
+ *
+ * @param[in] param Pointer to the ATOM_WORKQ object
+ *
+ * @return None
+ */
+static void atomWorkQThread (uint32_t param)
+{
+    CRITICAL_STORE;
+    ATOM_WORKQ *wq;
+    ATOM_WORK job;
+    uint32_t latency;
+
+    /* Get the pool this worker belongs to (see atomWorkQCreate() on the cast) */
+    wq = (ATOM_WORKQ *)param;
+
+    /* Run jobs until told to stop */
+    while ((atomQueueGet (&wq->queue, 0, (uint8_t *)&job) == ATOM_OK)
+           && (job.func != NULL))
+    {
+        /* Record the latency */
+        latency = atomTimeGet() - job.submit_time;
+        CRITICAL_START ();
+        wq->total_latency += latency;
+        if (latency > wq->max_latency)
+        {
+            wq->max_latency = latency;
+        }
+        CRITICAL_END ();
+
+        /* Run the job */
+        job.func (job.arg);
+
+        /* Count the completion and notify the submitter if requested */
+        CRITICAL_START ();
+        wq->num_completed++;
+        CRITICAL_END ();
+        if (job.done_sem)
+        {
+            (void)atomSemPut (job.done_sem);
+        }
+    }
+
+    /* Terminate the worker, waking atomWorkQDelete() */
+    (void)atomThreadExit ();
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __ATOM_WORKQ_H
+#define __ATOM_WORKQ_H
+
+#include "atomqueue.h"
+#include "atomsem.h"
+
+/* Job function prototype */
+typedef void ( * ATOM_WORK_FUNC ) ( POINTER arg ) ;
+
+/* Job descriptor, copied into the work queue on submission */
+typedef struct atom_work
+{
+    ATOM_WORK_FUNC  func;           /* Job function (NULL stops a worker) */
+    POINTER         arg;            /* Parameter passed to the job function */
+    ATOM_SEM *      done_sem;       /* Semaphore put on completion, or NULL */
+    uint32_t        submit_time;    /* System time at submission */
+} ATOM_WORK;
+
+typedef struct atom_workq
+{
+    ATOM_QUEUE      queue;          /* Queue of pending jobs */
+    ATOM_TCB *      tcbs;           /* Worker thread TCBs */
+    uint8_t         num_workers;    /* Number of worker threads */
+    uint32_t        num_submitted;  /* Jobs submitted */
+    uint32_t        num_completed;  /* Jobs completed */
+    uint32_t        max_latency;    /* Max ticks from submission to start */
+    uint32_t        total_latency;  /* Sum of ticks from submission to start */
+} ATOM_WORKQ;
+
+typedef struct atom_workq_stats
+{
+    uint32_t        depth;          /* Jobs currently pending */
+    uint32_t        max_depth;      /* High-water mark of pending jobs */
+    uint32_t        num_submitted;  /* Jobs submitted */
+    uint32_t        num_completed;  /* Jobs completed */
+    uint32_t        max_latency;    /* Max ticks from submission to start */
+    uint32_t        total_latency;  /* Sum of ticks from submission to start */
+} ATOM_WORKQ_STATS;
+
+extern uint8_t atomWorkQCreate (ATOM_WORKQ *wq, ATOM_WORK *job_buff, uint32_t max_jobs, ATOM_TCB *tcbs, uint8_t *stacks, uint32_t stack_size, uint8_t num_workers, uint8_t priority);
+extern uint8_t atomWorkQDelete (ATOM_WORKQ *wq);
+extern uint8_t atomWorkQSubmit (ATOM_WORKQ *wq, int32_t timeout, ATOM_WORK_FUNC func, POINTER arg, ATOM_SEM *done_sem);
+extern uint8_t atomWorkQStats (ATOM_WORKQ *wq, ATOM_WORKQ_STATS *stats);
+
+#endif /* __ATOM_WORKQ_H */
@@ -26,6 +26,9 @@ PART=STM8S105
 # Enable stack-checking
 STACK_CHECK=true
 
+# Enable benchmark logging in tests which support it (e.g. queue13)
+LOG_BENCHMARKS=false
+
 # Directory for built objects
 BUILD_DIR=build-cosmic
 
@@ -37,7 +40,7 @@ APP_ASM_OBJECTS = atomport-asm-cosmic.o
 PERIPH_OBJECTS = stm8s_gpio.o stm8s_tim1.o stm8s_clk.o stm8s_uart2.o
 
 # Kernel object files
-KERNEL_OBJECTS = atomkernel.o atomsem.o atommutex.o atomtimer.o atomqueue.o
+KERNEL_OBJECTS = atomkernel.o atomsem.o atommutex.o atomtimer.o atomqueue.o atomring.o atomstream.o atomqset.o atommempool.o atomheap.o atommailbox.o atomworkq.o atomdpc.o atomnotify.o atomedf.o atomperiodic.o atombudget.o atomcyclic.o atomtask.o atomactive.o atomtopic.o atomseqlock.o atomcond.o atomipc.o
 
 # Collection of built objects (excluding test applications)
 ALL_OBJECTS = $(APP_OBJECTS) $(APP_ASM_OBJECTS) $(PERIPH_OBJECTS) $(KERNEL_OBJECTS)
@@ -67,6 +70,12 @@ CFLAGS += -dATOM_STACK_CHECKING
 DBG_CFLAGS += -dATOM_STACK_CHECKING
 endif
 
+# Enable benchmark logging in the tests (disable if not required)
+ifeq ($(LOG_BENCHMARKS),true)
+CFLAGS += -dTESTS_LOG_BENCHMARKS
+DBG_CFLAGS += -dTESTS_LOG_BENCHMARKS
+endif
+
 
 #################
 # Build targets #
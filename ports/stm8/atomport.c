@@ -75,7 +75,8 @@ static NO_REG_SAVE void thread_shell (void);
  * If the compiler supports it, stack space can be saved by preventing
  * the function from saving registers on entry. This is because we
  * are called directly by the context-switch assembler, and know that
- * threads cannot return from here. The NO_REG_SAVE macro is used to
+ * threads cannot return from here (threads which return from their entry
+ * point are terminated using atomThreadExit()). The NO_REG_SAVE macro is used to
  * denote such functions in a compiler-agnostic way, though not all
  * compilers support it.
  *
@@ -106,7 +107,11 @@ static NO_REG_SAVE void thread_shell (void)
         curr_tcb->entry_point(curr_tcb->entry_param);
     }
 
-    /* Not reached - threads should never return from the entry point */
+    /**
+     * The thread returned from its entry point. Terminate it, waking any
+     * threads joining it. This never returns.
+     */
+    (void)atomThreadExit ();
 
 }
 
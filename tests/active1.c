@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomactive.h"
+#include "atomtests.h"
+
+
+/* Application signals */
+enum
+{
+    SIG_GO = ATOM_SIG_USER,
+    SIG_BACK,
+    SIG_DATA,
+    NUM_SIGNALS
+};
+
+/* Application event carrying data */
+typedef struct data_event
+{
+    ATOM_EVENT  super;
+    uint16_t    value;
+} DATA_EVENT;
+
+/* Number of events in the pool, and queue lengths */
+#define NUM_EVENTS          4
+#define QUEUE_LEN           4
+
+/* Max number of state actions logged */
+#define LOG_SIZE            16
+
+
+/* Test OS objects */
+static ATOM_ACTIVE ao1, ao2;
+static ATOM_EVENT *ao1_queue[QUEUE_LEN], *ao2_queue[QUEUE_LEN];
+static ATOM_SUBSCR subscr_table[NUM_SIGNALS];
+static ATOM_MEMPOOL pool1;
+static DATA_EVENT pool_storage[NUM_EVENTS];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static uint8_t executor_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+/* Static events, never freed */
+static ATOM_EVENT go_evt = { SIG_GO, 0, NULL };
+static ATOM_EVENT back_evt = { SIG_BACK, 0, NULL };
+
+
+/* Test result tracking */
+static volatile char g_log[LOG_SIZE + 1];
+static volatile int g_log_idx;
+static volatile uint32_t g_sum1, g_sum2;
+
+
+/* Forward declarations */
+static uint8_t ao1_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao1_parent (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao1_a (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao1_b (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao2_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao2_counting (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t publish_data (int32_t timeout, uint16_t value);
+static void log_action (char action);
+static int check_log (const char *expected);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start active object test.
+ *
+ * Two active objects are started, one with its own thread and one run as
+ * a task on the shared executor. The first has a hierarchical state
+ * machine, and we check its entry and exit actions and initial
+ * transitions for its start, a transition between sibling states and a
+ * transition to a superstate.
+ *
+ * Both subscribe to a data event, which is published from thread and
+ * interrupt context. Each publish must be delivered to both objects and
+ * the event returned to its pool once both have processed it. After one
+ * object unsubscribes, only the other must receive events.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise the executor, library and event pool */
+    if ((atomTaskInit (&executor_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, TEST_THREAD_PRIO - 1) != ATOM_OK)
+        || (atomActiveInit (subscr_table, NUM_SIGNALS) != ATOM_OK)
+        || (atomMemPoolCreate (&pool1, (uint8_t *)&pool_storage[0],
+            sizeof(DATA_EVENT), NUM_EVENTS) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error initialising\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Check bad parameters */
+    if ((atomActiveStart (&ao1, NULL, ao1_queue, QUEUE_LEN, NULL, 1, NULL, 0) != ATOM_ERR_PARAM)
+        || (atomActivePublish (&go_evt) != ATOM_OK)
+        || (atomActiveSubscribe (&ao1, ATOM_SIG_INIT) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Bad param check\n"));
+        failures++;
+    }
+
+    /* Start both objects, the first with its own thread above us */
+    g_log_idx = 0;
+    if ((atomActiveStart (&ao1, ao1_initial, ao1_queue, QUEUE_LEN, &tcb1,
+            TEST_THREAD_PRIO - 1, &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        || (atomActiveStart (&ao2, ao2_initial, ao2_queue, QUEUE_LEN, NULL,
+            10, NULL, 0) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error starting\n"));
+        failures++;
+    }
+    else
+    {
+        /* Initial transition into the parent state, then its substate */
+        if (check_log ("pa") == FALSE)
+        {
+            ATOMLOG (_STR("Initial\n"));
+            failures++;
+        }
+
+        /* Transition between siblings */
+        if ((atomActivePost (&ao1, &go_evt) != ATOM_OK)
+            || (check_log ("paAb") == FALSE))
+        {
+            ATOMLOG (_STR("Sibling tran\n"));
+            failures++;
+        }
+
+        /* Transition to the superstate, exiting and re-entering it */
+        if ((atomActivePost (&ao1, &back_evt) != ATOM_OK)
+            || (check_log ("paAbBPpa") == FALSE))
+        {
+            ATOMLOG (_STR("Super tran\n"));
+            failures++;
+        }
+
+        /* Publish to both subscribers from this thread */
+        g_sum1 = g_sum2 = 0;
+        if ((atomActiveSubscribe (&ao1, SIG_DATA) != ATOM_OK)
+            || (atomActiveSubscribe (&ao2, SIG_DATA) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Subscribe\n"));
+            failures++;
+        }
+        if ((publish_data (0, 1) != ATOM_OK) || (publish_data (0, 2) != ATOM_OK)
+            || (publish_data (0, 3) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Publish\n"));
+            failures++;
+        }
+
+        /* Publish from interrupt context */
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = 2;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+        atomTimerDelay (5);
+        if ((g_sum1 != 16) || (g_sum2 != 16))
+        {
+            ATOMLOG (_STR("Sums %d %d\n"), (int)g_sum1, (int)g_sum2);
+            failures++;
+        }
+
+        /* Only the remaining subscriber receives events */
+        if ((atomActiveUnsubscribe (&ao2, SIG_DATA) != ATOM_OK)
+            || (publish_data (0, 100) != ATOM_OK)
+            || (g_sum1 != 116) || (g_sum2 != 16))
+        {
+            ATOMLOG (_STR("Unsubscribe\n"));
+            failures++;
+        }
+
+        /* All events were returned to the pool, static events untouched */
+        if ((pool1.num_free != NUM_EVENTS) || (go_evt.refs != 0))
+        {
+            ATOMLOG (_STR("Pool %d\n"), (int)pool1.num_free);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b publish_data
+ *
+ * Allocates and publishes a data event.
+ *
+ * @param[in] timeout Timeout for the allocation
+ * @param[in] value Data value
+ *
+ * @retval ATOM_OK Success
+ */
+static uint8_t publish_data (int32_t timeout, uint16_t value)
+{
+    ATOM_EVENT *e;
+    uint8_t status;
+
+    status = atomEventNew (&pool1, timeout, SIG_DATA, &e);
+    if (status == ATOM_OK)
+    {
+        ((DATA_EVENT *)e)->value = value;
+        status = atomActivePublish (e);
+    }
+    return (status);
+}
+
+
+/**
+ * \b log_action
+ *
+ * Logs a state entry or exit action.
+ *
+ * @param[in] action Action ID: lower case for entry, upper case for exit
+ *
+ * @return None
+ */
+static void log_action (char action)
+{
+    if (g_log_idx < LOG_SIZE)
+    {
+        g_log[g_log_idx++] = action;
+    }
+}
+
+
+/**
+ * \b check_log
+ *
+ * Compares the log of state actions with the expected sequence.
+ *
+ * @param[in] expected Expected sequence of actions
+ *
+ * @retval TRUE if the log matches
+ */
+static int check_log (const char *expected)
+{
+    int i;
+
+    for (i = 0; expected[i]; i++)
+    {
+        if ((i >= g_log_idx) || (g_log[i] != expected[i]))
+        {
+            return FALSE;
+        }
+    }
+    return (i == g_log_idx) ? TRUE : FALSE;
+}
+
+
+/**
+ * \b ao1_initial
+ *
+ * Initial pseudostate of the first active object.
+ */
+static uint8_t ao1_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    /* Compiler warnings */
+    e = e;
+
+    return ATOM_TRAN (me, ao1_parent);
+}
+
+
+/**
+ * \b ao1_parent
+ *
+ * Composite state of the first active object, containing states a and b.
+ * Handles data events for both substates.
+ */
+static uint8_t ao1_parent (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    switch (e->sig)
+    {
+        case ATOM_SIG_ENTRY:
+            log_action ('p');
+            return ATOM_RET_HANDLED;
+
+        case ATOM_SIG_EXIT:
+            log_action ('P');
+            return ATOM_RET_HANDLED;
+
+        case ATOM_SIG_INIT:
+            return ATOM_TRAN (me, ao1_a);
+
+        case SIG_DATA:
+            g_sum1 += ((const DATA_EVENT *)e)->value;
+            return ATOM_RET_HANDLED;
+    }
+    return ATOM_SUPER (me, atomActiveTop);
+}
+
+
+/**
+ * \b ao1_a
+ *
+ * Substate a of the first active object.
+ */
+static uint8_t ao1_a (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    switch (e->sig)
+    {
+        case ATOM_SIG_ENTRY:
+            log_action ('a');
+            return ATOM_RET_HANDLED;
+
+        case ATOM_SIG_EXIT:
+            log_action ('A');
+            return ATOM_RET_HANDLED;
+
+        case SIG_GO:
+            return ATOM_TRAN (me, ao1_b);
+    }
+    return ATOM_SUPER (me, ao1_parent);
+}
+
+
+/**
+ * \b ao1_b
+ *
+ * Substate b of the first active object.
+ */
+static uint8_t ao1_b (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    switch (e->sig)
+    {
+        case ATOM_SIG_ENTRY:
+            log_action ('b');
+            return ATOM_RET_HANDLED;
+
+        case ATOM_SIG_EXIT:
+            log_action ('B');
+            return ATOM_RET_HANDLED;
+
+        case SIG_BACK:
+            return ATOM_TRAN (me, ao1_parent);
+    }
+    return ATOM_SUPER (me, ao1_parent);
+}
+
+
+/**
+ * \b ao2_initial
+ *
+ * Initial pseudostate of the second active object.
+ */
+static uint8_t ao2_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    /* Compiler warnings */
+    e = e;
+
+    return ATOM_TRAN (me, ao2_counting);
+}
+
+
+/**
+ * \b ao2_counting
+ *
+ * Only state of the second active object, sums data events.
+ */
+static uint8_t ao2_counting (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    if (e->sig == SIG_DATA)
+    {
+        g_sum2 += ((const DATA_EVENT *)e)->value;
+        return ATOM_RET_HANDLED;
+    }
+    return ATOM_SUPER (me, atomActiveTop);
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Allocates and publishes a data event with value 10 from interrupt
+ * context, without blocking on the event pool. Both subscribed active
+ * objects should receive it and add 10 to their sums.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    (void)publish_data (-1, 10);
+}
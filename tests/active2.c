@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atomactive.h"
+#include "atomtests.h"
+
+
+/* Application signals */
+enum
+{
+    SIG_DATA = ATOM_SIG_USER,
+    NUM_SIGNALS
+};
+
+/* Application event carrying data */
+typedef struct data_event
+{
+    ATOM_EVENT  super;
+    uint16_t    value;
+} DATA_EVENT;
+
+/* Number of events in the pool, and queue lengths */
+#define NUM_EVENTS          4
+#define QUEUE_LEN           4
+
+
+/* Test OS objects */
+static ATOM_ACTIVE ao1, ao2, ao_bad;
+static ATOM_EVENT *ao1_queue[QUEUE_LEN], *ao2_queue[QUEUE_LEN], *ao_bad_queue[QUEUE_LEN];
+static ATOM_SUBSCR subscr_table[NUM_SIGNALS];
+static ATOM_MEMPOOL pool1;
+static DATA_EVENT pool_storage[NUM_EVENTS];
+static uint8_t executor_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint32_t g_sum1, g_sum2;
+static volatile uint8_t g_sub_status;
+
+
+/* Forward declarations */
+static uint8_t ao1_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao2_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t bad_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao1_running (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t ao2_running (ATOM_ACTIVE *me, const ATOM_EVENT *e);
+static uint8_t publish_data (uint16_t value);
+
+
+/**
+ * \b test_start
+ *
+ * Start active object test.
+ *
+ * This tests subscribing to signals from an active object's initial
+ * transition, before atomActiveStart() has returned.
+ *
+ * Objects which have not been started must not be able to subscribe. An
+ * object whose initial pseudostate subscribes and then fails to take a
+ * transition must not be left subscribed. Two objects which subscribe
+ * from their initial transitions must then each receive every published
+ * event.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Initialise the executor, library and event pool */
+    if ((atomTaskInit (&executor_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, TEST_THREAD_PRIO - 1) != ATOM_OK)
+        || (atomActiveInit (subscr_table, NUM_SIGNALS) != ATOM_OK)
+        || (atomMemPoolCreate (&pool1, (uint8_t *)&pool_storage[0],
+            sizeof(DATA_EVENT), NUM_EVENTS) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error initialising\n"));
+        failures++;
+        return failures;
+    }
+
+    /* Objects which have not been started cannot subscribe */
+    if ((atomActiveSubscribe (&ao1, SIG_DATA) != ATOM_ERR_PARAM)
+        || (atomActiveUnsubscribe (&ao1, SIG_DATA) != ATOM_ERR_PARAM)
+        || (subscr_table[SIG_DATA] != 0))
+    {
+        ATOMLOG (_STR("Unstarted subscribe\n"));
+        failures++;
+    }
+
+    /* A failed start must not leave the object subscribed */
+    g_sub_status = ATOM_ERROR;
+    if ((atomActiveStart (&ao_bad, bad_initial, ao_bad_queue, QUEUE_LEN, NULL,
+            10, NULL, 0) != ATOM_ERR_PARAM)
+        || (g_sub_status != ATOM_OK) || (subscr_table[SIG_DATA] != 0)
+        || (atomActiveSubscribe (&ao_bad, SIG_DATA) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Failed start %d\n"), (int)g_sub_status);
+        failures++;
+    }
+
+    /* Start both objects, each subscribing from its initial transition */
+    if ((atomActiveStart (&ao1, ao1_initial, ao1_queue, QUEUE_LEN, NULL,
+            10, NULL, 0) != ATOM_OK)
+        || (atomActiveStart (&ao2, ao2_initial, ao2_queue, QUEUE_LEN, NULL,
+            11, NULL, 0) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error starting\n"));
+        failures++;
+    }
+    else
+    {
+        /* Both objects receive each event */
+        g_sum1 = g_sum2 = 0;
+        if ((publish_data (1) != ATOM_OK) || (publish_data (2) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Publish\n"));
+            failures++;
+        }
+        atomTimerDelay (2);
+        if ((g_sum1 != 3) || (g_sum2 != 3))
+        {
+            ATOMLOG (_STR("Sums %d %d\n"), (int)g_sum1, (int)g_sum2);
+            failures++;
+        }
+
+        /* All events were returned to the pool */
+        if (pool1.num_free != NUM_EVENTS)
+        {
+            ATOMLOG (_STR("Pool %d\n"), (int)pool1.num_free);
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b publish_data
+ *
+ * Allocates and publishes a data event.
+ *
+ * @param[in] value Data value
+ *
+ * @retval ATOM_OK Success
+ */
+static uint8_t publish_data (uint16_t value)
+{
+    ATOM_EVENT *e;
+    uint8_t status;
+
+    status = atomEventNew (&pool1, -1, SIG_DATA, &e);
+    if (status == ATOM_OK)
+    {
+        ((DATA_EVENT *)e)->value = value;
+        status = atomActivePublish (e);
+    }
+    return (status);
+}
+
+
+/**
+ * \b ao1_initial
+ *
+ * Initial pseudostate of the first active object, subscribes to data.
+ */
+static uint8_t ao1_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    /* Compiler warnings */
+    e = e;
+
+    (void)atomActiveSubscribe (me, SIG_DATA);
+    return ATOM_TRAN (me, ao1_running);
+}
+
+
+/**
+ * \b ao2_initial
+ *
+ * Initial pseudostate of the second active object, subscribes to data.
+ */
+static uint8_t ao2_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    /* Compiler warnings */
+    e = e;
+
+    (void)atomActiveSubscribe (me, SIG_DATA);
+    return ATOM_TRAN (me, ao2_running);
+}
+
+
+/**
+ * \b bad_initial
+ *
+ * Initial pseudostate which subscribes to data but fails to transition.
+ */
+static uint8_t bad_initial (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    /* Compiler warnings */
+    e = e;
+
+    g_sub_status = atomActiveSubscribe (me, SIG_DATA);
+    return ATOM_RET_HANDLED;
+}
+
+
+/**
+ * \b ao1_running
+ *
+ * Only state of the first active object, sums data values.
+ */
+static uint8_t ao1_running (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    if (e->sig == SIG_DATA)
+    {
+        g_sum1 += ((const DATA_EVENT *)e)->value;
+        return ATOM_RET_HANDLED;
+    }
+    return ATOM_SUPER (me, atomActiveTop);
+}
+
+
+/**
+ * \b ao2_running
+ *
+ * Only state of the second active object, sums data values.
+ */
+static uint8_t ao2_running (ATOM_ACTIVE *me, const ATOM_EVENT *e)
+{
+    if (e->sig == SIG_DATA)
+    {
+        g_sum2 += ((const DATA_EVENT *)e)->value;
+        return ATOM_RET_HANDLED;
+    }
+    return ATOM_SUPER (me, atomActiveTop);
+}
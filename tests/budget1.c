@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atombudget.h"
+#include "atomtests.h"
+
+
+/* Budget of the spinning threads, in ticks per period */
+#define TEST_BUDGET         3
+#define TEST_PERIOD         10
+
+
+#ifdef ATOM_CPU_BUDGETS
+
+/* Test OS objects */
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_BUDGET budget1;
+
+
+/* Test result tracking */
+static volatile int g_stop;
+static volatile int g_callbacks;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void exhaustedCallback (ATOM_TCB *tcb_ptr);
+#endif
+
+
+/**
+ * \b test_start
+ *
+ * Start CPU budget test.
+ *
+ * This tests per-thread CPU budgets, and requires ATOM_CPU_BUDGETS to be
+ * defined (otherwise it passes without testing anything).
+ *
+ * A thread which never blocks is run above our priority, which would
+ * starve us without a budget. With a budget of 3 ticks in every 10 we
+ * check that we still get to run, first with the thread suspended on
+ * exhaustion and then with it demoted below our priority, and that the
+ * exhaustion callback is made and the thread restored on replenishment.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+#ifdef ATOM_CPU_BUDGETS
+    uint32_t exhaustions, start_time;
+#endif
+
+    /* Default to zero failures */
+    failures = 0;
+
+#ifndef ATOM_CPU_BUDGETS
+    ATOMLOG (_STR("CPU budgets not enabled\n"));
+#else
+
+    /* Check bad parameters */
+    if ((atomBudgetCreate (&budget1, &tcb1, 0, TEST_PERIOD, ATOM_BUDGET_SUSPEND, 0, NULL) != ATOM_ERR_PARAM)
+        || (atomBudgetCreate (&budget1, &tcb1, TEST_PERIOD + 1, TEST_PERIOD, ATOM_BUDGET_SUSPEND, 0, NULL) != ATOM_ERR_PARAM)
+        || (atomBudgetCreate (&budget1, &tcb1, TEST_BUDGET, TEST_PERIOD, 0, 0, NULL) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Bad param check\n"));
+        failures++;
+    }
+    if (atomBudgetDelete (&budget1) != ATOM_ERR_NOT_FOUND)
+    {
+        ATOMLOG (_STR("Delete inactive\n"));
+        failures++;
+    }
+
+    /**
+     * Suspend on exhaustion. The thread is created below us so that the
+     * budget can be attached before it first runs, then raised above us.
+     */
+    g_stop = FALSE;
+    g_callbacks = 0;
+    if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO + 1, test_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating thread\n"));
+        failures++;
+    }
+    else if (atomBudgetCreate (&budget1, &tcb1, TEST_BUDGET, TEST_PERIOD,
+            ATOM_BUDGET_SUSPEND, 0, exhaustedCallback) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating budget\n"));
+        failures++;
+    }
+    else
+    {
+        /* We only get to continue once the budget is used up */
+        start_time = atomTimeGet();
+        (void)atomThreadSetPriority (&tcb1, TEST_THREAD_PRIO - 1);
+        if ((atomTimeGet() - start_time) > TEST_BUDGET + 1)
+        {
+            ATOMLOG (_STR("Suspend late\n"));
+            failures++;
+        }
+
+        /* Sleep for five periods, the thread exhausting its budget in each */
+        atomTimerDelay (5 * TEST_PERIOD);
+        if ((atomBudgetGet (&budget1, NULL, &exhaustions) != ATOM_OK)
+            || (exhaustions < 5) || (exhaustions > 7))
+        {
+            ATOMLOG (_STR("Exhaustions %d\n"), (int)exhaustions);
+            failures++;
+        }
+        else if (g_callbacks != (int)exhaustions)
+        {
+            ATOMLOG (_STR("Callbacks %d\n"), g_callbacks);
+            failures++;
+        }
+
+        /* Remove the budget and let the thread finish */
+        g_stop = TRUE;
+        if (atomBudgetDelete (&budget1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete\n"));
+            failures++;
+        }
+        if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join\n"));
+            failures++;
+        }
+    }
+
+    /* Demote on exhaustion */
+    g_stop = FALSE;
+    if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO + 1, test_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating thread\n"));
+        failures++;
+    }
+    else if (atomBudgetCreate (&budget1, &tcb1, TEST_BUDGET, TEST_PERIOD,
+            ATOM_BUDGET_DEMOTE, TEST_THREAD_PRIO + 2, NULL) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating budget\n"));
+        failures++;
+    }
+    else
+    {
+        /* We only get to continue once the thread is demoted */
+        start_time = atomTimeGet();
+        (void)atomThreadSetPriority (&tcb1, TEST_THREAD_PRIO - 1);
+        if ((atomTimeGet() - start_time) > TEST_BUDGET + 1)
+        {
+            ATOMLOG (_STR("Demote late\n"));
+            failures++;
+        }
+        if (tcb1.priority != TEST_THREAD_PRIO + 2)
+        {
+            ATOMLOG (_STR("Demoted prio %d\n"), (int)tcb1.priority);
+            failures++;
+        }
+
+        /**
+         * Sleep past the replenishment. The thread is restored, and we
+         * only get to run again once it has been demoted again.
+         */
+        atomTimerDelay (TEST_PERIOD);
+        if ((atomBudgetGet (&budget1, NULL, &exhaustions) != ATOM_OK)
+            || (exhaustions != 2))
+        {
+            ATOMLOG (_STR("Demotions %d\n"), (int)exhaustions);
+            failures++;
+        }
+
+        /* Deleting the budget restores the priority */
+        g_stop = TRUE;
+        if (atomBudgetDelete (&budget1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete\n"));
+            failures++;
+        }
+        if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join\n"));
+            failures++;
+        }
+        else if (tcb1.priority != TEST_THREAD_PRIO - 1)
+        {
+            ATOMLOG (_STR("Restored prio %d\n"), (int)tcb1.priority);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+#endif /* ATOM_CPU_BUDGETS */
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_CPU_BUDGETS
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Spins without ever blocking until told to stop.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    while (g_stop == FALSE)
+    {
+        /* Busy */
+    }
+}
+
+
+/**
+ * \b exhaustedCallback
+ *
+ * Budget exhaustion callback, runs in interrupt context.
+ *
+ * @param[in] tcb_ptr Thread which exhausted its budget
+ *
+ * @return None
+ */
+static void exhaustedCallback (ATOM_TCB *tcb_ptr)
+{
+    if (tcb_ptr == &tcb1)
+    {
+        g_callbacks++;
+    }
+}
+#endif /* ATOM_CPU_BUDGETS */
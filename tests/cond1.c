@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atommutex.h"
+#include "atomcond.h"
+#include "atomtests.h"
+
+
+/* Number of waiting threads */
+#define NUM_TEST_THREADS    3
+
+
+/* Test OS objects */
+static ATOM_MUTEX mutex1;
+static ATOM_COND cond1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_woken;
+static volatile int g_deleted;
+static volatile int g_released;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start condition variable test.
+ *
+ * This tests basic operation of condition variables.
+ *
+ * After checking the parameter, ownership and timeout handling, several
+ * threads wait on the condition while holding a recursive lock on the
+ * mutex. We check that the mutex is released while they wait, that a
+ * signal wakes exactly one thread which cannot return until the mutex is
+ * free, and that a broadcast wakes all the rest. Finally, deleting the
+ * condition must wake every waiter with ATOM_ERR_DELETED, each still
+ * holding its full recursive lock on the mutex.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t i, start_time;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test objects */
+    if ((atomMutexCreate (&mutex1) != ATOM_OK)
+        || (atomCondCreate (&cond1) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating test objects\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Check parameters */
+        if ((atomCondCreate (NULL) != ATOM_ERR_PARAM)
+            || (atomCondWait (&cond1, NULL, 0) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Param checks\n"));
+            failures++;
+        }
+
+        /* Waiting requires ownership of the mutex */
+        if (atomCondWait (&cond1, &mutex1, 0) != ATOM_ERR_OWNERSHIP)
+        {
+            ATOMLOG (_STR("Ownership check\n"));
+            failures++;
+        }
+
+        /* Lock the mutex for the remaining single-thread checks */
+        (void)atomMutexGet (&mutex1, 0);
+
+        /* Check no block with timeout -1 */
+        if (atomCondWait (&cond1, &mutex1, -1) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Wait -1\n"));
+            failures++;
+        }
+
+        /* Check a wait times out and the mutex is held on return */
+        start_time = atomTimeGet();
+        if (atomCondWait (&cond1, &mutex1, SYSTEM_TICKS_PER_SEC/10) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Wait timeout\n"));
+            failures++;
+        }
+        else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+        {
+            ATOMLOG (_STR("Timeout early\n"));
+            failures++;
+        }
+        if (atomMutexPut (&mutex1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Not owner after timeout\n"));
+            failures++;
+        }
+
+        /* Create threads which will all wait on the condition */
+        g_woken = g_deleted = g_released = 0;
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO, test_thread_func, i,
+                  &test_thread_stack[i][TEST_THREAD_STACK_SIZE - 1],
+                  TEST_THREAD_STACK_SIZE) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error creating test thread %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Give the threads time to start waiting */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+        /* The waiters must have released the mutex */
+        if (atomMutexGet (&mutex1, -1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Mutex not released\n"));
+            failures++;
+        }
+        else
+        {
+            /* Signal while holding the mutex: the woken thread must wait for it */
+            if (atomCondSignal (&cond1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Signal\n"));
+                failures++;
+            }
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+            if (g_woken != 0)
+            {
+                ATOMLOG (_STR("Woke without mutex\n"));
+                failures++;
+            }
+            (void)atomMutexPut (&mutex1);
+        }
+
+        /* Exactly one thread should now have returned */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if (g_woken != 1)
+        {
+            ATOMLOG (_STR("Signal woke %d\n"), g_woken);
+            failures++;
+        }
+
+        /* Broadcast wakes the rest */
+        if (atomCondBroadcast (&cond1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Broadcast\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if (g_woken != NUM_TEST_THREADS)
+        {
+            ATOMLOG (_STR("Broadcast woke %d\n"), g_woken);
+            failures++;
+        }
+
+        /* All threads wait again, deleting the condition wakes them */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if (atomCondDelete (&cond1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        if ((g_deleted != NUM_TEST_THREADS) || (g_released != NUM_TEST_THREADS))
+        {
+            ATOMLOG (_STR("Delete woke %d/%d\n"), g_deleted, g_released);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb[0], &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Takes a recursive lock on the mutex and waits on the condition until
+ * signalled, then waits again until the condition is deleted. Finally
+ * checks the recursive lock count was preserved by unlocking twice.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t status;
+    CRITICAL_STORE;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Lock the mutex recursively */
+    if ((atomMutexGet (&mutex1, 0) == ATOM_OK)
+        && (atomMutexGet (&mutex1, 0) == ATOM_OK))
+    {
+        /* Wait to be signalled */
+        if (atomCondWait (&cond1, &mutex1, 0) == ATOM_OK)
+        {
+            g_woken++;
+        }
+
+        /* Wait until the condition is deleted, ignoring later broadcasts */
+        while ((status = atomCondWait (&cond1, &mutex1, 0)) == ATOM_OK)
+            ;
+        if (status == ATOM_ERR_DELETED)
+        {
+            g_deleted++;
+        }
+
+        /* Both locks should still be held */
+        if ((atomMutexPut (&mutex1) == ATOM_OK)
+            && (atomMutexPut (&mutex1) == ATOM_OK)
+            && (atomMutexPut (&mutex1) == ATOM_ERR_OWNERSHIP))
+        {
+            /* No longer holding the mutex */
+            CRITICAL_START ();
+            g_released++;
+            CRITICAL_END ();
+        }
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomcyclic.h"
+#include "atomtests.h"
+
+
+/* Major frame length in ticks */
+#define FRAME_TICKS         20
+
+/* Max number of activation times recorded */
+#define MAX_TIMES           16
+
+
+/* Test OS objects */
+static ATOM_CYCLIC cyc1;
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint32_t g_frame_times[MAX_TIMES];
+static volatile int g_num_frames;
+static volatile uint32_t g_slot_times[MAX_TIMES];
+static volatile int g_num_slots;
+static volatile int g_overruns;
+static volatile int g_overrun_slot;
+static volatile uint8_t g_status;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void frameCallback (POINTER cb_data);
+static void overrunCallback (uint8_t slot);
+
+
+/* Schedule table: a callback at the frame start and two thread slots */
+static const ATOM_CYCLIC_SLOT schedule[] =
+{
+    { 0, NULL, frameCallback, NULL },
+    { 5, &tcb1, NULL, NULL },
+    { 12, &tcb1, NULL, NULL }
+};
+
+
+/**
+ * \b test_start
+ *
+ * Start cyclic executive test.
+ *
+ * A schedule with a callback slot at the start of each frame and two slots
+ * activating a thread is run for several frames. We check that frames
+ * start exactly one frame length apart and that the thread is activated
+ * at the exact slot offsets. The thread overruns one slot, which must be
+ * counted and reported for that slot only. Stopping the schedule must
+ * wake the thread with ATOM_ERR_DELETED.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int i;
+    uint32_t frames, overruns;
+    static const ATOM_CYCLIC_SLOT bad_schedule[] =
+    {
+        { 5, &tcb1, NULL, NULL },
+        { 5, &tcb1, NULL, NULL }
+    };
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check bad parameters */
+    if ((atomCyclicCreate (&cyc1, bad_schedule, 2, FRAME_TICKS, NULL) != ATOM_ERR_PARAM)
+        || (atomCyclicCreate (&cyc1, schedule, 3, 12, NULL) != ATOM_ERR_PARAM)
+        || (atomCyclicCreate (&cyc1, schedule, 0, FRAME_TICKS, NULL) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Bad table check\n"));
+        failures++;
+    }
+
+    /* Create the slot thread above our priority, it waits for activation */
+    g_status = ATOM_OK;
+    if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO - 1, test_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating thread\n"));
+        failures++;
+    }
+    else if ((atomCyclicCreate (&cyc1, schedule, 3, FRAME_TICKS, overrunCallback) != ATOM_OK)
+        || (atomCyclicStart (&cyc1) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error starting executive\n"));
+        failures++;
+    }
+    else
+    {
+        /* Run for three and a half frames */
+        atomTimerDelay ((FRAME_TICKS * 3) + (FRAME_TICKS / 2));
+
+        /* Stop, which should wake the thread */
+        if (atomCyclicStop (&cyc1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stop\n"));
+            failures++;
+        }
+        if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join\n"));
+            failures++;
+        }
+        else if (g_status != ATOM_ERR_DELETED)
+        {
+            ATOMLOG (_STR("Stop status %d\n"), (int)g_status);
+            failures++;
+        }
+
+        /* Check the frame clock */
+        if ((atomCyclicStats (&cyc1, &frames, &overruns) != ATOM_OK)
+            || (frames != 4) || (g_num_frames != 4))
+        {
+            ATOMLOG (_STR("Frames %d\n"), g_num_frames);
+            failures++;
+        }
+        else
+        {
+            for (i = 1; i < g_num_frames; i++)
+            {
+                if ((g_frame_times[i] - g_frame_times[i - 1]) != FRAME_TICKS)
+                {
+                    ATOMLOG (_STR("Frame %d\n"), i);
+                    failures++;
+                }
+            }
+        }
+
+        /* Check the thread slots of the first two frames */
+        if (g_num_slots < 4)
+        {
+            ATOMLOG (_STR("Slots %d\n"), g_num_slots);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < 4; i++)
+            {
+                if ((g_slot_times[i] - g_frame_times[i / 2]) != schedule[1 + (i % 2)].offset)
+                {
+                    ATOMLOG (_STR("Slot %d\n"), i);
+                    failures++;
+                }
+            }
+        }
+
+        /* Only the fourth activation overran, into the next frame */
+        if ((overruns != 1) || (g_overruns != 1) || (g_overrun_slot != 2))
+        {
+            ATOMLOG (_STR("Overruns %d\n"), g_overruns);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for the slot thread.
+ *
+ * Records the time of each activation. The fourth activation spins for
+ * 10 ticks, overrunning the 8 ticks until the next slot.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint32_t end_time;
+    uint8_t status;
+
+    /* Compiler warnings */
+    param = param;
+
+    while ((status = atomCyclicWait (&cyc1)) == ATOM_OK)
+    {
+        if (g_num_slots < MAX_TIMES)
+        {
+            g_slot_times[g_num_slots++] = atomTimeGet();
+        }
+
+        /* Overrun the fourth slot */
+        if (g_num_slots == 4)
+        {
+            end_time = atomTimeGet() + 10;
+            while ((int32_t)(atomTimeGet() - end_time) < 0)
+            {
+                /* Busy */
+            }
+        }
+    }
+    g_status = status;
+}
+
+
+/**
+ * \b frameCallback
+ *
+ * Slot callback at the start of each frame, runs in interrupt context.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void frameCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    if (g_num_frames < MAX_TIMES)
+    {
+        g_frame_times[g_num_frames++] = atomTimeGet();
+    }
+}
+
+
+/**
+ * \b overrunCallback
+ *
+ * Slot overrun callback, runs in interrupt context.
+ *
+ * @param[in] slot Index of the slot which overran
+ *
+ * @return None
+ */
+static void overrunCallback (uint8_t slot)
+{
+    g_overruns++;
+    g_overrun_slot = slot;
+}
@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomdpc.h"
+#include "atomtests.h"
+
+
+/* Number of times dpc4 runs, more than a semaphore can count */
+#define DPC4_RUNS           300
+
+
+/* Test OS objects */
+static ATOM_DPC dpc1, dpc2, dpc3, dpc4;
+static ATOM_SEM sem1;
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static uint8_t dpc_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile int g_dpc1_runs;
+static volatile int g_dpc3_runs;
+static volatile int g_dpc4_runs;
+static volatile int g_requeue_errors;
+static volatile int g_cancel_result;
+static volatile uint8_t g_log[2];
+static volatile int g_log_idx;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+static void dpc1_func (POINTER arg);
+static void dpc2_func (POINTER arg);
+static void dpc3_func (POINTER arg);
+static void dpc4_func (POINTER arg);
+
+
+/**
+ * \b test_start
+ *
+ * Start DPC test.
+ *
+ * This tests basic operation of deferred procedure calls.
+ *
+ * A timer callback (running in interrupt context) wakes a high priority
+ * thread and queues a DPC twice. We check that the DPC runs once, and
+ * before the woken thread. We then check that queueing from thread context
+ * runs the DPC immediately, and that a pending DPC can be cancelled.
+ * Finally a DPC requeues itself more times than the DPC thread's wake
+ * semaphore can count, checking every requeue succeeds.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_dpc1_runs = 0;
+    g_dpc3_runs = 0;
+    g_dpc4_runs = 0;
+    g_requeue_errors = 0;
+    g_log_idx = 0;
+
+    /* Check bad parameters */
+    if (atomDpcCreate (NULL, dpc1_func, NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad DPC check\n"));
+        failures++;
+    }
+    if (atomDpcCreate (&dpc1, NULL, NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad func check\n"));
+        failures++;
+    }
+    if (atomDpcQueue (NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad queue check\n"));
+        failures++;
+    }
+
+    /* Start the DPC thread at the highest priority and create the DPCs */
+    if (atomDpcInit (&dpc_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error starting DPC thread\n"));
+        failures++;
+    }
+    else if ((atomDpcCreate (&dpc1, dpc1_func, NULL) != ATOM_OK)
+        || (atomDpcCreate (&dpc2, dpc2_func, NULL) != ATOM_OK)
+        || (atomDpcCreate (&dpc3, dpc3_func, NULL) != ATOM_OK)
+        || (atomDpcCreate (&dpc4, dpc4_func, NULL) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating DPCs\n"));
+        failures++;
+    }
+    else if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating semaphore\n"));
+        failures++;
+    }
+
+    /* Create a thread, higher priority than us, which waits on sem1 */
+    else if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO - 1, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test thread\n"));
+        failures++;
+    }
+    else
+    {
+        /* Wake the thread and queue the DPC from interrupt context */
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+
+        /* Give the callback, DPC and thread time to run */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        if (g_dpc1_runs != 1)
+        {
+            ATOMLOG (_STR("ISR runs %d\n"), g_dpc1_runs);
+            failures++;
+        }
+        else if ((g_log_idx != 2) || (g_log[0] != 'D') || (g_log[1] != 'T'))
+        {
+            ATOMLOG (_STR("Order\n"));
+            failures++;
+        }
+
+        /* Queue from thread context, which should run it immediately */
+        if (atomDpcQueue (&dpc1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Queue\n"));
+            failures++;
+        }
+        else if (g_dpc1_runs != 2)
+        {
+            ATOMLOG (_STR("Thread runs %d\n"), g_dpc1_runs);
+            failures++;
+        }
+
+        /* dpc2 queues and then cancels dpc3 */
+        g_cancel_result = 0;
+        if (atomDpcQueue (&dpc2) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Queue2\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if (g_cancel_result != 1)
+        {
+            ATOMLOG (_STR("Cancel %d\n"), g_cancel_result);
+            failures++;
+        }
+        else if (g_dpc3_runs != 0)
+        {
+            ATOMLOG (_STR("Cancelled DPC ran\n"));
+            failures++;
+        }
+
+        /* dpc4 requeues itself until it has run DPC4_RUNS times */
+        if (atomDpcQueue (&dpc4) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Queue4\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if ((g_dpc4_runs != DPC4_RUNS) || (g_requeue_errors != 0))
+        {
+            ATOMLOG (_STR("Requeue %d %d\n"), g_dpc4_runs, g_requeue_errors);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Puts sem1 to wake the high priority test thread, then queues dpc1 twice
+ * from interrupt context. The second queue should be coalesced with the
+ * first, so dpc1 runs once, and it should run before the woken thread as
+ * the DPC thread is scheduled in first when the callback returns.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Wake the thread first, the DPC should still run before it */
+    (void)atomSemPut (&sem1);
+
+    /* The second queue should be coalesced with the first */
+    (void)atomDpcQueue (&dpc1);
+    (void)atomDpcQueue (&dpc1);
+}
+
+
+/**
+ * \b dpc1_func
+ *
+ * Counts its runs, logging the first.
+ *
+ * @param[in] arg Unused
+ *
+ * @return None
+ */
+static void dpc1_func (POINTER arg)
+{
+    /* Compiler warnings */
+    arg = arg;
+
+    if (g_dpc1_runs++ == 0)
+    {
+        g_log[g_log_idx++] = 'D';
+    }
+}
+
+
+/**
+ * \b dpc2_func
+ *
+ * Queues dpc3, which cannot run until we return, then cancels it.
+ *
+ * @param[in] arg Unused
+ *
+ * @return None
+ */
+static void dpc2_func (POINTER arg)
+{
+    /* Compiler warnings */
+    arg = arg;
+
+    if (atomDpcQueue (&dpc3) != ATOM_OK)
+    {
+        g_cancel_result = 2;
+    }
+    else if (atomDpcCancel (&dpc3) != ATOM_OK)
+    {
+        g_cancel_result = 3;
+    }
+    else if (atomDpcCancel (&dpc3) != ATOM_ERR_NOT_FOUND)
+    {
+        g_cancel_result = 4;
+    }
+    else
+    {
+        g_cancel_result = 1;
+    }
+}
+
+
+/**
+ * \b dpc3_func
+ *
+ * Should never run, as it is always cancelled.
+ *
+ * @param[in] arg Unused
+ *
+ * @return None
+ */
+static void dpc3_func (POINTER arg)
+{
+    /* Compiler warnings */
+    arg = arg;
+
+    g_dpc3_runs++;
+}
+
+
+/**
+ * \b dpc4_func
+ *
+ * Requeues itself until it has run DPC4_RUNS times, counting any failed
+ * requeues.
+ *
+ * @param[in] arg Unused
+ *
+ * @return None
+ */
+static void dpc4_func (POINTER arg)
+{
+    /* Compiler warnings */
+    arg = arg;
+
+    if ((++g_dpc4_runs < DPC4_RUNS) && (atomDpcQueue (&dpc4) != ATOM_OK))
+    {
+        g_requeue_errors++;
+    }
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Waits for the timer callback to wake it, then logs that it ran.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    /* Wait to be woken from interrupt context */
+    if (atomSemGet (&sem1, 0) == ATOM_OK)
+    {
+        g_log[g_log_idx++] = 'T';
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
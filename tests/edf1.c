@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomedf.h"
+#include "atomnotify.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    3
+
+
+#ifdef ATOM_EDF
+
+/* Test OS objects */
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile uint8_t g_log[NUM_TEST_THREADS];
+static volatile int g_log_idx;
+static volatile int g_ran[NUM_TEST_THREADS];
+static volatile int g_ran_during[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void log_thread_func (uint32_t param);
+static void event_thread_func (uint32_t param);
+static void spin_thread_func (uint32_t param);
+static void periodic_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+#endif
+
+
+/**
+ * \b test_start
+ *
+ * Start EDF test.
+ *
+ * This tests the earliest-deadline-first scheduling class, and requires
+ * ATOM_EDF to be defined (otherwise it passes without testing anything).
+ *
+ * Three threads are made ready with different deadlines, checking that
+ * they run in deadline order rather than the order they were readied. A
+ * long-deadline thread is then run while two sporadic threads are woken
+ * from interrupt context, checking that only the one with the earlier
+ * deadline preempts it, and that yielding does not give way to the other.
+ * Finally a periodic thread overruns one job,
+ * checking that one deadline miss is counted.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+#ifdef ATOM_EDF
+    int thread;
+    uint32_t misses;
+    static const uint32_t deadlines[NUM_TEST_THREADS] = { 50, 20, 30 };
+#endif
+
+    /* Default to zero failures */
+    failures = 0;
+
+#ifndef ATOM_EDF
+    ATOMLOG (_STR("EDF not enabled\n"));
+#else
+
+    /* Check bad parameters */
+    if (atomEdfSetParams (NULL, 10, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad TCB check\n"));
+        failures++;
+    }
+    if (atomEdfSetParams (atomCurrentContext(), 0, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad deadline check\n"));
+        failures++;
+    }
+    if (atomEdfJobEnd () != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Non-EDF job end\n"));
+        failures++;
+    }
+
+    /**
+     * Make three threads ready with different deadlines. They are lower
+     * priority than us so only run once we block.
+     */
+    g_log_idx = 0;
+    for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+    {
+        if ((atomThreadCreate(&tcb[thread], TEST_THREAD_PRIO + 1, log_thread_func,
+                (uint32_t)thread, &test_thread_stack[thread][TEST_THREAD_STACK_SIZE - 1],
+                TEST_THREAD_STACK_SIZE) != ATOM_OK)
+            || (atomEdfSetParams (&tcb[thread], deadlines[thread], 0) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Error creating thread %d\n"), thread);
+            failures++;
+        }
+    }
+    for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+    {
+        (void)atomThreadJoin (&tcb[thread], SYSTEM_TICKS_PER_SEC);
+    }
+    if ((g_log_idx != 3) || (g_log[0] != 1) || (g_log[1] != 2) || (g_log[2] != 0))
+    {
+        ATOMLOG (_STR("Deadline order\n"));
+        failures++;
+    }
+
+    /* Create two sporadic threads, with short and long deadlines */
+    for (thread = 1; thread < NUM_TEST_THREADS; thread++)
+    {
+        g_ran[thread] = FALSE;
+        if ((atomThreadCreate(&tcb[thread], TEST_THREAD_PRIO + 1, event_thread_func,
+                (uint32_t)thread, &test_thread_stack[thread][TEST_THREAD_STACK_SIZE - 1],
+                TEST_THREAD_STACK_SIZE) != ATOM_OK)
+            || (atomEdfSetParams (&tcb[thread], (thread == 1) ? 10 : 5000, 0) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Error creating event thread %d\n"), thread);
+            failures++;
+        }
+    }
+
+    /* Let them block waiting for their events */
+    atomTimerDelay (2);
+
+    /* Run a spinning thread, and wake both sporadic threads meanwhile */
+    if ((atomThreadCreate(&tcb[0], TEST_THREAD_PRIO + 1, spin_thread_func, 0,
+            &test_thread_stack[0][TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        || (atomEdfSetParams (&tcb[0], 1000, 0) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating spin thread\n"));
+        failures++;
+    }
+    else
+    {
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = 10;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            (void)atomThreadJoin (&tcb[thread], SYSTEM_TICKS_PER_SEC);
+        }
+
+        /* Only the earlier deadline should have preempted */
+        if ((g_ran_during[1] != TRUE) || (g_ran_during[2] != FALSE))
+        {
+            ATOMLOG (_STR("Preemption %d %d\n"), g_ran_during[1], g_ran_during[2]);
+            failures++;
+        }
+        if ((g_ran[1] != TRUE) || (g_ran[2] != TRUE))
+        {
+            ATOMLOG (_STR("Event threads\n"));
+            failures++;
+        }
+    }
+
+    /* Run a periodic thread which overruns its first job */
+    if ((atomThreadCreate(&tcb[0], TEST_THREAD_PRIO + 1, periodic_thread_func, 0,
+            &test_thread_stack[0][TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        || (atomEdfSetParams (&tcb[0], 5, 10) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating periodic thread\n"));
+        failures++;
+    }
+    else if (atomThreadJoin (&tcb[0], SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Periodic join\n"));
+        failures++;
+    }
+    else if ((atomEdfGetMisses (&tcb[0], &misses) != ATOM_OK) || (misses != 1))
+    {
+        ATOMLOG (_STR("Misses %d\n"), (int)misses);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+#endif /* ATOM_EDF */
+
+    /* Quit */
+    return failures;
+
+}
+
+
+#ifdef ATOM_EDF
+/**
+ * \b log_thread_func
+ *
+ * Entry point for deadline-order test threads.
+ *
+ * Logs its ID, then ends its job and exits.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void log_thread_func (uint32_t param)
+{
+    g_log[g_log_idx++] = (uint8_t)param;
+    (void)atomEdfJobEnd ();
+}
+
+
+/**
+ * \b event_thread_func
+ *
+ * Entry point for sporadic test threads.
+ *
+ * Ends its first job straight away, then waits for a notification which
+ * releases its second job. Records that it ran, then exits.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void event_thread_func (uint32_t param)
+{
+    uint32_t value;
+
+    (void)atomEdfJobEnd ();
+    if (atomThreadNotifyWait (0, ATOM_NOTIFY_COUNT, &value) == ATOM_OK)
+    {
+        g_ran[param] = TRUE;
+    }
+    (void)atomEdfJobEnd ();
+}
+
+
+/**
+ * \b spin_thread_func
+ *
+ * Entry point for the long-deadline thread.
+ *
+ * Spins for a while, yielding, during which the timer callback wakes the
+ * sporadic threads, then records which of them preempted it.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void spin_thread_func (uint32_t param)
+{
+    uint32_t end_time;
+
+    /* Compiler warnings */
+    param = param;
+
+    /**
+     * Spin well past the timer callback, yielding as we go. Yielding
+     * should not hand the CPU to the later-deadline sporadic thread.
+     */
+    end_time = atomTimeGet() + 30;
+    while ((int32_t)(atomTimeGet() - end_time) < 0)
+    {
+        (void)atomThreadYield ();
+    }
+
+    /* Record which threads ran while we had work to do */
+    g_ran_during[1] = g_ran[1];
+    g_ran_during[2] = g_ran[2];
+    (void)atomEdfJobEnd ();
+}
+
+
+/**
+ * \b periodic_thread_func
+ *
+ * Entry point for the periodic thread.
+ *
+ * Overruns the deadline of its first job, then completes a second job on
+ * time and exits.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void periodic_thread_func (uint32_t param)
+{
+    uint32_t end_time;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* First job: spin past the 5 tick deadline */
+    end_time = atomTimeGet() + 8;
+    while ((int32_t)(atomTimeGet() - end_time) < 0)
+    {
+        /* Busy */
+    }
+    (void)atomEdfJobEnd ();
+
+    /* Second job: finish immediately */
+    (void)atomEdfJobEnd ();
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Releases both sporadic threads from interrupt context by notifying
+ * them, while the spin thread (deadline 1000 ticks) is running. Only
+ * tcb[1], with a 10 tick deadline, should preempt the spin thread when the
+ * callback returns. tcb[2], with a 5000 tick deadline, should wait for the
+ * spin thread's job to end.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    (void)atomThreadNotify (&tcb[1], ATOM_NOTIFY_COUNT, 0);
+    (void)atomThreadNotify (&tcb[2], ATOM_NOTIFY_COUNT, 0);
+}
+#endif /* ATOM_EDF */
@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <string.h>
+#include "atom.h"
+#include "atomheap.h"
+#include "atomtests.h"
+
+
+/* Test heap size */
+#define HEAP_SIZE           512
+
+
+/* Test OS objects */
+static ATOM_HEAP heap1;
+static POINTER heap1_storage[HEAP_SIZE / sizeof(POINTER)];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result;
+static volatile uint8_t g_stop;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static int check_empty (uint32_t total);
+static int alloc_free_loop (uint8_t fill);
+
+
+/**
+ * \b test_start
+ *
+ * Start heap test.
+ *
+ * This tests basic operation of the TLSF heap.
+ *
+ * Blocks of several sizes are allocated and filled, checking they do not
+ * overlap. Freed blocks must be reused for allocations of the same size,
+ * neighbouring free blocks must merge so that once everything is freed
+ * the whole heap is available as a single block again, and invalid or
+ * repeated frees must be rejected. The statistics are checked throughout.
+ * Finally a thread and the test thread allocate and free concurrently to
+ * check the heap is thread-safe.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t i;
+    uint8_t *mem[4];
+    POINTER ptr;
+    uint32_t total;
+    ATOM_HEAP_STATS stats;
+    static const uint16_t sizes[4] = {1, 24, 60, 100};
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomHeapCreate (&heap1, (uint8_t *)&heap1_storage[0], 4) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad size check\n"));
+        failures++;
+    }
+
+    /* Create test heap */
+    if (atomHeapCreate (&heap1, (uint8_t *)&heap1_storage[0], HEAP_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test heap\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Check the initial statistics */
+        (void)atomHeapStats (&heap1, &stats);
+        total = stats.free_bytes;
+        if ((total == 0) || (total > HEAP_SIZE) || (stats.largest_free != total)
+            || (stats.used_bytes != 0) || (stats.max_used_bytes != 0))
+        {
+            ATOMLOG (_STR("Initial stats\n"));
+            failures++;
+        }
+
+        /* Allocate and fill some blocks */
+        for (i = 0; i < 4; i++)
+        {
+            if (atomHeapAlloc (&heap1, sizes[i], &ptr) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Alloc %d\n"), (int)i);
+                failures++;
+                mem[i] = NULL;
+            }
+            else
+            {
+                mem[i] = (uint8_t *)ptr;
+                memset (mem[i], 0xA0 + i, sizes[i]);
+            }
+        }
+
+        /* Check no block was overwritten by another */
+        for (i = 0; i < 4; i++)
+        {
+            if ((mem[i] != NULL) && ((mem[i][0] != 0xA0 + i) || (mem[i][sizes[i] - 1] != 0xA0 + i)))
+            {
+                ATOMLOG (_STR("Overlap %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Check an impossible request fails */
+        if (atomHeapAlloc (&heap1, HEAP_SIZE, &ptr) != ATOM_ERR_OVF)
+        {
+            ATOMLOG (_STR("Alloc too big\n"));
+            failures++;
+        }
+
+        /* Check sizes which would wrap when rounded up are rejected */
+        if ((atomHeapAlloc (&heap1, 0xFFFFFFFF, &ptr) != ATOM_ERR_OVF)
+            || (atomHeapAlloc (&heap1, 0xFFFFFFFD, &ptr) != ATOM_ERR_OVF))
+        {
+            ATOMLOG (_STR("Alloc wrap\n"));
+            failures++;
+        }
+
+        /* Free a middle block and check the hole is reused */
+        if (atomHeapFree (&heap1, mem[2]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Free 2\n"));
+            failures++;
+        }
+        if (atomHeapFree (&heap1, mem[2]) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Double free\n"));
+            failures++;
+        }
+        if ((atomHeapAlloc (&heap1, sizes[2], &ptr) != ATOM_OK) || (ptr != mem[2]))
+        {
+            ATOMLOG (_STR("Reuse\n"));
+            failures++;
+        }
+
+        /* Check the high-water mark covers the allocations */
+        (void)atomHeapStats (&heap1, &stats);
+        if ((stats.used_bytes < 185) || (stats.max_used_bytes != stats.used_bytes)
+            || (stats.free_bytes + stats.used_bytes != total))
+        {
+            ATOMLOG (_STR("Used stats\n"));
+            failures++;
+        }
+
+        /* Free in an order which exercises merging both ways */
+        if ((atomHeapFree (&heap1, mem[1]) != ATOM_OK)
+            || (atomHeapFree (&heap1, mem[3]) != ATOM_OK)
+            || (atomHeapFree (&heap1, mem[2]) != ATOM_OK)
+            || (atomHeapFree (&heap1, mem[0]) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Free all\n"));
+            failures++;
+        }
+        failures += check_empty (total);
+
+        /* Check pointers outside the heap are rejected */
+        if (atomHeapFree (&heap1, &stats) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Free foreign\n"));
+            failures++;
+        }
+
+        /* Allocate and free concurrently with another thread */
+        g_result = 0;
+        g_stop = FALSE;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Run until the thread has been preempted several times */
+            total = atomTimeGet() + (SYSTEM_TICKS_PER_SEC / 2);
+            while (atomTimeGet() < total)
+            {
+                if (alloc_free_loop (0x55) != 0)
+                {
+                    ATOMLOG (_STR("Main corrupt\n"));
+                    failures++;
+                    break;
+                }
+            }
+
+            /* Stop the thread and check it saw no problems */
+            g_stop = TRUE;
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+
+            /* Everything should have been merged back together */
+            (void)atomHeapStats (&heap1, &stats);
+            failures += check_empty (stats.free_bytes + stats.used_bytes);
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b check_empty
+ *
+ * Checks the heap statistics show nothing allocated and the whole heap
+ * available as a single block.
+ *
+ * @param[in] total Expected free bytes
+ *
+ * @retval Number of failures
+ */
+static int check_empty (uint32_t total)
+{
+    ATOM_HEAP_STATS stats;
+    int failures;
+
+    failures = 0;
+    (void)atomHeapStats (&heap1, &stats);
+    if ((stats.free_bytes != total) || (stats.largest_free != total)
+        || (stats.used_bytes != 0))
+    {
+        ATOMLOG (_STR("Not merged %ld/%ld\n"), (long)stats.largest_free, (long)total);
+        failures++;
+    }
+
+    return failures;
+}
+
+
+/**
+ * \b alloc_free_loop
+ *
+ * Allocates a few blocks, fills them with a pattern, checks the pattern
+ * and frees them again.
+ *
+ * @param[in] fill Pattern byte to use
+ *
+ * @retval Non-zero if a block was corrupted or could not be allocated
+ */
+static int alloc_free_loop (uint8_t fill)
+{
+    POINTER ptr[3];
+    uint8_t i, j;
+    int errors;
+
+    errors = 0;
+    for (i = 0; i < 3; i++)
+    {
+        if (atomHeapAlloc (&heap1, 16 + (i * 20), &ptr[i]) != ATOM_OK)
+        {
+            errors++;
+            ptr[i] = NULL;
+        }
+        else
+        {
+            memset (ptr[i], fill, 16 + (i * 20));
+        }
+    }
+    for (i = 0; i < 3; i++)
+    {
+        if (ptr[i] != NULL)
+        {
+            for (j = 0; j < 16 + (i * 20); j++)
+            {
+                if (((uint8_t *)ptr[i])[j] != fill)
+                {
+                    errors++;
+                    break;
+                }
+            }
+            if (atomHeapFree (&heap1, ptr[i]) != ATOM_OK)
+            {
+                errors++;
+            }
+        }
+    }
+
+    return errors;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Allocates and frees blocks in a loop until told to stop.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    int result;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Run until stopped */
+    result = 1;
+    while (g_stop == FALSE)
+    {
+        if (alloc_free_loop (0xAA) != 0)
+        {
+            result = 2;
+            break;
+        }
+    }
+    g_result = result;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atomipc.h"
+#include "atomtests.h"
+
+
+/* Server thread runs at a lower priority than the test (client) thread */
+#define SERVER_PRIO         (TEST_THREAD_PRIO + 4)
+
+
+/* Number of requests made by the test thread */
+#define NUM_REQUESTS        3
+
+
+/* Request asking the server to change its own priority before replying */
+#define REQ_SET_PRIO        0x99
+
+
+/* Test OS objects */
+static ATOM_CHANNEL chan1;
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_served;
+static volatile int g_deleted;
+static volatile uint8_t g_server_prio[NUM_REQUESTS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start IPC test.
+ *
+ * This tests basic operation of synchronous send/receive/reply IPC.
+ *
+ * After checking the non-blocking and timeout cases with no server, a
+ * lower priority server thread handles several requests. The first finds
+ * the server already waiting to receive, and later ones are queued before
+ * the server calls atomReceive(), exercising both handoff paths. We check
+ * the replies, truncation of a reply which is too large for the client's
+ * buffer, and that the server runs at the client's priority while serving
+ * and drops back afterwards, unless the server changed its own priority
+ * while serving. Finally, deleting the channel must wake the
+ * server waiting for the next request with ATOM_ERR_DELETED.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t request, reply[2], reply_size, i, start_time;
+    ATOM_TCB *client;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test channel with priority handoff */
+    if (atomChannelCreate (&chan1, TRUE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test channel\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* No server: check no block with timeout -1 */
+        request = 1;
+        reply_size = sizeof(reply);
+        if (atomSend (&chan1, -1, (uint8_t *)&request, sizeof(request),
+                (uint8_t *)&reply[0], &reply_size) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Send -1\n"));
+            failures++;
+        }
+
+        /* No client: check no block with timeout -1 */
+        reply_size = sizeof(reply);
+        if (atomReceive (&chan1, -1, (uint8_t *)&reply[0], &reply_size,
+                &client) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Receive -1\n"));
+            failures++;
+        }
+
+        /* Check a send times out with no server */
+        start_time = atomTimeGet();
+        reply_size = sizeof(reply);
+        if (atomSend (&chan1, SYSTEM_TICKS_PER_SEC/10, (uint8_t *)&request,
+                sizeof(request), (uint8_t *)&reply[0], &reply_size) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Send timeout\n"));
+            failures++;
+        }
+        else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+        {
+            ATOMLOG (_STR("Timeout early\n"));
+            failures++;
+        }
+
+        /* Check a reply to a thread with no request outstanding */
+        if (atomReply (&tcb1, NULL, 0) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Bad reply\n"));
+            failures++;
+        }
+
+        /* Create the server thread */
+        g_served = g_deleted = 0;
+        if (atomThreadCreate(&tcb1, SERVER_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the server time to start waiting for requests */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+
+            /**
+             * Make the requests. Replies wake us straight away, so each
+             * later request is sent before the server gets back to
+             * atomReceive().
+             */
+            for (i = 0; i < NUM_REQUESTS; i++)
+            {
+                /* The last request only has room for half the reply */
+                request = 10 * (i + 1);
+                reply[0] = reply[1] = 0;
+                reply_size = (i == NUM_REQUESTS - 1) ? sizeof(reply[0]) : sizeof(reply);
+                if (atomSend (&chan1, 0, (uint8_t *)&request, sizeof(request),
+                        (uint8_t *)&reply[0], &reply_size) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Send %d\n"), (int)i);
+                    failures++;
+                }
+                else if ((reply_size != sizeof(reply)) || (reply[0] != request * 2))
+                {
+                    ATOMLOG (_STR("Reply %d size %d\n"), (int)i, (int)reply_size);
+                    failures++;
+                }
+                else if (reply[1] != ((i == NUM_REQUESTS - 1) ? 0 : request + 1))
+                {
+                    ATOMLOG (_STR("Reply %d word 1\n"), (int)i);
+                    failures++;
+                }
+
+                /* Server ran at our priority, and must have dropped back */
+                if (g_server_prio[i] != TEST_THREAD_PRIO)
+                {
+                    ATOMLOG (_STR("Handoff prio %d\n"), (int)g_server_prio[i]);
+                    failures++;
+                }
+                if (tcb1.priority != SERVER_PRIO)
+                {
+                    ATOMLOG (_STR("Restored prio %d\n"), (int)tcb1.priority);
+                    failures++;
+                }
+            }
+
+            /**
+             * Priority changes made while serving must be kept when the
+             * server replies, rather than being overwritten by its
+             * priority from before the handoff.
+             */
+            request = REQ_SET_PRIO;
+            reply_size = sizeof(reply);
+            if (atomSend (&chan1, 0, (uint8_t *)&request, sizeof(request),
+                    (uint8_t *)&reply[0], &reply_size) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Send set prio\n"));
+                failures++;
+            }
+            else if (tcb1.priority != SERVER_PRIO - 1)
+            {
+                ATOMLOG (_STR("Changed prio %d\n"), (int)tcb1.priority);
+                failures++;
+            }
+
+            /* Let the server get back to waiting, then delete the channel */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+            if (atomChannelDelete (&chan1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Delete failed\n"));
+                failures++;
+            }
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+            if ((g_served != NUM_REQUESTS + 1) || (g_deleted != 1))
+            {
+                ATOMLOG (_STR("Served %d deleted %d\n"), g_served, g_deleted);
+                failures++;
+            }
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for the server thread.
+ *
+ * Receives requests until the channel is deleted, replying to each with
+ * twice the request value followed by the request value plus one. Records
+ * the priority it runs at while serving each request, and lowers its
+ * priority slightly while serving a REQ_SET_PRIO request.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint32_t request, reply[2], size;
+    ATOM_TCB *client;
+    uint8_t status;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Serve requests */
+    while (1)
+    {
+        size = sizeof(request);
+        status = atomReceive (&chan1, 0, (uint8_t *)&request, &size, &client);
+        if (status != ATOM_OK)
+        {
+            break;
+        }
+
+        /* Note our priority while serving */
+        if (g_served < NUM_REQUESTS)
+        {
+            g_server_prio[g_served] = tcb1.priority;
+        }
+
+        /* Change our own priority while serving if asked */
+        if (request == REQ_SET_PRIO)
+        {
+            (void)atomThreadSetPriority (&tcb1, SERVER_PRIO - 1);
+        }
+
+        /* Reply to the client */
+        reply[0] = request * 2;
+        reply[1] = request + 1;
+        if ((size == sizeof(request))
+            && (atomReply (client, (uint8_t *)&reply[0], sizeof(reply)) == ATOM_OK))
+        {
+            g_served++;
+        }
+    }
+
+    /* Channel deleted while waiting */
+    if (status == ATOM_ERR_DELETED)
+    {
+        g_deleted++;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomtests.h"
+
+
+/* Number of times the test thread storage is reused */
+#define NUM_REUSES          3
+
+
+/* Test OS objects */
+static ATOM_TCB tcb1, tcb2;
+static uint8_t test_thread_stack[2][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_runs;
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void join_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests thread termination and joining.
+ *
+ * A test thread which returns from its entry point is joined, checking
+ * the non-blocking and timeout behaviour while it is still running, and
+ * that joining an exited thread returns immediately. The same TCB and
+ * stack are then reused for further threads which exit explicitly using
+ * atomThreadExit(), with a second thread joining at the same time to
+ * check that all joining threads are woken.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_runs = 0;
+
+    /* Check bad parameters */
+    if (atomThreadJoin (NULL, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad TCB check\n"));
+        failures++;
+    }
+    if (atomThreadJoin (atomCurrentContext(), 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Self join check\n"));
+        failures++;
+    }
+
+    /* Create a test thread which returns from its entry point */
+    if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+          &test_thread_stack[0][TEST_THREAD_STACK_SIZE - 1],
+          TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test thread\n"));
+        failures++;
+    }
+    else
+    {
+        /* Thread is still running: check no block with timeout -1 */
+        if (atomThreadJoin (&tcb1, -1) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Join running\n"));
+            failures++;
+        }
+
+        /* Check a blocking join times out */
+        if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC/10) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Join timeout\n"));
+            failures++;
+        }
+
+        /* Now wait for it to exit */
+        if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join\n"));
+            failures++;
+        }
+        else if (g_runs != 1)
+        {
+            ATOMLOG (_STR("Runs %d\n"), g_runs);
+            failures++;
+        }
+
+        /* Joining an exited thread should return immediately */
+        if (atomThreadJoin (&tcb1, -1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join exited\n"));
+            failures++;
+        }
+    }
+
+    /* Reuse the TCB and stack, with a second thread also joining */
+    for (i = 0; i < NUM_REUSES; i++)
+    {
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 1,
+              &test_thread_stack[0][TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error recreating test thread\n"));
+            failures++;
+            break;
+        }
+        if (atomThreadCreate(&tcb2, TEST_THREAD_PRIO, join_thread_func, 0,
+              &test_thread_stack[1][TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating join thread\n"));
+            failures++;
+            break;
+        }
+
+        /* Wait for both threads to exit */
+        if ((atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+            || (atomThreadJoin (&tcb2, SYSTEM_TICKS_PER_SEC) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Join %d\n"), i);
+            failures++;
+            break;
+        }
+
+        /* Check the join thread was also woken */
+        if (g_result != 1)
+        {
+            ATOMLOG (_STR("Join thread result %d\n"), g_result);
+            failures++;
+        }
+    }
+
+    /* Check every thread ran once, and none ran past atomThreadExit() */
+    if (g_runs != NUM_REUSES + 1)
+    {
+        ATOMLOG (_STR("Total runs %d\n"), g_runs);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Runs for a short while then terminates, either by returning from the
+ * entry point (param 0) or by calling atomThreadExit() (param 1).
+ *
+ * @param[in] param Termination method
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    /* Give the joining threads time to block */
+    atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+    /* Count the run */
+    g_runs++;
+
+    /* Terminate explicitly if requested */
+    if (param == 1)
+    {
+        (void)atomThreadExit ();
+
+        /* Not reached: make sure the run count shows it if it is */
+        g_runs++;
+    }
+}
+
+
+/**
+ * \b join_thread_func
+ *
+ * Entry point for join thread.
+ *
+ * Joins the test thread alongside the main test thread, then returns.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void join_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    /* Wait for the test thread to exit */
+    g_result = (atomThreadJoin (&tcb1, 0) == ATOM_OK) ? 1 : 2;
+}
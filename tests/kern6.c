@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomtests.h"
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    3
+
+
+/* Test OS objects */
+static ATOM_SEM sem1;
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_first;
+static volatile int g_ran;
+static volatile int g_stop;
+
+
+/* Forward declarations */
+static void sem_thread_func (uint32_t param);
+static void ready_thread_func (uint32_t param);
+static void yield_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests runtime priority changes and yielding.
+ *
+ * Two threads block on a semaphore, and the later (lower priority) one is
+ * raised above the other, checking that it is re-sorted on the semaphore's
+ * suspend queue and is woken first. A ready thread is then raised above
+ * the main test thread, and the main test thread lowers itself below a
+ * ready thread, checking that preemption occurs immediately in both cases.
+ * Finally the main test thread yields to a same-priority thread.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, count;
+    ATOM_TCB *self;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_first = 0;
+    g_stop = FALSE;
+    self = atomCurrentContext();
+
+    /* Check bad parameters */
+    if (atomThreadSetPriority (NULL, TEST_THREAD_PRIO) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad TCB check\n"));
+        failures++;
+    }
+
+    /* Nothing else is ready: yield should return straight away */
+    if (atomThreadYield () != ATOM_OK)
+    {
+        ATOMLOG (_STR("Yield alone\n"));
+        failures++;
+    }
+
+    /* Block two lower priority threads on a semaphore */
+    if (atomSemCreate (&sem1, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating semaphore\n"));
+        failures++;
+    }
+    else if ((atomThreadCreate(&tcb[0], TEST_THREAD_PRIO + 4, sem_thread_func, 1,
+              &test_thread_stack[0][TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        || (atomThreadCreate(&tcb[1], TEST_THREAD_PRIO + 5, sem_thread_func, 2,
+              &test_thread_stack[1][TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating sem threads\n"));
+        failures++;
+    }
+    else
+    {
+        /* Let both threads block */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+
+        /* Raise the second above us, it should be woken first */
+        if (atomThreadSetPriority (&tcb[1], TEST_THREAD_PRIO - 1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("SetPriority blocked\n"));
+            failures++;
+        }
+        (void)atomSemPut (&sem1);
+        if (g_first != 2)
+        {
+            ATOMLOG (_STR("First woken %d\n"), g_first);
+            failures++;
+        }
+
+        /* Release the other thread, and wait for both to exit */
+        (void)atomSemPut (&sem1);
+        if ((atomThreadJoin (&tcb[0], SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+            || (atomThreadJoin (&tcb[1], SYSTEM_TICKS_PER_SEC) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Sem threads\n"));
+            failures++;
+        }
+    }
+
+    /* Raise a ready thread above us, it should run immediately */
+    g_ran = FALSE;
+    if (atomThreadCreate(&tcb[0], TEST_THREAD_PRIO + 4, ready_thread_func, 0,
+          &test_thread_stack[0][TEST_THREAD_STACK_SIZE - 1],
+          TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating ready thread\n"));
+        failures++;
+    }
+    else if (g_ran != FALSE)
+    {
+        ATOMLOG (_STR("Ran early\n"));
+        failures++;
+    }
+    else if ((atomThreadSetPriority (&tcb[0], TEST_THREAD_PRIO - 1) != ATOM_OK)
+        || (g_ran != TRUE))
+    {
+        ATOMLOG (_STR("Raise ready\n"));
+        failures++;
+    }
+
+    /* Lower ourselves below a ready thread, it should run immediately */
+    g_ran = FALSE;
+    if (atomThreadCreate(&tcb[1], TEST_THREAD_PRIO + 4, ready_thread_func, 0,
+          &test_thread_stack[1][TEST_THREAD_STACK_SIZE - 1],
+          TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating ready thread\n"));
+        failures++;
+    }
+    else if ((atomThreadSetPriority (self, TEST_THREAD_PRIO + 5) != ATOM_OK)
+        || (g_ran != TRUE))
+    {
+        ATOMLOG (_STR("Lower self\n"));
+        failures++;
+    }
+    if ((atomThreadSetPriority (self, TEST_THREAD_PRIO) != ATOM_OK)
+        || (self->priority != TEST_THREAD_PRIO))
+    {
+        ATOMLOG (_STR("Restore self\n"));
+        failures++;
+    }
+
+    /* Yield to a same-priority thread */
+    if (atomThreadCreate(&tcb[2], TEST_THREAD_PRIO, yield_thread_func, 0,
+          &test_thread_stack[2][TEST_THREAD_STACK_SIZE - 1],
+          TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating yield thread\n"));
+        failures++;
+    }
+    else
+    {
+        /* Each yield should let the other thread run before we continue */
+        for (count = 0; count < 10; count++)
+        {
+            g_ran = FALSE;
+            if ((atomThreadYield () != ATOM_OK) || (g_ran != TRUE))
+            {
+                ATOMLOG (_STR("Yield %d\n"), count);
+                failures++;
+                break;
+            }
+        }
+
+        /* Stop the thread */
+        g_stop = TRUE;
+        if (atomThreadJoin (&tcb[2], SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Yield thread\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < NUM_TEST_THREADS; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b sem_thread_func
+ *
+ * Entry point for semaphore test threads.
+ *
+ * Blocks on the semaphore, records its ID if it is the first woken, then
+ * exits.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void sem_thread_func (uint32_t param)
+{
+    if ((atomSemGet (&sem1, 0) == ATOM_OK) && (g_first == 0))
+    {
+        g_first = (int)param;
+    }
+}
+
+
+/**
+ * \b ready_thread_func
+ *
+ * Entry point for ready test threads. Records that it ran, then exits.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void ready_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    g_ran = TRUE;
+}
+
+
+/**
+ * \b yield_thread_func
+ *
+ * Entry point for yield test thread.
+ *
+ * Records each time it runs and yields straight back, until stopped.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void yield_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    while (g_stop == FALSE)
+    {
+        g_ran = TRUE;
+        (void)atomThreadYield ();
+    }
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomtests.h"
+
+
+/* Number of ticks for which the test threads compete */
+#define TEST_TICKS          40
+
+
+/* Test OS objects */
+static ATOM_TCB tcb[2];
+static uint8_t test_thread_stack[2][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint32_t g_end_time;
+static volatile int g_last;
+static volatile int g_switches;
+
+
+/* Forward declarations */
+static int run_threads (uint16_t ticks);
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start kernel test.
+ *
+ * This tests the round-robin timeslice quantum.
+ *
+ * Two CPU-bound threads of the same priority compete for a fixed number
+ * of ticks with various quanta, counting how often the CPU switches
+ * between them. With the default one-tick quantum they should switch on
+ * roughly every tick, with a longer quantum proportionally less often,
+ * and with timeslicing disabled not at all.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, switches;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check bad parameters */
+    if (atomThreadSetTimeslice (NULL, 1) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad TCB check\n"));
+        failures++;
+    }
+
+    /* Default quantum: expect a switch on nearly every tick */
+    switches = run_threads (ATOM_DEFAULT_TIMESLICE);
+    if ((switches < TEST_TICKS / 2) || (switches > TEST_TICKS + 2))
+    {
+        ATOMLOG (_STR("Default switches %d\n"), switches);
+        failures++;
+    }
+
+    /* Five tick quantum: expect around a fifth as many */
+    switches = run_threads (5);
+    if ((switches < TEST_TICKS / 10) || (switches > (TEST_TICKS / 5) + 2))
+    {
+        ATOMLOG (_STR("Quantum switches %d\n"), switches);
+        failures++;
+    }
+
+    /* No timeslicing: the first thread runs until the end time */
+    switches = run_threads (0);
+    if (switches != 1)
+    {
+        ATOMLOG (_STR("No slice switches %d\n"), switches);
+        failures++;
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+        int thread;
+
+        /* Check all threads */
+        for (thread = 0; thread < 2; thread++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[thread], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), thread);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b run_threads
+ *
+ * Runs the two test threads with the given quantum until they finish.
+ *
+ * The main test thread blocks until both threads have finished, so they
+ * have the CPU to themselves.
+ *
+ * @param[in] ticks Quantum for both threads
+ *
+ * @retval Number of times the CPU switched between the threads, or -1 on error
+ */
+static int run_threads (uint16_t ticks)
+{
+    int thread;
+
+    /* Reset the switch count */
+    g_last = -1;
+    g_switches = 0;
+    g_end_time = atomTimeGet() + TEST_TICKS;
+
+    /**
+     * Create both threads at a lower priority than us, so that neither
+     * gets a head start: they only run once we block waiting for them.
+     */
+    for (thread = 0; thread < 2; thread++)
+    {
+        if ((atomThreadCreate(&tcb[thread], TEST_THREAD_PRIO + 1, test_thread_func,
+                (uint32_t)thread, &test_thread_stack[thread][TEST_THREAD_STACK_SIZE - 1],
+                TEST_THREAD_STACK_SIZE) != ATOM_OK)
+            || (atomThreadSetTimeslice (&tcb[thread], ticks) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Error creating thread\n"));
+            return (-1);
+        }
+    }
+
+    /* Wait for both to finish */
+    for (thread = 0; thread < 2; thread++)
+    {
+        if (atomThreadJoin (&tcb[thread], 0) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join\n"));
+            return (-1);
+        }
+    }
+
+    return (g_switches);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Spins until the end time, counting each time it takes over the CPU from
+ * the other thread.
+ *
+ * @param[in] param Thread ID
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    while ((int32_t)(atomTimeGet() - g_end_time) < 0)
+    {
+        if (g_last != (int)param)
+        {
+            g_last = (int)param;
+            g_switches++;
+        }
+    }
+}
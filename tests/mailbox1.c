@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atommailbox.h"
+#include "atomtests.h"
+
+
+/* Depth of the multi-slot test mailbox */
+#define MBOX_DEPTH          4
+
+
+/* Test OS objects */
+static ATOM_MAILBOX mbox1, mbox2;
+static POINTER mbox2_slots[MBOX_DEPTH];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Buffers whose addresses are passed as messages */
+static uint8_t buffers[MBOX_DEPTH];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start mailbox test.
+ *
+ * This tests basic operation of pointer mailboxes.
+ *
+ * Single-slot and multi-slot mailboxes are filled and drained, checking
+ * the capacity, FIFO ordering and non-blocking and timeout behaviour.
+ * We then check the direct handoffs: a receiver blocking on an empty
+ * mailbox is handed a message posted from interrupt context (a timer
+ * callback), and a sender blocking on a full mailbox has its message moved
+ * into the slot freed by a receiver.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t i;
+    POINTER msg;
+    uint32_t start_time;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomMailboxCreate (&mbox2, NULL, MBOX_DEPTH) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad slots check\n"));
+        failures++;
+    }
+    if (atomMailboxCreate (&mbox2, &mbox2_slots[0], 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad depth check\n"));
+        failures++;
+    }
+
+    /* Create test mailboxes, the single-slot one using built-in storage */
+    if (atomMailboxCreate (&mbox1, NULL, 1) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating mbox1\n"));
+        failures++;
+    }
+    else if (atomMailboxCreate (&mbox2, &mbox2_slots[0], MBOX_DEPTH) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating mbox2\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Empty mailbox: check no block with timeout -1 */
+        if (atomMailboxGet (&mbox1, -1, &msg) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Get empty\n"));
+            failures++;
+        }
+
+        /* Single slot: one message fits, the next would block */
+        if (atomMailboxPut (&mbox1, -1, &buffers[0]) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Put1\n"));
+            failures++;
+        }
+        if (atomMailboxPut (&mbox1, -1, &buffers[1]) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Put1 full\n"));
+            failures++;
+        }
+        if ((atomMailboxGet (&mbox1, -1, &msg) != ATOM_OK) || (msg != &buffers[0]))
+        {
+            ATOMLOG (_STR("Get1\n"));
+            failures++;
+        }
+
+        /* Multi slot: fill twice over to check wrapping and ordering */
+        for (i = 0; i < MBOX_DEPTH * 2; i++)
+        {
+            if (i == MBOX_DEPTH)
+            {
+                /* Mailbox should now be full */
+                if (atomMailboxPut (&mbox2, -1, &buffers[0]) != ATOM_WOULDBLOCK)
+                {
+                    ATOMLOG (_STR("Put2 full\n"));
+                    failures++;
+                }
+
+                /* Take the first two messages out */
+                if ((atomMailboxGet (&mbox2, -1, &msg) != ATOM_OK) || (msg != &buffers[0])
+                    || (atomMailboxGet (&mbox2, -1, &msg) != ATOM_OK) || (msg != &buffers[1]))
+                {
+                    ATOMLOG (_STR("Get2 first\n"));
+                    failures++;
+                }
+            }
+            if ((i < MBOX_DEPTH + 2)
+                && (atomMailboxPut (&mbox2, -1, &buffers[i % MBOX_DEPTH]) != ATOM_OK))
+            {
+                ATOMLOG (_STR("Put2 %d\n"), (int)i);
+                failures++;
+            }
+        }
+        for (i = 2; i < MBOX_DEPTH + 2; i++)
+        {
+            if ((atomMailboxGet (&mbox2, -1, &msg) != ATOM_OK)
+                || (msg != &buffers[i % MBOX_DEPTH]))
+            {
+                ATOMLOG (_STR("Get2 %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Check a blocking get times out */
+        start_time = atomTimeGet();
+        if (atomMailboxGet (&mbox2, SYSTEM_TICKS_PER_SEC/10, &msg) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Get timeout\n"));
+            failures++;
+        }
+        else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+        {
+            ATOMLOG (_STR("Timeout early\n"));
+            failures++;
+        }
+
+        /* Create a test thread which will block receiving on mbox1 */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Hand a message to the blocked thread from interrupt context */
+            timer1.cb_func = testCallback;
+            timer1.cb_data = NULL;
+            timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+            if (atomTimerRegister (&timer1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error registering timer\n"));
+                failures++;
+            }
+
+            /**
+             * Give the callback and thread time to run. The thread should
+             * now be blocking to send its second message.
+             */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+            if (g_result != 0)
+            {
+                ATOMLOG (_STR("Thread early %d\n"), g_result);
+                failures++;
+            }
+
+            /* Receive the first message, freeing the slot for the second */
+            if ((atomMailboxGet (&mbox1, -1, &msg) != ATOM_OK) || (msg != &buffers[1]))
+            {
+                ATOMLOG (_STR("Get thread1\n"));
+                failures++;
+            }
+
+            /* Give the sender time to complete */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+
+            /* The second message should have been moved into the slot */
+            if ((atomMailboxGet (&mbox1, -1, &msg) != ATOM_OK) || (msg != &buffers[2]))
+            {
+                ATOMLOG (_STR("Get thread2\n"));
+                failures++;
+            }
+        }
+
+        /* Delete mailboxes, test finished */
+        if ((atomMailboxDelete (&mbox1) != ATOM_OK)
+            || (atomMailboxDelete (&mbox2) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Posts &buffers[0] to the empty mbox1 from interrupt context, without
+ * blocking. The test thread is blocked in atomMailboxGet(), so the pointer
+ * should be handed straight to it rather than stored in the mailbox. It
+ * then posts its own two messages back.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Post the message, never blocking */
+    (void)atomMailboxPut (&mbox1, -1, &buffers[0]);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Blocks on the empty mailbox until the timer callback posts a message,
+ * then posts two messages back. The second blocks until the main test
+ * thread frees up the slot.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    POINTER msg;
+    int result;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Wait for the handoff from the timer callback */
+    if (atomMailboxGet (&mbox1, 0, &msg) != ATOM_OK)
+    {
+        result = 2;
+    }
+    else if (msg != &buffers[0])
+    {
+        result = 3;
+    }
+
+    /* Post two messages, blocking on the second */
+    else if (atomMailboxPut (&mbox1, 0, &buffers[1]) != ATOM_OK)
+    {
+        result = 4;
+    }
+    else if (atomMailboxPut (&mbox1, 0, &buffers[2]) != ATOM_OK)
+    {
+        result = 5;
+    }
+    else
+    {
+        result = 1;
+    }
+    g_result = result;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atommempool.h"
+#include "atomtests.h"
+
+
+/* Test pool dimensions */
+#define NUM_BLOCKS          4
+#define BLOCK_SIZE          8
+
+
+/* Test OS objects */
+static ATOM_MEMPOOL pool1;
+static POINTER pool1_storage[(NUM_BLOCKS * BLOCK_SIZE) / sizeof(POINTER)];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Blocks allocated by the test */
+static POINTER blocks[NUM_BLOCKS];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start memory pool test.
+ *
+ * This tests basic operation of memory pools.
+ *
+ * Every block is allocated, checking each is a distinct block within the
+ * pool, and we check that further allocations fail without blocking or
+ * time out correctly. Blocks which were not allocated from the pool must
+ * be rejected when freed. We then check that a thread blocking on the
+ * empty pool is handed a block freed from interrupt context, and that all
+ * blocks can be allocated again once freed.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t i, j;
+    uint8_t *pool_start, *pool_end;
+    POINTER block;
+
+    /* Default to zero failures */
+    failures = 0;
+    pool_start = (uint8_t *)&pool1_storage[0];
+    pool_end = pool_start + (NUM_BLOCKS * BLOCK_SIZE);
+
+    /* Check creation parameters */
+    if (atomMemPoolCreate (&pool1, pool_start, 1, NUM_BLOCKS) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad size check\n"));
+        failures++;
+    }
+
+    /* Create test pool */
+    if (atomMemPoolCreate (&pool1, pool_start, BLOCK_SIZE, NUM_BLOCKS) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test pool\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Allocate every block, checking each is distinct and in the pool */
+        for (i = 0; i < NUM_BLOCKS; i++)
+        {
+            if (atomMemPoolAlloc (&pool1, -1, &blocks[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Alloc %d\n"), (int)i);
+                failures++;
+            }
+            else if (((uint8_t *)blocks[i] < pool_start) || ((uint8_t *)blocks[i] >= pool_end))
+            {
+                ATOMLOG (_STR("Range %d\n"), (int)i);
+                failures++;
+            }
+            else
+            {
+                for (j = 0; j < i; j++)
+                {
+                    if (blocks[j] == blocks[i])
+                    {
+                        ATOMLOG (_STR("Dup %d\n"), (int)i);
+                        failures++;
+                    }
+                }
+            }
+        }
+
+        /* Pool is empty: check no block and timeout */
+        if (atomMemPoolAlloc (&pool1, -1, &block) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Alloc empty\n"));
+            failures++;
+        }
+        if (atomMemPoolAlloc (&pool1, SYSTEM_TICKS_PER_SEC/10, &block) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Alloc timeout\n"));
+            failures++;
+        }
+
+        /* Check blocks not from the pool are rejected */
+        if ((atomMemPoolFree (&pool1, pool_start + 1) != ATOM_ERR_PARAM)
+            || (atomMemPoolFree (&pool1, pool_end) != ATOM_ERR_PARAM))
+        {
+            ATOMLOG (_STR("Free check\n"));
+            failures++;
+        }
+
+        /* Create a thread which will block on the empty pool */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Free a block from interrupt context */
+            timer1.cb_func = testCallback;
+            timer1.cb_data = NULL;
+            timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+            if (atomTimerRegister (&timer1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error registering timer\n"));
+                failures++;
+            }
+
+            /* Give the callback and thread time to run */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+        }
+
+        /* Free the remaining blocks (the thread returned block 0) */
+        for (i = 1; i < NUM_BLOCKS; i++)
+        {
+            if (atomMemPoolFree (&pool1, blocks[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Free %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Check every block can be allocated again */
+        for (i = 0; i < NUM_BLOCKS; i++)
+        {
+            if (atomMemPoolAlloc (&pool1, -1, &blocks[i]) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Realloc %d\n"), (int)i);
+                failures++;
+            }
+        }
+        if (atomMemPoolAlloc (&pool1, -1, &block) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Realloc empty\n"));
+            failures++;
+        }
+
+        /* Delete pool, test finished */
+        if (atomMemPoolDelete (&pool1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Frees blocks[0] back to the exhausted pool1 from interrupt context. The
+ * test thread is blocked in atomMemPoolAlloc(), and should be handed that
+ * same block directly rather than the block going back on the free list.
+ * The thread checks this and sets g_result.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Free a block, waking the blocked thread */
+    (void)atomMemPoolFree (&pool1, blocks[0]);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Blocks allocating from the empty pool, checks it is handed the block
+ * freed by the timer callback and then frees it again.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    POINTER block;
+    int result;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block until a block is freed */
+    if (atomMemPoolAlloc (&pool1, 0, &block) != ATOM_OK)
+    {
+        result = 2;
+    }
+    else if (block != blocks[0])
+    {
+        result = 3;
+    }
+    else if (atomMemPoolFree (&pool1, block) != ATOM_OK)
+    {
+        result = 4;
+    }
+    else
+    {
+        result = 1;
+    }
+    g_result = result;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
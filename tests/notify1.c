@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomnotify.h"
+#include "atomtests.h"
+
+
+/* Test OS objects */
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile uint32_t g_value;
+static volatile int g_wakes;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start notification test.
+ *
+ * This tests basic operation of thread notifications.
+ *
+ * The main test thread notifies itself in counting mode and checks that
+ * each wait consumes one notification, and that waits time out or return
+ * immediately when not notified. A second thread then waits in event-bit
+ * mode, and is notified from interrupt context (a timer callback) and
+ * from thread context, checking that all bits set before it runs are
+ * returned by a single wait.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint32_t value, start_time;
+    ATOM_TCB *self;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_value = 0;
+    g_wakes = 0;
+    self = atomCurrentContext();
+
+    /* Check bad parameters */
+    if (atomThreadNotify (NULL, ATOM_NOTIFY_COUNT, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad TCB check\n"));
+        failures++;
+    }
+    if (atomThreadNotify (self, 0, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad mode check\n"));
+        failures++;
+    }
+    if (atomThreadNotifyWait (-1, ATOM_NOTIFY_COUNT, NULL) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad value check\n"));
+        failures++;
+    }
+
+    /* Not notified: check no block with timeout -1 */
+    if (atomThreadNotifyWait (-1, ATOM_NOTIFY_COUNT, &value) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Wait empty\n"));
+        failures++;
+    }
+
+    /* Counting mode: two notifications are consumed one at a time */
+    if ((atomThreadNotify (self, ATOM_NOTIFY_COUNT, 0) != ATOM_OK)
+        || (atomThreadNotify (self, ATOM_NOTIFY_COUNT, 0) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Notify count\n"));
+        failures++;
+    }
+    if ((atomThreadNotifyWait (-1, ATOM_NOTIFY_COUNT, &value) != ATOM_OK) || (value != 2))
+    {
+        ATOMLOG (_STR("Count1\n"));
+        failures++;
+    }
+    if ((atomThreadNotifyWait (0, ATOM_NOTIFY_COUNT, &value) != ATOM_OK) || (value != 1))
+    {
+        ATOMLOG (_STR("Count2\n"));
+        failures++;
+    }
+
+    /* Check a blocking wait times out */
+    start_time = atomTimeGet();
+    if (atomThreadNotifyWait (SYSTEM_TICKS_PER_SEC/10, ATOM_NOTIFY_COUNT, &value) != ATOM_TIMEOUT)
+    {
+        ATOMLOG (_STR("Wait timeout\n"));
+        failures++;
+    }
+    else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+    {
+        ATOMLOG (_STR("Timeout early\n"));
+        failures++;
+    }
+
+    /* Create a thread which waits for event bits */
+    if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+          &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+          TEST_THREAD_STACK_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test thread\n"));
+        failures++;
+    }
+    else
+    {
+        /* Give the thread time to start blocking */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+        /* Notify it from interrupt context */
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+
+        /* Give the callback and thread time to run */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        if ((g_wakes != 1) || (g_value != 0x05))
+        {
+            ATOMLOG (_STR("ISR wake %d %08lx\n"), g_wakes, (long)g_value);
+            failures++;
+        }
+
+        /* Notify it from thread context */
+        if (atomThreadNotify (&tcb1, ATOM_NOTIFY_BITS, 0x80) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Notify bits\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if ((g_wakes != 2) || (g_value != 0x80))
+        {
+            ATOMLOG (_STR("Thread wake %d %08lx\n"), g_wakes, (long)g_value);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Sets event bits 0x01 and then 0x04 on the blocked test thread from
+ * interrupt context. The thread cannot run until the callback returns, so
+ * it should be woken once and receive both bits together (0x05).
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Both bits are set before the thread gets to run */
+    (void)atomThreadNotify (&tcb1, ATOM_NOTIFY_BITS, 0x01);
+    (void)atomThreadNotify (&tcb1, ATOM_NOTIFY_BITS, 0x04);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Waits for event bits, recording the bits received and number of wakes.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint32_t value;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Loop forever */
+    while (1)
+    {
+        if (atomThreadNotifyWait (0, ATOM_NOTIFY_BITS, &value) == ATOM_OK)
+        {
+            g_value = value;
+            g_wakes++;
+        }
+    }
+}
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomperiodic.h"
+#include "atomtests.h"
+
+
+/* Number of jobs timed in the release test */
+#define NUM_JOBS            5
+
+/* Periodic thread priority, above the test thread so releases are prompt */
+#define PERIODIC_PRIO       (TEST_THREAD_PRIO - 1)
+
+
+/* Test OS objects */
+static ATOM_PERIODIC per1;
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint32_t g_start_times[NUM_JOBS];
+static volatile int g_jobs;
+static volatile uint8_t g_status;
+
+
+/* Forward declarations */
+static void release_thread_func (uint32_t param);
+static void overrun_thread_func (uint32_t param);
+static void spin (uint32_t ticks);
+
+
+/**
+ * \b test_start
+ *
+ * Start periodic thread test.
+ *
+ * A periodic thread with a phase records the start time of each of its
+ * jobs, checking that the first is released after the phase and each
+ * following job exactly one period later. Stopping its releases while it
+ * waits must wake it with ATOM_ERR_DELETED.
+ *
+ * A second periodic thread then overruns its deadline on one job and its
+ * whole period on the next, checking the overrun and deadline-miss counts
+ * and the worst-case jitter and response times. It exits without
+ * stopping its releases, and is then created again using the same control
+ * block to check that the releases stopped when it exited.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    int job;
+    uint32_t create_time;
+    ATOM_PERIODIC_STATS stats;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check bad parameters */
+    if (atomThreadCreatePeriodic (&per1, &tcb1, PERIODIC_PRIO, release_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, 0, 0, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad period check\n"));
+        failures++;
+    }
+    if (atomThreadWaitNextPeriod () != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Non-periodic wait\n"));
+        failures++;
+    }
+    if ((atomThreadStopPeriodic (NULL) != ATOM_ERR_PARAM)
+        || (atomThreadPeriodicStats (&per1, NULL) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Bad ptr check\n"));
+        failures++;
+    }
+
+    /* Create a thread with period 10 and phase 5 */
+    g_jobs = 0;
+    g_status = ATOM_OK;
+    create_time = atomTimeGet();
+    if (atomThreadCreatePeriodic (&per1, &tcb1, PERIODIC_PRIO, release_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, 10, 5, 0) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating release thread\n"));
+        failures++;
+    }
+    else
+    {
+        /* Wait until the last job has started, before the next release */
+        atomTimerDelay (NUM_JOBS * 10);
+        if (g_jobs != NUM_JOBS)
+        {
+            ATOMLOG (_STR("Jobs %d\n"), g_jobs);
+            failures++;
+        }
+
+        /* Check the release times */
+        else if (((g_start_times[0] - create_time) < 5)
+            || ((g_start_times[0] - create_time) > 6))
+        {
+            ATOMLOG (_STR("Phase\n"));
+            failures++;
+        }
+        else
+        {
+            for (job = 1; job < NUM_JOBS; job++)
+            {
+                if ((g_start_times[job] - g_start_times[job - 1]) != 10)
+                {
+                    ATOMLOG (_STR("Period %d\n"), job);
+                    failures++;
+                }
+            }
+        }
+
+        /* Stop the releases, which should wake the thread */
+        if (atomThreadStopPeriodic (&per1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stop\n"));
+            failures++;
+        }
+        if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Join release thread\n"));
+            failures++;
+        }
+        else if (g_status != ATOM_ERR_DELETED)
+        {
+            ATOMLOG (_STR("Stop status %d\n"), (int)g_status);
+            failures++;
+        }
+
+        /* All jobs were on time */
+        if ((atomThreadPeriodicStats (&per1, &stats) != ATOM_OK)
+            || (stats.jobs != NUM_JOBS) || (stats.overruns != 0)
+            || (stats.deadline_misses != 0) || (stats.max_jitter != 0))
+        {
+            ATOMLOG (_STR("Release stats\n"));
+            failures++;
+        }
+    }
+
+    /* Create a thread with period 10, no phase and deadline 6 */
+    if (atomThreadCreatePeriodic (&per1, &tcb1, PERIODIC_PRIO, overrun_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, 10, 0, 6) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating overrun thread\n"));
+        failures++;
+    }
+    else if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Join overrun thread\n"));
+        failures++;
+    }
+    else if (atomThreadPeriodicStats (&per1, &stats) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Stats\n"));
+        failures++;
+    }
+    else
+    {
+        /* Jobs of 8, 13 and 0 ticks, the second overrunning its period */
+        if ((stats.jobs != 3) || (stats.overruns != 1)
+            || (stats.deadline_misses != 2))
+        {
+            ATOMLOG (_STR("Counts %d %d %d\n"), (int)stats.jobs,
+                (int)stats.overruns, (int)stats.deadline_misses);
+            failures++;
+        }
+
+        /* Third job started 3 ticks late, second completed after 13 */
+        if ((stats.max_jitter < 3) || (stats.max_jitter > 4)
+            || (stats.max_response < 13) || (stats.max_response > 14))
+        {
+            ATOMLOG (_STR("Times %d %d\n"), (int)stats.max_jitter,
+                (int)stats.max_response);
+            failures++;
+        }
+    }
+
+    /**
+     * The overrun thread exited without stopping its releases. Check the
+     * control block can be used again for a new thread once it is joined.
+     */
+    if (atomThreadCreatePeriodic (&per1, &tcb1, PERIODIC_PRIO, overrun_thread_func, 0,
+            &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, 10, 0, 6) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error re-creating overrun thread\n"));
+        failures++;
+    }
+    else if (atomThreadJoin (&tcb1, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Join re-created thread\n"));
+        failures++;
+    }
+    else if ((atomThreadPeriodicStats (&per1, &stats) != ATOM_OK)
+        || (stats.jobs != 3) || (stats.overruns != 1))
+    {
+        ATOMLOG (_STR("Re-created stats\n"));
+        failures++;
+    }
+    else
+    {
+        /* No releases should follow once the thread has exited */
+        atomTimerDelay (25);
+        if ((atomThreadPeriodicStats (&per1, &stats) != ATOM_OK)
+            || (stats.overruns != 1) || (per1.pending != 0))
+        {
+            ATOMLOG (_STR("Released after exit\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b release_thread_func
+ *
+ * Entry point for the release timing thread.
+ *
+ * Records the start time of each job, then waits for one more release
+ * and records the status when the releases are stopped.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void release_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    while (g_jobs < NUM_JOBS)
+    {
+        if (atomThreadWaitNextPeriod () != ATOM_OK)
+        {
+            break;
+        }
+        g_start_times[g_jobs++] = atomTimeGet();
+    }
+
+    /* Wait until stopped */
+    g_status = atomThreadWaitNextPeriod ();
+}
+
+
+/**
+ * \b overrun_thread_func
+ *
+ * Entry point for the overrunning thread.
+ *
+ * Runs three jobs: one longer than its deadline, one longer than its
+ * period and one which completes immediately, then exits.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void overrun_thread_func (uint32_t param)
+{
+    /* Compiler warnings */
+    param = param;
+
+    if (atomThreadWaitNextPeriod () == ATOM_OK)
+    {
+        spin (8);
+    }
+    if (atomThreadWaitNextPeriod () == ATOM_OK)
+    {
+        spin (13);
+    }
+    (void)atomThreadWaitNextPeriod ();
+
+    /* Complete the third job */
+    (void)atomThreadWaitNextPeriod ();
+}
+
+
+/**
+ * \b spin
+ *
+ * Busy-waits for the given number of system ticks.
+ *
+ * @param[in] ticks Number of ticks to spin for
+ *
+ * @return None
+ */
+static void spin (uint32_t ticks)
+{
+    uint32_t end_time;
+
+    end_time = atomTimeGet() + ticks;
+    while ((int32_t)(atomTimeGet() - end_time) < 0)
+    {
+        /* Busy */
+    }
+}
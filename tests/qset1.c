@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomsem.h"
+#include "atomqset.h"
+#include "atomtests.h"
+
+
+/* Number of queue entries */
+#define QUEUE_ENTRIES       4
+
+
+/* Test OS objects */
+static ATOM_QSET qset1;
+static ATOM_QSET_ENTRY qset1_entries[3];
+static ATOM_QUEUE queue1, queue2;
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static uint8_t queue2_storage[QUEUE_ENTRIES];
+static ATOM_SEM sem1, sem2;
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Events seen by the test thread */
+static volatile uint8_t g_events[4];
+static volatile uint8_t g_num_events;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue set test.
+ *
+ * This tests basic operation of queue sets containing two queues and a
+ * semaphore.
+ *
+ * We first check adding and removing members, and that non-blocking and
+ * timed waits behave correctly when nothing is ready. We then check that
+ * the first ready member in the order they were added is reported, and
+ * that a thread blocking on the set is woken by a semaphore put from
+ * interrupt context and by a message posted to a queue, reporting the
+ * correct member each time. Finally the set is deleted while the thread
+ * is blocking on it.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg;
+    POINTER ready;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_num_events = 0;
+
+    /* Create the member objects and the set */
+    if ((atomQueueCreate (&queue1, &queue1_storage[0], sizeof(uint8_t), QUEUE_ENTRIES) != ATOM_OK)
+        || (atomQueueCreate (&queue2, &queue2_storage[0], sizeof(uint8_t), QUEUE_ENTRIES) != ATOM_OK)
+        || (atomSemCreate (&sem1, 0) != ATOM_OK)
+        || (atomSemCreate (&sem2, 0) != ATOM_OK)
+        || (atomQSetCreate (&qset1, &qset1_entries[0], 3) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating test objects\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Add the members */
+        if ((atomQSetAddQueue (&qset1, &queue1) != ATOM_OK)
+            || (atomQSetAddQueue (&qset1, &queue2) != ATOM_OK)
+            || (atomQSetAddSem (&qset1, &sem1) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Add failed\n"));
+            failures++;
+        }
+        if (atomQSetAddQueue (&qset1, &queue1) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Add twice\n"));
+            failures++;
+        }
+        if (atomQSetAddSem (&qset1, &sem2) != ATOM_ERR_OVF)
+        {
+            ATOMLOG (_STR("Add full\n"));
+            failures++;
+        }
+
+        /* Nothing ready: check non-blocking and timed waits */
+        if (atomQSetWait (&qset1, -1, &ready) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Wait empty\n"));
+            failures++;
+        }
+        if (atomQSetWait (&qset1, SYSTEM_TICKS_PER_SEC/10, &ready) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Wait timeout\n"));
+            failures++;
+        }
+
+        /* Check the ready member is reported, in the order added */
+        msg = 0x22;
+        (void)atomQueuePut (&queue2, -1, &msg);
+        if ((atomQSetWait (&qset1, -1, &ready) != ATOM_OK) || (ready != &queue2))
+        {
+            ATOMLOG (_STR("Wait queue2\n"));
+            failures++;
+        }
+        msg = 0x11;
+        (void)atomQueuePut (&queue1, -1, &msg);
+        (void)atomSemPut (&sem1);
+        if ((atomQSetWait (&qset1, -1, &ready) != ATOM_OK) || (ready != &queue1))
+        {
+            ATOMLOG (_STR("Wait order\n"));
+            failures++;
+        }
+
+        /* Drain everything so the set is no longer ready */
+        (void)atomQueueGet (&queue1, -1, &msg);
+        (void)atomQueueGet (&queue2, -1, &msg);
+        (void)atomSemGet (&sem1, -1);
+
+        /* Create a thread which will block on the set */
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Put the semaphore from interrupt context */
+            timer1.cb_func = testCallback;
+            timer1.cb_data = NULL;
+            timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+            if (atomTimerRegister (&timer1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error registering timer\n"));
+                failures++;
+            }
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Post a message to the second queue from thread context */
+            msg = 0x33;
+            (void)atomQueuePut (&queue2, -1, &msg);
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Check removing members */
+            if (atomQSetRemove (&qset1, &queue1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Remove failed\n"));
+                failures++;
+            }
+            if (atomQSetRemove (&qset1, &queue1) != ATOM_ERR_NOT_FOUND)
+            {
+                ATOMLOG (_STR("Remove twice\n"));
+                failures++;
+            }
+
+            /* Delete the set while the thread is blocking on it */
+            if (atomQSetDelete (&qset1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Delete failed\n"));
+                failures++;
+            }
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Check the thread saw the semaphore, queue2 and the deletion */
+            if ((g_num_events != 3) || (g_events[0] != 3)
+                || (g_events[1] != 2) || (g_events[2] != 0xFF))
+            {
+                ATOMLOG (_STR("Events %d: %d %d %d\n"), (int)g_num_events,
+                         (int)g_events[0], (int)g_events[1], (int)g_events[2]);
+                failures++;
+            }
+
+            /* Members of the deleted set have been detached */
+            if ((queue2.qset != NULL) || (sem1.qset != NULL))
+            {
+                ATOMLOG (_STR("Not detached\n"));
+                failures++;
+            }
+        }
+
+        /* Delete the member objects, test finished */
+        if ((atomQueueDelete (&queue1) != ATOM_OK)
+            || (atomQueueDelete (&queue2) != ATOM_OK)
+            || (atomSemDelete (&sem1) != ATOM_OK)
+            || (atomSemDelete (&sem2) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Delete members failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Puts sem1, a member of qset1, from interrupt context. The test thread is
+ * blocked waiting on the set, and should be woken with sem1 returned as
+ * the ready member, which it records (as 3) in its log of wakeups.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Signal the semaphore */
+    (void)atomSemPut (&sem1);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Services the set, recording which member was ready each time it is
+ * woken (1 = queue1, 2 = queue2, 3 = sem1, 0xFF = error), until the wait
+ * fails.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    POINTER ready;
+    uint8_t msg, event;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Service the set until it is deleted */
+    do
+    {
+        event = 0xFF;
+        if (atomQSetWait (&qset1, 0, &ready) == ATOM_OK)
+        {
+            /* Read the member which was reported ready */
+            if ((ready == &queue1) && (atomQueueGet (&queue1, -1, &msg) == ATOM_OK))
+                event = 1;
+            else if ((ready == &queue2) && (atomQueueGet (&queue2, -1, &msg) == ATOM_OK))
+                event = 2;
+            else if ((ready == &sem1) && (atomSemGet (&sem1, -1) == ATOM_OK))
+                event = 3;
+        }
+        if (g_num_events < sizeof(g_events))
+        {
+            g_events[g_num_events++] = event;
+        }
+    } while (event != 0xFF);
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
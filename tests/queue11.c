@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       4
+
+/* Test message size */
+#define MSG_SIZE            8
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[QUEUE_ENTRIES * MSG_SIZE];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests the zero-copy atomQueueReserve()/atomQueueCommit() and
+ * atomQueuePeek()/atomQueueRelease() APIs.
+ *
+ * Messages are filled in place using reserve/commit, interleaved with
+ * normal atomQueuePut() calls, and received in place using peek/release
+ * to check that FIFO ordering is kept across both APIs. We also check
+ * that the queue is treated as full while a slot is reserved, and as
+ * empty while a message is held, and that a thread blocking in
+ * atomQueuePeek() is woken by atomQueueCommit().
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i, j;
+    uint8_t *slot, *held;
+    uint8_t msg[MSG_SIZE];
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue1_storage[0], MSG_SIZE, QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Check bad parameters and unbalanced calls are caught */
+        if (atomQueueReserve (NULL, 0, &slot) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Reserve param\n"));
+            failures++;
+        }
+        if (atomQueuePeek (&queue1, 0, NULL) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Peek param\n"));
+            failures++;
+        }
+        if (atomQueueCommit (&queue1) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Commit unreserved\n"));
+            failures++;
+        }
+        if (atomQueueRelease (&queue1) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Release unheld\n"));
+            failures++;
+        }
+
+        /* Empty queue: peek must not block with timeout -1 */
+        if (atomQueuePeek (&queue1, -1, &held) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Peek empty\n"));
+            failures++;
+        }
+
+        /* Fill the queue, alternating in-place fills with normal puts */
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            if ((i & 1) == 0)
+            {
+                if (atomQueueReserve (&queue1, 0, &slot) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Reserve %d\n"), i);
+                    failures++;
+                    continue;
+                }
+
+                /* Queue is treated as full while the slot is reserved */
+                if (atomQueuePut (&queue1, -1, &msg[0]) != ATOM_WOULDBLOCK)
+                {
+                    ATOMLOG (_STR("Put reserved\n"));
+                    failures++;
+                }
+                if (atomQueueReserve (&queue1, -1, &held) != ATOM_WOULDBLOCK)
+                {
+                    ATOMLOG (_STR("Double reserve\n"));
+                    failures++;
+                }
+
+                /* Fill the message in place and post it */
+                for (j = 0; j < MSG_SIZE; j++)
+                    slot[j] = (uint8_t)(i + j);
+                if (atomQueueCommit (&queue1) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Commit %d\n"), i);
+                    failures++;
+                }
+            }
+            else
+            {
+                for (j = 0; j < MSG_SIZE; j++)
+                    msg[j] = (uint8_t)(i + j);
+                if (atomQueuePut (&queue1, 0, &msg[0]) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Put %d\n"), i);
+                    failures++;
+                }
+            }
+        }
+
+        /* Queue is now full */
+        if (atomQueueReserve (&queue1, -1, &slot) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Reserve full\n"));
+            failures++;
+        }
+
+        /* Drain the queue, alternating in-place reads with normal gets */
+        for (i = 0; i < QUEUE_ENTRIES; i++)
+        {
+            if ((i & 1) == 0)
+            {
+                if (atomQueuePeek (&queue1, 0, &held) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Peek %d\n"), i);
+                    failures++;
+                    continue;
+                }
+
+                /* Queue is treated as empty while the message is held */
+                if (atomQueueGet (&queue1, -1, &msg[0]) != ATOM_WOULDBLOCK)
+                {
+                    ATOMLOG (_STR("Get held\n"));
+                    failures++;
+                }
+
+                /* Check the message in place and give it back */
+                for (j = 0; j < MSG_SIZE; j++)
+                {
+                    if (held[j] != (uint8_t)(i + j))
+                    {
+                        ATOMLOG (_STR("Val%d\n"), i);
+                        failures++;
+                        break;
+                    }
+                }
+                if (atomQueueRelease (&queue1) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Release %d\n"), i);
+                    failures++;
+                }
+            }
+            else
+            {
+                if (atomQueueGet (&queue1, 0, &msg[0]) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Get %d\n"), i);
+                    failures++;
+                }
+                else if (msg[MSG_SIZE - 1] != (uint8_t)(i + MSG_SIZE - 1))
+                {
+                    ATOMLOG (_STR("Val%d\n"), i);
+                    failures++;
+                }
+            }
+        }
+
+        /* Create a thread which will block in atomQueuePeek() */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Post a message in place, which should wake the thread */
+            if (atomQueueReserve (&queue1, 0, &slot) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Reserve wake\n"));
+                failures++;
+            }
+            else
+            {
+                slot[0] = 0x5A;
+                if (atomQueueCommit (&queue1) != ATOM_OK)
+                {
+                    ATOMLOG (_STR("Commit wake\n"));
+                    failures++;
+                }
+            }
+
+            /* Give the thread time to wake and check the message */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+        }
+
+        /* Delete queue, test finished */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Blocks in atomQueuePeek() until the main thread posts a message, then
+ * checks it in place and releases it.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t *held;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block until a message is posted */
+    if (atomQueuePeek (&queue1, 0, &held) != ATOM_OK)
+    {
+        g_result = 2;
+    }
+    else if (held[0] != 0x5A)
+    {
+        g_result = 3;
+    }
+    else if (atomQueueRelease (&queue1) != ATOM_OK)
+    {
+        g_result = 4;
+    }
+    else
+    {
+        g_result = 1;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
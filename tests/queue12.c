@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       8
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint8_t queue1_storage[QUEUE_ENTRIES];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests the batch atomQueuePutMulti() and atomQueueGetMulti() APIs.
+ *
+ * Batches of different sizes are posted and received such that the
+ * batches are truncated when the queue fills or empties, and such that
+ * batches wrap around the end of the queue storage. The received values
+ * are checked for correct FIFO ordering. We also check that a thread
+ * blocking in atomQueueGetMulti() on an empty queue is woken by a batch
+ * post and receives the whole batch.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t tx_val, rx_val;
+    uint8_t msgs[QUEUE_ENTRIES + 2];
+    uint32_t i, count;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue1_storage[0], sizeof(uint8_t), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Check bad parameters are caught */
+        if (atomQueuePutMulti (&queue1, 0, &msgs[0], 0, &count) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("PutMulti count\n"));
+            failures++;
+        }
+        if (atomQueueGetMulti (&queue1, 0, &msgs[0], 1, NULL) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("GetMulti count ptr\n"));
+            failures++;
+        }
+
+        /* Empty queue: check no block with timeout -1 */
+        if (atomQueueGetMulti (&queue1, -1, &msgs[0], 1, &count) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("GetMulti empty\n"));
+            failures++;
+        }
+
+        tx_val = rx_val = 0;
+
+        /* Post 5, then 5 more of which only 3 fit */
+        for (i = 0; i < 10; i++)
+            msgs[i] = tx_val + (uint8_t)i;
+        if ((atomQueuePutMulti (&queue1, 0, &msgs[0], 5, &count) != ATOM_OK) || (count != 5))
+        {
+            ATOMLOG (_STR("PutMulti 5\n"));
+            failures++;
+        }
+        if ((atomQueuePutMulti (&queue1, 0, &msgs[5], 5, &count) != ATOM_OK) || (count != 3))
+        {
+            ATOMLOG (_STR("PutMulti trunc\n"));
+            failures++;
+        }
+        tx_val += 8;
+
+        /* Queue is now full: check no block with timeout -1 */
+        if (atomQueuePutMulti (&queue1, -1, &msgs[0], 1, &count) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("PutMulti full\n"));
+            failures++;
+        }
+
+        /* Receive 6 */
+        if ((atomQueueGetMulti (&queue1, 0, &msgs[0], 6, &count) != ATOM_OK) || (count != 6))
+        {
+            ATOMLOG (_STR("GetMulti 6\n"));
+            failures++;
+        }
+        for (i = 0; i < 6; i++, rx_val++)
+        {
+            if (msgs[i] != rx_val)
+            {
+                ATOMLOG (_STR("Val%d\n"), (int)rx_val);
+                failures++;
+            }
+        }
+
+        /* Post 4, which wraps around the end of the storage */
+        for (i = 0; i < 4; i++)
+            msgs[i] = tx_val + (uint8_t)i;
+        if ((atomQueuePutMulti (&queue1, 0, &msgs[0], 4, &count) != ATOM_OK) || (count != 4))
+        {
+            ATOMLOG (_STR("PutMulti wrap\n"));
+            failures++;
+        }
+        tx_val += 4;
+
+        /* Ask for more than are stored, which also wraps */
+        if ((atomQueueGetMulti (&queue1, 0, &msgs[0], QUEUE_ENTRIES + 2, &count) != ATOM_OK) || (count != 6))
+        {
+            ATOMLOG (_STR("GetMulti wrap\n"));
+            failures++;
+        }
+        for (i = 0; i < 6; i++, rx_val++)
+        {
+            if (msgs[i] != rx_val)
+            {
+                ATOMLOG (_STR("Val%d\n"), (int)rx_val);
+                failures++;
+            }
+        }
+
+        /* Create a thread which will block in atomQueueGetMulti() */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Post a batch of 3, which should wake the thread */
+            msgs[0] = 0x11;
+            msgs[1] = 0x22;
+            msgs[2] = 0x33;
+            if ((atomQueuePutMulti (&queue1, 0, &msgs[0], 3, &count) != ATOM_OK) || (count != 3))
+            {
+                ATOMLOG (_STR("PutMulti wake\n"));
+                failures++;
+            }
+
+            /* Give the thread time to wake and check the batch */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+        }
+
+        /* Delete queue, test finished */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Blocks in atomQueueGetMulti() until the main thread posts a batch, then
+ * checks the whole batch was received in one call.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msgs[4];
+    uint32_t count;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block until a batch is posted */
+    if (atomQueueGetMulti (&queue1, 0, &msgs[0], 4, &count) != ATOM_OK)
+    {
+        g_result = 2;
+    }
+    else if ((count != 3) || (msgs[0] != 0x11) || (msgs[1] != 0x22) || (msgs[2] != 0x33))
+    {
+        g_result = 3;
+    }
+    else
+    {
+        g_result = 1;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
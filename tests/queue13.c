@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <string.h>
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Number of ticks to run each benchmark for */
+#define BENCH_TICKS         (SYSTEM_TICKS_PER_SEC/4)
+
+
+/* Queue storage, large enough for every configuration tested */
+static uint8_t queue_storage[32];
+
+
+/* Test configurations: message size and queue depth */
+static const uint8_t test_config[][2] =
+{
+    {1, 16},    /* Byte variants */
+    {2, 8},     /* Word variants */
+    {4, 4},     /* Long variants */
+    {4, 5},     /* Long variants, odd depth */
+    {1, 7},     /* Byte variants, odd depth */
+    {3, 5},     /* Generic calls only */
+    {8, 4}      /* Generic calls only */
+};
+#define NUM_CONFIGS         (sizeof(test_config) / sizeof(test_config[0]))
+
+
+/* Typed get/put variants, indexed by message size (NULL if none) */
+typedef uint8_t (*QUEUE_FUNC)(ATOM_QUEUE *qptr, int32_t timeout, uint8_t *msgptr);
+static const QUEUE_FUNC typed_get[5] = { NULL, atomQueueGet8, atomQueueGet16, NULL, atomQueueGet32 };
+static const QUEUE_FUNC typed_put[5] = { NULL, atomQueuePut8, atomQueuePut16, NULL, atomQueuePut32 };
+
+
+/* Forward declarations */
+static int test_queue (uint8_t unit_size, uint8_t depth);
+static int test_pattern (ATOM_QUEUE *qptr, uint8_t unit_size, uint8_t depth, QUEUE_FUNC put_fn, QUEUE_FUNC get_fn);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests the typed get and put variants used for queues of 1, 2 and 4
+ * byte messages, alongside the generic atomQueueGet() and atomQueuePut().
+ *
+ * For each configuration the queue is filled and drained several times
+ * with a distinct pattern, so that the insert and remove indices wrap at
+ * different offsets, checking every byte is received in FIFO order. This
+ * is done first with the generic calls and then with the typed variants
+ * where they exist, and the typed variants for the other message sizes are
+ * checked to reject the queue.
+ *
+ * If TESTS_LOG_BENCHMARKS is defined (LOG_BENCHMARKS=true in the STM8
+ * makefiles), the number of put/get pairs which can be made in a fixed
+ * period is also logged for each configuration, for both the generic calls
+ * and the typed variants, so that they can be compared on the target.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Test each configuration in turn */
+    for (i = 0; i < NUM_CONFIGS; i++)
+    {
+        failures += test_queue (test_config[i][0], test_config[i][1]);
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_queue
+ *
+ * Checks ordering through a queue of the given configuration using the
+ * generic and typed calls, and optionally logs their throughput.
+ *
+ * @param[in] unit_size Size of each message
+ * @param[in] depth Maximum number of messages in the queue
+ *
+ * @retval Number of failures
+ */
+static int test_queue (uint8_t unit_size, uint8_t depth)
+{
+    ATOM_QUEUE queue1;
+    QUEUE_FUNC put_fn, get_fn;
+    uint8_t msg[8];
+    uint8_t size;
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Find the typed variants for this message size, if there are some */
+    put_fn = (unit_size <= 4) ? typed_put[unit_size] : NULL;
+    get_fn = (unit_size <= 4) ? typed_get[unit_size] : NULL;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, &queue_storage[0], unit_size, depth) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating Q %d/%d\n"), (int)unit_size, (int)depth);
+        failures++;
+    }
+    else
+    {
+        /* Check ordering using the generic calls */
+        failures += test_pattern (&queue1, unit_size, depth, atomQueuePut, atomQueueGet);
+
+        /* Check ordering using the typed variants, if there are some */
+        if (put_fn != NULL)
+        {
+            failures += test_pattern (&queue1, unit_size, depth, put_fn, get_fn);
+        }
+
+        /* Typed variants for other message sizes should reject the queue */
+        for (size = 1; size <= 4; size++)
+        {
+            if ((size != unit_size) && (typed_put[size] != NULL))
+            {
+                if ((typed_put[size] (&queue1, -1, msg) != ATOM_ERR_PARAM)
+                    || (typed_get[size] (&queue1, -1, msg) != ATOM_ERR_PARAM))
+                {
+                    ATOMLOG (_STR("Size %d accepted %d/%d\n"), (int)size, (int)unit_size, (int)depth);
+                    failures++;
+                }
+            }
+        }
+
+        /* Check the queue is still empty */
+        if (atomQueueGet (&queue1, -1, msg) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Not empty %d/%d\n"), (int)unit_size, (int)depth);
+            failures++;
+        }
+
+#ifdef TESTS_LOG_BENCHMARKS
+        {
+            uint32_t end_time, num_msgs;
+            uint8_t typed;
+
+            /* Time the generic calls, then the typed variants if any */
+            for (typed = 0; (typed < 2) && ((typed == 0) || (put_fn != NULL)); typed++)
+            {
+
+                /* Wait for the start of a tick, then count put/get pairs */
+                end_time = atomTimeGet();
+                while (atomTimeGet() == end_time)
+                    ;
+                end_time = atomTimeGet() + BENCH_TICKS;
+                num_msgs = 0;
+                while (atomTimeGet() < end_time)
+                {
+                    if (typed)
+                    {
+                        (void)put_fn (&queue1, -1, msg);
+                        (void)get_fn (&queue1, -1, msg);
+                    }
+                    else
+                    {
+                        (void)atomQueuePut (&queue1, -1, msg);
+                        (void)atomQueueGet (&queue1, -1, msg);
+                    }
+                    num_msgs++;
+                }
+                ATOMLOG (_STR("Q %d/%d %c: %ld\n"), (int)unit_size, (int)depth,
+                         typed ? 'T' : 'G', (long)num_msgs);
+            }
+        }
+#endif
+
+        /* Delete queue */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+
+/**
+ * \b test_pattern
+ *
+ * Partially fills and drains the queue repeatedly using the passed put and
+ * get calls, so that the indices wrap in many places, checking that each
+ * message comes back intact and in FIFO order. Leaves the queue empty.
+ *
+ * @param[in] qptr Pointer to the (empty) queue to test
+ * @param[in] unit_size Size of each message
+ * @param[in] depth Maximum number of messages in the queue
+ * @param[in] put_fn Put call to use
+ * @param[in] get_fn Get call to use
+ *
+ * @retval Number of failures
+ */
+static int test_pattern (ATOM_QUEUE *qptr, uint8_t unit_size, uint8_t depth, QUEUE_FUNC put_fn, QUEUE_FUNC get_fn)
+{
+    uint8_t msg[8];
+    uint8_t pass, count, j, seq;
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    seq = 0;
+    for (pass = 0; (pass < 3 * depth) && (failures == 0); pass++)
+    {
+        /* Put a varying number of messages */
+        count = (pass % depth) + 1;
+        for (j = 0; j < count; j++)
+        {
+            memset (msg, seq + j, unit_size);
+            msg[unit_size - 1] = (uint8_t)~(seq + j);
+            if (put_fn (qptr, -1, msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Put %d/%d\n"), (int)unit_size, (int)depth);
+                failures++;
+            }
+        }
+
+        /* Get them back and check the pattern */
+        for (j = 0; j < count; j++)
+        {
+            if (get_fn (qptr, -1, msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Get %d/%d\n"), (int)unit_size, (int)depth);
+                failures++;
+            }
+            else if ((msg[0] != (uint8_t)(unit_size == 1 ? ~(seq + j) : (seq + j)))
+                || (msg[unit_size - 1] != (uint8_t)~(seq + j)))
+            {
+                ATOMLOG (_STR("Val %d/%d\n"), (int)unit_size, (int)depth);
+                failures++;
+            }
+        }
+        seq += count;
+    }
+
+    /* Check the queue is now empty */
+    if (get_fn (qptr, -1, msg) != ATOM_WOULDBLOCK)
+    {
+        ATOMLOG (_STR("Not empty %d/%d\n"), (int)unit_size, (int)depth);
+        failures++;
+    }
+
+    return failures;
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       4
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    2
+
+
+/* Test thread behaviours */
+#define TEST_RESERVE        0
+#define TEST_PUT            1
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint32_t queue1_storage[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result[NUM_TEST_THREADS];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static int fill_queue (void);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests that threads woken together when space or messages become
+ * available re-check the queue before using it.
+ *
+ * A thread blocked in atomQueueReserve() and a lower priority thread
+ * blocked in atomQueuePut() are both woken by one batch receive. The
+ * reserving thread takes its slot first and holds it for a while, so the
+ * putting thread must go back to waiting rather than write into the
+ * reserved slot, and both messages must arrive intact and in order.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i;
+    uint32_t msgs[QUEUE_ENTRIES], num_got;
+    static const uint32_t expected[QUEUE_ENTRIES] = { 3, 4, 0x55, 0x77 };
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, (uint8_t *)&queue1_storage[0], sizeof(uint32_t), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Fill the queue so that both threads block */
+        failures += fill_queue ();
+
+        /* Reserving thread has higher priority than the putting thread */
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            g_result[i] = 0;
+            if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO - 2 + i, test_thread_func, i,
+                  &test_thread_stack[i][TEST_THREAD_STACK_SIZE - 1],
+                  TEST_THREAD_STACK_SIZE) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error creating test thread %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Remove two messages, waking both threads */
+        if ((atomQueueGetMulti (&queue1, 0, (uint8_t *)&msgs[0], 2, &num_got) != ATOM_OK)
+            || (num_got != 2))
+        {
+            ATOMLOG (_STR("GetMulti\n"));
+            failures++;
+        }
+
+        /* Give the threads time to finish */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+        if ((g_result[TEST_RESERVE] != 1) || (g_result[TEST_PUT] != 1))
+        {
+            ATOMLOG (_STR("Thread results %d %d\n"), g_result[TEST_RESERVE], g_result[TEST_PUT]);
+            failures++;
+        }
+
+        /* Check the queue contents */
+        if ((atomQueueGetMulti (&queue1, -1, (uint8_t *)&msgs[0], QUEUE_ENTRIES, &num_got) != ATOM_OK)
+            || (num_got != QUEUE_ENTRIES))
+        {
+            ATOMLOG (_STR("Drain %d\n"), (int)num_got);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < QUEUE_ENTRIES; i++)
+            {
+                if (msgs[i] != expected[i])
+                {
+                    ATOMLOG (_STR("Msg%d %d\n"), i, (int)msgs[i]);
+                    failures++;
+                }
+            }
+        }
+
+        /* Delete queue, test finished */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check all threads */
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[i], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), i);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b fill_queue
+ *
+ * Fills the test queue with the messages 1 to QUEUE_ENTRIES.
+ *
+ * @retval Number of failures
+ */
+static int fill_queue (void)
+{
+    uint32_t msg;
+    int failures;
+
+    failures = 0;
+    for (msg = 1; msg <= QUEUE_ENTRIES; msg++)
+    {
+        if (atomQueuePut (&queue1, -1, (uint8_t *)&msg) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Fill %d\n"), (int)msg);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Blocks on the full queue, either reserving a slot (and holding it for a
+ * while before committing) or putting a message, depending on \c param.
+ * Sets g_result[param] to 1 on success.
+ *
+ * @param[in] param Test thread behaviour
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t *slot;
+    uint32_t msg;
+
+    switch (param)
+    {
+        case TEST_RESERVE:
+            /* Reserve a slot, fill it slowly and commit it */
+            if (atomQueueReserve (&queue1, 0, &slot) == ATOM_OK)
+            {
+                *(uint32_t *)slot = 0x55;
+                atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+                if (atomQueueCommit (&queue1) == ATOM_OK)
+                {
+                    g_result[param] = 1;
+                }
+            }
+            break;
+
+        case TEST_PUT:
+            /* Put a message, which must wait for the reservation */
+            msg = 0x77;
+            if (atomQueuePut (&queue1, 0, (uint8_t *)&msg) == ATOM_OK)
+            {
+                g_result[param] = 1;
+            }
+            break;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
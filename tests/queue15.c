@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atomqueue.h"
+#include "atomtests.h"
+
+
+/* Test queue size */
+#define QUEUE_ENTRIES       4
+
+
+/* Number of messages each test thread asks for */
+#define BATCH_SIZE          3
+
+
+/* Number of test threads */
+#define NUM_TEST_THREADS    4
+
+
+/* Test thread behaviours (even threads send, odd threads receive) */
+#define TEST_PUT1           0
+#define TEST_GET1           1
+#define TEST_PUT2           2
+#define TEST_GET2           3
+
+
+/* Test OS objects */
+static ATOM_QUEUE queue1;
+static uint32_t queue1_storage[QUEUE_ENTRIES];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile uint32_t g_count[NUM_TEST_THREADS];
+static volatile int g_done[NUM_TEST_THREADS];
+static volatile uint32_t g_got[NUM_TEST_THREADS][BATCH_SIZE];
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static int start_threads (int first);
+static int check_state (int first, uint32_t count1, int done2, uint32_t count2);
+static int check_msgs (uint32_t *msgs, const uint32_t *expected, uint32_t num_msgs);
+
+
+/**
+ * \b test_start
+ *
+ * Start queue test.
+ *
+ * This tests that several threads blocked in atomQueuePutMulti() or
+ * atomQueueGetMulti() do not overrun the queue when they are woken
+ * together but there is less space (or fewer messages) than they asked
+ * for.
+ *
+ * Two senders each ask to put a batch of BATCH_SIZE messages on a full
+ * queue, and two messages are removed. The higher priority sender takes
+ * the two free slots and the other must go back to waiting instead of
+ * returning early, until a later receive makes room for its whole batch.
+ * The same is then checked for two receivers on an empty queue.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i;
+    uint32_t msgs[QUEUE_ENTRIES], num_got, num_put;
+    static const uint32_t fill[QUEUE_ENTRIES] = { 1, 2, 3, 4 };
+    static const uint32_t exp_get1[QUEUE_ENTRIES] = { 3, 4, 0x10, 0x11 };
+    static const uint32_t exp_get2[BATCH_SIZE] = { 0x20, 0x21, 0x22 };
+    static const uint32_t exp_put1[2] = { 0x30, 0x31 };
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Create test queue */
+    if (atomQueueCreate (&queue1, (uint8_t *)&queue1_storage[0], sizeof(uint32_t), QUEUE_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test queue\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Fill the queue so that both senders block */
+        if ((atomQueuePutMulti (&queue1, -1, (uint8_t *)&fill[0], QUEUE_ENTRIES, &num_put) != ATOM_OK)
+            || (num_put != QUEUE_ENTRIES))
+        {
+            ATOMLOG (_STR("Fill\n"));
+            failures++;
+        }
+        failures += start_threads (TEST_PUT1);
+
+        /* Make room for two, which wakes both senders */
+        if ((atomQueueGetMulti (&queue1, -1, (uint8_t *)&msgs[0], 2, &num_got) != ATOM_OK)
+            || (num_got != 2))
+        {
+            ATOMLOG (_STR("Get1\n"));
+            failures++;
+        }
+
+        /* The first sender fills the space and the second keeps waiting */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        failures += check_state (TEST_PUT1, 2, FALSE, 0);
+
+        /* Make room for the whole of the second batch */
+        if ((atomQueueGetMulti (&queue1, -1, (uint8_t *)&msgs[0], QUEUE_ENTRIES, &num_got) != ATOM_OK)
+            || (num_got != QUEUE_ENTRIES))
+        {
+            ATOMLOG (_STR("Get2 %d\n"), (int)num_got);
+            failures++;
+        }
+        else
+        {
+            failures += check_msgs (msgs, exp_get1, QUEUE_ENTRIES);
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        failures += check_state (TEST_PUT1, 2, TRUE, BATCH_SIZE);
+
+        /* The second batch should be intact */
+        if ((atomQueueGetMulti (&queue1, -1, (uint8_t *)&msgs[0], QUEUE_ENTRIES, &num_got) != ATOM_OK)
+            || (num_got != BATCH_SIZE))
+        {
+            ATOMLOG (_STR("Get3 %d\n"), (int)num_got);
+            failures++;
+        }
+        else
+        {
+            failures += check_msgs (msgs, exp_get2, BATCH_SIZE);
+        }
+
+        /* Queue is now empty, so both receivers block */
+        failures += start_threads (TEST_GET1);
+
+        /* Post two messages, which wakes both receivers */
+        if ((atomQueuePutMulti (&queue1, -1, (uint8_t *)&exp_put1[0], 2, &num_put) != ATOM_OK)
+            || (num_put != 2))
+        {
+            ATOMLOG (_STR("Put1\n"));
+            failures++;
+        }
+
+        /* The first receiver takes both and the second keeps waiting */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        failures += check_state (TEST_GET1, 2, FALSE, 0);
+
+        /* Post the whole of the second batch */
+        if ((atomQueuePutMulti (&queue1, -1, (uint8_t *)&exp_get2[0], BATCH_SIZE, &num_put) != ATOM_OK)
+            || (num_put != BATCH_SIZE))
+        {
+            ATOMLOG (_STR("Put2\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        failures += check_state (TEST_GET1, 2, TRUE, BATCH_SIZE);
+
+        /* Check the receivers got the right messages */
+        for (i = 0; i < 2; i++)
+        {
+            msgs[i] = g_got[TEST_GET1][i];
+        }
+        failures += check_msgs (msgs, exp_put1, 2);
+        for (i = 0; i < BATCH_SIZE; i++)
+        {
+            msgs[i] = g_got[TEST_GET2][i];
+        }
+        failures += check_msgs (msgs, exp_get2, BATCH_SIZE);
+
+        /* Delete queue, test finished */
+        if (atomQueueDelete (&queue1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check all threads */
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            /* Check thread stack usage */
+            if (atomThreadStackCheck (&tcb[i], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow %d\n"), i);
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b start_threads
+ *
+ * Creates a pair of sending or receiving test threads, the first at a
+ * higher priority than the second.
+ *
+ * @param[in] first Behaviour of the first thread (TEST_PUT1 or TEST_GET1)
+ *
+ * @retval Number of failures
+ */
+static int start_threads (int first)
+{
+    int failures, i, thread;
+
+    failures = 0;
+    for (i = 0; i < 2; i++)
+    {
+        thread = first + (i * 2);
+        g_count[thread] = 0;
+        g_done[thread] = FALSE;
+        if (atomThreadCreate(&tcb[thread], TEST_THREAD_PRIO - 2 + i, test_thread_func, thread,
+              &test_thread_stack[thread][TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread %d\n"), thread);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+
+/**
+ * \b check_state
+ *
+ * Checks the progress of a pair of test threads.
+ *
+ * @param[in] first Behaviour of the first thread (TEST_PUT1 or TEST_GET1)
+ * @param[in] count1 Messages expected to have been handled by the first
+ * @param[in] done2 Whether the second thread should have returned
+ * @param[in] count2 Messages expected to have been handled by the second
+ *
+ * @retval Number of failures
+ */
+static int check_state (int first, uint32_t count1, int done2, uint32_t count2)
+{
+    int failures;
+
+    failures = 0;
+
+    /* Check the first thread got its share */
+    if ((g_done[first] != TRUE) || (g_count[first] != count1))
+    {
+        ATOMLOG (_STR("T%d %d %d\n"), first, g_done[first], (int)g_count[first]);
+        failures++;
+    }
+
+    /* Check the second thread has only returned when there was room */
+    if ((g_done[first + 2] != done2) || (g_count[first + 2] != count2))
+    {
+        ATOMLOG (_STR("T%d %d %d\n"), first + 2, g_done[first + 2], (int)g_count[first + 2]);
+        failures++;
+    }
+
+    /* Check the queue was never overfilled */
+    if (queue1.num_msgs_stored > queue1.max_num_msgs)
+    {
+        ATOMLOG (_STR("Stored %d\n"), (int)queue1.num_msgs_stored);
+        failures++;
+    }
+    return failures;
+}
+
+
+/**
+ * \b check_msgs
+ *
+ * Compares a list of received messages with those expected.
+ *
+ * @param[in] msgs Messages received
+ * @param[in] expected Messages expected
+ * @param[in] num_msgs Number of messages to compare
+ *
+ * @retval Number of failures
+ */
+static int check_msgs (uint32_t *msgs, const uint32_t *expected, uint32_t num_msgs)
+{
+    int failures;
+    uint32_t i;
+
+    failures = 0;
+    for (i = 0; i < num_msgs; i++)
+    {
+        if (msgs[i] != expected[i])
+        {
+            ATOMLOG (_STR("Msg%d %d\n"), (int)i, (int)msgs[i]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Makes a single batch send or receive of BATCH_SIZE messages on the
+ * test queue, depending on \c param, and records how many messages were
+ * handled.
+ *
+ * @param[in] param Test thread behaviour
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint32_t msgs[BATCH_SIZE], count, i;
+    uint8_t status;
+
+    if ((param == TEST_PUT1) || (param == TEST_PUT2))
+    {
+        /* Each sender has its own recognisable batch */
+        for (i = 0; i < BATCH_SIZE; i++)
+        {
+            msgs[i] = ((param == TEST_PUT1) ? 0x10 : 0x20) + i;
+        }
+        status = atomQueuePutMulti (&queue1, 0, (uint8_t *)&msgs[0], BATCH_SIZE, &count);
+    }
+    else
+    {
+        /* Receive and keep a copy of the messages */
+        status = atomQueueGetMulti (&queue1, 0, (uint8_t *)&msgs[0], BATCH_SIZE, &count);
+        for (i = 0; (status == ATOM_OK) && (i < count); i++)
+        {
+            g_got[param][i] = msgs[i];
+        }
+    }
+
+    /* Record the result */
+    if (status == ATOM_OK)
+    {
+        g_count[param] = count;
+        g_done[param] = TRUE;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
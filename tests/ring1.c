@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomring.h"
+#include "atomtests.h"
+
+
+/* Test ring size */
+#define RING_ENTRIES        8
+
+
+/* Test OS objects */
+static ATOM_RING ring1;
+static uint16_t ring1_storage[RING_ENTRIES];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start ring test.
+ *
+ * This tests basic operation of the lock-free ring buffer.
+ *
+ * Entries are put until the ring is full and then received, checking
+ * the capacity and FIFO ordering. We then check that a consumer thread
+ * blocking on an empty ring is woken by entries put from interrupt
+ * context (a timer callback), and that a blocking get times out
+ * correctly if nothing is put.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint16_t msg, i;
+    uint32_t start_time;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomRingCreate (&ring1, NULL, sizeof(uint16_t), RING_ENTRIES) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad buff ptr check\n"));
+        failures++;
+    }
+    if (atomRingCreate (&ring1, (uint8_t *)&ring1_storage[0], sizeof(uint16_t), 1) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad entries check\n"));
+        failures++;
+    }
+
+    /* Create test ring */
+    if (atomRingCreate (&ring1, (uint8_t *)&ring1_storage[0], sizeof(uint16_t), RING_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test ring\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Empty ring: check no block with timeout -1 */
+        if (atomRingGet (&ring1, -1, (uint8_t *)&msg) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Get empty\n"));
+            failures++;
+        }
+
+        /* Fill the ring, one slot is always kept free */
+        for (i = 0; i < RING_ENTRIES - 1; i++)
+        {
+            msg = 0x1000 + i;
+            if (atomRingPut (&ring1, (uint8_t *)&msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Put %d\n"), (int)i);
+                failures++;
+            }
+        }
+        if (atomRingPut (&ring1, (uint8_t *)&msg) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Put full\n"));
+            failures++;
+        }
+
+        /* Drain the ring and check ordering */
+        for (i = 0; i < RING_ENTRIES - 1; i++)
+        {
+            if (atomRingGet (&ring1, 0, (uint8_t *)&msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Get %d\n"), (int)i);
+                failures++;
+            }
+            else if (msg != 0x1000 + i)
+            {
+                ATOMLOG (_STR("Val%d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Check a blocking get times out */
+        start_time = atomTimeGet();
+        if (atomRingGet (&ring1, SYSTEM_TICKS_PER_SEC/10, (uint8_t *)&msg) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Get timeout\n"));
+            failures++;
+        }
+        else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+        {
+            ATOMLOG (_STR("Timeout early\n"));
+            failures++;
+        }
+
+        /* Create a consumer thread which will block on the empty ring */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Put some entries from interrupt context */
+            timer1.cb_func = testCallback;
+            timer1.cb_data = NULL;
+            timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+            if (atomTimerRegister (&timer1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error registering timer\n"));
+                failures++;
+            }
+
+            /* Give the callback and thread time to run */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+        }
+
+        /* Delete ring, test finished */
+        if (atomRingDelete (&ring1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Puts three entries on ring1 from interrupt context with atomRingPut(),
+ * as a receive ISR would. The consumer thread is blocked on the empty ring,
+ * so the first put should wake it, and the other two should be published
+ * without entering the kernel. The thread checks it receives all three in
+ * order and sets g_result.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    uint16_t msg;
+
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Put three entries, the first of which wakes the consumer */
+    for (msg = 0x2000; msg < 0x2003; msg++)
+    {
+        (void)atomRingPut (&ring1, (uint8_t *)&msg);
+    }
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Blocks on the empty ring until the timer callback puts entries, then
+ * checks all three entries are received in order.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint16_t msg, expected;
+    int result;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Receive the three entries, blocking for the first */
+    result = 1;
+    for (expected = 0x2000; expected < 0x2003; expected++)
+    {
+        if (atomRingGet (&ring1, 0, (uint8_t *)&msg) != ATOM_OK)
+        {
+            result = 2;
+            break;
+        }
+        else if (msg != expected)
+        {
+            result = 3;
+            break;
+        }
+    }
+    g_result = result;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
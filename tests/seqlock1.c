@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atomseqlock.h"
+#include "atomtests.h"
+
+
+/* Number of words in the protected snapshot */
+#define SNAP_WORDS          8
+
+
+/* Test phases */
+#define PHASE_ISR_WRITES    1
+#define PHASE_ISR_READS     2
+#define PHASE_DONE          3
+
+
+/* Protected state: every word holds the same value in a consistent snapshot */
+typedef struct snapshot
+{
+    uint16_t word[SNAP_WORDS];
+} SNAPSHOT;
+
+
+/* Test OS objects */
+static ATOM_SEQLOCK lock1;
+static SNAPSHOT lock1_storage[2];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile int g_phase;
+static volatile uint16_t g_isr_count;
+static volatile int g_isr_errors;
+static volatile int g_isr_seq_errors;
+static volatile uint8_t g_seq_base;
+
+
+/* Forward declarations */
+static void testCallback (POINTER cb_data);
+static int snapshotValid (SNAPSHOT *snap);
+
+
+/**
+ * \b test_start
+ *
+ * Start seqlock test.
+ *
+ * This tests basic operation of the seqlock.
+ *
+ * After checking a simple write and read, a timer callback (interrupt
+ * context) writes a new snapshot on every tick while this thread reads
+ * continuously, checking that no torn snapshot is ever returned and that
+ * the values only move forwards. The roles are then reversed, with this
+ * thread writing continuously and the timer callback reading, which must
+ * always see a consistent snapshot, with the sequence number of the last
+ * write completed before it even when it interrupts a write.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    SNAPSHOT snap;
+    uint16_t i, last, reads;
+    uint8_t seq1, seq2;
+    uint32_t end_time;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomSeqlockCreate (&lock1, NULL, sizeof(SNAPSHOT)) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad buff ptr check\n"));
+        failures++;
+    }
+    if (atomSeqlockCreate (&lock1, (uint8_t *)&lock1_storage[0], 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad size check\n"));
+        failures++;
+    }
+
+    /* Create test seqlock */
+    if (atomSeqlockCreate (&lock1, (uint8_t *)&lock1_storage[0], sizeof(SNAPSHOT)) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test seqlock\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Initial snapshot is cleared */
+        if ((atomSeqlockRead (&lock1, (uint8_t *)&snap, &seq1) != ATOM_OK)
+            || !snapshotValid (&snap) || (snap.word[0] != 0))
+        {
+            ATOMLOG (_STR("Initial read\n"));
+            failures++;
+        }
+
+        /* Write and read back, check the sequence number moves on */
+        for (i = 0; i < SNAP_WORDS; i++)
+        {
+            snap.word[i] = 0x1234;
+        }
+        if (atomSeqlockWrite (&lock1, (uint8_t *)&snap) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Write\n"));
+            failures++;
+        }
+        if ((atomSeqlockRead (&lock1, (uint8_t *)&snap, &seq2) != ATOM_OK)
+            || !snapshotValid (&snap) || (snap.word[0] != 0x1234))
+        {
+            ATOMLOG (_STR("Read back\n"));
+            failures++;
+        }
+        else if (seq2 != (uint8_t)((seq1 + 1) & 0x7F))
+        {
+            ATOMLOG (_STR("Seq %d after %d\n"), (int)seq2, (int)seq1);
+            failures++;
+        }
+
+        /* Restart the values from zero */
+        for (i = 0; i < SNAP_WORDS; i++)
+        {
+            snap.word[i] = 0;
+        }
+        (void)atomSeqlockWrite (&lock1, (uint8_t *)&snap);
+
+        /* Start the timer callback writing on every tick */
+        g_phase = PHASE_ISR_WRITES;
+        g_isr_count = 0;
+        g_isr_errors = 0;
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = 1;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+
+        /* Read continuously while the callback writes */
+        last = 0;
+        end_time = atomTimeGet() + (SYSTEM_TICKS_PER_SEC / 2);
+        while (atomTimeGet() < end_time)
+        {
+            (void)atomSeqlockRead (&lock1, (uint8_t *)&snap, NULL);
+            if (!snapshotValid (&snap))
+            {
+                ATOMLOG (_STR("Torn read %d\n"), (int)snap.word[0]);
+                failures++;
+                break;
+            }
+            if (snap.word[0] < last)
+            {
+                ATOMLOG (_STR("Went back %d\n"), (int)snap.word[0]);
+                failures++;
+                break;
+            }
+            last = snap.word[0];
+        }
+        if (last < (SYSTEM_TICKS_PER_SEC / 4))
+        {
+            ATOMLOG (_STR("Few writes %d\n"), (int)last);
+            failures++;
+        }
+
+        /**
+         * Now write continuously while the callback reads. The value i is
+         * written by the (i + 1)th write from here on.
+         */
+        (void)atomSeqlockRead (&lock1, (uint8_t *)&snap, &seq1);
+        g_seq_base = seq1;
+        g_isr_count = 0;
+        g_isr_seq_errors = 0;
+        g_phase = PHASE_ISR_READS;
+        i = 0;
+        end_time = atomTimeGet() + (SYSTEM_TICKS_PER_SEC / 2);
+        while (atomTimeGet() < end_time)
+        {
+            for (reads = 0; reads < SNAP_WORDS; reads++)
+            {
+                snap.word[reads] = i;
+            }
+            (void)atomSeqlockWrite (&lock1, (uint8_t *)&snap);
+            i++;
+        }
+        reads = g_isr_count;
+
+        /* Stop the callback */
+        g_phase = PHASE_DONE;
+        atomTimerDelay (2);
+        if (g_isr_errors)
+        {
+            ATOMLOG (_STR("ISR torn reads %d\n"), g_isr_errors);
+            failures++;
+        }
+        if (g_isr_seq_errors)
+        {
+            ATOMLOG (_STR("ISR seq errors %d\n"), g_isr_seq_errors);
+            failures++;
+        }
+        if (reads < (SYSTEM_TICKS_PER_SEC / 4))
+        {
+            ATOMLOG (_STR("Few ISR reads %d\n"), (int)reads);
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b snapshotValid
+ *
+ * Checks that all words of a snapshot hold the same value, as they do in
+ * every snapshot written by this test.
+ *
+ * @param[in] snap Pointer to snapshot
+ *
+ * @retval 1 Snapshot is consistent
+ * @retval 0 Snapshot is torn
+ */
+static int snapshotValid (SNAPSHOT *snap)
+{
+    int i;
+
+    for (i = 1; i < SNAP_WORDS; i++)
+    {
+        if (snap->word[i] != snap->word[0])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Acts as the interrupt-context side of the seqlock test on every tick.
+ * In the write phase it writes the next value of g_isr_count to every word
+ * of the snapshot while the test thread reads. In the read phase it reads
+ * while the thread writes. It can never be interrupted by the writer, so
+ * it expects each snapshot to be consistent, and the sequence number to
+ * match the write which produced it. It counts any failures, then
+ * re-registers itself for the next tick.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    SNAPSHOT snap;
+    uint8_t seq;
+    int i;
+
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    if (g_phase == PHASE_ISR_WRITES)
+    {
+        /* Write the next value to every word */
+        g_isr_count++;
+        for (i = 0; i < SNAP_WORDS; i++)
+        {
+            snap.word[i] = g_isr_count;
+        }
+        (void)atomSeqlockWrite (&lock1, (uint8_t *)&snap);
+    }
+    else if (g_phase == PHASE_ISR_READS)
+    {
+        /* The writer cannot run while we read, so this never retries */
+        (void)atomSeqlockRead (&lock1, (uint8_t *)&snap, &seq);
+        if (!snapshotValid (&snap))
+        {
+            g_isr_errors++;
+        }
+
+        /**
+         * Once the thread has completed a write, the sequence number must
+         * count the write which produced this snapshot, even if we
+         * interrupted the next one.
+         */
+        else if ((seq != g_seq_base)
+            && (seq != (uint8_t)((g_seq_base + snap.word[0] + 1) & 0x7F)))
+        {
+            g_isr_seq_errors++;
+        }
+        g_isr_count++;
+    }
+
+    /* Run again on the next tick until the test is finished */
+    if (g_phase != PHASE_DONE)
+    {
+        timer1.cb_ticks = 1;
+        (void)atomTimerRegister (&timer1);
+    }
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomstream.h"
+#include "atomtests.h"
+
+
+/* Test buffer size and trigger level */
+#define STREAM_SIZE         16
+#define STREAM_TRIGGER      4
+
+
+/* Test OS objects */
+static ATOM_STREAM stream1;
+static uint8_t stream1_storage[STREAM_SIZE];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start stream buffer test.
+ *
+ * This tests basic operation of stream buffers.
+ *
+ * Bytes are sent until the buffer is full, checking that only as many as
+ * fit are accepted, and then received in pieces across the wrap point. We
+ * then check that a receiver blocking on the buffer is not woken until the
+ * trigger level is reached, and that a blocking receive which times out
+ * below the trigger level still returns the bytes which were stored.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t data[STREAM_SIZE + 4];
+    uint16_t count, i;
+    uint32_t start_time;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomStreamCreate (&stream1, &stream1_storage[0], STREAM_SIZE, 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad trigger check\n"));
+        failures++;
+    }
+    if (atomStreamCreate (&stream1, &stream1_storage[0], STREAM_SIZE, STREAM_SIZE + 1) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Big trigger check\n"));
+        failures++;
+    }
+
+    /* Create test stream */
+    if (atomStreamCreate (&stream1, &stream1_storage[0], STREAM_SIZE, STREAM_TRIGGER) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test stream\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Empty stream: check no block with timeout -1 */
+        if (atomStreamReceive (&stream1, -1, data, sizeof(data), &count) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Receive empty\n"));
+            failures++;
+        }
+
+        /* Message buffer calls are not allowed on a stream */
+        if (atomStreamMsgSend (&stream1, -1, data, 1) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Mode check\n"));
+            failures++;
+        }
+
+        /* Offer more bytes than fit, check only the free space is used */
+        for (i = 0; i < sizeof(data); i++)
+        {
+            data[i] = (uint8_t)i;
+        }
+        if ((atomStreamSend (&stream1, -1, data, 10, &count) != ATOM_OK) || (count != 10))
+        {
+            ATOMLOG (_STR("Send 10\n"));
+            failures++;
+        }
+        if ((atomStreamSend (&stream1, -1, &data[10], 10, &count) != ATOM_OK) || (count != 6))
+        {
+            ATOMLOG (_STR("Send partial\n"));
+            failures++;
+        }
+        if (atomStreamSend (&stream1, -1, data, 1, &count) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Send full\n"));
+            failures++;
+        }
+
+        /* Read back part of the data, then wrap round with a new write */
+        if ((atomStreamReceive (&stream1, 0, data, 12, &count) != ATOM_OK) || (count != 12))
+        {
+            ATOMLOG (_STR("Receive 12\n"));
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < 12; i++)
+            {
+                if (data[i] != i)
+                {
+                    ATOMLOG (_STR("Val%d\n"), (int)i);
+                    failures++;
+                }
+                data[i] = (uint8_t)(16 + i);
+            }
+        }
+        if ((atomStreamSend (&stream1, -1, data, 8, &count) != ATOM_OK) || (count != 8))
+        {
+            ATOMLOG (_STR("Send wrap\n"));
+            failures++;
+        }
+        if ((atomStreamReceive (&stream1, 0, data, sizeof(data), &count) != ATOM_OK) || (count != 12))
+        {
+            ATOMLOG (_STR("Receive wrap %d\n"), (int)count);
+            failures++;
+        }
+        else
+        {
+            for (i = 0; i < 12; i++)
+            {
+                if (data[i] != 12 + i)
+                {
+                    ATOMLOG (_STR("Wrap val%d\n"), (int)i);
+                    failures++;
+                }
+            }
+        }
+
+        /* Check a receive below the trigger level returns what is stored */
+        data[0] = 0x55;
+        (void)atomStreamSend (&stream1, -1, data, 1, &count);
+        start_time = atomTimeGet();
+        if ((atomStreamReceive (&stream1, SYSTEM_TICKS_PER_SEC/10, data, sizeof(data), &count) != ATOM_OK)
+            || (count != 1) || (data[0] != 0x55))
+        {
+            ATOMLOG (_STR("Receive partial\n"));
+            failures++;
+        }
+        else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+        {
+            ATOMLOG (_STR("Partial early\n"));
+            failures++;
+        }
+
+        /* Check a receive on an empty stream times out */
+        if (atomStreamReceive (&stream1, SYSTEM_TICKS_PER_SEC/10, data, sizeof(data), &count) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Receive timeout\n"));
+            failures++;
+        }
+
+        /* Create a receiver thread which will block on the empty stream */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+            /* Send less than the trigger level, thread should stay blocked */
+            data[0] = 1;
+            data[1] = 2;
+            (void)atomStreamSend (&stream1, -1, data, 2, &count);
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 0)
+            {
+                ATOMLOG (_STR("Woken early\n"));
+                failures++;
+            }
+
+            /* Reach the trigger level, thread should now receive */
+            data[0] = 3;
+            data[1] = 4;
+            (void)atomStreamSend (&stream1, -1, data, 2, &count);
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+        }
+
+        /* Delete stream, test finished */
+        if (atomStreamDelete (&stream1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Blocks on the empty stream and checks that all four bytes sent in two
+ * pieces are received together once the trigger level is reached.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t data[8];
+    uint16_t count;
+    int result;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Block until the trigger level is reached */
+    if (atomStreamReceive (&stream1, 0, data, sizeof(data), &count) != ATOM_OK)
+    {
+        result = 2;
+    }
+    else if ((count != 4) || (data[0] != 1) || (data[3] != 4))
+    {
+        result = 3;
+    }
+    else
+    {
+        result = 1;
+    }
+    g_result = result;
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
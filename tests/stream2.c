@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atom.h"
+#include "atomstream.h"
+#include "atomtests.h"
+
+
+/* Test buffer size */
+#define MSGBUF_SIZE         20
+
+
+/* Test OS objects */
+static ATOM_STREAM msgbuf1;
+static uint8_t msgbuf1_storage[MSGBUF_SIZE];
+static ATOM_TCB tcb1;
+static uint8_t test_thread_stack[TEST_THREAD_STACK_SIZE];
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+
+
+/**
+ * \b test_start
+ *
+ * Start message buffer test.
+ *
+ * This tests basic operation of message buffers.
+ *
+ * Variable length messages are sent and received, checking that message
+ * boundaries are preserved, that a message larger than the receiver's
+ * buffer is left in place, and that a message is only accepted if it fits
+ * whole. We then check that a sender blocking for space is woken once
+ * enough space has been freed by a receive.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    uint8_t msg[MSGBUF_SIZE];
+    uint16_t len, i;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomStreamMsgCreate (&msgbuf1, &msgbuf1_storage[0], ATOM_STREAM_MSG_HDR_SIZE) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad size check\n"));
+        failures++;
+    }
+
+    /* Create test message buffer */
+    if (atomStreamMsgCreate (&msgbuf1, &msgbuf1_storage[0], MSGBUF_SIZE) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test msgbuf\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Empty buffer: check no block with timeout -1 */
+        if (atomStreamMsgReceive (&msgbuf1, -1, msg, sizeof(msg), &len) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Receive empty\n"));
+            failures++;
+        }
+
+        /* Check messages which can never fit are rejected */
+        if (atomStreamMsgSend (&msgbuf1, 0, msg, MSGBUF_SIZE - ATOM_STREAM_MSG_HDR_SIZE + 1) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Oversize check\n"));
+            failures++;
+        }
+
+        /* Send a 5 byte and a 3 byte message, using 12 bytes */
+        for (i = 0; i < 5; i++)
+        {
+            msg[i] = (uint8_t)(0x10 + i);
+        }
+        if (atomStreamMsgSend (&msgbuf1, -1, msg, 5) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Send 5\n"));
+            failures++;
+        }
+        for (i = 0; i < 3; i++)
+        {
+            msg[i] = (uint8_t)(0x20 + i);
+        }
+        if (atomStreamMsgSend (&msgbuf1, -1, msg, 3) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Send 3\n"));
+            failures++;
+        }
+
+        /* A 7 byte message needs 9 bytes and must not be split */
+        if (atomStreamMsgSend (&msgbuf1, -1, msg, 7) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Send full\n"));
+            failures++;
+        }
+
+        /* Receive into a short buffer, the message must be left in place */
+        if ((atomStreamMsgReceive (&msgbuf1, -1, msg, 2, &len) != ATOM_ERR_OVF) || (len != 5))
+        {
+            ATOMLOG (_STR("Receive short\n"));
+            failures++;
+        }
+
+        /* Create a sender thread which will block for space */
+        g_result = 0;
+        if (atomThreadCreate(&tcb1, TEST_THREAD_PRIO, test_thread_func, 0,
+              &test_thread_stack[TEST_THREAD_STACK_SIZE - 1],
+              TEST_THREAD_STACK_SIZE) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating test thread\n"));
+            failures++;
+        }
+        else
+        {
+            /* Give the thread time to start blocking */
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 0)
+            {
+                ATOMLOG (_STR("Sent early\n"));
+                failures++;
+            }
+
+            /* Receive the first message, freeing space for the thread */
+            if ((atomStreamMsgReceive (&msgbuf1, 0, msg, sizeof(msg), &len) != ATOM_OK)
+                || (len != 5) || (msg[0] != 0x10) || (msg[4] != 0x14))
+            {
+                ATOMLOG (_STR("Receive 5\n"));
+                failures++;
+            }
+            atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+            if (g_result != 1)
+            {
+                ATOMLOG (_STR("Thread result %d\n"), g_result);
+                failures++;
+            }
+
+            /* Check the remaining messages arrive intact and in order */
+            if ((atomStreamMsgReceive (&msgbuf1, 0, msg, sizeof(msg), &len) != ATOM_OK)
+                || (len != 3) || (msg[0] != 0x20) || (msg[2] != 0x22))
+            {
+                ATOMLOG (_STR("Receive 3\n"));
+                failures++;
+            }
+            if ((atomStreamMsgReceive (&msgbuf1, 0, msg, sizeof(msg), &len) != ATOM_OK)
+                || (len != 10))
+            {
+                ATOMLOG (_STR("Receive 10\n"));
+                failures++;
+            }
+            else
+            {
+                for (i = 0; i < 10; i++)
+                {
+                    if (msg[i] != 0x30 + i)
+                    {
+                        ATOMLOG (_STR("Val%d\n"), (int)i);
+                        failures++;
+                    }
+                }
+            }
+        }
+
+        /* Delete message buffer, test finished */
+        if (atomStreamDelete (&msgbuf1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb1, &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test thread.
+ *
+ * Sends a 10 byte message, which needs 12 bytes of space and so blocks
+ * until the test thread receives the first message.
+ *
+ * @param[in] param Unused (optional thread entry parameter)
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    uint8_t msg[10];
+    uint8_t i;
+
+    /* Compiler warnings */
+    param = param;
+
+    /* Send a message which does not currently fit */
+    for (i = 0; i < sizeof(msg); i++)
+    {
+        msg[i] = (uint8_t)(0x30 + i);
+    }
+    if (atomStreamMsgSend (&msgbuf1, 0, msg, sizeof(msg)) != ATOM_OK)
+    {
+        g_result = 2;
+    }
+    else
+    {
+        g_result = 1;
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
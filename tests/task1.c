@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomtask.h"
+#include "atomtests.h"
+
+
+/* Max number of task runs logged */
+#define LOG_SIZE            16
+
+/* Number of times the reposting task runs, more than a semaphore can count */
+#define REPOST_RUNS         300
+
+
+/* Test OS objects */
+static ATOM_TASK task_low, task_mid, task_high, task_bg, task_repost;
+static uint8_t executor_stack[TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile char g_log[LOG_SIZE + 1];
+static volatile int g_log_idx;
+static volatile int g_nest;
+static volatile int g_repost_runs;
+static volatile int g_repost_errors;
+
+
+/* Forward declarations */
+static void task_func (POINTER arg);
+static void low_task_func (POINTER arg);
+static void repost_task_func (POINTER arg);
+static void testCallback (POINTER cb_data);
+static int check_log (const char *expected);
+
+
+/**
+ * \b test_start
+ *
+ * Start run-to-completion task test.
+ *
+ * Tasks of three priorities are posted together from interrupt context,
+ * checking that they run in priority order, and one of them three times
+ * checking that each post is run. A task posted from a thread of lower
+ * priority than the executor must run before the post returns. Finally a
+ * low priority task posts a higher priority task, which must run nested
+ * within it, and a lower priority task, which must wait for it to finish.
+ * Finally a task reposts itself more times than the executor's wake
+ * semaphore can count, checking every post succeeds.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check bad parameters */
+    if ((atomTaskCreate (NULL, 0, task_func, NULL) != ATOM_ERR_PARAM)
+        || (atomTaskCreate (&task_low, 0, NULL, NULL) != ATOM_ERR_PARAM)
+        || (atomTaskPost (NULL) != ATOM_ERR_PARAM))
+    {
+        ATOMLOG (_STR("Bad param check\n"));
+        failures++;
+    }
+
+    /* Start the executor above our priority, and create the tasks */
+    if ((atomTaskInit (&executor_stack[TEST_THREAD_STACK_SIZE - 1],
+            TEST_THREAD_STACK_SIZE, TEST_THREAD_PRIO - 1) != ATOM_OK)
+        || (atomTaskCreate (&task_low, 20, low_task_func, (POINTER)'L') != ATOM_OK)
+        || (atomTaskCreate (&task_mid, 10, task_func, (POINTER)'M') != ATOM_OK)
+        || (atomTaskCreate (&task_high, 5, task_func, (POINTER)'H') != ATOM_OK)
+        || (atomTaskCreate (&task_bg, 30, task_func, (POINTER)'B') != ATOM_OK)
+        || (atomTaskCreate (&task_repost, 15, repost_task_func, NULL) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating tasks\n"));
+        failures++;
+    }
+    else
+    {
+        /* Post from interrupt context in reverse priority order */
+        g_log_idx = 0;
+        g_nest = FALSE;
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = 2;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+        atomTimerDelay (5);
+        if (check_log ("HMMML") == FALSE)
+        {
+            ATOMLOG (_STR("Priority order\n"));
+            failures++;
+        }
+
+        /* Post from this thread, the executor preempts us */
+        g_log_idx = 0;
+        if ((atomTaskPost (&task_mid) != ATOM_OK) || (check_log ("M") == FALSE))
+        {
+            ATOMLOG (_STR("Thread post\n"));
+            failures++;
+        }
+
+        /* Post from a task, higher priority nests and lower waits */
+        g_log_idx = 0;
+        g_nest = TRUE;
+        if ((atomTaskPost (&task_low) != ATOM_OK) || (check_log ("LHlB") == FALSE))
+        {
+            ATOMLOG (_STR("Nested post\n"));
+            failures++;
+        }
+
+        /* The reposting task runs REPOST_RUNS times before we continue */
+        g_repost_runs = 0;
+        g_repost_errors = 0;
+        if ((atomTaskPost (&task_repost) != ATOM_OK)
+            || (g_repost_runs != REPOST_RUNS) || (g_repost_errors != 0))
+        {
+            ATOMLOG (_STR("Repost %d %d\n"), g_repost_runs, g_repost_errors);
+            failures++;
+        }
+    }
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b check_log
+ *
+ * Compares the log of task runs with the expected sequence.
+ *
+ * @param[in] expected Expected sequence of task IDs
+ *
+ * @retval TRUE if the log matches
+ */
+static int check_log (const char *expected)
+{
+    int i;
+
+    for (i = 0; expected[i]; i++)
+    {
+        if ((i >= g_log_idx) || (g_log[i] != expected[i]))
+        {
+            return FALSE;
+        }
+    }
+    return (i == g_log_idx) ? TRUE : FALSE;
+}
+
+
+/**
+ * \b task_func
+ *
+ * Task function, logs the task's ID.
+ *
+ * @param[in] arg Task ID
+ *
+ * @return None
+ */
+static void task_func (POINTER arg)
+{
+    if (g_log_idx < LOG_SIZE)
+    {
+        g_log[g_log_idx++] = (char)(uint32_t)arg;
+    }
+}
+
+
+/**
+ * \b low_task_func
+ *
+ * Low priority task function. Logs its ID, and in the nesting test posts
+ * a higher and a lower priority task before logging completion.
+ *
+ * @param[in] arg Task ID
+ *
+ * @return None
+ */
+static void low_task_func (POINTER arg)
+{
+    task_func (arg);
+    if (g_nest == TRUE)
+    {
+        (void)atomTaskPost (&task_bg);
+        (void)atomTaskPost (&task_high);
+        task_func ((POINTER)'l');
+    }
+}
+
+
+/**
+ * \b repost_task_func
+ *
+ * Reposts its own task until it has run REPOST_RUNS times, counting any
+ * failed posts.
+ *
+ * @param[in] arg Unused
+ *
+ * @return None
+ */
+static void repost_task_func (POINTER arg)
+{
+    /* Compiler warnings */
+    arg = arg;
+
+    if ((++g_repost_runs < REPOST_RUNS) && (atomTaskPost (&task_repost) != ATOM_OK))
+    {
+        g_repost_errors++;
+    }
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Posts task_low, task_mid three times, then task_high from interrupt
+ * context, in reverse priority order. None can run until the callback
+ * returns, after which the executor should run them highest priority
+ * first, with task_mid once per post, logging "HMMML".
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    (void)atomTaskPost (&task_low);
+    (void)atomTaskPost (&task_mid);
+    (void)atomTaskPost (&task_mid);
+    (void)atomTaskPost (&task_mid);
+    (void)atomTaskPost (&task_high);
+}
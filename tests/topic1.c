@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "atom.h"
+#include "atomtopic.h"
+#include "atomtests.h"
+
+
+/* Test topic size */
+#define TOPIC_ENTRIES       4
+
+
+/* Number of subscriber threads */
+#define NUM_TEST_THREADS    2
+
+
+/* Test OS objects */
+static ATOM_TOPIC topic1;
+static uint16_t topic1_storage[TOPIC_ENTRIES];
+static ATOM_TOPIC_SUB thread_sub[NUM_TEST_THREADS];
+static ATOM_TCB tcb[NUM_TEST_THREADS];
+static uint8_t test_thread_stack[NUM_TEST_THREADS][TEST_THREAD_STACK_SIZE];
+static ATOM_TIMER timer1;
+
+
+/* Test result tracking */
+static volatile int g_result;
+
+
+/* Forward declarations */
+static void test_thread_func (uint32_t param);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start topic test.
+ *
+ * This tests basic operation of publish/subscribe topics.
+ *
+ * Two subscribers check that each receives every published message, and
+ * that a subscriber which falls behind is resynchronised to the oldest
+ * message held with the correct lost count. We then check that a blocking
+ * read times out, that two threads blocked on the topic are both woken by
+ * a single publish from interrupt context, and that deleting the topic
+ * wakes blocked readers with ATOM_ERR_DELETED.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures;
+    ATOM_TOPIC_SUB sub1, sub2;
+    uint16_t msg, i;
+    uint32_t lost, start_time;
+
+    /* Default to zero failures */
+    failures = 0;
+
+    /* Check creation parameters */
+    if (atomTopicCreate (&topic1, NULL, sizeof(uint16_t), TOPIC_ENTRIES) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad buff ptr check\n"));
+        failures++;
+    }
+    if (atomTopicCreate (&topic1, (uint8_t *)&topic1_storage[0], sizeof(uint16_t), 0) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad entries check\n"));
+        failures++;
+    }
+
+    /* Create test topic */
+    if (atomTopicCreate (&topic1, (uint8_t *)&topic1_storage[0], sizeof(uint16_t), TOPIC_ENTRIES) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating test topic\n"));
+        failures++;
+    }
+
+    else
+    {
+        /* Messages published before subscribing are not seen */
+        msg = 0x0100;
+        (void)atomTopicPublish (&topic1, (uint8_t *)&msg);
+
+        /* Attach two subscribers */
+        if ((atomTopicSubscribe (&topic1, &sub1) != ATOM_OK)
+            || (atomTopicSubscribe (&topic1, &sub2) != ATOM_OK))
+        {
+            ATOMLOG (_STR("Subscribe\n"));
+            failures++;
+        }
+
+        /* Nothing new: check no block with timeout -1 */
+        if (atomTopicRead (&sub1, -1, (uint8_t *)&msg, &lost) != ATOM_WOULDBLOCK)
+        {
+            ATOMLOG (_STR("Read empty\n"));
+            failures++;
+        }
+
+        /* Publish once, both subscribers receive each message */
+        for (i = 0; i < TOPIC_ENTRIES - 1; i++)
+        {
+            msg = 0x1000 + i;
+            if (atomTopicPublish (&topic1, (uint8_t *)&msg) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Publish %d\n"), (int)i);
+                failures++;
+            }
+        }
+        for (i = 0; i < TOPIC_ENTRIES - 1; i++)
+        {
+            if ((atomTopicRead (&sub1, -1, (uint8_t *)&msg, &lost) != ATOM_OK)
+                || (msg != 0x1000 + i) || (lost != 0))
+            {
+                ATOMLOG (_STR("Sub1 read %d\n"), (int)i);
+                failures++;
+            }
+            if ((atomTopicRead (&sub2, -1, (uint8_t *)&msg, &lost) != ATOM_OK)
+                || (msg != 0x1000 + i) || (lost != 0))
+            {
+                ATOMLOG (_STR("Sub2 read %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Overrun sub1 while sub2 keeps up */
+        for (i = 0; i < TOPIC_ENTRIES + 2; i++)
+        {
+            msg = 0x2000 + i;
+            (void)atomTopicPublish (&topic1, (uint8_t *)&msg);
+            if ((atomTopicRead (&sub2, -1, (uint8_t *)&msg, &lost) != ATOM_OK)
+                || (msg != 0x2000 + i) || (lost != 0))
+            {
+                ATOMLOG (_STR("Sub2 keep up %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Slow subscriber resumes at the oldest message held */
+        if (atomTopicRead (&sub1, -1, (uint8_t *)&msg, &lost) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Overrun read\n"));
+            failures++;
+        }
+        else if ((lost != 2) || (msg != 0x2002))
+        {
+            ATOMLOG (_STR("Overrun lost %d msg %d\n"), (int)lost, (int)msg);
+            failures++;
+        }
+        for (i = 3; i < TOPIC_ENTRIES + 2; i++)
+        {
+            if ((atomTopicRead (&sub1, -1, (uint8_t *)&msg, &lost) != ATOM_OK)
+                || (msg != 0x2000 + i) || (lost != 0))
+            {
+                ATOMLOG (_STR("Overrun drain %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Check a blocking read times out */
+        start_time = atomTimeGet();
+        if (atomTopicRead (&sub1, SYSTEM_TICKS_PER_SEC/10, (uint8_t *)&msg, &lost) != ATOM_TIMEOUT)
+        {
+            ATOMLOG (_STR("Read timeout\n"));
+            failures++;
+        }
+        else if ((atomTimeGet() - start_time) < SYSTEM_TICKS_PER_SEC/10)
+        {
+            ATOMLOG (_STR("Timeout early\n"));
+            failures++;
+        }
+
+        /* Create subscriber threads which will block on the topic */
+        g_result = 0;
+        for (i = 0; i < NUM_TEST_THREADS; i++)
+        {
+            if (atomThreadCreate(&tcb[i], TEST_THREAD_PRIO, test_thread_func, i,
+                  &test_thread_stack[i][TEST_THREAD_STACK_SIZE - 1],
+                  TEST_THREAD_STACK_SIZE) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Error creating test thread %d\n"), (int)i);
+                failures++;
+            }
+        }
+
+        /* Give the threads time to start blocking */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+
+        /* Publish one message from interrupt context */
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+
+        /* Give the callback and threads time to run */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/2);
+        if (g_result != 0x03)
+        {
+            ATOMLOG (_STR("Publish result %d\n"), g_result);
+            failures++;
+        }
+
+        /* Delete topic, which should wake both threads */
+        if (atomTopicDelete (&topic1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+
+        /* Give the threads time to run */
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/4);
+        if (g_result != 0x0F)
+        {
+            ATOMLOG (_STR("Delete result %d\n"), g_result);
+            failures++;
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        if (atomThreadStackCheck (&tcb[0], &used_bytes, &free_bytes) != ATOM_OK)
+        {
+            ATOMLOG (_STR("StackCheck\n"));
+            failures++;
+        }
+        else
+        {
+            /* Check the thread did not use up to the end of stack */
+            if (free_bytes == 0)
+            {
+                ATOMLOG (_STR("StackOverflow\n"));
+                failures++;
+            }
+
+            /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+            ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Publishes a single message (0x3000) to topic1 from interrupt context.
+ * Both test threads are blocked reading their subscriptions, and this one
+ * publish should wake both, each receiving the message with nothing lost.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    uint16_t msg;
+
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* One publish wakes every waiting subscriber */
+    msg = 0x3000;
+    (void)atomTopicPublish (&topic1, (uint8_t *)&msg);
+}
+
+
+/**
+ * \b test_thread_func
+ *
+ * Entry point for test threads.
+ *
+ * Subscribes and blocks until the timer callback publishes, then blocks
+ * again until the topic is deleted. Each step sets a result bit for this
+ * thread in g_result.
+ *
+ * @param[in] param Thread number
+ *
+ * @return None
+ */
+static void test_thread_func (uint32_t param)
+{
+    ATOM_TOPIC_SUB *sub;
+    uint16_t msg;
+    uint32_t lost;
+    CRITICAL_STORE;
+
+    /* Subscribe to messages from now on */
+    sub = &thread_sub[param];
+    if (atomTopicSubscribe (&topic1, sub) == ATOM_OK)
+    {
+        /* Block until the timer callback publishes */
+        if ((atomTopicRead (sub, 0, (uint8_t *)&msg, &lost) == ATOM_OK)
+            && (msg == 0x3000) && (lost == 0))
+        {
+            CRITICAL_START ();
+            g_result |= (1 << param);
+            CRITICAL_END ();
+        }
+
+        /* Block again until the topic is deleted */
+        if (atomTopicRead (sub, 0, (uint8_t *)&msg, &lost) == ATOM_ERR_DELETED)
+        {
+            CRITICAL_START ();
+            g_result |= (1 << (param + NUM_TEST_THREADS));
+            CRITICAL_END ();
+        }
+    }
+
+    /* Loop forever */
+    while (1)
+    {
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC);
+    }
+}
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2010, Kelvin Lawson. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. No personal names or organizations' names associated with the
+ *    Atomthreads project may be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE ATOMTHREADS PROJECT AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "atom.h"
+#include "atomsem.h"
+#include "atomworkq.h"
+#include "atomtests.h"
+
+
+/* Pool dimensions */
+#define NUM_WORKERS         2
+#define MAX_JOBS            8
+
+
+/* Test OS objects */
+static ATOM_WORKQ wq1;
+static ATOM_WORK wq1_jobs[MAX_JOBS];
+static ATOM_TCB worker_tcbs[NUM_WORKERS];
+static uint8_t worker_stacks[NUM_WORKERS * TEST_THREAD_STACK_SIZE];
+static ATOM_SEM done_sem, block_sem;
+static ATOM_TIMER timer1;
+
+
+/* Job arguments */
+static int values[4] = { 1, 2, 4, 8 };
+
+
+/* Test result tracking */
+static volatile int g_sum;
+
+
+/* Forward declarations */
+static void add_job (POINTER arg);
+static void block_job (POINTER arg);
+static void testCallback (POINTER cb_data);
+
+
+/**
+ * \b test_start
+ *
+ * Start work queue test.
+ *
+ * This tests basic operation of worker thread pools.
+ *
+ * Jobs are submitted from thread context and from interrupt context (a
+ * timer callback), checking that each job runs once and its completion
+ * semaphore is put. Blocking jobs are used to occupy all of the workers
+ * so that jobs are left pending, and the statistics are checked. Finally
+ * the pool is deleted and the workers are checked to have exited. The pool
+ * is then recreated with higher priority workers, checking that a job they
+ * take straight away is still counted in the high-water mark.
+ *
+ * @retval Number of failures
+ */
+uint32_t test_start (void)
+{
+    int failures, i;
+    ATOM_WORKQ_STATS stats;
+
+    /* Default to zero failures */
+    failures = 0;
+    g_sum = 0;
+
+    /* Check creation parameters */
+    if (atomWorkQCreate (&wq1, &wq1_jobs[0], MAX_JOBS, NULL, &worker_stacks[0],
+            TEST_THREAD_STACK_SIZE, NUM_WORKERS, TEST_THREAD_PRIO) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad TCB check\n"));
+        failures++;
+    }
+    if (atomWorkQCreate (&wq1, NULL, MAX_JOBS, &worker_tcbs[0], &worker_stacks[0],
+            TEST_THREAD_STACK_SIZE, NUM_WORKERS, TEST_THREAD_PRIO) != ATOM_ERR_PARAM)
+    {
+        ATOMLOG (_STR("Bad job buff check\n"));
+        failures++;
+    }
+
+    /* Create semaphores and the test pool */
+    if ((atomSemCreate (&done_sem, 0) != ATOM_OK)
+        || (atomSemCreate (&block_sem, 0) != ATOM_OK))
+    {
+        ATOMLOG (_STR("Error creating semaphores\n"));
+        failures++;
+    }
+    else if (atomWorkQCreate (&wq1, &wq1_jobs[0], MAX_JOBS, &worker_tcbs[0],
+            &worker_stacks[0], TEST_THREAD_STACK_SIZE, NUM_WORKERS,
+            TEST_THREAD_PRIO) != ATOM_OK)
+    {
+        ATOMLOG (_STR("Error creating pool\n"));
+        failures++;
+    }
+    else
+    {
+        /* Check bad job parameters */
+        if (atomWorkQSubmit (&wq1, 0, NULL, NULL, NULL) != ATOM_ERR_PARAM)
+        {
+            ATOMLOG (_STR("Bad func check\n"));
+            failures++;
+        }
+
+        /* Submit jobs from thread context */
+        for (i = 0; i < 4; i++)
+        {
+            if (atomWorkQSubmit (&wq1, 0, add_job, &values[i], &done_sem) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Submit %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Wait for them all to complete */
+        for (i = 0; i < 4; i++)
+        {
+            if (atomSemGet (&done_sem, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Done %d\n"), i);
+                failures++;
+            }
+        }
+        if (g_sum != 15)
+        {
+            ATOMLOG (_STR("Sum %d\n"), g_sum);
+            failures++;
+        }
+
+        /* Occupy both workers, leaving a third job pending */
+        for (i = 0; i < NUM_WORKERS; i++)
+        {
+            if (atomWorkQSubmit (&wq1, 0, block_job, NULL, &done_sem) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Submit block %d\n"), i);
+                failures++;
+            }
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if (atomWorkQSubmit (&wq1, 0, add_job, &values[0], &done_sem) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Submit pending\n"));
+            failures++;
+        }
+        atomTimerDelay (SYSTEM_TICKS_PER_SEC/10);
+        if (atomWorkQStats (&wq1, &stats) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stats\n"));
+            failures++;
+        }
+        else if ((stats.depth != 1) || (stats.num_completed != 4))
+        {
+            ATOMLOG (_STR("Pending stats %d %d\n"), (int)stats.depth,
+                (int)stats.num_completed);
+            failures++;
+        }
+
+        /* Release the workers and wait for all three jobs */
+        for (i = 0; i < NUM_WORKERS; i++)
+        {
+            (void)atomSemPut (&block_sem);
+        }
+        for (i = 0; i < NUM_WORKERS + 1; i++)
+        {
+            if (atomSemGet (&done_sem, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Done block %d\n"), i);
+                failures++;
+            }
+        }
+
+        /* Submit a job from interrupt context */
+        timer1.cb_func = testCallback;
+        timer1.cb_data = NULL;
+        timer1.cb_ticks = SYSTEM_TICKS_PER_SEC/10;
+        if (atomTimerRegister (&timer1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error registering timer\n"));
+            failures++;
+        }
+        else if (atomSemGet (&done_sem, SYSTEM_TICKS_PER_SEC) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Done ISR\n"));
+            failures++;
+        }
+        if (g_sum != 15 + 1 + 8)
+        {
+            ATOMLOG (_STR("Final sum %d\n"), g_sum);
+            failures++;
+        }
+
+        /* Check the final statistics */
+        if (atomWorkQStats (&wq1, &stats) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Stats\n"));
+            failures++;
+        }
+        else if ((stats.depth != 0) || (stats.num_submitted != 8)
+            || (stats.num_completed != 8) || (stats.max_depth < 1)
+            || (stats.max_latency < SYSTEM_TICKS_PER_SEC/10)
+            || (stats.total_latency < stats.max_latency))
+        {
+            ATOMLOG (_STR("Final stats\n"));
+            failures++;
+        }
+
+        /* Delete the pool, which waits for the workers to exit */
+        if (atomWorkQDelete (&wq1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Delete failed\n"));
+            failures++;
+        }
+        for (i = 0; i < NUM_WORKERS; i++)
+        {
+            if (atomThreadJoin (&worker_tcbs[i], -1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Worker %d running\n"), i);
+                failures++;
+            }
+        }
+
+        /**
+         * Recreate the pool with workers which preempt the submitter, so
+         * that each job is taken before atomWorkQSubmit() returns, and
+         * check the job was still counted as pending.
+         */
+        if (atomWorkQCreate (&wq1, &wq1_jobs[0], MAX_JOBS, &worker_tcbs[0],
+                &worker_stacks[0], TEST_THREAD_STACK_SIZE, NUM_WORKERS,
+                TEST_THREAD_PRIO - 1) != ATOM_OK)
+        {
+            ATOMLOG (_STR("Error creating pool 2\n"));
+            failures++;
+        }
+        else
+        {
+            if ((atomWorkQSubmit (&wq1, 0, add_job, &values[0], &done_sem) != ATOM_OK)
+                || (atomSemGet (&done_sem, SYSTEM_TICKS_PER_SEC) != ATOM_OK))
+            {
+                ATOMLOG (_STR("Preempt job\n"));
+                failures++;
+            }
+            else if ((atomWorkQStats (&wq1, &stats) != ATOM_OK)
+                || (stats.max_depth != 1))
+            {
+                ATOMLOG (_STR("Preempt max_depth %d\n"), (int)stats.max_depth);
+                failures++;
+            }
+            if (atomWorkQDelete (&wq1) != ATOM_OK)
+            {
+                ATOMLOG (_STR("Delete 2 failed\n"));
+                failures++;
+            }
+        }
+    }
+
+    /* Check thread stack usage (if enabled) */
+#ifdef ATOM_STACK_CHECKING
+    {
+        uint32_t used_bytes, free_bytes;
+
+        /* Check thread stack usage */
+        for (i = 0; i < NUM_WORKERS; i++)
+        {
+            if (atomThreadStackCheck (&worker_tcbs[i], &used_bytes, &free_bytes) != ATOM_OK)
+            {
+                ATOMLOG (_STR("StackCheck\n"));
+                failures++;
+            }
+            else
+            {
+                /* Check the thread did not use up to the end of stack */
+                if (free_bytes == 0)
+                {
+                    ATOMLOG (_STR("StackOverflow\n"));
+                    failures++;
+                }
+
+                /* Log the stack usage */
+#ifdef TESTS_LOG_STACK_USAGE
+                ATOMLOG (_STR("StackUse:%d\n"), (int)used_bytes);
+#endif
+            }
+        }
+    }
+#endif
+
+    /* Quit */
+    return failures;
+
+}
+
+
+/**
+ * \b add_job
+ *
+ * Job function which adds the value pointed to by \c arg to the result.
+ *
+ * @param[in] arg Pointer to an int
+ *
+ * @return None
+ */
+static void add_job (POINTER arg)
+{
+    CRITICAL_STORE;
+
+    /* Workers may be preempted by each other, so protect the update */
+    CRITICAL_START ();
+    g_sum += *(int *)arg;
+    CRITICAL_END ();
+}
+
+
+/**
+ * \b block_job
+ *
+ * Job function which occupies its worker until \c block_sem is put.
+ *
+ * @param[in] arg Unused
+ *
+ * @return None
+ */
+static void block_job (POINTER arg)
+{
+    /* Compiler warnings */
+    arg = arg;
+
+    /* Wait to be released by the main test thread */
+    (void)atomSemGet (&block_sem, 0);
+}
+
+
+/**
+ * \b testCallback
+ *
+ * Submits an add_job for values[3] to wq1 from interrupt context with a
+ * timeout of -1, as an ISR handing off lengthy processing would. The job
+ * should be queued without blocking and run by a worker, which puts
+ * done_sem for the waiting test thread.
+ *
+ * @param[in] cb_data Unused
+ *
+ * @return None
+ */
+static void testCallback (POINTER cb_data)
+{
+    /* Compiler warnings */
+    cb_data = cb_data;
+
+    /* Hand the work off to the pool */
+    (void)atomWorkQSubmit (&wq1, -1, add_job, &values[3], &done_sem);
+}